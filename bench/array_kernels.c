@@ -0,0 +1,188 @@
+// Vector array builtins against the loops they replace.
+//
+//   make bench && ./bin/bench_array_kernels [elements] [repeats]
+//
+// The first table runs Hunick scripts: a for loop that adds up a [float]
+// (or multiplies two) element by element, then sum and dot on the same
+// arrays. The loop makes a float per element, and the heap keeps them all
+// until its VM is freed, so every repeat runs in a fresh VM; at the default
+// size the whole bench peaks around 300 MB, and that grows with the size.
+// The second calls every kernel directly on C buffers at each instruction
+// set level the processor supports and reports billions of elements per
+// second.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hunick.h"
+#include "simd.h"
+
+typedef struct ScriptCase {
+    const char* name;
+    const char* loop;
+    const char* builtin;
+} ScriptCase;
+
+// The loops are defined once, with the arrays, by the setup script below.
+static const ScriptCase script_cases[] = {
+    { "sum", "loop_sum()\n", "sum(xs)\n" },
+    { "dot", "loop_dot()\n", "dot(xs, ys)\n" },
+};
+
+#define SCRIPT_CASE_COUNT (int)(sizeof(script_cases) / sizeof(script_cases[0]))
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Seconds per run of source, which must end in a float, in a VM that
+// has run setup and nothing else.
+static double time_script(const char* setup, const char* source, int repeats, double* result, int* failed) {
+    double elapsed = 0;
+    for (int i = 0; i < repeats && !*failed; i++) {
+        HunickVM* vm = hunick_vm_new();
+        HunickStatus status = hunick_vm_run(vm, setup, strlen(setup));
+        if (status == HUNICK_OK) {
+            double start = now_seconds();
+            status = hunick_vm_run(vm, source, strlen(source));
+            elapsed += now_seconds() - start;
+        }
+        if (status == HUNICK_OK) {
+            HunickValue value = hunick_vm_result(vm);
+            if (value.type != HUNICK_FLOAT) *failed = 1;
+            *result = value.number;
+        } else {
+            fputs(hunick_vm_error(vm), stderr);
+            *failed = 1;
+        }
+        hunick_vm_free(vm);
+    }
+    return elapsed / repeats;
+}
+
+static void run_scripts(int64_t elements, int repeats, int* failed) {
+    char setup[1024];
+
+    // Small integers in floats, so every summation order gives the same
+    // result.
+    snprintf(setup, sizeof(setup),
+             "let mut xs: [float] = []\nlet mut ys: [float] = []\nlet mut v = 0.0\n"
+             "for i in 0..%lld { push(xs, v)\npush(ys, 2.0 - v)\nv = if (v < 8.0) { v + 1.0 } else { 0.0 } }\n"
+             "func loop_sum() -> float {\n"
+             "    let mut total = 0.0\n"
+             "    for i in 0..len(xs) { total = total + xs[i] }\n"
+             "    total\n"
+             "}\n"
+             "func loop_dot() -> float {\n"
+             "    let mut total = 0.0\n"
+             "    for i in 0..len(xs) { total = total + xs[i] * ys[i] }\n"
+             "    total\n"
+             "}\n",
+             (long long)elements);
+
+    printf("%8s %14s %14s %10s\n", "script", "loop ms", "builtin ms", "speedup");
+    for (int i = 0; i < SCRIPT_CASE_COUNT; i++) {
+        double loop_result, builtin_result;
+        double loop = time_script(setup, script_cases[i].loop, repeats, &loop_result, failed);
+        double builtin = time_script(setup, script_cases[i].builtin, repeats, &builtin_result, failed);
+        if (loop_result != builtin_result) *failed = 1;
+        printf("%8s %14.3f %14.3f %9.1fx\n", script_cases[i].name, loop * 1e3, builtin * 1e3, loop / builtin);
+    }
+}
+
+// Keeps the compiler from dropping kernel calls whose result is unused.
+static volatile double sink;
+
+static double time_kernel(int kernel, double* fa, double* fb, double* fout,
+                          int64_t* ia, int64_t* ib, int64_t* iout, int64_t n, int repeats) {
+    double start = now_seconds();
+    for (int r = 0; r < repeats; r++) {
+        switch (kernel) {
+            case 0: sink += simd_sum_f64(fa, n); break;
+            case 1: sink += simd_dot_f64(fa, fb, n); break;
+            case 2: simd_add_f64(fout, fa, fb, n); sink += fout[n - 1]; break;
+            case 3: simd_scale_f64(fout, fa, 1.5, n); sink += fout[n - 1]; break;
+            case 4: sink += simd_min_f64(fa, n); break;
+            case 5: sink += simd_max_f64(fa, n); break;
+            case 6: sink += simd_argmax_f64(fa, n); break;
+            case 7: sink += simd_sum_i64(ia, n); break;
+            case 8: sink += simd_dot_i64(ia, ib, n); break;
+            case 9: simd_add_i64(iout, ia, ib, n); sink += iout[n - 1]; break;
+            case 10: simd_scale_i64(iout, ia, 3, n); sink += iout[n - 1]; break;
+            case 11: sink += simd_min_i64(ia, n); break;
+            case 12: sink += simd_max_i64(ia, n); break;
+            default: sink += simd_argmax_i64(ia, n); break;
+        }
+    }
+    return (now_seconds() - start) / repeats;
+}
+
+static const char* kernel_names[] = {
+    "sum f64", "dot f64", "add f64", "scale f64", "min f64", "max f64", "argmax f64",
+    "sum i64", "dot i64", "add i64", "scale i64", "min i64", "max i64", "argmax i64",
+};
+
+#define KERNEL_COUNT (int)(sizeof(kernel_names) / sizeof(kernel_names[0]))
+
+static void run_kernels(int64_t elements, int repeats) {
+    double* fa = malloc(sizeof(double) * elements);
+    double* fb = malloc(sizeof(double) * elements);
+    double* fout = malloc(sizeof(double) * elements);
+    int64_t* ia = malloc(sizeof(int64_t) * elements);
+    int64_t* ib = malloc(sizeof(int64_t) * elements);
+    int64_t* iout = malloc(sizeof(int64_t) * elements);
+    for (int64_t i = 0; i < elements; i++) {
+        fa[i] = (double)((i * 7919) % 1000);
+        fb[i] = (double)(i % 13);
+        ia[i] = (i * 7919) % 1000;
+        ib[i] = i % 13;
+    }
+
+    SimdLevel best = simd_level();
+    printf("\n%10s", "Gelem/s");
+    for (int level = SIMD_SCALAR; level <= (int)best; level++) printf(" %10s", simd_level_name(level));
+    printf("\n");
+
+    for (int kernel = 0; kernel < KERNEL_COUNT; kernel++) {
+        printf("%10s", kernel_names[kernel]);
+        for (int level = SIMD_SCALAR; level <= (int)best; level++) {
+            simd_set_level(level);
+            double seconds = time_kernel(kernel, fa, fb, fout, ia, ib, iout, elements, repeats);
+            printf(" %10.2f", elements / seconds / 1e9);
+        }
+        printf("\n");
+    }
+    simd_set_level(best);
+
+    free(fa);
+    free(fb);
+    free(fout);
+    free(ia);
+    free(ib);
+    free(iout);
+}
+
+int main(int argc, char* argv[]) {
+    int64_t elements = argc > 1 ? atoll(argv[1]) : 250000;
+    int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    if (elements <= 0) elements = 1;
+    if (repeats <= 0) repeats = 1;
+
+    printf("%lld elements, %d repeats, widest kernels: %s\n\n",
+           (long long)elements, repeats, simd_level_name(simd_level()));
+
+    int failed = 0;
+    run_scripts(elements, repeats, &failed);
+    run_kernels(elements, repeats * 10);
+
+    if (failed) {
+        fprintf(stderr, "a builtin disagreed with its loop\n");
+        return 1;
+    }
+    return 0;
+}
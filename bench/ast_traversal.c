@@ -0,0 +1,215 @@
+// Compares the pointer-based AST with the flattened FlatAst layout.
+//
+//   make bench && ./bin/bench_ast_traversal [function_count]
+//
+// A synthetic program is parsed and analyzed once, then the same work is
+// timed on both layouts: a recursive walk summing integer literals, a
+// linear scan (only possible on the flat arrays) and full evaluation.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lexer.h"
+#include "parser.h"
+#include "semantic.h"
+#include "evaluator.h"
+#include "flatast.h"
+
+#define WALK_ROUNDS 50
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* generate_source(int function_count) {
+    size_t capacity = (size_t)function_count * 160 + 256;
+    char* source = malloc(capacity);
+    size_t length = 0;
+
+    for (int i = 0; i < function_count; i++) {
+        length += snprintf(source + length, capacity - length,
+                           "func f%d(x: int) -> int { let a = x * %d + 3; if (a > 10) { a - %d } else { a + 1 } }\n",
+                           i, i % 7 + 1, i % 5);
+    }
+    length += snprintf(source + length, capacity - length,
+                       "func fib(n: int) -> int { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }\n"
+                       "fib(22) + f1(4)\n");
+    return source;
+}
+
+static int64_t walk_statement(Statement* stmt);
+
+static int64_t walk_expression(Expression* expr) {
+    if (!expr) return 0;
+
+    int64_t sum = 0;
+    switch (expr->node_type) {
+        case EXPR_INTEGER_LITERAL:
+            return expr->data.integer_literal.value;
+        case EXPR_FUNCTION_LITERAL:
+            for (int i = 0; i < expr->data.function_literal.body_count; i++) {
+                sum += walk_statement(expr->data.function_literal.body[i]);
+            }
+            return sum;
+        case EXPR_CALL:
+            sum = walk_expression(expr->data.call.function);
+            for (int i = 0; i < expr->data.call.argument_count; i++) {
+                sum += walk_expression(expr->data.call.arguments[i]);
+            }
+            return sum;
+        case EXPR_INFIX:
+            return walk_expression(expr->data.infix.left) + walk_expression(expr->data.infix.right);
+        case EXPR_PREFIX:
+            return walk_expression(expr->data.prefix.right);
+        case EXPR_IF:
+            sum = walk_expression(expr->data.if_expr.condition);
+            for (int i = 0; i < expr->data.if_expr.then_count; i++) {
+                sum += walk_statement(expr->data.if_expr.then_branch[i]);
+            }
+            for (int i = 0; i < expr->data.if_expr.else_count; i++) {
+                sum += walk_statement(expr->data.if_expr.else_branch[i]);
+            }
+            return sum;
+        default:
+            return 0;
+    }
+}
+
+static int64_t walk_statement(Statement* stmt) {
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            return walk_expression(stmt->data.let_stmt.value);
+        case STMT_RETURN:
+            return walk_expression(stmt->data.return_stmt.return_value);
+        case STMT_EXPRESSION:
+            return walk_expression(stmt->data.expression_stmt.expression);
+        default:
+            return 0;
+    }
+}
+
+static int64_t walk_flat(const FlatAst* ast, FlatRef ref) {
+    if (ref == FLAT_NONE) return 0;
+
+    int64_t sum = 0;
+    switch (ast->kinds[ref]) {
+        case EXPR_INTEGER_LITERAL:
+            return ast->integers[ast->a[ref]];
+        case EXPR_FUNCTION_LITERAL:
+            return walk_flat(ast, ast->functions[ast->a[ref]].body);
+        case EXPR_CALL:
+            sum = walk_flat(ast, ast->a[ref]);
+            for (uint32_t i = 0; i < ast->c[ref]; i++) {
+                sum += walk_flat(ast, flat_child(ast, ast->b[ref], i));
+            }
+            return sum;
+        case EXPR_INFIX:
+            return walk_flat(ast, ast->a[ref]) + walk_flat(ast, ast->c[ref]);
+        case EXPR_PREFIX:
+            return walk_flat(ast, ast->b[ref]);
+        case EXPR_IF:
+            return walk_flat(ast, ast->a[ref]) + walk_flat(ast, ast->b[ref]) + walk_flat(ast, ast->c[ref]);
+        case STMT_LET:
+            return walk_flat(ast, ast->b[ref]);
+        case STMT_RETURN:
+        case STMT_EXPRESSION:
+            return walk_flat(ast, ast->a[ref]);
+        case STMT_BLOCK:
+            for (uint32_t i = 0; i < ast->b[ref]; i++) {
+                sum += walk_flat(ast, flat_child(ast, ast->a[ref], i));
+            }
+            return sum;
+        default:
+            return 0;
+    }
+}
+
+static int64_t scan_flat(const FlatAst* ast) {
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < ast->node_count; i++) {
+        if (ast->kinds[i] == EXPR_INTEGER_LITERAL) sum += ast->integers[ast->a[i]];
+    }
+    return sum;
+}
+
+int main(int argc, char* argv[]) {
+    int function_count = argc > 1 ? atoi(argv[1]) : 20000;
+    char* source = generate_source(function_count);
+
+    Lexer* lexer = lexer_new(source);
+    Parser* parser = parser_new(lexer);
+    Program* program = parser_parse_program(parser);
+    if (parser->error_count > 0) {
+        parser_print_errors(parser);
+        return 1;
+    }
+
+    SemanticAnalyzer* analyzer = semantic_analyzer_new();
+    if (!semantic_analyze_program(analyzer, program)) {
+        semantic_print_errors(analyzer);
+        return 1;
+    }
+
+    double start = now_seconds();
+    FlatAst* flat = flat_ast_from_program(program);
+    double flatten_time = now_seconds() - start;
+
+    printf("%d functions, %u flat nodes, flattened in %.2f ms\n",
+           function_count, flat->node_count, flatten_time * 1e3);
+
+    int64_t tree_sum = 0;
+    start = now_seconds();
+    for (int round = 0; round < WALK_ROUNDS; round++) {
+        for (int i = 0; i < program->statement_count; i++) {
+            tree_sum += walk_statement(program->statements[i]);
+        }
+    }
+    double tree_time = now_seconds() - start;
+
+    int64_t flat_sum = 0;
+    start = now_seconds();
+    for (int round = 0; round < WALK_ROUNDS; round++) {
+        flat_sum += walk_flat(flat, flat->root);
+    }
+    double flat_time = now_seconds() - start;
+
+    int64_t scan_sum = 0;
+    start = now_seconds();
+    for (int round = 0; round < WALK_ROUNDS; round++) {
+        scan_sum += scan_flat(flat);
+    }
+    double scan_time = now_seconds() - start;
+
+    printf("recursive walk, pointer tree: %8.2f ms (sum %lld)\n", tree_time * 1e3, (long long)tree_sum);
+    printf("recursive walk, flat arrays:  %8.2f ms (sum %lld)\n", flat_time * 1e3, (long long)flat_sum);
+    printf("linear scan,    flat arrays:  %8.2f ms (sum %lld)\n", scan_time * 1e3, (long long)scan_sum);
+
+    Environment* env = environment_new();
+    start = now_seconds();
+    Object* tree_result = eval_program(program, env);
+    double tree_eval_time = now_seconds() - start;
+    environment_free(env);
+
+    env = environment_new();
+    start = now_seconds();
+    Object* flat_result = flat_eval_program(flat, env);
+    double flat_eval_time = now_seconds() - start;
+    environment_free(env);
+
+    printf("evaluate, pointer tree:       %8.2f ms (=> %lld)\n", tree_eval_time * 1e3,
+           (long long)(tree_result ? tree_result->value.integer : 0));
+    printf("evaluate, flat arrays:        %8.2f ms (=> %lld)\n", flat_eval_time * 1e3,
+           (long long)(flat_result ? flat_result->value.integer : 0));
+
+    flat_ast_free(flat);
+    semantic_analyzer_free(analyzer);
+    program_free(program);
+    parser_free(parser);
+    free(source);
+    return 0;
+}
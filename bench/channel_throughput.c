@@ -0,0 +1,177 @@
+// Channel throughput with 1, 2, 4, ... producer/consumer pairs.
+//
+//   make bench && ./bin/bench_channel_throughput [max_pairs] [items_per_producer]
+//
+// All pairs share one channel, so every producer contends with every other
+// producer (and consumers with consumers) on the same queue. Each row runs
+// the bounded ring, the unbounded linked queue and, as a baseline, a ring
+// guarded by a mutex and two condition variables, and reports millions of
+// items moved per second.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "channel.h"
+#include "parallel.h"
+#include "vm.h"
+
+#define BOUNDED_CAPACITY 1024
+
+typedef struct LockedQueue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+    void** items;
+    int64_t capacity;
+    int64_t head;
+    int64_t count;
+} LockedQueue;
+
+typedef struct Endpoint {
+    HunickVM* vm;
+    Channel* channel;      // NULL for the locked baseline
+    LockedQueue* locked;
+    int64_t items;
+    uint64_t sum;
+} Endpoint;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void locked_send(LockedQueue* queue, void* item) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->capacity) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    queue->items[(queue->head + queue->count) % queue->capacity] = item;
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+static void* locked_recv(LockedQueue* queue) {
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    void* item = queue->items[queue->head];
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return item;
+}
+
+// Items are 1..n so none of them is NULL.
+static void* produce(void* arg) {
+    Endpoint* endpoint = arg;
+    vm_bind(endpoint->vm);
+    for (int64_t i = 1; i <= endpoint->items; i++) {
+        if (endpoint->channel) {
+            channel_send(endpoint->channel, (void*)(uintptr_t)i);
+        } else {
+            locked_send(endpoint->locked, (void*)(uintptr_t)i);
+        }
+    }
+    return NULL;
+}
+
+static void* consume(void* arg) {
+    Endpoint* endpoint = arg;
+    vm_bind(endpoint->vm);
+    for (int64_t i = 0; i < endpoint->items; i++) {
+        void* item = endpoint->channel ? channel_recv(endpoint->channel) : locked_recv(endpoint->locked);
+        endpoint->sum += (uintptr_t)item;
+    }
+    return NULL;
+}
+
+// Seconds taken by `pairs` producers and consumers to move `items` items
+// each through one channel (capacity 0 for unbounded, -1 for the locked
+// baseline).
+static double measure(HunickVM* vm, int pairs, int64_t items, int64_t capacity, int* failed) {
+    Channel* channel = NULL;
+    LockedQueue locked;
+
+    if (capacity >= 0) {
+        HunickVM* previous = vm_bind(vm);
+        channel = channel_new(capacity);
+        vm_bind(previous);
+    } else {
+        pthread_mutex_init(&locked.lock, NULL);
+        pthread_cond_init(&locked.not_full, NULL);
+        pthread_cond_init(&locked.not_empty, NULL);
+        locked.capacity = BOUNDED_CAPACITY;
+        locked.items = malloc(sizeof(void*) * locked.capacity);
+        locked.head = 0;
+        locked.count = 0;
+    }
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * pairs * 2);
+    Endpoint* endpoints = calloc(pairs * 2, sizeof(Endpoint));
+
+    double start = now_seconds();
+    for (int i = 0; i < pairs * 2; i++) {
+        endpoints[i].vm = vm;
+        endpoints[i].channel = channel;
+        endpoints[i].locked = &locked;
+        endpoints[i].items = items;
+        pthread_create(&threads[i], NULL, i % 2 ? consume : produce, &endpoints[i]);
+    }
+    uint64_t sum = 0;
+    for (int i = 0; i < pairs * 2; i++) {
+        pthread_join(threads[i], NULL);
+        sum += endpoints[i].sum;
+    }
+    double elapsed = now_seconds() - start;
+
+    if (sum != (uint64_t)pairs * (uint64_t)items * (uint64_t)(items + 1) / 2) *failed = 1;
+
+    if (capacity < 0) {
+        pthread_mutex_destroy(&locked.lock);
+        pthread_cond_destroy(&locked.not_full);
+        pthread_cond_destroy(&locked.not_empty);
+        free(locked.items);
+    }
+    free(threads);
+    free(endpoints);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int max_pairs = argc > 1 ? atoi(argv[1]) : parallel_cpu_count();
+    int64_t items = argc > 2 ? atoll(argv[2]) : 200000;
+    if (max_pairs <= 0) max_pairs = 1;
+    if (items <= 0) items = 1;
+
+    // Unbounded nodes come from this VM's heap.
+    HunickVM* vm = hunick_vm_new();
+
+    printf("%lld items per producer, bounded capacity %d, %d processors\n\n",
+           (long long)items, BOUNDED_CAPACITY, parallel_cpu_count());
+    printf("%8s %16s %16s %16s\n", "pairs", "bounded Mitem/s", "linked Mitem/s", "mutex Mitem/s");
+
+    int failed = 0;
+    for (int pairs = 1;; pairs *= 2) {
+        if (pairs > max_pairs) pairs = max_pairs;
+        double moved = (double)pairs * items / 1e6;
+        double bounded = measure(vm, pairs, items, BOUNDED_CAPACITY, &failed);
+        double linked = measure(vm, pairs, items, 0, &failed);
+        double mutex = measure(vm, pairs, items, -1, &failed);
+        printf("%8d %16.2f %16.2f %16.2f\n", pairs, moved / bounded, moved / linked, moved / mutex);
+        if (pairs == max_pairs) break;
+    }
+
+    hunick_vm_free(vm);
+    if (failed) {
+        fprintf(stderr, "a consumer received the wrong items\n");
+        return 1;
+    }
+    return 0;
+}
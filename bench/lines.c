@@ -0,0 +1,150 @@
+// lines(path) against C line readers over the same file.
+//
+//   make bench && ./bin/bench_lines [megabytes] [path]
+//
+// Writes a log-like file of the given size (default 256 MB, at path or
+// under /tmp), reads it once to have it in the page cache, and then times
+// each reader over it, reporting GB/s and the number of lines as a check:
+//
+//   memchr    the newline search alone, the most any reader can do
+//   getline   stdio's getline into one reused buffer
+//   lines     a Hunick loop counting the lines and adding up their lengths
+//   pipeline  the same over `lines(path) |> filter(...)`, keeping the
+//             lines that start with "ERROR"
+//
+// The file is removed afterwards.
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hunick.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char* levels[] = { "INFO", "DEBUG", "WARN", "ERROR" };
+
+// Lines of 40 to 160 bytes, a quarter of them errors.
+static int64_t write_file(const char* path, int64_t bytes) {
+    FILE* file = fopen(path, "w");
+    if (!file) return -1;
+
+    int64_t written = 0, lines = 0;
+    uint64_t state = 88172645463325252ULL;
+    while (written < bytes) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        int padding = (int)(state % 120);
+        written += fprintf(file, "%s 2024-01-01T00:00:%02d request %llu took %d ms %.*s\n",
+                           levels[state >> 62], (int)(state % 60), (unsigned long long)(state >> 20 & 0xffffff),
+                           (int)(state >> 8 & 0x3ff), padding,
+                           "................................................................"
+                           "................................................................");
+        lines++;
+    }
+    fclose(file);
+    return lines;
+}
+
+static int64_t count_memchr(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    fstat(fd, &st);
+    const char* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    int64_t lines = 0;
+    const char* end = data + st.st_size;
+    for (const char* p = data; p < end; lines++) {
+        const char* newline = memchr(p, '\n', end - p);
+        p = newline ? newline + 1 : end;
+    }
+    munmap((void*)data, st.st_size);
+    return lines;
+}
+
+static int64_t count_getline(const char* path) {
+    FILE* file = fopen(path, "r");
+    char* line = NULL;
+    size_t capacity = 0;
+    int64_t lines = 0;
+    while (getline(&line, &capacity, file) >= 0) lines++;
+    free(line);
+    fclose(file);
+    return lines;
+}
+
+static int64_t count_script(const char* source) {
+    HunickVM* vm = hunick_vm_new();
+    int64_t lines = -1;
+    if (hunick_vm_run(vm, source, strlen(source)) == HUNICK_OK) {
+        HunickValue value = hunick_vm_result(vm);
+        if (value.type == HUNICK_INT) lines = value.integer;
+    } else {
+        fputs(hunick_vm_error(vm), stderr);
+    }
+    hunick_vm_free(vm);
+    return lines;
+}
+
+int main(int argc, char* argv[]) {
+    int64_t megabytes = argc > 1 ? atoll(argv[1]) : 256;
+    const char* path = argc > 2 ? argv[2] : "/tmp/hunick_bench_lines.log";
+    if (megabytes <= 0) megabytes = 1;
+
+    int64_t expected = write_file(path, megabytes << 20);
+    if (expected < 0) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    struct stat st;
+    stat(path, &st);
+    count_memchr(path);
+
+    char lines_script[512], pipeline_script[512];
+    snprintf(lines_script, sizeof(lines_script),
+             "let mut count = 0\nlet mut bytes = 0\n"
+             "for line in lines(\"%s\") { count = count + 1\nbytes = bytes + len(line) }\ncount\n", path);
+    snprintf(pipeline_script, sizeof(pipeline_script),
+             "func is_error(line: string) -> bool { len(line) > 5 && line > \"ERROR\" && line < \"ERROS\" }\n"
+             "let mut count = 0\n"
+             "for line in lines(\"%s\") |> filter(is_error) { count = count + 1 }\ncount\n", path);
+
+    printf("%.1f MB, %lld lines\n\n", st.st_size / 1e6, (long long)expected);
+    printf("%10s %10s %12s\n", "reader", "GB/s", "lines");
+
+    int failed = 0;
+    for (int reader = 0; reader < 4; reader++) {
+        double start = now_seconds();
+        int64_t lines;
+        switch (reader) {
+            case 0: lines = count_memchr(path); break;
+            case 1: lines = count_getline(path); break;
+            case 2: lines = count_script(lines_script); break;
+            default: lines = count_script(pipeline_script); break;
+        }
+        double seconds = now_seconds() - start;
+        static const char* names[] = { "memchr", "getline", "lines", "pipeline" };
+        printf("%10s %10.2f %12lld\n", names[reader], st.st_size / seconds / 1e9, (long long)lines);
+        if (reader < 3 ? lines != expected : lines <= 0) failed = 1;
+    }
+
+    unlink(path);
+    if (failed) {
+        fprintf(stderr, "a reader miscounted the lines\n");
+        return 1;
+    }
+    return 0;
+}
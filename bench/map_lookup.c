@@ -0,0 +1,284 @@
+// map<K, V> against a chained hash table, for int and string keys.
+//
+//   make bench && ./bin/bench_map_lookup [keys] [repeats]
+//
+// Each row inserts every key into an empty table, looks every key up,
+// looks up as many keys that are not there, and deletes every key, and
+// reports millions of operations per second. The chained table is the
+// usual baseline: a power-of-two bucket array of malloc'd nodes, grown at
+// load factor 1, with the same hash functions as map.c. Lookups and
+// deletes visit the keys in another order than they were inserted in, or
+// the chained nodes, allocated one after another, would be read in
+// sequence. String lookups use fresh copies of the keys, so neither table
+// can match on the pointer; the "hit, same string" row passes the stored
+// pointers to show that path.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hunick.h"
+#include "map.h"
+#include "vm.h"
+
+typedef struct ChainNode {
+    uint64_t hash;
+    Object* key;
+    Object* value;
+    struct ChainNode* next;
+} ChainNode;
+
+typedef struct ChainTable {
+    ChainNode** buckets;
+    int64_t bucket_count;
+    int64_t size;
+} ChainTable;
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t chain_hash(Object* key) {
+    if (key->type != OBJ_STRING) return mix((uint64_t)key->value.integer);
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* c = (const unsigned char*)string_chars(&key->value.string); *c; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ULL;
+    }
+    return mix(hash);
+}
+
+static int chain_equal(Object* a, Object* b) {
+    if (a->type == OBJ_STRING) return strcmp(string_chars(&a->value.string), string_chars(&b->value.string)) == 0;
+    return a->value.integer == b->value.integer;
+}
+
+static void chain_init(ChainTable* table) {
+    table->bucket_count = 16;
+    table->size = 0;
+    table->buckets = calloc(table->bucket_count, sizeof(ChainNode*));
+}
+
+static ChainNode** chain_find(ChainTable* table, Object* key, uint64_t hash) {
+    ChainNode** link = &table->buckets[hash & (table->bucket_count - 1)];
+    while (*link && ((*link)->hash != hash || !chain_equal((*link)->key, key))) link = &(*link)->next;
+    return link;
+}
+
+static void chain_set(ChainTable* table, Object* key, Object* value) {
+    uint64_t hash = chain_hash(key);
+    ChainNode** link = chain_find(table, key, hash);
+    if (*link) {
+        (*link)->value = value;
+        return;
+    }
+
+    ChainNode* node = malloc(sizeof(ChainNode));
+    node->hash = hash;
+    node->key = key;
+    node->value = value;
+    node->next = NULL;
+    *link = node;
+
+    if (++table->size > table->bucket_count) {
+        int64_t count = table->bucket_count * 2;
+        ChainNode** buckets = calloc(count, sizeof(ChainNode*));
+        for (int64_t i = 0; i < table->bucket_count; i++) {
+            ChainNode* next;
+            for (ChainNode* n = table->buckets[i]; n; n = next) {
+                next = n->next;
+                n->next = buckets[n->hash & (count - 1)];
+                buckets[n->hash & (count - 1)] = n;
+            }
+        }
+        free(table->buckets);
+        table->buckets = buckets;
+        table->bucket_count = count;
+    }
+}
+
+static Object* chain_get(ChainTable* table, Object* key) {
+    ChainNode* node = *chain_find(table, key, chain_hash(key));
+    return node ? node->value : NULL;
+}
+
+static int chain_delete(ChainTable* table, Object* key) {
+    ChainNode** link = chain_find(table, key, chain_hash(key));
+    ChainNode* node = *link;
+    if (!node) return 0;
+    *link = node->next;
+    free(node);
+    table->size--;
+    return 1;
+}
+
+static void chain_free(ChainTable* table) {
+    for (int64_t i = 0; i < table->bucket_count; i++) {
+        ChainNode* next;
+        for (ChainNode* n = table->buckets[i]; n; n = next) {
+            next = n->next;
+            free(n);
+        }
+    }
+    free(table->buckets);
+}
+
+typedef enum {
+    OP_INSERT,
+    OP_HIT,
+    OP_HIT_SAME,
+    OP_MISS,
+    OP_DELETE
+} Operation;
+
+static const char* operation_names[] = { "insert", "hit", "hit, same string", "miss", "delete" };
+
+// The keys to insert, the same keys in another order, equal copies in
+// that order, and keys that are never inserted.
+typedef struct KeySet {
+    Object** stored;
+    Object** shuffled;
+    Object** copies;
+    Object** missing;
+    int64_t count;
+} KeySet;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Shuffled, so neither table sees keys in the order they hash.
+static int64_t key_number(int64_t i) {
+    return (int64_t)(mix((uint64_t)i) >> 2);
+}
+
+static Object* make_key(int is_string, int64_t number) {
+    if (!is_string) return object_new_integer(number);
+    char text[32];
+    snprintf(text, sizeof(text), "key-%lld", (long long)number);
+    return object_new_string(text);
+}
+
+static void make_keys(KeySet* keys, int is_string, int64_t count) {
+    keys->count = count;
+    keys->stored = malloc(sizeof(Object*) * count);
+    keys->shuffled = malloc(sizeof(Object*) * count);
+    keys->copies = malloc(sizeof(Object*) * count);
+    keys->missing = malloc(sizeof(Object*) * count);
+    for (int64_t i = 0; i < count; i++) {
+        keys->stored[i] = make_key(is_string, key_number(i));
+        keys->shuffled[i] = keys->stored[i];
+        keys->missing[i] = make_key(is_string, key_number(i + count));
+    }
+    for (int64_t i = count - 1; i > 0; i--) {
+        int64_t j = (int64_t)(mix((uint64_t)i ^ 0x9e3779b97f4a7c15ULL) % (uint64_t)(i + 1));
+        Object* key = keys->shuffled[i];
+        keys->shuffled[i] = keys->shuffled[j];
+        keys->shuffled[j] = key;
+    }
+    for (int64_t i = 0; i < count; i++) {
+        keys->copies[i] = is_string ? object_new_string(string_chars(&keys->shuffled[i]->value.string)) : object_new_integer(keys->shuffled[i]->value.integer);
+    }
+}
+
+// Runs op over all keys and returns the seconds it took; *checked counts
+// the results, which must be count for every operation but a miss.
+static double run_map(Map* map, const KeySet* keys, Operation op, Object* value, int64_t* checked) {
+    double start = now_seconds();
+    for (int64_t i = 0; i < keys->count; i++) {
+        switch (op) {
+            case OP_INSERT: map_set(map, keys->stored[i], value); (*checked)++; break;
+            case OP_HIT: *checked += map_get(map, keys->copies[i]) != NULL; break;
+            case OP_HIT_SAME: *checked += map_get(map, keys->shuffled[i]) != NULL; break;
+            case OP_MISS: *checked += map_get(map, keys->missing[i]) != NULL; break;
+            case OP_DELETE: *checked += map_delete(map, keys->copies[i]); break;
+        }
+    }
+    return now_seconds() - start;
+}
+
+static double run_chain(ChainTable* table, const KeySet* keys, Operation op, Object* value, int64_t* checked) {
+    double start = now_seconds();
+    for (int64_t i = 0; i < keys->count; i++) {
+        switch (op) {
+            case OP_INSERT: chain_set(table, keys->stored[i], value); (*checked)++; break;
+            case OP_HIT: *checked += chain_get(table, keys->copies[i]) != NULL; break;
+            case OP_HIT_SAME: *checked += chain_get(table, keys->shuffled[i]) != NULL; break;
+            case OP_MISS: *checked += chain_get(table, keys->missing[i]) != NULL; break;
+            case OP_DELETE: *checked += chain_delete(table, keys->copies[i]); break;
+        }
+    }
+    return now_seconds() - start;
+}
+
+static void run_keys(const char* kind, int is_string, int64_t count, int repeats, int* failed) {
+    KeySet keys;
+    make_keys(&keys, is_string, count);
+    Object* value = object_new_integer(1);
+    double map_seconds[5] = { 0 };
+    double chain_seconds[5] = { 0 };
+
+    for (int r = 0; r < repeats; r++) {
+        Map* map = map_new(0);
+        ChainTable table;
+        chain_init(&table);
+        for (int op = OP_INSERT; op <= OP_DELETE; op++) {
+            if (op == OP_HIT_SAME && !is_string) continue;
+            int64_t map_checked = 0, chain_checked = 0;
+            map_seconds[op] += run_map(map, &keys, op, value, &map_checked);
+            chain_seconds[op] += run_chain(&table, &keys, op, value, &chain_checked);
+            int64_t expected = op == OP_MISS ? 0 : count;
+            if (map_checked != expected || chain_checked != expected) *failed = 1;
+        }
+        if (map->size != 0 || table.size != 0) *failed = 1;
+        chain_free(&table);
+    }
+
+    for (int op = OP_INSERT; op <= OP_DELETE; op++) {
+        if (op == OP_HIT_SAME && !is_string) continue;
+        double map_rate = count * repeats / map_seconds[op] / 1e6;
+        double chain_rate = count * repeats / chain_seconds[op] / 1e6;
+        printf("%7s %-17s %12.1f %12.1f %9.2fx\n", kind, operation_names[op], map_rate, chain_rate, map_rate / chain_rate);
+    }
+
+    free(keys.stored);
+    free(keys.shuffled);
+    free(keys.copies);
+    free(keys.missing);
+}
+
+int main(int argc, char* argv[]) {
+    int64_t count = argc > 1 ? atoll(argv[1]) : 1000000;
+    int repeats = argc > 2 ? atoi(argv[2]) : 5;
+    if (count <= 0) count = 1;
+    if (repeats <= 0) repeats = 1;
+
+    // Keys and map slots come from this VM's heap.
+    HunickVM* vm = hunick_vm_new();
+    HunickVM* previous = vm_bind(vm);
+
+    printf("%lld keys, %d repeats, Mops/s\n\n", (long long)count, repeats);
+    printf("%7s %-17s %12s %12s %10s\n", "keys", "operation", "map", "chained", "speedup");
+
+    int failed = 0;
+    run_keys("int", 0, count, repeats, &failed);
+    run_keys("string", 1, count, repeats, &failed);
+
+    vm_bind(previous);
+    hunick_vm_free(vm);
+
+    if (failed) {
+        fprintf(stderr, "a table lost or invented a key\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+// A 100-arm match against the if chain it replaces.
+//
+//   make bench && ./bin/bench_match [calls] [arms]
+//
+// Each row calls a Hunick function that picks one of the arms for every
+// value in turn, once written as a match and once as a chain of ifs that
+// return early, under both evaluators. The match finds its arm in a table,
+// so it costs about the same whichever arm is taken; the chain tests half
+// the arms on average. Three kinds of pattern:
+//
+//   dense    0 .. arms-1, a jump table
+//   sparse   multiples of 1000, a binary search
+//   string   "key0" .. "key<arms-1>", the hashed strings
+//
+// Both versions must add up to the same total.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hunick.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+typedef enum { KIND_DENSE, KIND_SPARSE, KIND_STRING } PatternKind;
+
+static void pattern_text(PatternKind kind, int arm, char* out, size_t size) {
+    switch (kind) {
+        case KIND_DENSE: snprintf(out, size, "%d", arm); break;
+        case KIND_SPARSE: snprintf(out, size, "%d", arm * 1000); break;
+        default: snprintf(out, size, "\"key%d\"", arm); break;
+    }
+}
+
+// `pick` as a match or as an if chain, then a loop over every arm's value.
+static char* build_script(PatternKind kind, int use_match, int arms, int64_t calls) {
+    size_t size = (size_t)arms * 96 + 1024;
+    char* source = malloc(size);
+    char pattern[32];
+    size_t used = snprintf(source, size, "func pick(v: %s) -> int {\n", kind == KIND_STRING ? "string" : "int");
+
+    if (use_match) used += snprintf(source + used, size - used, "    match (v) {\n");
+    for (int arm = 0; arm < arms; arm++) {
+        pattern_text(kind, arm, pattern, sizeof(pattern));
+        used += snprintf(source + used, size - used,
+                         use_match ? "        %s -> %d\n" : "    if (v == %s) { return %d }\n", pattern, arm * 7 + 1);
+    }
+    used += snprintf(source + used, size - used, use_match ? "        _ -> 0\n    }\n}\n" : "    0\n}\n");
+
+    char argument[64];
+    switch (kind) {
+        case KIND_DENSE: snprintf(argument, sizeof(argument), "i %% %d", arms); break;
+        case KIND_SPARSE: snprintf(argument, sizeof(argument), "i %% %d * 1000", arms); break;
+        default: snprintf(argument, sizeof(argument), "get(values, i %% %d)", arms); break;
+    }
+    if (kind == KIND_STRING) {
+        used += snprintf(source + used, size - used, "let values = {");
+        for (int arm = 0; arm < arms; arm++) {
+            pattern_text(kind, arm, pattern, sizeof(pattern));
+            used += snprintf(source + used, size - used, arm > 0 ? ", %d: %s" : "%d: %s", arm, pattern);
+        }
+        used += snprintf(source + used, size - used, "}\n");
+    }
+    snprintf(source + used, size - used, "let mut total = 0\nfor i in 0..%lld {\n    total = total + pick(%s)\n}\ntotal\n",
+             (long long)calls, argument);
+    return source;
+}
+
+static double time_script(const char* source, int flat, int64_t* total) {
+    HunickVM* vm = hunick_vm_new();
+    hunick_vm_set_flat(vm, flat);
+    double start = now_seconds();
+    HunickStatus status = hunick_vm_run(vm, source, strlen(source));
+    double elapsed = now_seconds() - start;
+    *total = -1;
+    if (status == HUNICK_OK) {
+        HunickValue value = hunick_vm_result(vm);
+        if (value.type == HUNICK_INT) *total = value.integer;
+    } else {
+        fputs(hunick_vm_error(vm), stderr);
+    }
+    hunick_vm_free(vm);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int64_t calls = argc > 1 ? atoll(argv[1]) : 200000;
+    int arms = argc > 2 ? atoi(argv[2]) : 100;
+    if (calls <= 0) calls = 1;
+    if (arms <= 0) arms = 1;
+
+    static const char* kinds[] = { "dense", "sparse", "string" };
+    printf("%lld calls, %d arms, ns per call\n\n", (long long)calls, arms);
+    printf("%8s %6s %10s %10s %10s\n", "patterns", "eval", "match", "if chain", "speedup");
+
+    int failed = 0;
+    for (int kind = KIND_DENSE; kind <= KIND_STRING; kind++) {
+        char* match_script = build_script((PatternKind)kind, 1, arms, calls);
+        char* chain_script = build_script((PatternKind)kind, 0, arms, calls);
+        for (int flat = 0; flat <= 1; flat++) {
+            int64_t match_total, chain_total;
+            double match_seconds = time_script(match_script, flat, &match_total);
+            double chain_seconds = time_script(chain_script, flat, &chain_total);
+            printf("%8s %6s %10.1f %10.1f %9.2fx\n", kinds[kind], flat ? "flat" : "tree",
+                   match_seconds / calls * 1e9, chain_seconds / calls * 1e9, chain_seconds / match_seconds);
+            if (match_total < 0 || match_total != chain_total) failed = 1;
+        }
+        free(match_script);
+        free(chain_script);
+    }
+
+    if (failed) {
+        fprintf(stderr, "the match and the if chain disagree\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// The buffered output behind print against printf, one line at a time.
+//
+//   make bench && ./bin/bench_output [lines] [repeats]
+//
+// Every row writes the same lines to /dev/null, so the numbers are the
+// cost of formatting and buffering rather than of a terminal or a disk.
+// The printf rows go through stdio's own buffer, so both sides make about
+// as many system calls. The last rows run a Hunick loop that prints each
+// number against one that only adds them up, which is what the loop costs
+// without any output.
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hunick.h"
+#include "output.h"
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Both buffers are emptied before standard output is put back.
+static int silence(void) {
+    int saved = dup(STDOUT_FILENO);
+    int null = open("/dev/null", O_WRONLY);
+    fflush(stdout);
+    dup2(null, STDOUT_FILENO);
+    close(null);
+    return saved;
+}
+
+static void restore(int saved) {
+    output_flush();
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
+// Values with as many digits as typical output: counters and prices.
+static int64_t int_value(int64_t i) {
+    return i * 7919 % 100000007;
+}
+
+static double float_value(int64_t i) {
+    return (double)(i * 7919 % 1000003) / 64.0;
+}
+
+static double time_lines(int use_output, int is_float, int64_t lines) {
+    int saved = silence();
+    double start = now_seconds();
+    for (int64_t i = 0; i < lines; i++) {
+        if (use_output) {
+            if (is_float) {
+                output_float(float_value(i));
+            } else {
+                output_int(int_value(i));
+            }
+            output_write("\n", 1);
+        } else if (is_float) {
+            printf("%f\n", float_value(i));
+        } else {
+            printf("%lld\n", (long long)int_value(i));
+        }
+    }
+    restore(saved);
+    return now_seconds() - start;
+}
+
+static double time_script(HunickVM* vm, const char* source, int* failed) {
+    int saved = silence();
+    double start = now_seconds();
+    if (hunick_vm_run(vm, source, strlen(source)) != HUNICK_OK) *failed = 1;
+    restore(saved);
+    double elapsed = now_seconds() - start;
+    if (*failed) fputs(hunick_vm_error(vm), stderr);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int64_t lines = argc > 1 ? atoll(argv[1]) : 5000000;
+    int repeats = argc > 2 ? atoi(argv[2]) : 3;
+    if (lines <= 0) lines = 1;
+    if (repeats <= 0) repeats = 1;
+
+    printf("%lld lines, %d repeats, Mlines/s\n\n", (long long)lines, repeats);
+    printf("%8s %12s %12s %10s\n", "values", "output", "printf", "speedup");
+
+    for (int is_float = 0; is_float <= 1; is_float++) {
+        double output_seconds = 0, printf_seconds = 0;
+        for (int r = 0; r < repeats; r++) {
+            output_seconds += time_lines(1, is_float, lines);
+            printf_seconds += time_lines(0, is_float, lines);
+        }
+        double output_rate = lines * repeats / output_seconds / 1e6;
+        double printf_rate = lines * repeats / printf_seconds / 1e6;
+        printf("%8s %12.1f %12.1f %9.2fx\n", is_float ? "float" : "int", output_rate, printf_rate,
+               output_rate / printf_rate);
+    }
+
+    HunickVM* vm = hunick_vm_new();
+    char print_loop[256], sum_loop[256];
+    snprintf(print_loop, sizeof(print_loop), "for i in 0..%lld { print(i) }\n", (long long)lines);
+    snprintf(sum_loop, sizeof(sum_loop), "for i in 0..%lld { total = total + i }\n", (long long)lines);
+
+    int failed = 0;
+    time_script(vm, "let mut total = 0\n", &failed);
+    double print_seconds = 0, sum_seconds = 0;
+    for (int r = 0; r < repeats && !failed; r++) {
+        print_seconds += time_script(vm, print_loop, &failed);
+        sum_seconds += time_script(vm, sum_loop, &failed);
+    }
+    hunick_vm_free(vm);
+    if (failed) return 1;
+
+    printf("\n%8s %12s %12s\n", "script", "ms", "Mlines/s");
+    printf("%8s %12.1f %12.1f\n", "print", print_seconds / repeats * 1e3, lines * repeats / print_seconds / 1e6);
+    printf("%8s %12.1f %12.1f\n", "add", sum_seconds / repeats * 1e3, lines * repeats / sum_seconds / 1e6);
+    return 0;
+}
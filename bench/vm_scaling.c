@@ -0,0 +1,104 @@
+// Runs independent HunickVM instances on 1, 2, 4, ... threads.
+//
+//   make bench && ./bin/bench_vm_scaling [max_threads] [runs_per_thread]
+//
+// Every thread creates its own VM, defines a recursive fib once and then
+// evaluates fib(N) runs_per_thread times. VMs share no mutable state, so
+// the throughput should grow with the thread count until it runs out of
+// cores; the speedup column compares it with the single-thread row.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "hunick.h"
+#include "parallel.h"
+
+#define FIB_ARGUMENT "20"
+#define FIB_RESULT 6765
+
+static const char* definition =
+    "func fib(n: int) -> int { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }\n";
+static const char* workload = "fib(" FIB_ARGUMENT ")\n";
+
+typedef struct ThreadRun {
+    int runs;
+    int failed;
+} ThreadRun;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* run_vm(void* arg) {
+    ThreadRun* run = arg;
+    HunickVM* vm = hunick_vm_new();
+
+    if (hunick_vm_run(vm, definition, strlen(definition)) != HUNICK_OK) {
+        fputs(hunick_vm_error(vm), stderr);
+        run->failed = 1;
+    }
+    for (int i = 0; i < run->runs && !run->failed; i++) {
+        HunickValue result;
+        if (hunick_vm_run(vm, workload, strlen(workload)) != HUNICK_OK ||
+            (result = hunick_vm_result(vm)).type != HUNICK_INT || result.integer != FIB_RESULT) {
+            run->failed = 1;
+        }
+    }
+
+    hunick_vm_free(vm);
+    return NULL;
+}
+
+// Seconds taken by thread_count threads doing runs_per_thread runs each.
+static double measure(int thread_count, int runs_per_thread, int* failed) {
+    pthread_t* threads = malloc(sizeof(pthread_t) * thread_count);
+    ThreadRun* runs = calloc(thread_count, sizeof(ThreadRun));
+
+    double start = now_seconds();
+    for (int i = 0; i < thread_count; i++) {
+        runs[i].runs = runs_per_thread;
+        pthread_create(&threads[i], NULL, run_vm, &runs[i]);
+    }
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+        *failed |= runs[i].failed;
+    }
+    double elapsed = now_seconds() - start;
+
+    free(threads);
+    free(runs);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : parallel_cpu_count();
+    int runs_per_thread = argc > 2 ? atoi(argv[2]) : 20;
+    if (max_threads <= 0) max_threads = 1;
+    if (runs_per_thread <= 0) runs_per_thread = 1;
+
+    printf("fib(%s), %d runs per thread, %d processors\n\n", FIB_ARGUMENT, runs_per_thread, parallel_cpu_count());
+    printf("%8s %12s %14s %10s %12s\n", "threads", "seconds", "runs/second", "speedup", "efficiency");
+
+    double base_rate = 0;
+    int failed = 0;
+    for (int threads = 1;; threads *= 2) {
+        if (threads > max_threads) threads = max_threads;
+        double elapsed = measure(threads, runs_per_thread, &failed);
+        double rate = threads * runs_per_thread / elapsed;
+        if (threads == 1) base_rate = rate;
+        double speedup = rate / base_rate;
+        printf("%8d %12.3f %14.1f %9.2fx %11.0f%%\n", threads, elapsed, rate, speedup, 100.0 * speedup / threads);
+        if (threads == max_threads) break;
+    }
+
+    if (failed) {
+        fprintf(stderr, "a VM returned a wrong result\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,806 @@
+#include "cgen.h"
+#include "semantic.h"
+#include "match.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CGEN_DECL_LENGTH 1024
+
+typedef enum {
+    TAIL_DISCARD,
+    TAIL_RETURN,
+    TAIL_ASSIGN
+} TailMode;
+
+typedef struct CGen {
+    FILE* out;
+    int indent;
+    int temp_counter;
+    int failed;
+} CGen;
+
+static void cgen_statement(CGen* gen, Statement* stmt);
+static void cgen_expression(CGen* gen, Expression* expr);
+static void cgen_tail(CGen* gen, Statement** statements, int count, TailMode mode, const char* target);
+static void cgen_if_statement(CGen* gen, Expression* expr, TailMode mode, const char* target);
+
+static void cgen_error(CGen* gen, int line, int column, const char* message) {
+    if (!gen->failed) {
+        fprintf(stderr, "emit-c error at %d:%d: %s\n", line, column, message);
+    }
+    gen->failed = 1;
+}
+
+static void cgen_indent(CGen* gen) {
+    fprintf(gen->out, "%*s", gen->indent * 4, "");
+}
+
+static int is_unit_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_UNIT;
+}
+
+static int is_builtin_type(TypeInfo* type, BuiltinType builtin) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == builtin;
+}
+
+// Builds a C declarator for `type` around `inner` (a name, or "" for an
+// abstract declarator). Function types become function pointers.
+static int c_declarator(TypeInfo* type, const char* inner, char* out, size_t size) {
+    if (!type) return 0;
+
+    if (type->category == TYPECAT_BUILTIN) {
+        const char* base;
+        switch (type->data.builtin) {
+            case BUILTIN_INT: base = "int64_t"; break;
+            case BUILTIN_FLOAT: base = "double"; break;
+            case BUILTIN_BOOL: base = "int"; break;
+            case BUILTIN_STRING: base = "const char*"; break;
+            case BUILTIN_UNIT: base = "void"; break;
+            default: return 0;
+        }
+        snprintf(out, size, inner[0] ? "%s %s" : "%s", base, inner);
+        return 1;
+    }
+
+    if (type->category == TYPECAT_FUNCTION) {
+        char params[CGEN_DECL_LENGTH] = "";
+        char wrapped[CGEN_DECL_LENGTH * 3];
+
+        for (int i = 0; i < type->data.function.param_count; i++) {
+            char param[CGEN_DECL_LENGTH];
+            if (!c_declarator(type->data.function.param_types[i], "", param, sizeof(param))) return 0;
+            if (i > 0) strncat(params, ", ", sizeof(params) - strlen(params) - 1);
+            strncat(params, param, sizeof(params) - strlen(params) - 1);
+        }
+        if (type->data.function.param_count == 0) strcpy(params, "void");
+
+        snprintf(wrapped, sizeof(wrapped), "(*%s)(%s)", inner, params);
+        return c_declarator(type->data.function.return_type, wrapped, out, size);
+    }
+
+    return 0;
+}
+
+static void cgen_declaration(CGen* gen, TypeInfo* type, const char* name, int line, int column) {
+    char decl[CGEN_DECL_LENGTH];
+    if (!c_declarator(type, name, decl, sizeof(decl)) || is_unit_type(type)) {
+        char* type_str = type_info_to_string(type);
+        char message[CGEN_DECL_LENGTH];
+        snprintf(message, sizeof(message), "cannot declare '%s' of type %s in C", name, type_str);
+        free(type_str);
+        cgen_error(gen, line, column, message);
+        return;
+    }
+    fputs(decl, gen->out);
+}
+
+static void cgen_string_literal(CGen* gen, const char* value) {
+    fputc('"', gen->out);
+    for (const unsigned char* p = (const unsigned char*)value; *p; p++) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(gen->out, "\\%c", *p);
+        } else if (*p < 0x20 || *p >= 0x7f) {
+            fprintf(gen->out, "\\%03o", *p);
+        } else {
+            fputc(*p, gen->out);
+        }
+    }
+    fputc('"', gen->out);
+}
+
+static void cgen_float_literal(CGen* gen, double value) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.17g", value);
+    if (!strpbrk(buffer, ".eEn")) {
+        strcat(buffer, ".0");
+    }
+    fputs(buffer, gen->out);
+}
+
+// Integer arithmetic and comparisons go through the HK_NULL-aware helpers
+// of the prelude (see cgen_prelude).
+static const char* int_operator_helper(const char* op) {
+    static const char* const helpers[][2] = {
+        { "+", "HK_add" }, { "-", "HK_sub" }, { "*", "HK_mul" }, { "/", "HK_div" }, { "%", "HK_mod" },
+        { "<", "HK_lt" }, { ">", "HK_gt" }, { "<=", "HK_le" }, { ">=", "HK_ge" }, { "==", "HK_eq" }, { "!=", "HK_ne" },
+    };
+    for (size_t i = 0; i < sizeof(helpers) / sizeof(helpers[0]); i++) {
+        if (strcmp(op, helpers[i][0]) == 0) return helpers[i][1];
+    }
+    return NULL;
+}
+
+static void cgen_infix(CGen* gen, Expression* expr) {
+    const char* op = expr->data.infix.operator;
+    TypeInfo* left_type = expr->data.infix.left->resolved_type;
+    TypeInfo* right_type = expr->data.infix.right->resolved_type;
+
+    if (strcmp(op, "=") == 0) {
+        fputs("(", gen->out);
+        cgen_expression(gen, expr->data.infix.left);
+        fputs(" = ", gen->out);
+        cgen_expression(gen, expr->data.infix.right);
+        fputs(")", gen->out);
+        return;
+    }
+
+    if (is_builtin_type(left_type, BUILTIN_STRING) && is_builtin_type(right_type, BUILTIN_STRING)) {
+        if (strcmp(op, "+") == 0) {
+            cgen_error(gen, expr->line, expr->column, "string concatenation is not supported");
+            return;
+        }
+        fputs("(strcmp(", gen->out);
+        cgen_expression(gen, expr->data.infix.left);
+        fputs(", ", gen->out);
+        cgen_expression(gen, expr->data.infix.right);
+        fprintf(gen->out, ") %s 0)", op);
+        return;
+    }
+
+    if (strcmp(op, "%") == 0 &&
+        (is_builtin_type(left_type, BUILTIN_FLOAT) || is_builtin_type(right_type, BUILTIN_FLOAT))) {
+        fputs("fmod((double)", gen->out);
+        cgen_expression(gen, expr->data.infix.left);
+        fputs(", (double)", gen->out);
+        cgen_expression(gen, expr->data.infix.right);
+        fputs(")", gen->out);
+        return;
+    }
+
+    if (is_builtin_type(left_type, BUILTIN_INT) && is_builtin_type(right_type, BUILTIN_INT)) {
+        const char* helper = int_operator_helper(op);
+        if (helper) {
+            fprintf(gen->out, "%s(", helper);
+            cgen_expression(gen, expr->data.infix.left);
+            fputs(", ", gen->out);
+            cgen_expression(gen, expr->data.infix.right);
+            fputs(")", gen->out);
+            return;
+        }
+    }
+
+    fputs("(", gen->out);
+    cgen_expression(gen, expr->data.infix.left);
+    fprintf(gen->out, " %s ", op);
+    cgen_expression(gen, expr->data.infix.right);
+    fputs(")", gen->out);
+}
+
+// An `if` used for its value becomes a GNU statement expression that
+// assigns the tail of the taken branch to a temporary.
+static void cgen_if_value(CGen* gen, Expression* expr) {
+    TypeInfo* type = expr->resolved_type;
+    char temp[32] = "";
+
+    fputs("({\n", gen->out);
+    gen->indent++;
+
+    if (!is_unit_type(type)) {
+        snprintf(temp, sizeof(temp), "cg_tmp%d", gen->temp_counter++);
+        cgen_indent(gen);
+        cgen_declaration(gen, type, temp, expr->line, expr->column);
+        fputs(";\n", gen->out);
+    }
+
+    cgen_if_statement(gen, expr, temp[0] ? TAIL_ASSIGN : TAIL_DISCARD, temp);
+
+    if (temp[0]) {
+        cgen_indent(gen);
+        fprintf(gen->out, "%s;\n", temp);
+    }
+
+    gen->indent--;
+    cgen_indent(gen);
+    fputs("})", gen->out);
+}
+
+static void cgen_match_arm(CGen* gen, Expression* result, const char* temp) {
+    if (temp[0]) fprintf(gen->out, "%s = ", temp);
+    cgen_expression(gen, result);
+    fputs(";", gen->out);
+}
+
+// A `match` on an int or bool becomes a switch, which the C compiler
+// turns into a jump table or a search as it sees fit; one on a string
+// becomes a chain of strcmp tests. Either is a GNU statement expression
+// like an `if` used for its value.
+static void cgen_match_value(CGen* gen, Expression* expr) {
+    TypeInfo* type = expr->resolved_type;
+    Expression* subject = expr->data.match.expression;
+    int on_string = is_builtin_type(subject->resolved_type, BUILTIN_STRING);
+    char subject_temp[32];
+    char temp[32] = "";
+
+    fputs("({\n", gen->out);
+    gen->indent++;
+
+    snprintf(subject_temp, sizeof(subject_temp), "cg_tmp%d", gen->temp_counter++);
+    cgen_indent(gen);
+    cgen_declaration(gen, subject->resolved_type, subject_temp, subject->line, subject->column);
+    fputs(" = ", gen->out);
+    cgen_expression(gen, subject);
+    fputs(";\n", gen->out);
+
+    if (!is_unit_type(type)) {
+        snprintf(temp, sizeof(temp), "cg_tmp%d", gen->temp_counter++);
+        cgen_indent(gen);
+        cgen_declaration(gen, type, temp, expr->line, expr->column);
+        fputs(";\n", gen->out);
+    }
+
+    cgen_indent(gen);
+    if (!on_string) fprintf(gen->out, "switch (%s) {\n", subject_temp);
+    for (int i = 0; i < expr->data.match.case_count; i++) {
+        MatchCase* match_case = expr->data.match.cases[i];
+        int is_default = match_pattern_is_wildcard(match_case->pattern);
+        if (on_string) {
+            if (i > 0) fputs(" else ", gen->out);
+            if (!is_default) {
+                fprintf(gen->out, "if (strcmp(%s, ", subject_temp);
+                cgen_expression(gen, match_case->pattern);
+                fputs(") == 0) ", gen->out);
+            }
+            fputs("{\n", gen->out);
+            gen->indent++;
+            cgen_indent(gen);
+            cgen_match_arm(gen, match_case->result, temp);
+            fputs("\n", gen->out);
+            gen->indent--;
+            cgen_indent(gen);
+            fputs("}", gen->out);
+            continue;
+        }
+        cgen_indent(gen);
+        if (is_default) {
+            fputs("default: ", gen->out);
+        } else {
+            fputs("case ", gen->out);
+            cgen_expression(gen, match_case->pattern);
+            fputs(": ", gen->out);
+        }
+        cgen_match_arm(gen, match_case->result, temp);
+        fputs(" break;\n", gen->out);
+    }
+    if (on_string) {
+        fputs("\n", gen->out);
+    } else {
+        cgen_indent(gen);
+        fputs("}\n", gen->out);
+    }
+
+    if (temp[0]) {
+        cgen_indent(gen);
+        fprintf(gen->out, "%s;\n", temp);
+    }
+
+    gen->indent--;
+    cgen_indent(gen);
+    fputs("})", gen->out);
+}
+
+// print, write and flush go through stdio, which the "=> value" line
+// uses too, so everything comes out in program order. Returns 0 for any
+// other builtin.
+static int cgen_output_call(CGen* gen, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression* argument = expr->data.call.argument_count == 1 ? expr->data.call.arguments[0] : NULL;
+
+    if (strcmp(name, "flush") == 0) {
+        fputs("HK_flush()", gen->out);
+    } else if (strcmp(name, "write") == 0) {
+        fputs("HK_write(", gen->out);
+        cgen_expression(gen, argument);
+        fputs(")", gen->out);
+    } else if (strcmp(name, "print") == 0) {
+        TypeInfo* type = argument->resolved_type;
+        const char* helper = is_builtin_type(type, BUILTIN_INT) ? "HK_println_int"
+                           : is_builtin_type(type, BUILTIN_FLOAT) ? "HK_println_float"
+                           : is_builtin_type(type, BUILTIN_BOOL) ? "HK_println_bool"
+                           : is_builtin_type(type, BUILTIN_STRING) ? "HK_write_line"
+                           : NULL;
+        if (!helper) {
+            cgen_error(gen, expr->line, expr->column, "print supports only int, float, bool and string values");
+            return 1;
+        }
+        fprintf(gen->out, "%s(", helper);
+        cgen_expression(gen, argument);
+        fputs(")", gen->out);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+static void cgen_expression(CGen* gen, Expression* expr) {
+    if (!expr || gen->failed) return;
+
+    switch (expr->node_type) {
+        case EXPR_INTEGER_LITERAL:
+            fprintf(gen->out, "INT64_C(%d)", expr->data.integer_literal.value);
+            break;
+        case EXPR_FLOAT_LITERAL:
+            cgen_float_literal(gen, expr->data.float_literal.value);
+            break;
+        case EXPR_STRING_LITERAL:
+            cgen_string_literal(gen, expr->data.string_literal.value);
+            break;
+        case EXPR_BOOLEAN_LITERAL:
+            fputs(expr->data.boolean_literal.value ? "1" : "0", gen->out);
+            break;
+        case EXPR_IDENTIFIER:
+            fprintf(gen->out, "hk_%s", expr->data.identifier.value);
+            break;
+        case EXPR_PREFIX:
+            if (strcmp(expr->data.prefix.operator, "spawn") == 0 || strcmp(expr->data.prefix.operator, "await") == 0) {
+                cgen_error(gen, expr->line, expr->column, "spawn and await are not supported");
+                return;
+            }
+            if (strcmp(expr->data.prefix.operator, "-") != 0 && strcmp(expr->data.prefix.operator, "!") != 0) {
+                cgen_error(gen, expr->line, expr->column, "references are not supported");
+                return;
+            }
+            // A negated literal stays a constant expression, as a case label needs.
+            if (strcmp(expr->data.prefix.operator, "-") == 0 &&
+                is_builtin_type(expr->data.prefix.right->resolved_type, BUILTIN_INT) &&
+                expr->data.prefix.right->node_type != EXPR_INTEGER_LITERAL) {
+                fputs("HK_neg(", gen->out);
+            } else {
+                fprintf(gen->out, "(%s", expr->data.prefix.operator);
+            }
+            cgen_expression(gen, expr->data.prefix.right);
+            fputs(")", gen->out);
+            break;
+        case EXPR_INFIX:
+            cgen_infix(gen, expr);
+            break;
+        case EXPR_CALL:
+            // Builtin calls are typed by the analyzer without resolving the callee.
+            if (expr->data.call.function->node_type == EXPR_IDENTIFIER && !expr->data.call.function->resolved_type) {
+                if (!cgen_output_call(gen, expr)) {
+                    cgen_error(gen, expr->line, expr->column, "builtins other than print, write and flush are not supported");
+                }
+                break;
+            }
+            cgen_expression(gen, expr->data.call.function);
+            fputs("(", gen->out);
+            for (int i = 0; i < expr->data.call.argument_count; i++) {
+                if (i > 0) fputs(", ", gen->out);
+                cgen_expression(gen, expr->data.call.arguments[i]);
+            }
+            fputs(")", gen->out);
+            break;
+        case EXPR_PIPE:
+            fputs("(", gen->out);
+            cgen_expression(gen, expr->data.pipe.right);
+            fputs(")(", gen->out);
+            cgen_expression(gen, expr->data.pipe.left);
+            fputs(")", gen->out);
+            break;
+        case EXPR_IF:
+            cgen_if_value(gen, expr);
+            break;
+        case EXPR_MATCH:
+            cgen_match_value(gen, expr);
+            break;
+        case EXPR_FUNCTION_LITERAL:
+            cgen_error(gen, expr->line, expr->column, "functions must be declared at the top level, not bound with let mut");
+            break;
+        case EXPR_ARRAY_LITERAL:
+        case EXPR_INDEX:
+            cgen_error(gen, expr->line, expr->column, "arrays are not supported");
+            break;
+        case EXPR_MAP_LITERAL:
+            cgen_error(gen, expr->line, expr->column, "maps are not supported");
+            break;
+        case EXPR_FIELD:
+            cgen_error(gen, expr->line, expr->column, "structs are not supported");
+            break;
+        default:
+            cgen_error(gen, expr->line, expr->column, "unsupported expression");
+            break;
+    }
+}
+
+static void cgen_if_statement(CGen* gen, Expression* expr, TailMode mode, const char* target) {
+    cgen_indent(gen);
+    fputs("if (", gen->out);
+    cgen_expression(gen, expr->data.if_expr.condition);
+    fputs(") {\n", gen->out);
+    gen->indent++;
+    cgen_tail(gen, expr->data.if_expr.then_branch, expr->data.if_expr.then_count, mode, target);
+    gen->indent--;
+    cgen_indent(gen);
+    fputs("}", gen->out);
+    if (expr->data.if_expr.else_branch) {
+        fputs(" else {\n", gen->out);
+        gen->indent++;
+        cgen_tail(gen, expr->data.if_expr.else_branch, expr->data.if_expr.else_count, mode, target);
+        gen->indent--;
+        cgen_indent(gen);
+        fputs("}", gen->out);
+    }
+    fputs("\n", gen->out);
+}
+
+static void cgen_tail_statement(CGen* gen, Statement* stmt, TailMode mode, const char* target) {
+    if (stmt->node_type != STMT_EXPRESSION || mode == TAIL_DISCARD) {
+        cgen_statement(gen, stmt);
+        return;
+    }
+
+    Expression* expr = stmt->data.expression_stmt.expression;
+
+    if (expr->node_type == EXPR_IF) {
+        cgen_if_statement(gen, expr, mode, target);
+        return;
+    }
+
+    if (is_unit_type(expr->resolved_type)) {
+        cgen_statement(gen, stmt);
+        return;
+    }
+
+    cgen_indent(gen);
+    if (mode == TAIL_RETURN) {
+        fputs("return ", gen->out);
+    } else {
+        fprintf(gen->out, "%s = ", target);
+    }
+    cgen_expression(gen, expr);
+    fputs(";\n", gen->out);
+}
+
+static void cgen_tail(CGen* gen, Statement** statements, int count, TailMode mode, const char* target) {
+    for (int i = 0; i < count; i++) {
+        if (i == count - 1) {
+            cgen_tail_statement(gen, statements[i], mode, target);
+        } else {
+            cgen_statement(gen, statements[i]);
+        }
+    }
+}
+
+static void cgen_statement(CGen* gen, Statement* stmt) {
+    if (!stmt || gen->failed) return;
+
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            {
+                Expression* value = stmt->data.let_stmt.value;
+                char name[CGEN_DECL_LENGTH];
+
+                if (!value) {
+                    cgen_error(gen, stmt->line, stmt->column, "declarations without a value are not supported");
+                    return;
+                }
+                if (value->node_type == EXPR_FUNCTION_LITERAL) {
+                    cgen_error(gen, stmt->line, stmt->column, "functions must be declared at the top level");
+                    return;
+                }
+
+                snprintf(name, sizeof(name), "hk_%s", stmt->data.let_stmt.name);
+                cgen_indent(gen);
+                cgen_declaration(gen, value->resolved_type, name, stmt->line, stmt->column);
+                fputs(" = ", gen->out);
+                cgen_expression(gen, value);
+                fputs(";\n", gen->out);
+                break;
+            }
+        case STMT_RETURN:
+            cgen_indent(gen);
+            if (stmt->data.return_stmt.return_value) {
+                fputs("return ", gen->out);
+                cgen_expression(gen, stmt->data.return_stmt.return_value);
+                fputs(";\n", gen->out);
+            } else {
+                fputs("return;\n", gen->out);
+            }
+            break;
+        case STMT_EXPRESSION:
+            {
+                Expression* expr = stmt->data.expression_stmt.expression;
+                if (expr && expr->node_type == EXPR_IF) {
+                    cgen_if_statement(gen, expr, TAIL_DISCARD, "");
+                    break;
+                }
+                cgen_indent(gen);
+                fputs("(void)", gen->out);
+                cgen_expression(gen, expr);
+                fputs(";\n", gen->out);
+                break;
+            }
+        case STMT_BLOCK:
+            cgen_indent(gen);
+            fputs("{\n", gen->out);
+            gen->indent++;
+            for (int i = 0; i < stmt->data.block_stmt.statement_count; i++) {
+                cgen_statement(gen, stmt->data.block_stmt.statements[i]);
+            }
+            gen->indent--;
+            cgen_indent(gen);
+            fputs("}\n", gen->out);
+            break;
+        case STMT_WHILE:
+            cgen_indent(gen);
+            fputs("while (", gen->out);
+            cgen_expression(gen, stmt->data.while_stmt.condition);
+            fputs(")\n", gen->out);
+            cgen_statement(gen, stmt->data.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (!stmt->data.for_stmt.end) {
+                cgen_error(gen, stmt->line, stmt->column, "for loops over sequences are not supported");
+                return;
+            }
+            {
+                // The end bound is evaluated once, as the interpreter does. A
+                // par for becomes an OpenMP loop; without -fopenmp the pragma
+                // is ignored and the loop runs sequentially.
+                int end = gen->temp_counter++;
+                cgen_indent(gen);
+                fputs("{\n", gen->out);
+                gen->indent++;
+                cgen_indent(gen);
+                fprintf(gen->out, "int64_t cg_end%d = ", end);
+                cgen_expression(gen, stmt->data.for_stmt.end);
+                fputs(";\n", gen->out);
+                if (stmt->data.for_stmt.is_parallel) {
+                    cgen_indent(gen);
+                    fputs("#pragma omp parallel for", gen->out);
+                    for (int i = 0; i < stmt->data.for_stmt.reduce_count; i++) {
+                        fprintf(gen->out, " reduction(%s: hk_%s)", stmt->data.for_stmt.reduce_operators[i],
+                                stmt->data.for_stmt.reduce_names[i]);
+                    }
+                    fputs("\n", gen->out);
+                }
+                cgen_indent(gen);
+                fprintf(gen->out, "for (int64_t hk_%s = ", stmt->data.for_stmt.variable);
+                cgen_expression(gen, stmt->data.for_stmt.start);
+                fprintf(gen->out, "; hk_%s < cg_end%d; hk_%s++)\n", stmt->data.for_stmt.variable, end,
+                        stmt->data.for_stmt.variable);
+                cgen_statement(gen, stmt->data.for_stmt.body);
+                gen->indent--;
+                cgen_indent(gen);
+                fputs("}\n", gen->out);
+                break;
+            }
+        case STMT_TYPE:
+            cgen_error(gen, stmt->line, stmt->column, "structs are not supported");
+            break;
+        default:
+            cgen_error(gen, stmt->line, stmt->column, "unsupported statement");
+            break;
+    }
+}
+
+// A `let mut` function is a variable, and its literal is not supported.
+static int is_function_declaration(Statement* stmt) {
+    return (stmt->node_type == STMT_LET || stmt->node_type == STMT_CONST) &&
+           stmt->data.let_stmt.is_const && stmt->data.let_stmt.value &&
+           stmt->data.let_stmt.value->node_type == EXPR_FUNCTION_LITERAL;
+}
+
+static void cgen_function_header(CGen* gen, Statement* stmt) {
+    Expression* function = stmt->data.let_stmt.value;
+    TypeInfo* type = function->resolved_type;
+    char header[CGEN_DECL_LENGTH];
+    char decl[CGEN_DECL_LENGTH];
+
+    if (!type || type->category != TYPECAT_FUNCTION) {
+        cgen_error(gen, stmt->line, stmt->column, "function has no resolved type");
+        return;
+    }
+    if (function->data.function_literal.is_generator) {
+        cgen_error(gen, stmt->line, stmt->column, "generators are not supported");
+        return;
+    }
+
+    snprintf(header, sizeof(header), "hk_%s(", stmt->data.let_stmt.name);
+    for (int i = 0; i < function->data.function_literal.parameter_count; i++) {
+        char name[CGEN_DECL_LENGTH];
+        char param[CGEN_DECL_LENGTH];
+        snprintf(name, sizeof(name), "hk_%s", function->data.function_literal.parameters[i]->name);
+        if (!c_declarator(type->data.function.param_types[i], name, param, sizeof(param)) ||
+            is_unit_type(type->data.function.param_types[i])) {
+            cgen_error(gen, stmt->line, stmt->column, "unsupported parameter type");
+            return;
+        }
+        if (i > 0) strncat(header, ", ", sizeof(header) - strlen(header) - 1);
+        strncat(header, param, sizeof(header) - strlen(header) - 1);
+    }
+    if (function->data.function_literal.parameter_count == 0) {
+        strncat(header, "void", sizeof(header) - strlen(header) - 1);
+    }
+    strncat(header, ")", sizeof(header) - strlen(header) - 1);
+
+    if (!c_declarator(type->data.function.return_type, header, decl, sizeof(decl))) {
+        cgen_error(gen, stmt->line, stmt->column, "unsupported return type");
+        return;
+    }
+    fprintf(gen->out, "static %s", decl);
+}
+
+static void cgen_print_value(CGen* gen, TypeInfo* type, const char* name) {
+    cgen_indent(gen);
+    fputs("fputs(\"=> \", stdout);\n", gen->out);
+    cgen_indent(gen);
+    if (is_builtin_type(type, BUILTIN_INT)) {
+        fprintf(gen->out, "HK_print_int(%s);\n", name);
+    } else if (is_builtin_type(type, BUILTIN_FLOAT)) {
+        fprintf(gen->out, "printf(\"%%f\", %s);\n", name);
+    } else if (is_builtin_type(type, BUILTIN_BOOL)) {
+        fprintf(gen->out, "fputs(%s ? \"true\" : \"false\", stdout);\n", name);
+    } else if (is_builtin_type(type, BUILTIN_STRING)) {
+        fprintf(gen->out, "printf(\"\\\"%%s\\\"\", %s);\n", name);
+    } else if (type && type->category == TYPECAT_FUNCTION) {
+        fprintf(gen->out, "printf(\"<func(%d params)>\");\n", type->data.function.param_count);
+    }
+    cgen_indent(gen);
+    fputs("fputs(\"\\n\", stdout);\n", gen->out);
+}
+
+// Mirrors main.c: the value of the final top-level expression (or of a
+// top-level return) is printed as "=> value".
+static void cgen_main(CGen* gen, Program* program) {
+    fputs("int main(void) {\n", gen->out);
+    gen->indent = 1;
+
+    for (int i = 0; i < program->statement_count && !gen->failed; i++) {
+        Statement* stmt = program->statements[i];
+        int is_last = (i == program->statement_count - 1);
+
+        if (is_function_declaration(stmt)) continue;
+
+        if (stmt->node_type == STMT_LET || stmt->node_type == STMT_CONST) {
+            cgen_indent(gen);
+            fprintf(gen->out, "hk_%s = ", stmt->data.let_stmt.name);
+            cgen_expression(gen, stmt->data.let_stmt.value);
+            fputs(";\n", gen->out);
+            continue;
+        }
+
+        Expression* value = NULL;
+        if (stmt->node_type == STMT_RETURN) {
+            value = stmt->data.return_stmt.return_value;
+        } else if (is_last && stmt->node_type == STMT_EXPRESSION) {
+            value = stmt->data.expression_stmt.expression;
+        }
+
+        if (!value || is_unit_type(value->resolved_type)) {
+            cgen_statement(gen, stmt);
+            continue;
+        }
+
+        cgen_indent(gen);
+        fputs("{\n", gen->out);
+        gen->indent++;
+        cgen_indent(gen);
+        cgen_declaration(gen, value->resolved_type, "cg_result", value->line, value->column);
+        fputs(";\n", gen->out);
+        if (stmt->node_type == STMT_RETURN) {
+            cgen_indent(gen);
+            fputs("cg_result = ", gen->out);
+            cgen_expression(gen, value);
+            fputs(";\n", gen->out);
+        } else {
+            cgen_tail_statement(gen, stmt, TAIL_ASSIGN, "cg_result");
+        }
+        cgen_print_value(gen, value->resolved_type, "cg_result");
+        if (stmt->node_type == STMT_RETURN) {
+            cgen_indent(gen);
+            fputs("return 0;\n", gen->out);
+        }
+        gen->indent--;
+        cgen_indent(gen);
+        fputs("}\n", gen->out);
+    }
+
+    fputs("    return 0;\n}\n", gen->out);
+}
+
+// Integer `/` and `%` by zero give null in the interpreter, and null then
+// spreads through arithmetic and prints as "null". Generated ints carry it
+// as HK_NULL: arithmetic passes it on, a comparison with it is false, as a
+// null condition is, and printing shows "null". Wrapping arithmetic that
+// lands on INT64_MIN reads as null too. The helpers are named HK_ so they
+// cannot clash with the hk_ names given to the program's own.
+static const char* const cgen_prelude =
+    "#define HK_NULL INT64_MIN\n"
+    "#define HK_KNOWN(a, b) ((a) != HK_NULL && (b) != HK_NULL)\n"
+    "static inline int64_t HK_add(int64_t a, int64_t b) { return HK_KNOWN(a, b) ? (int64_t)((uint64_t)a + (uint64_t)b) : HK_NULL; }\n"
+    "static inline int64_t HK_sub(int64_t a, int64_t b) { return HK_KNOWN(a, b) ? (int64_t)((uint64_t)a - (uint64_t)b) : HK_NULL; }\n"
+    "static inline int64_t HK_mul(int64_t a, int64_t b) { return HK_KNOWN(a, b) ? (int64_t)((uint64_t)a * (uint64_t)b) : HK_NULL; }\n"
+    "static inline int64_t HK_div(int64_t a, int64_t b) { return !HK_KNOWN(a, b) || b == 0 ? HK_NULL : b == -1 ? (int64_t)(0 - (uint64_t)a) : a / b; }\n"
+    "static inline int64_t HK_mod(int64_t a, int64_t b) { return !HK_KNOWN(a, b) || b == 0 ? HK_NULL : b == -1 ? 0 : a % b; }\n"
+    "static inline int64_t HK_neg(int64_t a) { return a == HK_NULL ? HK_NULL : (int64_t)(0 - (uint64_t)a); }\n"
+    "static inline int HK_lt(int64_t a, int64_t b) { return HK_KNOWN(a, b) && a < b; }\n"
+    "static inline int HK_gt(int64_t a, int64_t b) { return HK_KNOWN(a, b) && a > b; }\n"
+    "static inline int HK_le(int64_t a, int64_t b) { return HK_KNOWN(a, b) && a <= b; }\n"
+    "static inline int HK_ge(int64_t a, int64_t b) { return HK_KNOWN(a, b) && a >= b; }\n"
+    "static inline int HK_eq(int64_t a, int64_t b) { return HK_KNOWN(a, b) && a == b; }\n"
+    "static inline int HK_ne(int64_t a, int64_t b) { return HK_KNOWN(a, b) && a != b; }\n"
+    "static inline void HK_print_int(int64_t a) {\n"
+    "    if (a == HK_NULL) fputs(\"null\", stdout); else printf(\"%lld\", (long long)a);\n"
+    "}\n"
+    "static inline void HK_println_int(int64_t a) { HK_print_int(a); putchar('\\n'); }\n"
+    "static inline void HK_println_float(double a) { printf(\"%f\\n\", a); }\n"
+    "static inline void HK_println_bool(int a) { puts(a ? \"true\" : \"false\"); }\n"
+    "static inline void HK_write(const char* s) { fputs(s, stdout); }\n"
+    "static inline void HK_write_line(const char* s) { puts(s); }\n"
+    "static inline void HK_flush(void) { fflush(stdout); }\n\n";
+
+int cgen_emit_program(Program* program, FILE* out) {
+    CGen gen = { out, 0, 0, 0 };
+
+    fputs("/* Generated by hunick --emit-c */\n", out);
+    fputs("#include <stdint.h>\n#include <stdio.h>\n#include <string.h>\n#include <math.h>\n\n", out);
+    fputs(cgen_prelude, out);
+
+    for (int i = 0; i < program->statement_count && !gen.failed; i++) {
+        Statement* stmt = program->statements[i];
+        if ((stmt->node_type == STMT_LET || stmt->node_type == STMT_CONST) && !is_function_declaration(stmt)) {
+            char name[CGEN_DECL_LENGTH];
+            if (!stmt->data.let_stmt.value) {
+                cgen_error(&gen, stmt->line, stmt->column, "declarations without a value are not supported");
+                break;
+            }
+            snprintf(name, sizeof(name), "hk_%s", stmt->data.let_stmt.name);
+            fputs("static ", out);
+            cgen_declaration(&gen, stmt->data.let_stmt.value->resolved_type, name, stmt->line, stmt->column);
+            fputs(";\n", out);
+        }
+    }
+    fputs("\n", out);
+
+    for (int i = 0; i < program->statement_count && !gen.failed; i++) {
+        if (is_function_declaration(program->statements[i])) {
+            cgen_function_header(&gen, program->statements[i]);
+            fputs(";\n", out);
+        }
+    }
+    fputs("\n", out);
+
+    for (int i = 0; i < program->statement_count && !gen.failed; i++) {
+        Statement* stmt = program->statements[i];
+        if (!is_function_declaration(stmt)) continue;
+
+        Expression* function = stmt->data.let_stmt.value;
+        TypeInfo* return_type = function->resolved_type->data.function.return_type;
+
+        cgen_function_header(&gen, stmt);
+        fputs(" {\n", out);
+        gen.indent = 1;
+        cgen_tail(&gen, function->data.function_literal.body, function->data.function_literal.body_count,
+                  is_unit_type(return_type) ? TAIL_DISCARD : TAIL_RETURN, "");
+        gen.indent = 0;
+        fputs("}\n\n", out);
+    }
+
+    if (!gen.failed) {
+        cgen_main(&gen, program);
+    }
+
+    return !gen.failed;
+}
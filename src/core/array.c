@@ -0,0 +1,59 @@
+#include "array.h"
+#include "vm.h"
+#include <string.h>
+
+#define ARRAY_MIN_CAPACITY 8
+
+// Elements are int64_t or double, both eight bytes.
+#define ELEMENT_SIZE sizeof(int64_t)
+
+Array* array_new(ArrayKind kind, int64_t capacity) {
+    Heap* heap = vm_heap();
+    Array* array = heap_alloc(heap, sizeof(Array));
+    array->kind = kind;
+    array->length = 0;
+    array->capacity = capacity > ARRAY_MIN_CAPACITY ? capacity : ARRAY_MIN_CAPACITY;
+    array->data.ints = heap_alloc(heap, ELEMENT_SIZE * array->capacity);
+    return array;
+}
+
+Array* array_copy(const Array* array) {
+    Array* copy = array_new(array->kind, array->length);
+    memcpy(copy->data.ints, array->data.ints, ELEMENT_SIZE * array->length);
+    copy->length = array->length;
+    return copy;
+}
+
+Object* array_get(const Array* array, int64_t index) {
+    if (index < 0 || index >= array->length) return object_new_null();
+    return array_load(array, index);
+}
+
+static int array_accepts(const Array* array, Object* value) {
+    if (!value) return 0;
+    if (array->kind == ARRAY_FLOAT) return value->type == OBJ_FLOAT || value->type == OBJ_INTEGER;
+    if (array->kind == ARRAY_INT) return value->type == OBJ_INTEGER;
+    return value->type == OBJ_FLOAT || value->type == OBJ_INTEGER;
+}
+
+void array_set(Array* array, int64_t index, Object* value) {
+    if (index < 0 || index >= array->length || !array_accepts(array, value)) return;
+    array_store(array, index, value);
+}
+
+void array_push(Array* array, Object* value) {
+    if (!array_accepts(array, value)) return;
+    if (array->kind == ARRAY_UNTYPED) {
+        array->kind = value->type == OBJ_FLOAT ? ARRAY_FLOAT : ARRAY_INT;
+    }
+
+    if (array->length == array->capacity) {
+        int64_t capacity = array->capacity * 2;
+        int64_t* data = heap_alloc_beside(vm_heap(), array, ELEMENT_SIZE * capacity);
+        memcpy(data, array->data.ints, ELEMENT_SIZE * array->length);
+        array->data.ints = data;
+        array->capacity = capacity;
+    }
+    array_store(array, array->length++, value);
+}
+
@@ -1,4 +1,5 @@
 #include "ast.h"
+#include "match.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -98,6 +99,50 @@ Statement* statement_new_while(Expression* condition, Statement* body, int line,
     return stmt;
 }
 
+Statement* statement_new_for(char* variable, Expression* start, Expression* end, Statement* body, int line, int column) {
+    Statement* stmt = malloc(sizeof(Statement));
+    if (!stmt) return NULL;
+
+    stmt->node_type = STMT_FOR;
+    stmt->line = line;
+    stmt->column = column;
+    stmt->data.for_stmt.variable = variable;
+    stmt->data.for_stmt.start = start;
+    stmt->data.for_stmt.end = end;
+    stmt->data.for_stmt.body = body;
+    stmt->data.for_stmt.is_parallel = 0;
+    stmt->data.for_stmt.reduce_operators = NULL;
+    stmt->data.for_stmt.reduce_names = NULL;
+    stmt->data.for_stmt.reduce_count = 0;
+
+    return stmt;
+}
+
+Statement* statement_new_yield(Expression* value, int line, int column) {
+    Statement* stmt = malloc(sizeof(Statement));
+    if (!stmt) return NULL;
+
+    stmt->node_type = STMT_YIELD;
+    stmt->line = line;
+    stmt->column = column;
+    stmt->data.yield_stmt.value = value;
+
+    return stmt;
+}
+
+Statement* statement_new_type(char* name, Type* type, int line, int column) {
+    Statement* stmt = malloc(sizeof(Statement));
+    if (!stmt) return NULL;
+
+    stmt->node_type = STMT_TYPE;
+    stmt->line = line;
+    stmt->column = column;
+    stmt->data.type_decl.name = name;
+    stmt->data.type_decl.type = type;
+
+    return stmt;
+}
+
 void statement_free(Statement* stmt) {
     if (!stmt) return;
     
@@ -126,6 +171,25 @@ void statement_free(Statement* stmt) {
             expression_free(stmt->data.while_stmt.condition);
             statement_free(stmt->data.while_stmt.body);
             break;
+        case STMT_FOR:
+            free(stmt->data.for_stmt.variable);
+            expression_free(stmt->data.for_stmt.start);
+            expression_free(stmt->data.for_stmt.end);
+            statement_free(stmt->data.for_stmt.body);
+            for (int i = 0; i < stmt->data.for_stmt.reduce_count; i++) {
+                free(stmt->data.for_stmt.reduce_operators[i]);
+                free(stmt->data.for_stmt.reduce_names[i]);
+            }
+            free(stmt->data.for_stmt.reduce_operators);
+            free(stmt->data.for_stmt.reduce_names);
+            break;
+        case STMT_YIELD:
+            expression_free(stmt->data.yield_stmt.value);
+            break;
+        case STMT_TYPE:
+            free(stmt->data.type_decl.name);
+            type_free(stmt->data.type_decl.type);
+            break;
         default:
             break;
     }
@@ -139,6 +203,7 @@ Expression* expression_new_identifier(char* value, int line, int column) {
     expr->node_type = EXPR_IDENTIFIER;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.identifier.value = value;
     
     return expr;
@@ -151,6 +216,7 @@ Expression* expression_new_integer_literal(int value, int line, int column) {
     expr->node_type = EXPR_INTEGER_LITERAL;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.integer_literal.value = value;
     
     return expr;
@@ -163,6 +229,7 @@ Expression* expression_new_float_literal(double value, int line, int column) {
     expr->node_type = EXPR_FLOAT_LITERAL;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.float_literal.value = value;
     
     return expr;
@@ -175,7 +242,9 @@ Expression* expression_new_string_literal(char* value, int line, int column) {
     expr->node_type = EXPR_STRING_LITERAL;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.string_literal.value = value;
+    string_literal_init(&expr->data.string_literal.literal, value);
     
     return expr;
 }
@@ -187,6 +256,7 @@ Expression* expression_new_boolean_literal(int value, int line, int column) {
     expr->node_type = EXPR_BOOLEAN_LITERAL;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.boolean_literal.value = value;
     
     return expr;
@@ -199,11 +269,17 @@ Expression* expression_new_function_literal(Parameter** params, int param_count,
     expr->node_type = EXPR_FUNCTION_LITERAL;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.function_literal.parameters = params;
     expr->data.function_literal.parameter_count = param_count;
     expr->data.function_literal.return_type = return_type;
     expr->data.function_literal.body = body;
     expr->data.function_literal.body_count = body_count;
+    expr->data.function_literal.name = NULL;
+    expr->data.function_literal.is_pure = 0;
+    expr->data.function_literal.is_memo = 0;
+    expr->data.function_literal.shares_mutable_state = 0;
+    expr->data.function_literal.is_generator = 0;
     
     return expr;
 }
@@ -215,6 +291,7 @@ Expression* expression_new_call(Expression* function, Expression** arguments, in
     expr->node_type = EXPR_CALL;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.call.function = function;
     expr->data.call.arguments = arguments;
     expr->data.call.argument_count = argument_count;
@@ -229,6 +306,7 @@ Expression* expression_new_infix(Expression* left, char* operator, Expression* r
     expr->node_type = EXPR_INFIX;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.infix.left = left;
     expr->data.infix.operator = operator;
     expr->data.infix.right = right;
@@ -243,6 +321,7 @@ Expression* expression_new_prefix(char* operator, Expression* right, int line, i
     expr->node_type = EXPR_PREFIX;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.prefix.operator = operator;
     expr->data.prefix.right = right;
     
@@ -256,6 +335,7 @@ Expression* expression_new_if(Expression* condition, Statement** then_branch, in
     expr->node_type = EXPR_IF;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.if_expr.condition = condition;
     expr->data.if_expr.then_branch = then_branch;
     expr->data.if_expr.then_count = then_count;
@@ -272,9 +352,11 @@ Expression* expression_new_match(Expression* expression, MatchCase** cases, int
     expr->node_type = EXPR_MATCH;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.match.expression = expression;
     expr->data.match.cases = cases;
     expr->data.match.case_count = case_count;
+    expr->data.match.table = match_table_new(cases, case_count);
     
     return expr;
 }
@@ -286,12 +368,71 @@ Expression* expression_new_pipe(Expression* left, Expression* right, int line, i
     expr->node_type = EXPR_PIPE;
     expr->line = line;
     expr->column = column;
+    expr->resolved_type = NULL;
     expr->data.pipe.left = left;
     expr->data.pipe.right = right;
     
     return expr;
 }
 
+Expression* expression_new_array_literal(Expression** elements, int element_count, int line, int column) {
+    Expression* expr = malloc(sizeof(Expression));
+    if (!expr) return NULL;
+
+    expr->node_type = EXPR_ARRAY_LITERAL;
+    expr->line = line;
+    expr->column = column;
+    expr->resolved_type = NULL;
+    expr->data.array_literal.elements = elements;
+    expr->data.array_literal.element_count = element_count;
+
+    return expr;
+}
+
+Expression* expression_new_index(Expression* array, Expression* index, int line, int column) {
+    Expression* expr = malloc(sizeof(Expression));
+    if (!expr) return NULL;
+
+    expr->node_type = EXPR_INDEX;
+    expr->line = line;
+    expr->column = column;
+    expr->resolved_type = NULL;
+    expr->data.index.array = array;
+    expr->data.index.index = index;
+    expr->data.index.unchecked = 0;
+
+    return expr;
+}
+
+Expression* expression_new_map_literal(Expression** entries, int entry_count, int line, int column) {
+    Expression* expr = malloc(sizeof(Expression));
+    if (!expr) return NULL;
+
+    expr->node_type = EXPR_MAP_LITERAL;
+    expr->line = line;
+    expr->column = column;
+    expr->resolved_type = NULL;
+    expr->data.map_literal.entries = entries;
+    expr->data.map_literal.entry_count = entry_count;
+
+    return expr;
+}
+
+Expression* expression_new_field(Expression* object, char* name, int line, int column) {
+    Expression* expr = malloc(sizeof(Expression));
+    if (!expr) return NULL;
+
+    expr->node_type = EXPR_FIELD;
+    expr->line = line;
+    expr->column = column;
+    expr->resolved_type = NULL;
+    expr->data.field.object = object;
+    expr->data.field.name = name;
+    expr->data.field.offset = -1;
+
+    return expr;
+}
+
 void expression_free(Expression* expr) {
     if (!expr) return;
     
@@ -301,6 +442,7 @@ void expression_free(Expression* expr) {
             break;
         case EXPR_STRING_LITERAL:
             free(expr->data.string_literal.value);
+            string_literal_release(&expr->data.string_literal.literal);
             break;
         case EXPR_FUNCTION_LITERAL:
             for (int i = 0; i < expr->data.function_literal.parameter_count; i++) {
@@ -313,6 +455,7 @@ void expression_free(Expression* expr) {
                 statement_free(expr->data.function_literal.body[i]);
             }
             free(expr->data.function_literal.body);
+            free(expr->data.function_literal.name);
             break;
         case EXPR_CALL:
             expression_free(expr->data.call.function);
@@ -349,11 +492,32 @@ void expression_free(Expression* expr) {
                 match_case_free(expr->data.match.cases[i]);
             }
             free(expr->data.match.cases);
+            match_table_free(expr->data.match.table);
             break;
         case EXPR_PIPE:
             expression_free(expr->data.pipe.left);
             expression_free(expr->data.pipe.right);
             break;
+        case EXPR_ARRAY_LITERAL:
+            for (int i = 0; i < expr->data.array_literal.element_count; i++) {
+                expression_free(expr->data.array_literal.elements[i]);
+            }
+            free(expr->data.array_literal.elements);
+            break;
+        case EXPR_INDEX:
+            expression_free(expr->data.index.array);
+            expression_free(expr->data.index.index);
+            break;
+        case EXPR_MAP_LITERAL:
+            for (int i = 0; i < expr->data.map_literal.entry_count; i++) {
+                expression_free(expr->data.map_literal.entries[i]);
+            }
+            free(expr->data.map_literal.entries);
+            break;
+        case EXPR_FIELD:
+            expression_free(expr->data.field.object);
+            free(expr->data.field.name);
+            break;
         default:
             break;
     }
@@ -418,6 +582,30 @@ Type* type_new_function(Type** params, int param_count, Type* return_type) {
     return type;
 }
 
+Type* type_new_generic(char* name, Type** arguments, int argument_count) {
+    Type* type = malloc(sizeof(Type));
+    if (!type) return NULL;
+
+    type->node_type = TYPE_GENERIC;
+    type->data.generic.name = name;
+    type->data.generic.arguments = arguments;
+    type->data.generic.argument_count = argument_count;
+
+    return type;
+}
+
+Type* type_new_struct(char** field_names, Type** field_types, int field_count) {
+    Type* type = malloc(sizeof(Type));
+    if (!type) return NULL;
+
+    type->node_type = TYPE_STRUCT;
+    type->data.struct_type.field_names = field_names;
+    type->data.struct_type.field_types = field_types;
+    type->data.struct_type.field_count = field_count;
+
+    return type;
+}
+
 void type_free(Type* type) {
     if (!type) return;
     
@@ -440,12 +628,29 @@ void type_free(Type* type) {
             free(type->data.struct_type.field_names);
             free(type->data.struct_type.field_types);
             break;
+        case TYPE_GENERIC:
+            free(type->data.generic.name);
+            for (int i = 0; i < type->data.generic.argument_count; i++) {
+                type_free(type->data.generic.arguments[i]);
+            }
+            free(type->data.generic.arguments);
+            break;
         default:
             break;
     }
     free(type);
 }
 
+static const char* ast_type_name(Type* type) {
+    switch (type->node_type) {
+        case TYPE_IDENTIFIER: return type->data.identifier.name;
+        case TYPE_FUNCTION: return "func";
+        case TYPE_STRUCT: return "struct";
+        case TYPE_GENERIC: return type->data.generic.name;
+        default: return "?";
+    }
+}
+
 void ast_print_program(Program* program, int indent) {
     printf("%*sProgram {\n", indent, "");
     for (int i = 0; i < program->statement_count; i++) {
@@ -463,7 +668,7 @@ void ast_print_statement(Statement* stmt, int indent) {
                    stmt->data.let_stmt.is_const ? "const" : "let",
                    stmt->data.let_stmt.name);
             if (stmt->data.let_stmt.type) {
-                printf(": %s", stmt->data.let_stmt.type->data.identifier.name);
+                printf(": %s", ast_type_name(stmt->data.let_stmt.type));
             }
             printf(" = ");
             ast_print_expression(stmt->data.let_stmt.value, 0);
@@ -479,6 +684,19 @@ void ast_print_statement(Statement* stmt, int indent) {
             ast_print_expression(stmt->data.expression_stmt.expression, 0);
             printf(";\n");
             break;
+        case STMT_YIELD:
+            printf("%*syield ", indent, "");
+            ast_print_expression(stmt->data.yield_stmt.value, 0);
+            printf(";\n");
+            break;
+        case STMT_TYPE:
+            printf("%*stype %s {", indent, "", stmt->data.type_decl.name);
+            for (int i = 0; i < stmt->data.type_decl.type->data.struct_type.field_count; i++) {
+                printf("%s %s: %s", i > 0 ? "," : "", stmt->data.type_decl.type->data.struct_type.field_names[i],
+                       ast_type_name(stmt->data.type_decl.type->data.struct_type.field_types[i]));
+            }
+            printf(" }\n");
+            break;
         default:
             printf("%*sUnknown statement\n", indent, "");
             break;
@@ -510,12 +728,12 @@ void ast_print_expression(Expression* expr, int indent) {
             for (int i = 0; i < expr->data.function_literal.parameter_count; i++) {
                 if (i > 0) printf(", ");
                 printf("%s %s", 
-                       expr->data.function_literal.parameters[i]->type->data.identifier.name,
+                       ast_type_name(expr->data.function_literal.parameters[i]->type),
                        expr->data.function_literal.parameters[i]->name);
             }
             printf(")");
             if (expr->data.function_literal.return_type) {
-                printf(" -> %s", expr->data.function_literal.return_type->data.identifier.name);
+                printf(" -> %s", ast_type_name(expr->data.function_literal.return_type));
             }
             printf(" { ... }");
             break;
@@ -548,11 +766,51 @@ void ast_print_expression(Expression* expr, int indent) {
                 printf(" else { ... }");
             }
             break;
+        case EXPR_MATCH:
+            printf("match (");
+            ast_print_expression(expr->data.match.expression, 0);
+            printf(") {");
+            for (int i = 0; i < expr->data.match.case_count; i++) {
+                printf(i > 0 ? ", " : " ");
+                ast_print_expression(expr->data.match.cases[i]->pattern, 0);
+                printf(" -> ");
+                ast_print_expression(expr->data.match.cases[i]->result, 0);
+            }
+            printf(" }");
+            break;
         case EXPR_PIPE:
             ast_print_expression(expr->data.pipe.left, 0);
             printf(" |> ");
             ast_print_expression(expr->data.pipe.right, 0);
             break;
+        case EXPR_ARRAY_LITERAL:
+            printf("[");
+            for (int i = 0; i < expr->data.array_literal.element_count; i++) {
+                if (i > 0) printf(", ");
+                ast_print_expression(expr->data.array_literal.elements[i], 0);
+            }
+            printf("]");
+            break;
+        case EXPR_INDEX:
+            ast_print_expression(expr->data.index.array, 0);
+            printf("[");
+            ast_print_expression(expr->data.index.index, 0);
+            printf("]");
+            break;
+        case EXPR_MAP_LITERAL:
+            printf("{");
+            for (int i = 0; i < expr->data.map_literal.entry_count; i += 2) {
+                if (i > 0) printf(", ");
+                ast_print_expression(expr->data.map_literal.entries[i], 0);
+                printf(": ");
+                ast_print_expression(expr->data.map_literal.entries[i + 1], 0);
+            }
+            printf("}");
+            break;
+        case EXPR_FIELD:
+            ast_print_expression(expr->data.field.object, 0);
+            printf(".%s", expr->data.field.name);
+            break;
         default:
             printf("Unknown expression");
             break;
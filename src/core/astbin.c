@@ -0,0 +1,1086 @@
+#include "astbin.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ASTBIN_STRING_BUCKETS 256
+
+typedef struct StringEntry {
+    const char* value;
+    uint32_t offset;
+    struct StringEntry* next;
+} StringEntry;
+
+typedef struct AstBinWriter {
+    AstBinNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    uint32_t* indices;
+    uint32_t index_count;
+    uint32_t index_capacity;
+    char* strings;
+    uint32_t strings_size;
+    uint32_t strings_capacity;
+    StringEntry* buckets[ASTBIN_STRING_BUCKETS];
+} AstBinWriter;
+
+static uint32_t write_statement(AstBinWriter* w, Statement* stmt);
+static uint32_t write_expression(AstBinWriter* w, Expression* expr);
+static uint32_t write_type(AstBinWriter* w, Type* type);
+static Statement* build_statement(const AstBinView* view, uint32_t index);
+static Expression* build_expression(const AstBinView* view, uint32_t index);
+static Type* build_type(const AstBinView* view, uint32_t index);
+
+static char* string_duplicate(const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str);
+    char* dup = malloc(len + 1);
+    if (!dup) return NULL;
+    strcpy(dup, str);
+    return dup;
+}
+
+static unsigned int hash_string(const char* str) {
+    unsigned int hash = 5381;
+    int c;
+    while ((c = *str++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash % ASTBIN_STRING_BUCKETS;
+}
+
+// --- Writer ---
+
+static uint32_t add_string(AstBinWriter* w, const char* value) {
+    if (!value) return ASTBIN_NONE;
+
+    StringEntry** bucket = &w->buckets[hash_string(value)];
+    for (StringEntry* entry = *bucket; entry; entry = entry->next) {
+        if (strcmp(entry->value, value) == 0) return entry->offset;
+    }
+
+    uint32_t length = (uint32_t)strlen(value) + 1;
+    if (w->strings_size + length > w->strings_capacity) {
+        uint32_t capacity = w->strings_capacity ? w->strings_capacity : 256;
+        while (w->strings_size + length > capacity) capacity *= 2;
+        w->strings = realloc(w->strings, capacity);
+        w->strings_capacity = capacity;
+    }
+    memcpy(w->strings + w->strings_size, value, length);
+
+    StringEntry* entry = malloc(sizeof(StringEntry));
+    entry->value = value;
+    entry->offset = w->strings_size;
+    entry->next = *bucket;
+    *bucket = entry;
+
+    w->strings_size += length;
+    return entry->offset;
+}
+
+static uint32_t add_node(AstBinWriter* w, int kind, int line, int column) {
+    if (w->node_count >= w->node_capacity) {
+        w->node_capacity = w->node_capacity ? w->node_capacity * 2 : 64;
+        w->nodes = realloc(w->nodes, sizeof(AstBinNode) * w->node_capacity);
+    }
+    AstBinNode* node = &w->nodes[w->node_count];
+    memset(node, 0, sizeof(*node));
+    node->kind = (uint16_t)kind;
+    node->line = line;
+    node->column = column;
+    for (int i = 0; i < 6; i++) node->op[i] = ASTBIN_NONE;
+    return w->node_count++;
+}
+
+// Children are written first, so a node's index is always greater than the
+// indices it refers to; astbin_open relies on this to reject cycles.
+static uint32_t add_range(AstBinWriter* w, const uint32_t* children, int count) {
+    if (w->index_count + (uint32_t)count > w->index_capacity) {
+        uint32_t capacity = w->index_capacity ? w->index_capacity : 64;
+        while (w->index_count + (uint32_t)count > capacity) capacity *= 2;
+        w->indices = realloc(w->indices, sizeof(uint32_t) * capacity);
+        w->index_capacity = capacity;
+    }
+    uint32_t start = w->index_count;
+    if (count > 0) {
+        memcpy(w->indices + start, children, sizeof(uint32_t) * count);
+    }
+    w->index_count += count;
+    return start;
+}
+
+static uint32_t write_statement_list(AstBinWriter* w, Statement** statements, int count) {
+    uint32_t* children = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        children[i] = write_statement(w, statements[i]);
+    }
+    uint32_t start = add_range(w, children, count);
+    free(children);
+    return start;
+}
+
+static uint32_t write_type(AstBinWriter* w, Type* type) {
+    if (!type) return ASTBIN_NONE;
+
+    switch (type->node_type) {
+        case TYPE_IDENTIFIER:
+            {
+                uint32_t name = add_string(w, type->data.identifier.name);
+                uint32_t index = add_node(w, TYPE_IDENTIFIER, 0, 0);
+                w->nodes[index].op[0] = name;
+                return index;
+            }
+        case TYPE_FUNCTION:
+            {
+                int count = type->data.function.param_count;
+                uint32_t* children = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    children[i] = write_type(w, type->data.function.params[i]);
+                }
+                uint32_t start = add_range(w, children, count);
+                free(children);
+                uint32_t return_type = write_type(w, type->data.function.return_type);
+                uint32_t index = add_node(w, TYPE_FUNCTION, 0, 0);
+                w->nodes[index].op[0] = start;
+                w->nodes[index].op[1] = (uint32_t)count;
+                w->nodes[index].op[2] = return_type;
+                return index;
+            }
+        case TYPE_STRUCT:
+            {
+                int count = type->data.struct_type.field_count;
+                uint32_t* children = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    uint32_t name = add_string(w, type->data.struct_type.field_names[i]);
+                    uint32_t field_type = write_type(w, type->data.struct_type.field_types[i]);
+                    children[i] = add_node(w, ASTBIN_FIELD, 0, 0);
+                    w->nodes[children[i]].op[0] = name;
+                    w->nodes[children[i]].op[1] = field_type;
+                }
+                uint32_t start = add_range(w, children, count);
+                free(children);
+                uint32_t index = add_node(w, TYPE_STRUCT, 0, 0);
+                w->nodes[index].op[0] = start;
+                w->nodes[index].op[1] = (uint32_t)count;
+                return index;
+            }
+        case TYPE_GENERIC:
+            {
+                int count = type->data.generic.argument_count;
+                uint32_t* children = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    children[i] = write_type(w, type->data.generic.arguments[i]);
+                }
+                uint32_t start = add_range(w, children, count);
+                free(children);
+                uint32_t name = add_string(w, type->data.generic.name);
+                uint32_t index = add_node(w, TYPE_GENERIC, 0, 0);
+                w->nodes[index].op[0] = name;
+                w->nodes[index].op[1] = start;
+                w->nodes[index].op[2] = (uint32_t)count;
+                return index;
+            }
+        default:
+            return ASTBIN_NONE;
+    }
+}
+
+static uint32_t write_statement(AstBinWriter* w, Statement* stmt) {
+    if (!stmt) return ASTBIN_NONE;
+
+    uint32_t op[6] = { ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE };
+    uint16_t flags = 0;
+
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            op[0] = add_string(w, stmt->data.let_stmt.name);
+            op[1] = write_type(w, stmt->data.let_stmt.type);
+            op[2] = write_expression(w, stmt->data.let_stmt.value);
+            if (stmt->data.let_stmt.is_const) flags |= ASTBIN_FLAG_CONST;
+            break;
+        case STMT_RETURN:
+            op[0] = write_expression(w, stmt->data.return_stmt.return_value);
+            break;
+        case STMT_EXPRESSION:
+            op[0] = write_expression(w, stmt->data.expression_stmt.expression);
+            break;
+        case STMT_YIELD:
+            op[0] = write_expression(w, stmt->data.yield_stmt.value);
+            break;
+        case STMT_BLOCK:
+            op[0] = write_statement_list(w, stmt->data.block_stmt.statements, stmt->data.block_stmt.statement_count);
+            op[1] = (uint32_t)stmt->data.block_stmt.statement_count;
+            break;
+        case STMT_WHILE:
+            op[0] = write_expression(w, stmt->data.while_stmt.condition);
+            op[1] = write_statement(w, stmt->data.while_stmt.body);
+            break;
+        case STMT_FOR:
+            {
+                int count = stmt->data.for_stmt.reduce_count;
+                uint32_t* reductions = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    uint32_t operator = add_string(w, stmt->data.for_stmt.reduce_operators[i]);
+                    uint32_t name = add_string(w, stmt->data.for_stmt.reduce_names[i]);
+                    reductions[i] = add_node(w, ASTBIN_REDUCTION, 0, 0);
+                    w->nodes[reductions[i]].op[0] = operator;
+                    w->nodes[reductions[i]].op[1] = name;
+                }
+                op[0] = add_string(w, stmt->data.for_stmt.variable);
+                op[1] = write_expression(w, stmt->data.for_stmt.start);
+                op[2] = write_expression(w, stmt->data.for_stmt.end);
+                op[3] = write_statement(w, stmt->data.for_stmt.body);
+                op[4] = add_range(w, reductions, count);
+                op[5] = (uint32_t)count;
+                free(reductions);
+                if (stmt->data.for_stmt.is_parallel) flags |= ASTBIN_FLAG_PARALLEL;
+            }
+            break;
+        case STMT_TYPE:
+            op[0] = add_string(w, stmt->data.type_decl.name);
+            op[1] = write_type(w, stmt->data.type_decl.type);
+            break;
+        default:
+            break;
+    }
+
+    uint32_t index = add_node(w, stmt->node_type, stmt->line, stmt->column);
+    w->nodes[index].flags = flags;
+    memcpy(w->nodes[index].op, op, sizeof(op));
+    return index;
+}
+
+static uint32_t write_expression(AstBinWriter* w, Expression* expr) {
+    if (!expr) return ASTBIN_NONE;
+
+    uint32_t op[6] = { ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE, ASTBIN_NONE };
+    uint16_t flags = 0;
+
+    switch (expr->node_type) {
+        case EXPR_IDENTIFIER:
+            op[0] = add_string(w, expr->data.identifier.value);
+            break;
+        case EXPR_INTEGER_LITERAL:
+            {
+                int64_t value = expr->data.integer_literal.value;
+                memcpy(op, &value, sizeof(value));
+            }
+            break;
+        case EXPR_FLOAT_LITERAL:
+            memcpy(op, &expr->data.float_literal.value, sizeof(double));
+            break;
+        case EXPR_STRING_LITERAL:
+            op[0] = add_string(w, expr->data.string_literal.value);
+            break;
+        case EXPR_BOOLEAN_LITERAL:
+            op[0] = (uint32_t)expr->data.boolean_literal.value;
+            break;
+        case EXPR_FUNCTION_LITERAL:
+            {
+                int count = expr->data.function_literal.parameter_count;
+                uint32_t* params = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    Parameter* param = expr->data.function_literal.parameters[i];
+                    uint32_t name = add_string(w, param->name);
+                    uint32_t type = write_type(w, param->type);
+                    params[i] = add_node(w, ASTBIN_PARAMETER, 0, 0);
+                    w->nodes[params[i]].op[0] = name;
+                    w->nodes[params[i]].op[1] = type;
+                }
+                op[0] = add_range(w, params, count);
+                op[1] = (uint32_t)count;
+                free(params);
+                op[2] = write_type(w, expr->data.function_literal.return_type);
+                op[3] = write_statement_list(w, expr->data.function_literal.body, expr->data.function_literal.body_count);
+                op[4] = (uint32_t)expr->data.function_literal.body_count;
+                op[5] = add_string(w, expr->data.function_literal.name);
+                if (expr->data.function_literal.is_pure) flags |= ASTBIN_FLAG_PURE;
+                if (expr->data.function_literal.is_memo) flags |= ASTBIN_FLAG_MEMO;
+                if (expr->data.function_literal.is_generator) flags |= ASTBIN_FLAG_GENERATOR;
+            }
+            break;
+        case EXPR_CALL:
+            {
+                int count = expr->data.call.argument_count;
+                uint32_t* args = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                op[0] = write_expression(w, expr->data.call.function);
+                for (int i = 0; i < count; i++) {
+                    args[i] = write_expression(w, expr->data.call.arguments[i]);
+                }
+                op[1] = add_range(w, args, count);
+                op[2] = (uint32_t)count;
+                free(args);
+            }
+            break;
+        case EXPR_INFIX:
+            op[0] = write_expression(w, expr->data.infix.left);
+            op[1] = add_string(w, expr->data.infix.operator);
+            op[2] = write_expression(w, expr->data.infix.right);
+            break;
+        case EXPR_PREFIX:
+            op[0] = add_string(w, expr->data.prefix.operator);
+            op[1] = write_expression(w, expr->data.prefix.right);
+            break;
+        case EXPR_IF:
+            op[0] = write_expression(w, expr->data.if_expr.condition);
+            op[1] = write_statement_list(w, expr->data.if_expr.then_branch, expr->data.if_expr.then_count);
+            op[2] = (uint32_t)expr->data.if_expr.then_count;
+            if (expr->data.if_expr.else_branch) {
+                flags |= ASTBIN_FLAG_HAS_ELSE;
+                op[3] = write_statement_list(w, expr->data.if_expr.else_branch, expr->data.if_expr.else_count);
+                op[4] = (uint32_t)expr->data.if_expr.else_count;
+            }
+            break;
+        case EXPR_MATCH:
+            {
+                int count = expr->data.match.case_count;
+                uint32_t* cases = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                op[0] = write_expression(w, expr->data.match.expression);
+                for (int i = 0; i < count; i++) {
+                    uint32_t pattern = write_expression(w, expr->data.match.cases[i]->pattern);
+                    uint32_t result = write_expression(w, expr->data.match.cases[i]->result);
+                    cases[i] = add_node(w, ASTBIN_MATCH_CASE, 0, 0);
+                    w->nodes[cases[i]].op[0] = pattern;
+                    w->nodes[cases[i]].op[1] = result;
+                }
+                op[1] = add_range(w, cases, count);
+                op[2] = (uint32_t)count;
+                free(cases);
+            }
+            break;
+        case EXPR_PIPE:
+            op[0] = write_expression(w, expr->data.pipe.left);
+            op[1] = write_expression(w, expr->data.pipe.right);
+            break;
+        case EXPR_ARRAY_LITERAL:
+            {
+                int count = expr->data.array_literal.element_count;
+                uint32_t* elements = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    elements[i] = write_expression(w, expr->data.array_literal.elements[i]);
+                }
+                op[0] = add_range(w, elements, count);
+                op[1] = (uint32_t)count;
+                free(elements);
+            }
+            break;
+        case EXPR_MAP_LITERAL:
+            {
+                int count = expr->data.map_literal.entry_count;
+                uint32_t* entries = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    entries[i] = write_expression(w, expr->data.map_literal.entries[i]);
+                }
+                op[0] = add_range(w, entries, count);
+                op[1] = (uint32_t)count;
+                free(entries);
+            }
+            break;
+        case EXPR_INDEX:
+            op[0] = write_expression(w, expr->data.index.array);
+            op[1] = write_expression(w, expr->data.index.index);
+            if (expr->data.index.unchecked) flags |= ASTBIN_FLAG_UNCHECKED;
+            break;
+        case EXPR_FIELD:
+            op[0] = write_expression(w, expr->data.field.object);
+            op[1] = add_string(w, expr->data.field.name);
+            op[2] = (uint32_t)expr->data.field.offset;
+            break;
+        default:
+            break;
+    }
+
+    uint32_t index = add_node(w, expr->node_type, expr->line, expr->column);
+    w->nodes[index].flags = flags;
+    memcpy(w->nodes[index].op, op, sizeof(op));
+    return index;
+}
+
+static void writer_free(AstBinWriter* w) {
+    for (int i = 0; i < ASTBIN_STRING_BUCKETS; i++) {
+        StringEntry* entry = w->buckets[i];
+        while (entry) {
+            StringEntry* next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(w->nodes);
+    free(w->indices);
+    free(w->strings);
+}
+
+int astbin_write(const char* path, Program* program) {
+    AstBinWriter writer;
+    memset(&writer, 0, sizeof(writer));
+
+    uint32_t root_start = write_statement_list(&writer, program->statements, program->statement_count);
+
+    AstBinHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASTBIN_MAGIC, sizeof(ASTBIN_MAGIC));
+    header.version = ASTBIN_VERSION;
+    header.node_count = writer.node_count;
+    header.index_count = writer.index_count;
+    header.strings_size = writer.strings_size;
+    header.root_start = root_start;
+    header.root_count = (uint32_t)program->statement_count;
+
+    FILE* file = fopen(path, "wb");
+    int ok = file != NULL;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(writer.nodes, sizeof(AstBinNode), writer.node_count, file) == writer.node_count &&
+             fwrite(writer.indices, sizeof(uint32_t), writer.index_count, file) == writer.index_count &&
+             fwrite(writer.strings, 1, writer.strings_size, file) == writer.strings_size;
+        ok = (fclose(file) == 0) && ok;
+    }
+
+    writer_free(&writer);
+    return ok;
+}
+
+// --- Reader ---
+
+const AstBinNode* astbin_node(const AstBinView* view, uint32_t index) {
+    if (index >= view->header->node_count) return NULL;
+    return &view->nodes[index];
+}
+
+const char* astbin_string(const AstBinView* view, uint32_t offset) {
+    if (offset >= view->header->strings_size) return NULL;
+    return view->strings + offset;
+}
+
+uint32_t astbin_child(const AstBinView* view, uint32_t start, uint32_t i) {
+    return view->indices[start + i];
+}
+
+int64_t astbin_integer(const AstBinNode* node) {
+    int64_t value;
+    memcpy(&value, node->op, sizeof(value));
+    return value;
+}
+
+double astbin_float(const AstBinNode* node) {
+    double value;
+    memcpy(&value, node->op, sizeof(value));
+    return value;
+}
+
+// What a child slot holds: any node of one of the three families, or one
+// of the ASTBIN_* pieces exactly.
+#define SLOT_EXPRESSION -1
+#define SLOT_STATEMENT -2
+#define SLOT_TYPE -3
+
+static int is_expression_kind(int kind) {
+    return (kind >= EXPR_IDENTIFIER && kind <= EXPR_PIPE) ||
+           (kind >= EXPR_ARRAY_LITERAL && kind <= EXPR_MAP_LITERAL) || kind == EXPR_FIELD;
+}
+
+static int is_statement_kind(int kind) {
+    return (kind >= STMT_LET && kind <= STMT_WHILE) || kind == STMT_YIELD || kind == STMT_TYPE;
+}
+
+static int is_type_kind(int kind) {
+    return kind >= TYPE_IDENTIFIER && kind <= TYPE_GENERIC;
+}
+
+static int fits_slot(const AstBinView* view, uint32_t child, int slot) {
+    int kind = view->nodes[child].kind;
+    switch (slot) {
+        case SLOT_EXPRESSION: return is_expression_kind(kind);
+        case SLOT_STATEMENT: return is_statement_kind(kind);
+        case SLOT_TYPE: return is_type_kind(kind);
+        default: return kind == slot;
+    }
+}
+
+static int required_child(const AstBinView* view, uint32_t parent, uint32_t child, int slot) {
+    return child < parent && fits_slot(view, child, slot);
+}
+
+static int optional_child(const AstBinView* view, uint32_t parent, uint32_t child, int slot) {
+    return child == ASTBIN_NONE || required_child(view, parent, child, slot);
+}
+
+static int valid_string(const AstBinView* view, uint32_t offset) {
+    return offset == ASTBIN_NONE || offset < view->header->strings_size;
+}
+
+static int valid_range(const AstBinView* view, uint32_t parent, uint32_t start, uint32_t count, int slot) {
+    if (start > view->header->index_count || count > view->header->index_count - start) return 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!required_child(view, parent, view->indices[start + i], slot)) return 0;
+    }
+    return 1;
+}
+
+// Checks every reference once so the accessors and walkers can trust the
+// mapping. Children must precede their parent, which rules out cycles, and
+// be of the kind their slot holds; only the slots the parser itself may
+// leave empty, such as a missing type annotation, accept ASTBIN_NONE.
+static int validate(const AstBinView* view) {
+    const AstBinHeader* h = view->header;
+
+    if (h->strings_size > 0 && view->strings[h->strings_size - 1] != '\0') return 0;
+    if (!valid_range(view, h->node_count, h->root_start, h->root_count, SLOT_STATEMENT)) return 0;
+
+    for (uint32_t i = 0; i < h->node_count; i++) {
+        const AstBinNode* n = &view->nodes[i];
+        const uint32_t* op = n->op;
+        int ok;
+
+        switch (n->kind) {
+            case EXPR_IDENTIFIER:
+            case EXPR_STRING_LITERAL:
+            case TYPE_IDENTIFIER:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]);
+                break;
+            case EXPR_INTEGER_LITERAL:
+            case EXPR_FLOAT_LITERAL:
+            case EXPR_BOOLEAN_LITERAL:
+                ok = 1;
+                break;
+            case EXPR_FUNCTION_LITERAL:
+                ok = valid_range(view, i, op[0], op[1], ASTBIN_PARAMETER) && optional_child(view, i, op[2], SLOT_TYPE) &&
+                     valid_range(view, i, op[3], op[4], SLOT_STATEMENT) && valid_string(view, op[5]);
+                break;
+            case EXPR_CALL:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && valid_range(view, i, op[1], op[2], SLOT_EXPRESSION);
+                break;
+            case EXPR_MATCH:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && valid_range(view, i, op[1], op[2], ASTBIN_MATCH_CASE);
+                break;
+            case EXPR_INFIX:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && op[1] != ASTBIN_NONE &&
+                     valid_string(view, op[1]) && required_child(view, i, op[2], SLOT_EXPRESSION);
+                break;
+            case EXPR_PREFIX:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) && required_child(view, i, op[1], SLOT_EXPRESSION);
+                break;
+            case EXPR_IF:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && valid_range(view, i, op[1], op[2], SLOT_STATEMENT) &&
+                     (!(n->flags & ASTBIN_FLAG_HAS_ELSE) || valid_range(view, i, op[3], op[4], SLOT_STATEMENT));
+                break;
+            case EXPR_PIPE:
+            case EXPR_INDEX:
+            case ASTBIN_MATCH_CASE:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && required_child(view, i, op[1], SLOT_EXPRESSION);
+                break;
+            case STMT_WHILE:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && required_child(view, i, op[1], SLOT_STATEMENT);
+                break;
+            case STMT_LET:
+            case STMT_CONST:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) &&
+                     optional_child(view, i, op[1], SLOT_TYPE) && required_child(view, i, op[2], SLOT_EXPRESSION);
+                break;
+            case STMT_FOR:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) &&
+                     required_child(view, i, op[1], SLOT_EXPRESSION) && optional_child(view, i, op[2], SLOT_EXPRESSION) &&
+                     required_child(view, i, op[3], SLOT_STATEMENT) && valid_range(view, i, op[4], op[5], ASTBIN_REDUCTION);
+                break;
+            case STMT_RETURN:
+            case STMT_EXPRESSION:
+            case STMT_YIELD:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION);
+                break;
+            case STMT_TYPE:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) && required_child(view, i, op[1], TYPE_STRUCT);
+                break;
+            case EXPR_FIELD:
+                ok = required_child(view, i, op[0], SLOT_EXPRESSION) && op[1] != ASTBIN_NONE && valid_string(view, op[1]);
+                break;
+            case STMT_BLOCK:
+                ok = valid_range(view, i, op[0], op[1], SLOT_STATEMENT);
+                break;
+            case TYPE_STRUCT:
+                ok = valid_range(view, i, op[0], op[1], ASTBIN_FIELD);
+                break;
+            case EXPR_ARRAY_LITERAL:
+                ok = valid_range(view, i, op[0], op[1], SLOT_EXPRESSION);
+                break;
+            case EXPR_MAP_LITERAL:
+                ok = valid_range(view, i, op[0], op[1], SLOT_EXPRESSION) && op[1] % 2 == 0;
+                break;
+            case TYPE_FUNCTION:
+                ok = valid_range(view, i, op[0], op[1], SLOT_TYPE) && optional_child(view, i, op[2], SLOT_TYPE);
+                break;
+            case TYPE_GENERIC:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) && valid_range(view, i, op[1], op[2], SLOT_TYPE);
+                break;
+            case ASTBIN_REDUCTION:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) &&
+                     op[1] != ASTBIN_NONE && valid_string(view, op[1]);
+                break;
+            case ASTBIN_PARAMETER:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) && optional_child(view, i, op[1], SLOT_TYPE);
+                break;
+            case ASTBIN_FIELD:
+                ok = op[0] != ASTBIN_NONE && valid_string(view, op[0]) && required_child(view, i, op[1], SLOT_TYPE);
+                break;
+            default:
+                ok = 0;
+                break;
+        }
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+AstBinView* astbin_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AstBinHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return NULL;
+
+    const AstBinHeader* header = mapping;
+    size_t nodes_size = (size_t)header->node_count * sizeof(AstBinNode);
+    size_t indices_size = (size_t)header->index_count * sizeof(uint32_t);
+
+    if (memcmp(header->magic, ASTBIN_MAGIC, sizeof(ASTBIN_MAGIC)) != 0 ||
+        header->version != ASTBIN_VERSION ||
+        sizeof(AstBinHeader) + nodes_size + indices_size + header->strings_size != size) {
+        munmap(mapping, size);
+        return NULL;
+    }
+
+    AstBinView* view = malloc(sizeof(AstBinView));
+    view->header = header;
+    view->nodes = (const AstBinNode*)((const char*)mapping + sizeof(AstBinHeader));
+    view->indices = (const uint32_t*)((const char*)view->nodes + nodes_size);
+    view->strings = (const char*)view->indices + indices_size;
+    view->mapping = mapping;
+    view->mapping_size = size;
+
+    if (!validate(view)) {
+        astbin_close(view);
+        return NULL;
+    }
+    return view;
+}
+
+void astbin_close(AstBinView* view) {
+    if (!view) return;
+    munmap(view->mapping, view->mapping_size);
+    free(view);
+}
+
+// --- Deserialization ---
+
+static char* copy_string(const AstBinView* view, uint32_t offset) {
+    return offset == ASTBIN_NONE ? NULL : string_duplicate(astbin_string(view, offset));
+}
+
+static Statement** build_statement_list(const AstBinView* view, uint32_t start, uint32_t count) {
+    Statement** statements = malloc(sizeof(Statement*) * (count > 0 ? count : 1));
+    for (uint32_t i = 0; i < count; i++) {
+        statements[i] = build_statement(view, astbin_child(view, start, i));
+    }
+    return statements;
+}
+
+static Type* build_type(const AstBinView* view, uint32_t index) {
+    const AstBinNode* n = astbin_node(view, index);
+    if (!n) return NULL;
+
+    switch (n->kind) {
+        case TYPE_IDENTIFIER:
+            return type_new_identifier(copy_string(view, n->op[0]));
+        case TYPE_FUNCTION:
+            {
+                Type** params = malloc(sizeof(Type*) * (n->op[1] > 0 ? n->op[1] : 1));
+                for (uint32_t i = 0; i < n->op[1]; i++) {
+                    params[i] = build_type(view, astbin_child(view, n->op[0], i));
+                }
+                return type_new_function(params, (int)n->op[1], build_type(view, n->op[2]));
+            }
+        case TYPE_STRUCT:
+            {
+                Type* type = malloc(sizeof(Type));
+                uint32_t count = n->op[1];
+                type->node_type = TYPE_STRUCT;
+                type->data.struct_type.field_count = (int)count;
+                type->data.struct_type.field_names = malloc(sizeof(char*) * (count > 0 ? count : 1));
+                type->data.struct_type.field_types = malloc(sizeof(Type*) * (count > 0 ? count : 1));
+                for (uint32_t i = 0; i < count; i++) {
+                    const AstBinNode* field = astbin_node(view, astbin_child(view, n->op[0], i));
+                    type->data.struct_type.field_names[i] = copy_string(view, field->op[0]);
+                    type->data.struct_type.field_types[i] = build_type(view, field->op[1]);
+                }
+                return type;
+            }
+        case TYPE_GENERIC:
+            {
+                Type** arguments = malloc(sizeof(Type*) * (n->op[2] > 0 ? n->op[2] : 1));
+                for (uint32_t i = 0; i < n->op[2]; i++) {
+                    arguments[i] = build_type(view, astbin_child(view, n->op[1], i));
+                }
+                return type_new_generic(copy_string(view, n->op[0]), arguments, (int)n->op[2]);
+            }
+        default:
+            return NULL;
+    }
+}
+
+static Statement* build_statement(const AstBinView* view, uint32_t index) {
+    const AstBinNode* n = astbin_node(view, index);
+    if (!n) return NULL;
+
+    switch (n->kind) {
+        case STMT_LET:
+        case STMT_CONST:
+            {
+                Statement* stmt = statement_new_let(copy_string(view, n->op[0]), build_type(view, n->op[1]),
+                                                    build_expression(view, n->op[2]),
+                                                    (n->flags & ASTBIN_FLAG_CONST) != 0, n->line, n->column);
+                stmt->node_type = n->kind;
+                return stmt;
+            }
+        case STMT_RETURN:
+            return statement_new_return(build_expression(view, n->op[0]), n->line, n->column);
+        case STMT_EXPRESSION:
+            return statement_new_expression(build_expression(view, n->op[0]), n->line, n->column);
+        case STMT_YIELD:
+            return statement_new_yield(build_expression(view, n->op[0]), n->line, n->column);
+        case STMT_BLOCK:
+            return statement_new_block(build_statement_list(view, n->op[0], n->op[1]), (int)n->op[1], n->line, n->column);
+        case STMT_WHILE:
+            return statement_new_while(build_expression(view, n->op[0]), build_statement(view, n->op[1]), n->line, n->column);
+        case STMT_FOR:
+            {
+                Statement* stmt = statement_new_for(copy_string(view, n->op[0]), build_expression(view, n->op[1]),
+                                                    build_expression(view, n->op[2]), build_statement(view, n->op[3]),
+                                                    n->line, n->column);
+                stmt->data.for_stmt.is_parallel = (n->flags & ASTBIN_FLAG_PARALLEL) != 0;
+                int count = (int)n->op[5];
+                if (count > 0) {
+                    stmt->data.for_stmt.reduce_operators = malloc(sizeof(char*) * count);
+                    stmt->data.for_stmt.reduce_names = malloc(sizeof(char*) * count);
+                    for (int i = 0; i < count; i++) {
+                        const AstBinNode* reduction = astbin_node(view, astbin_child(view, n->op[4], (uint32_t)i));
+                        stmt->data.for_stmt.reduce_operators[i] = copy_string(view, reduction ? reduction->op[0] : ASTBIN_NONE);
+                        stmt->data.for_stmt.reduce_names[i] = copy_string(view, reduction ? reduction->op[1] : ASTBIN_NONE);
+                    }
+                    stmt->data.for_stmt.reduce_count = count;
+                }
+                return stmt;
+            }
+        case STMT_TYPE:
+            return statement_new_type(copy_string(view, n->op[0]), build_type(view, n->op[1]), n->line, n->column);
+        default:
+            return NULL;
+    }
+}
+
+static Expression* build_expression(const AstBinView* view, uint32_t index) {
+    const AstBinNode* n = astbin_node(view, index);
+    if (!n) return NULL;
+
+    switch (n->kind) {
+        case EXPR_IDENTIFIER:
+            return expression_new_identifier(copy_string(view, n->op[0]), n->line, n->column);
+        case EXPR_INTEGER_LITERAL:
+            return expression_new_integer_literal((int)astbin_integer(n), n->line, n->column);
+        case EXPR_FLOAT_LITERAL:
+            return expression_new_float_literal(astbin_float(n), n->line, n->column);
+        case EXPR_STRING_LITERAL:
+            return expression_new_string_literal(copy_string(view, n->op[0]), n->line, n->column);
+        case EXPR_BOOLEAN_LITERAL:
+            return expression_new_boolean_literal((int)n->op[0], n->line, n->column);
+        case EXPR_FUNCTION_LITERAL:
+            {
+                Parameter** params = malloc(sizeof(Parameter*) * (n->op[1] > 0 ? n->op[1] : 1));
+                for (uint32_t i = 0; i < n->op[1]; i++) {
+                    const AstBinNode* param = astbin_node(view, astbin_child(view, n->op[0], i));
+                    params[i] = parameter_new(build_type(view, param->op[1]), copy_string(view, param->op[0]));
+                }
+                Expression* expr = expression_new_function_literal(params, (int)n->op[1], build_type(view, n->op[2]),
+                                                                   build_statement_list(view, n->op[3], n->op[4]), (int)n->op[4],
+                                                                   n->line, n->column);
+                expr->data.function_literal.name = copy_string(view, n->op[5]);
+                expr->data.function_literal.is_pure = (n->flags & ASTBIN_FLAG_PURE) != 0;
+                expr->data.function_literal.is_memo = (n->flags & ASTBIN_FLAG_MEMO) != 0;
+                expr->data.function_literal.is_generator = (n->flags & ASTBIN_FLAG_GENERATOR) != 0;
+                return expr;
+            }
+        case EXPR_CALL:
+            {
+                Expression** args = malloc(sizeof(Expression*) * (n->op[2] > 0 ? n->op[2] : 1));
+                for (uint32_t i = 0; i < n->op[2]; i++) {
+                    args[i] = build_expression(view, astbin_child(view, n->op[1], i));
+                }
+                return expression_new_call(build_expression(view, n->op[0]), args, (int)n->op[2], n->line, n->column);
+            }
+        case EXPR_INFIX:
+            return expression_new_infix(build_expression(view, n->op[0]), copy_string(view, n->op[1]),
+                                         build_expression(view, n->op[2]), n->line, n->column);
+        case EXPR_PREFIX:
+            return expression_new_prefix(copy_string(view, n->op[0]), build_expression(view, n->op[1]), n->line, n->column);
+        case EXPR_IF:
+            {
+                Statement** else_branch = NULL;
+                int else_count = 0;
+                if (n->flags & ASTBIN_FLAG_HAS_ELSE) {
+                    else_branch = build_statement_list(view, n->op[3], n->op[4]);
+                    else_count = (int)n->op[4];
+                }
+                return expression_new_if(build_expression(view, n->op[0]),
+                                         build_statement_list(view, n->op[1], n->op[2]), (int)n->op[2],
+                                         else_branch, else_count, n->line, n->column);
+            }
+        case EXPR_MATCH:
+            {
+                MatchCase** cases = malloc(sizeof(MatchCase*) * (n->op[2] > 0 ? n->op[2] : 1));
+                for (uint32_t i = 0; i < n->op[2]; i++) {
+                    const AstBinNode* match_case = astbin_node(view, astbin_child(view, n->op[1], i));
+                    cases[i] = match_case_new(build_expression(view, match_case->op[0]),
+                                              build_expression(view, match_case->op[1]));
+                }
+                return expression_new_match(build_expression(view, n->op[0]), cases, (int)n->op[2], n->line, n->column);
+            }
+        case EXPR_PIPE:
+            return expression_new_pipe(build_expression(view, n->op[0]), build_expression(view, n->op[1]), n->line, n->column);
+        case EXPR_ARRAY_LITERAL:
+            {
+                Expression** elements = malloc(sizeof(Expression*) * (n->op[1] > 0 ? n->op[1] : 1));
+                for (uint32_t i = 0; i < n->op[1]; i++) {
+                    elements[i] = build_expression(view, astbin_child(view, n->op[0], i));
+                }
+                return expression_new_array_literal(elements, (int)n->op[1], n->line, n->column);
+            }
+        case EXPR_MAP_LITERAL:
+            {
+                Expression** entries = malloc(sizeof(Expression*) * (n->op[1] > 0 ? n->op[1] : 1));
+                for (uint32_t i = 0; i < n->op[1]; i++) {
+                    entries[i] = build_expression(view, astbin_child(view, n->op[0], i));
+                }
+                return expression_new_map_literal(entries, (int)n->op[1], n->line, n->column);
+            }
+        case EXPR_INDEX:
+            {
+                Expression* expr = expression_new_index(build_expression(view, n->op[0]),
+                                                        build_expression(view, n->op[1]), n->line, n->column);
+                expr->data.index.unchecked = (n->flags & ASTBIN_FLAG_UNCHECKED) != 0;
+                return expr;
+            }
+        case EXPR_FIELD:
+            {
+                // op[2], the field's offset, is left for the analyzer to
+                // resolve again, as for parsed source: read from the file
+                // it could index past the end of the record.
+                return expression_new_field(build_expression(view, n->op[0]), copy_string(view, n->op[1]),
+                                            n->line, n->column);
+            }
+        default:
+            return NULL;
+    }
+}
+
+Program* astbin_to_program(const AstBinView* view) {
+    Program* program = program_new();
+    for (uint32_t i = 0; i < view->header->root_count; i++) {
+        program_add_statement(program, build_statement(view, astbin_child(view, view->header->root_start, i)));
+    }
+    return program;
+}
+
+// --- In-place printing ---
+
+static void print_expression(const AstBinView* view, uint32_t index);
+
+static const char* type_name(const AstBinView* view, uint32_t index) {
+    const AstBinNode* n = astbin_node(view, index);
+    switch (n ? n->kind : ASTBIN_NONE) {
+        case TYPE_IDENTIFIER: return astbin_string(view, n->op[0]);
+        case TYPE_FUNCTION: return "func";
+        case TYPE_STRUCT: return "struct";
+        case TYPE_GENERIC: return astbin_string(view, n->op[0]);
+        default: return "?";
+    }
+}
+
+static void print_statement(const AstBinView* view, uint32_t index, int indent) {
+    const AstBinNode* n = astbin_node(view, index);
+    if (!n) return;
+
+    switch (n->kind) {
+        case STMT_LET:
+        case STMT_CONST:
+            printf("%*s%s %s", indent, "", (n->flags & ASTBIN_FLAG_CONST) ? "const" : "let", astbin_string(view, n->op[0]));
+            if (n->op[1] != ASTBIN_NONE) {
+                printf(": %s", type_name(view, n->op[1]));
+            }
+            printf(" = ");
+            print_expression(view, n->op[2]);
+            printf(";\n");
+            break;
+        case STMT_RETURN:
+            printf("%*sreturn ", indent, "");
+            print_expression(view, n->op[0]);
+            printf(";\n");
+            break;
+        case STMT_EXPRESSION:
+            printf("%*s", indent, "");
+            print_expression(view, n->op[0]);
+            printf(";\n");
+            break;
+        case STMT_YIELD:
+            printf("%*syield ", indent, "");
+            print_expression(view, n->op[0]);
+            printf(";\n");
+            break;
+        case STMT_TYPE:
+            {
+                const AstBinNode* type = astbin_node(view, n->op[1]);
+                printf("%*stype %s {", indent, "", astbin_string(view, n->op[0]));
+                for (uint32_t i = 0; i < type->op[1]; i++) {
+                    const AstBinNode* field = astbin_node(view, astbin_child(view, type->op[0], i));
+                    printf("%s %s: %s", i > 0 ? "," : "", astbin_string(view, field->op[0]), type_name(view, field->op[1]));
+                }
+                printf(" }\n");
+            }
+            break;
+        default:
+            printf("%*sUnknown statement\n", indent, "");
+            break;
+    }
+}
+
+static void print_expression(const AstBinView* view, uint32_t index) {
+    const AstBinNode* n = astbin_node(view, index);
+    if (!n) return;
+
+    switch (n->kind) {
+        case EXPR_IDENTIFIER:
+            printf("%s", astbin_string(view, n->op[0]));
+            break;
+        case EXPR_INTEGER_LITERAL:
+            printf("%d", (int)astbin_integer(n));
+            break;
+        case EXPR_FLOAT_LITERAL:
+            printf("%f", astbin_float(n));
+            break;
+        case EXPR_STRING_LITERAL:
+            printf("\"%s\"", astbin_string(view, n->op[0]));
+            break;
+        case EXPR_BOOLEAN_LITERAL:
+            printf("%s", n->op[0] ? "true" : "false");
+            break;
+        case EXPR_FUNCTION_LITERAL:
+            printf("func(");
+            for (uint32_t i = 0; i < n->op[1]; i++) {
+                const AstBinNode* param = astbin_node(view, astbin_child(view, n->op[0], i));
+                if (i > 0) printf(", ");
+                printf("%s %s", type_name(view, param->op[1]), astbin_string(view, param->op[0]));
+            }
+            printf(")");
+            if (n->op[2] != ASTBIN_NONE) {
+                printf(" -> %s", type_name(view, n->op[2]));
+            }
+            printf(" { ... }");
+            break;
+        case EXPR_CALL:
+            print_expression(view, n->op[0]);
+            printf("(");
+            for (uint32_t i = 0; i < n->op[2]; i++) {
+                if (i > 0) printf(", ");
+                print_expression(view, astbin_child(view, n->op[1], i));
+            }
+            printf(")");
+            break;
+        case EXPR_INFIX:
+            printf("(");
+            print_expression(view, n->op[0]);
+            printf(" %s ", astbin_string(view, n->op[1]));
+            print_expression(view, n->op[2]);
+            printf(")");
+            break;
+        case EXPR_PREFIX:
+            printf("(%s", astbin_string(view, n->op[0]));
+            print_expression(view, n->op[1]);
+            printf(")");
+            break;
+        case EXPR_IF:
+            printf("if (");
+            print_expression(view, n->op[0]);
+            printf(") { ... }");
+            if (n->flags & ASTBIN_FLAG_HAS_ELSE) {
+                printf(" else { ... }");
+            }
+            break;
+        case EXPR_MATCH:
+            printf("match (");
+            print_expression(view, n->op[0]);
+            printf(") {");
+            for (uint32_t i = 0; i < n->op[2]; i++) {
+                const AstBinNode* match_case = astbin_node(view, astbin_child(view, n->op[1], i));
+                printf(i > 0 ? ", " : " ");
+                print_expression(view, match_case->op[0]);
+                printf(" -> ");
+                print_expression(view, match_case->op[1]);
+            }
+            printf(" }");
+            break;
+        case EXPR_PIPE:
+            print_expression(view, n->op[0]);
+            printf(" |> ");
+            print_expression(view, n->op[1]);
+            break;
+        case EXPR_ARRAY_LITERAL:
+            printf("[");
+            for (uint32_t i = 0; i < n->op[1]; i++) {
+                if (i > 0) printf(", ");
+                print_expression(view, astbin_child(view, n->op[0], i));
+            }
+            printf("]");
+            break;
+        case EXPR_INDEX:
+            print_expression(view, n->op[0]);
+            printf("[");
+            print_expression(view, n->op[1]);
+            printf("]");
+            break;
+        case EXPR_FIELD:
+            print_expression(view, n->op[0]);
+            printf(".%s", astbin_string(view, n->op[1]));
+            break;
+        case EXPR_MAP_LITERAL:
+            printf("{");
+            for (uint32_t i = 0; i + 1 < n->op[1]; i += 2) {
+                if (i > 0) printf(", ");
+                print_expression(view, astbin_child(view, n->op[0], i));
+                printf(": ");
+                print_expression(view, astbin_child(view, n->op[0], i + 1));
+            }
+            printf("}");
+            break;
+        default:
+            printf("Unknown expression");
+            break;
+    }
+}
+
+void astbin_print_program(const AstBinView* view, int indent) {
+    printf("%*sProgram {\n", indent, "");
+    for (uint32_t i = 0; i < view->header->root_count; i++) {
+        print_statement(view, astbin_child(view, view->header->root_start, i), indent + 2);
+    }
+    printf("%*s}\n", indent, "");
+}
@@ -1,23 +1,17 @@
 #include "environment.h"
+#include "heap.h"
+#include "object.h"
+#include "vm.h"
 #include <stdlib.h>
 #include <string.h>
 
-static unsigned int hash_string(const char* str) {
+static unsigned int hash_string(const char* str, unsigned int table_size) {
     unsigned int hash = 5381;
     int c;
     while ((c = *str++)) {
         hash = ((hash << 5) + hash) + c;
     }
-    return hash % HASH_TABLE_SIZE;
-}
-
-static char* string_duplicate(const char* str) {
-    if (!str) return NULL;
-    size_t len = strlen(str);
-    char* dup = malloc(len + 1);
-    if (!dup) return NULL;
-    strcpy(dup, str);
-    return dup;
+    return hash % table_size;
 }
 
 Environment* environment_new(void) {
@@ -25,21 +19,113 @@ Environment* environment_new(void) {
     if (!env) return NULL;
     
     env->entries = calloc(HASH_TABLE_SIZE, sizeof(EnvEntry*));
+    env->table_size = HASH_TABLE_SIZE;
     env->outer = NULL;
+    env->heap = NULL;
+    env->spare = NULL;
+    env->captured = 0;
     
     return env;
 }
 
-Environment* environment_new_enclosed(Environment* outer) {
-    Environment* env = environment_new();
+static Environment* heap_environment_init(Environment* env, Heap* heap, Environment* outer) {
+    env->entries = NULL;
+    env->table_size = HEAP_TABLE_SIZE;
     env->outer = outer;
+    env->heap = heap;
+    env->spare = NULL;
+    env->captured = 0;
     return env;
 }
 
+Environment* environment_new_on_heap(Heap* heap, Environment* outer) {
+    return heap_environment_init(heap_alloc(heap, sizeof(Environment)), heap, outer);
+}
+
+Environment* environment_new_beside(Heap* heap, const void* holder, Environment* outer) {
+    return heap_environment_init(heap_alloc_beside(heap, holder, sizeof(Environment)), heap, outer);
+}
+
+void environment_capture(Environment* env) {
+    for (; env && !env->captured; env = env->outer) {
+        env->captured = 1;
+    }
+}
+
+void environment_clear(Environment* env) {
+    if (!env->entries) return;
+    for (unsigned int i = 0; i < env->table_size; i++) {
+        EnvEntry* entry = env->entries[i];
+        while (entry) {
+            EnvEntry* next = entry->next;
+            entry->value = NULL;
+            entry->next = env->spare;
+            env->spare = entry;
+            entry = next;
+        }
+        env->entries[i] = NULL;
+    }
+}
+
+// Memory that lives as long as env: its heap's, or malloc's.
+static void* environment_alloc(Environment* env, size_t size) {
+    return env->heap ? heap_alloc_beside(env->heap, env, size) : malloc(size);
+}
+
+// Whether copying value's object to where depth lives takes all of it
+// there: a string's bytes must live as long already.
+static int is_cell_value(const Object* value, int depth) {
+    switch (value->type) {
+        case OBJ_INTEGER:
+        case OBJ_FLOAT:
+        case OBJ_BOOLEAN:
+        case OBJ_NULL:
+            return 1;
+        case OBJ_STRING:
+            return value->value.string.length <= STRING_INLINE_CAPACITY ||
+                   heap_scratch_depth_of(string_bytes(&value->value.string)) <= depth;
+        default:
+            return 0;
+    }
+}
+
+static Object* entry_store(Environment* env, EnvEntry* entry, Object* value) {
+    int depth = value && heap_scratch_depth() > 0 ? heap_scratch_depth_of(env) : 0;
+    if (value && heap_scratch_depth_of(value) > depth) {
+        if (is_cell_value(value, depth)) {
+            Object* cell = __atomic_load_n(&entry->cell, __ATOMIC_RELAXED);
+            if (!cell) {
+                cell = env->heap ? heap_alloc_beside(env->heap, env, sizeof(Object))
+                                 : heap_alloc_beside(vm_heap(), NULL, sizeof(Object));
+                __atomic_store_n(&entry->cell, cell, __ATOMIC_RELAXED);
+            }
+            *cell = *value;
+            value = cell;
+        } else {
+            heap_note_store(env, value);
+        }
+    }
+    __atomic_store_n(&entry->value, value, __ATOMIC_RELEASE);
+    return value;
+}
+
+static Object* entry_load(EnvEntry* entry) {
+    Object* value = __atomic_load_n(&entry->value, __ATOMIC_ACQUIRE);
+    if (value && value == __atomic_load_n(&entry->cell, __ATOMIC_RELAXED)) {
+        if (heap_scratch_depth() > 0) {
+            Object* copy = heap_alloc(vm_heap(), sizeof(Object));
+            *copy = *value;
+            return copy;
+        }
+        __atomic_store_n(&entry->cell, NULL, __ATOMIC_RELAXED);
+    }
+    return value;
+}
+
 void environment_free(Environment* env) {
-    if (!env) return;
+    if (!env || env->heap) return;
     
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
+    for (unsigned int i = 0; i < env->table_size; i++) {
         EnvEntry* entry = env->entries[i];
         while (entry) {
             EnvEntry* next = entry->next;
@@ -55,12 +141,15 @@ void environment_free(Environment* env) {
 Object* environment_get(Environment* env, const char* name) {
     if (!env || !name) return NULL;
     
-    unsigned int index = hash_string(name);
-    EnvEntry* entry = env->entries[index];
+    EnvEntry** entries = __atomic_load_n(&env->entries, __ATOMIC_ACQUIRE);
+    EnvEntry* entry = NULL;
+    if (entries) {
+        entry = __atomic_load_n(&entries[hash_string(name, env->table_size)], __ATOMIC_ACQUIRE);
+    }
 
     while (entry) {
         if (strcmp(entry->key, name) == 0) {
-            return entry->value;
+            return entry_load(entry);
         }
         entry = entry->next;
     }
@@ -72,25 +161,62 @@ Object* environment_get(Environment* env, const char* name) {
     return NULL;
 }
 
+// Spawned tasks read the environments they close over while the spawning
+// task may still be binding names in them, so new entries and values are
+// published with release stores (plain stores on x86).
 Object* environment_set(Environment* env, const char* name, Object* value) {
     if (!env || !name) return NULL;
 
-    unsigned int index = hash_string(name);
+    if (!env->entries) {
+        EnvEntry** entries = environment_alloc(env, sizeof(EnvEntry*) * env->table_size);
+        memset(entries, 0, sizeof(EnvEntry*) * env->table_size);
+        __atomic_store_n(&env->entries, entries, __ATOMIC_RELEASE);
+    }
+
+    unsigned int index = hash_string(name, env->table_size);
 
     EnvEntry* entry = env->entries[index];
     while (entry) {
         if (strcmp(entry->key, name) == 0) {
-            entry->value = value;
-            return value;
+            return entry_store(env, entry, value);
         }
         entry = entry->next;
     }
 
-    EnvEntry* new_entry = malloc(sizeof(EnvEntry));
-    new_entry->key = string_duplicate(name);
-    new_entry->value = value;
+    EnvEntry* new_entry = NULL;
+    for (EnvEntry** link = &env->spare; *link; link = &(*link)->next) {
+        if (strcmp((*link)->key, name) == 0) {
+            new_entry = *link;
+            *link = new_entry->next;
+            break;
+        }
+    }
+    if (!new_entry) {
+        new_entry = environment_alloc(env, sizeof(EnvEntry));
+        new_entry->key = environment_alloc(env, strlen(name) + 1);
+        strcpy(new_entry->key, name);
+        new_entry->cell = NULL;
+    }
+    new_entry->value = NULL;
+    value = entry_store(env, new_entry, value);
     new_entry->next = env->entries[index];
-    env->entries[index] = new_entry;
+    __atomic_store_n(&env->entries[index], new_entry, __ATOMIC_RELEASE);
 
     return value;
-}
\ No newline at end of file
+}
+
+Object* environment_assign(Environment* env, const char* name, Object* value) {
+    if (!name) return NULL;
+
+    for (; env; env = env->outer) {
+        EnvEntry** entries = __atomic_load_n(&env->entries, __ATOMIC_ACQUIRE);
+        if (!entries) continue;
+        EnvEntry* entry = __atomic_load_n(&entries[hash_string(name, env->table_size)], __ATOMIC_ACQUIRE);
+        for (; entry; entry = entry->next) {
+            if (strcmp(entry->key, name) == 0) {
+                return entry_store(env, entry, value);
+            }
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,396 @@
+#include "flatast.h"
+#include "match.h"
+#include "record.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FLAT_GROW(array, count, capacity, initial) \
+    do { \
+        if ((count) >= (capacity)) { \
+            (capacity) = (capacity) ? (capacity) * 2 : (initial); \
+            (array) = realloc((array), sizeof(*(array)) * (capacity)); \
+        } \
+    } while (0)
+
+static FlatRef flat_statement(FlatAst* ast, Statement* stmt);
+static FlatRef flat_expression(FlatAst* ast, Expression* expr);
+
+static char* string_duplicate(const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str);
+    char* dup = malloc(len + 1);
+    if (!dup) return NULL;
+    strcpy(dup, str);
+    return dup;
+}
+
+static unsigned int hash_string(const char* str) {
+    unsigned int hash = 5381;
+    int c;
+    while ((c = *str++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static const char* const operator_names[] = {
+    "+", "-", "*", "/", "%", "<", ">", "<=", ">=", "==", "!=", "&&", "||",
+    "!", "-", "&", "&mut", "=", "spawn", "await", "?"
+};
+
+// "-" resolves to FLAT_OP_SUB; flat_expression remaps it for prefix minus.
+FlatOperator flat_operator_from_string(const char* operator) {
+    for (int op = 0; op < FLAT_OP_UNKNOWN; op++) {
+        if (strcmp(operator, operator_names[op]) == 0) return (FlatOperator)op;
+    }
+    return FLAT_OP_UNKNOWN;
+}
+
+const char* flat_operator_to_string(FlatOperator op) {
+    return operator_names[op <= FLAT_OP_UNKNOWN ? op : FLAT_OP_UNKNOWN];
+}
+
+// --- Builder ---
+
+static void rehash_strings(FlatAst* ast) {
+    uint32_t bucket_count = ast->string_bucket_count ? ast->string_bucket_count * 2 : 64;
+    uint32_t* buckets = malloc(sizeof(uint32_t) * bucket_count);
+    for (uint32_t i = 0; i < bucket_count; i++) buckets[i] = FLAT_NONE;
+
+    for (uint32_t s = 0; s < ast->string_count; s++) {
+        uint32_t slot = hash_string(ast->strings[s]) & (bucket_count - 1);
+        while (buckets[slot] != FLAT_NONE) slot = (slot + 1) & (bucket_count - 1);
+        buckets[slot] = s;
+    }
+
+    free(ast->string_buckets);
+    ast->string_buckets = buckets;
+    ast->string_bucket_count = bucket_count;
+}
+
+static uint32_t intern(FlatAst* ast, const char* value) {
+    if (!value) return FLAT_NONE;
+
+    if (ast->string_count * 2 >= ast->string_bucket_count) {
+        rehash_strings(ast);
+    }
+
+    uint32_t mask = ast->string_bucket_count - 1;
+    uint32_t slot = hash_string(value) & mask;
+    while (ast->string_buckets[slot] != FLAT_NONE) {
+        uint32_t s = ast->string_buckets[slot];
+        if (strcmp(ast->strings[s], value) == 0) return s;
+        slot = (slot + 1) & mask;
+    }
+
+    FLAT_GROW(ast->strings, ast->string_count, ast->string_capacity, 64);
+    ast->strings[ast->string_count] = string_duplicate(value);
+    ast->string_buckets[slot] = ast->string_count;
+    return ast->string_count++;
+}
+
+static FlatRef add_node(FlatAst* ast, int kind, int line, int column, uint32_t a, uint32_t b, uint32_t c,
+                        struct TypeInfo* type) {
+    if (ast->node_count >= ast->node_capacity) {
+        uint32_t capacity = ast->node_capacity ? ast->node_capacity * 2 : 256;
+        ast->kinds = realloc(ast->kinds, sizeof(uint8_t) * capacity);
+        ast->lines = realloc(ast->lines, sizeof(int32_t) * capacity);
+        ast->columns = realloc(ast->columns, sizeof(int32_t) * capacity);
+        ast->a = realloc(ast->a, sizeof(uint32_t) * capacity);
+        ast->b = realloc(ast->b, sizeof(uint32_t) * capacity);
+        ast->c = realloc(ast->c, sizeof(uint32_t) * capacity);
+        ast->types = realloc(ast->types, sizeof(struct TypeInfo*) * capacity);
+        ast->node_capacity = capacity;
+    }
+
+    FlatRef ref = ast->node_count++;
+    ast->kinds[ref] = (uint8_t)kind;
+    ast->lines[ref] = line;
+    ast->columns[ref] = column;
+    ast->a[ref] = a;
+    ast->b[ref] = b;
+    ast->c[ref] = c;
+    ast->types[ref] = type;
+    return ref;
+}
+
+// Children are lowered into a scratch array first because nested lists
+// append to the pool too; the finished list is then copied in one range.
+static uint32_t add_range(FlatAst* ast, const uint32_t* refs, uint32_t count) {
+    while (ast->pool_count + count > ast->pool_capacity) {
+        ast->pool_capacity = ast->pool_capacity ? ast->pool_capacity * 2 : 256;
+        ast->pool = realloc(ast->pool, sizeof(uint32_t) * ast->pool_capacity);
+    }
+    uint32_t start = ast->pool_count;
+    if (count > 0) memcpy(ast->pool + start, refs, sizeof(uint32_t) * count);
+    ast->pool_count += count;
+    return start;
+}
+
+static FlatRef flat_block(FlatAst* ast, Statement** statements, int count, int line, int column) {
+    uint32_t* refs = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        refs[i] = flat_statement(ast, statements[i]);
+    }
+    uint32_t start = add_range(ast, refs, (uint32_t)count);
+    free(refs);
+    return add_node(ast, STMT_BLOCK, line, column, start, (uint32_t)count, 0, NULL);
+}
+
+static FlatRef flat_statement(FlatAst* ast, Statement* stmt) {
+    if (!stmt) return FLAT_NONE;
+
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            {
+                uint32_t name = intern(ast, stmt->data.let_stmt.name);
+                FlatRef value = flat_expression(ast, stmt->data.let_stmt.value);
+                return add_node(ast, STMT_LET, stmt->line, stmt->column, name, value,
+                                (uint32_t)stmt->data.let_stmt.is_const, NULL);
+            }
+        case STMT_RETURN:
+            {
+                FlatRef value = flat_expression(ast, stmt->data.return_stmt.return_value);
+                return add_node(ast, STMT_RETURN, stmt->line, stmt->column, value, 0, 0, NULL);
+            }
+        case STMT_YIELD:
+            {
+                FlatRef value = flat_expression(ast, stmt->data.yield_stmt.value);
+                return add_node(ast, STMT_YIELD, stmt->line, stmt->column, value, 0, 0, NULL);
+            }
+        case STMT_EXPRESSION:
+            {
+                FlatRef expr = flat_expression(ast, stmt->data.expression_stmt.expression);
+                return add_node(ast, STMT_EXPRESSION, stmt->line, stmt->column, expr, 0, 0, NULL);
+            }
+        case STMT_BLOCK:
+            return flat_block(ast, stmt->data.block_stmt.statements, stmt->data.block_stmt.statement_count,
+                              stmt->line, stmt->column);
+        case STMT_WHILE:
+            {
+                FlatRef condition = flat_expression(ast, stmt->data.while_stmt.condition);
+                FlatRef body = flat_statement(ast, stmt->data.while_stmt.body);
+                return add_node(ast, STMT_WHILE, stmt->line, stmt->column, condition, body, 0, NULL);
+            }
+        case STMT_FOR:
+            {
+                int reduce_count = stmt->data.for_stmt.reduce_count;
+                uint32_t* operands = malloc(sizeof(uint32_t) * (3 + reduce_count * 2));
+                operands[0] = flat_expression(ast, stmt->data.for_stmt.start);
+                operands[1] = flat_expression(ast, stmt->data.for_stmt.end);
+                operands[2] = flat_statement(ast, stmt->data.for_stmt.body);
+                for (int i = 0; i < reduce_count; i++) {
+                    operands[3 + i * 2] = intern(ast, stmt->data.for_stmt.reduce_operators[i]);
+                    operands[4 + i * 2] = intern(ast, stmt->data.for_stmt.reduce_names[i]);
+                }
+                uint32_t start = add_range(ast, operands, 3 + (uint32_t)reduce_count * 2);
+                free(operands);
+                return add_node(ast, STMT_FOR, stmt->line, stmt->column, intern(ast, stmt->data.for_stmt.variable), start,
+                                (uint32_t)reduce_count << 1 | (uint32_t)stmt->data.for_stmt.is_parallel, NULL);
+            }
+        case STMT_TYPE:
+            {
+                Type* type = stmt->data.type_decl.type;
+                int count = type->data.struct_type.field_count;
+                uint32_t* fields = malloc(sizeof(uint32_t) * (count > 0 ? count * 2 : 1));
+                for (int i = 0; i < count; i++) {
+                    fields[i * 2] = intern(ast, type->data.struct_type.field_names[i]);
+                    fields[i * 2 + 1] = (uint32_t)record_field_kind(type->data.struct_type.field_types[i]);
+                }
+                uint32_t start = add_range(ast, fields, (uint32_t)count * 2);
+                free(fields);
+                return add_node(ast, STMT_TYPE, stmt->line, stmt->column, intern(ast, stmt->data.type_decl.name), start,
+                                (uint32_t)count, NULL);
+            }
+        default:
+            return add_node(ast, stmt->node_type, stmt->line, stmt->column, 0, 0, 0, NULL);
+    }
+}
+
+static FlatRef flat_expression(FlatAst* ast, Expression* expr) {
+    if (!expr) return FLAT_NONE;
+
+    int line = expr->line;
+    int column = expr->column;
+    struct TypeInfo* type = expr->resolved_type;
+
+    switch (expr->node_type) {
+        case EXPR_IDENTIFIER:
+            return add_node(ast, EXPR_IDENTIFIER, line, column, intern(ast, expr->data.identifier.value), 0, 0, type);
+        case EXPR_INTEGER_LITERAL:
+            FLAT_GROW(ast->integers, ast->integer_count, ast->integer_capacity, 64);
+            ast->integers[ast->integer_count] = expr->data.integer_literal.value;
+            return add_node(ast, EXPR_INTEGER_LITERAL, line, column, ast->integer_count++, 0, 0, type);
+        case EXPR_FLOAT_LITERAL:
+            FLAT_GROW(ast->floats, ast->float_count, ast->float_capacity, 64);
+            ast->floats[ast->float_count] = expr->data.float_literal.value;
+            return add_node(ast, EXPR_FLOAT_LITERAL, line, column, ast->float_count++, 0, 0, type);
+        case EXPR_STRING_LITERAL:
+            FLAT_GROW(ast->literals, ast->literal_count, ast->literal_capacity, 16);
+            string_literal_init(&ast->literals[ast->literal_count], expr->data.string_literal.value);
+            return add_node(ast, EXPR_STRING_LITERAL, line, column, ast->literal_count++, 0, 0, type);
+        case EXPR_BOOLEAN_LITERAL:
+            return add_node(ast, EXPR_BOOLEAN_LITERAL, line, column, (uint32_t)expr->data.boolean_literal.value, 0, 0, type);
+        case EXPR_FUNCTION_LITERAL:
+            {
+                int count = expr->data.function_literal.parameter_count;
+                uint32_t* names = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    names[i] = intern(ast, expr->data.function_literal.parameters[i]->name);
+                }
+
+                FlatFunction function;
+                function.params_start = add_range(ast, names, (uint32_t)count);
+                function.param_count = (uint32_t)count;
+                free(names);
+                function.body = flat_block(ast, expr->data.function_literal.body, expr->data.function_literal.body_count,
+                                           line, column);
+                function.name = string_duplicate(expr->data.function_literal.name);
+                function.is_pure = expr->data.function_literal.is_pure;
+                function.is_memo = expr->data.function_literal.is_memo;
+                function.is_generator = expr->data.function_literal.is_generator;
+
+                FLAT_GROW(ast->functions, ast->function_count, ast->function_capacity, 16);
+                ast->functions[ast->function_count] = function;
+                return add_node(ast, EXPR_FUNCTION_LITERAL, line, column, ast->function_count++, 0, 0, type);
+            }
+        case EXPR_CALL:
+            {
+                int count = expr->data.call.argument_count;
+                uint32_t* args = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                FlatRef callee = flat_expression(ast, expr->data.call.function);
+                for (int i = 0; i < count; i++) {
+                    args[i] = flat_expression(ast, expr->data.call.arguments[i]);
+                }
+                uint32_t start = add_range(ast, args, (uint32_t)count);
+                free(args);
+                return add_node(ast, EXPR_CALL, line, column, callee, start, (uint32_t)count, type);
+            }
+        case EXPR_INFIX:
+            {
+                FlatRef left = flat_expression(ast, expr->data.infix.left);
+                FlatRef right = flat_expression(ast, expr->data.infix.right);
+                return add_node(ast, EXPR_INFIX, line, column, left,
+                                flat_operator_from_string(expr->data.infix.operator), right, type);
+            }
+        case EXPR_PREFIX:
+            {
+                FlatOperator op = flat_operator_from_string(expr->data.prefix.operator);
+                if (op == FLAT_OP_SUB) op = FLAT_OP_NEG;
+                FlatRef right = flat_expression(ast, expr->data.prefix.right);
+                return add_node(ast, EXPR_PREFIX, line, column, op, right, 0, type);
+            }
+        case EXPR_IF:
+            {
+                FlatRef condition = flat_expression(ast, expr->data.if_expr.condition);
+                FlatRef then_block = flat_block(ast, expr->data.if_expr.then_branch, expr->data.if_expr.then_count,
+                                                line, column);
+                FlatRef else_block = FLAT_NONE;
+                if (expr->data.if_expr.else_branch) {
+                    else_block = flat_block(ast, expr->data.if_expr.else_branch, expr->data.if_expr.else_count,
+                                            line, column);
+                }
+                return add_node(ast, EXPR_IF, line, column, condition, then_block, else_block, type);
+            }
+        case EXPR_MATCH:
+            {
+                int count = expr->data.match.case_count;
+                uint32_t* pairs = malloc(sizeof(uint32_t) * (count > 0 ? count * 2 : 1));
+                FlatRef subject = flat_expression(ast, expr->data.match.expression);
+                for (int i = 0; i < count; i++) {
+                    pairs[i * 2] = flat_expression(ast, expr->data.match.cases[i]->pattern);
+                    pairs[i * 2 + 1] = flat_expression(ast, expr->data.match.cases[i]->result);
+                }
+                uint32_t start = add_range(ast, pairs, (uint32_t)count * 2);
+                free(pairs);
+                FLAT_GROW(ast->matches, ast->match_count, ast->match_capacity, 8);
+                ast->matches[ast->match_count] = match_table_new(expr->data.match.cases, count);
+                return add_node(ast, EXPR_MATCH, line, column, subject, start, ast->match_count++, type);
+            }
+        case EXPR_PIPE:
+            {
+                FlatRef left = flat_expression(ast, expr->data.pipe.left);
+                FlatRef right = flat_expression(ast, expr->data.pipe.right);
+                return add_node(ast, EXPR_PIPE, line, column, left, right, 0, type);
+            }
+        case EXPR_ARRAY_LITERAL:
+            {
+                int count = expr->data.array_literal.element_count;
+                uint32_t* elements = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    elements[i] = flat_expression(ast, expr->data.array_literal.elements[i]);
+                }
+                uint32_t start = add_range(ast, elements, (uint32_t)count);
+                free(elements);
+                return add_node(ast, EXPR_ARRAY_LITERAL, line, column, start, (uint32_t)count, 0, type);
+            }
+        case EXPR_INDEX:
+            {
+                FlatRef array = flat_expression(ast, expr->data.index.array);
+                FlatRef index = flat_expression(ast, expr->data.index.index);
+                return add_node(ast, EXPR_INDEX, line, column, array, index, (uint32_t)expr->data.index.unchecked, type);
+            }
+        case EXPR_MAP_LITERAL:
+            {
+                int count = expr->data.map_literal.entry_count;
+                uint32_t* entries = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+                for (int i = 0; i < count; i++) {
+                    entries[i] = flat_expression(ast, expr->data.map_literal.entries[i]);
+                }
+                uint32_t start = add_range(ast, entries, (uint32_t)count);
+                free(entries);
+                return add_node(ast, EXPR_MAP_LITERAL, line, column, start, (uint32_t)count, 0, type);
+            }
+        case EXPR_FIELD:
+            {
+                FlatRef object = flat_expression(ast, expr->data.field.object);
+                return add_node(ast, EXPR_FIELD, line, column, object, intern(ast, expr->data.field.name),
+                                (uint32_t)expr->data.field.offset, type);
+            }
+        default:
+            return add_node(ast, expr->node_type, line, column, 0, 0, 0, type);
+    }
+}
+
+FlatAst* flat_ast_from_program(Program* program) {
+    FlatAst* ast = calloc(1, sizeof(FlatAst));
+    if (!ast) return NULL;
+
+    ast->root = flat_block(ast, program->statements, program->statement_count, 1, 1);
+    return ast;
+}
+
+void flat_ast_free(FlatAst* ast) {
+    if (!ast) return;
+
+    for (uint32_t i = 0; i < ast->string_count; i++) {
+        free(ast->strings[i]);
+    }
+    for (uint32_t i = 0; i < ast->literal_count; i++) {
+        string_literal_release(&ast->literals[i]);
+    }
+    for (uint32_t i = 0; i < ast->function_count; i++) {
+        free(ast->functions[i].name);
+    }
+    for (uint32_t i = 0; i < ast->match_count; i++) {
+        match_table_free(ast->matches[i]);
+    }
+
+    free(ast->kinds);
+    free(ast->lines);
+    free(ast->columns);
+    free(ast->a);
+    free(ast->b);
+    free(ast->c);
+    free(ast->types);
+    free(ast->pool);
+    free(ast->integers);
+    free(ast->floats);
+    free(ast->literals);
+    free(ast->strings);
+    free(ast->string_buckets);
+    free(ast->functions);
+    free(ast->matches);
+    free(ast);
+}
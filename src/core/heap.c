@@ -0,0 +1,327 @@
+#include "heap.h"
+#include "str.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HEAP_ALIGN 16
+
+struct HeapChunk {
+    struct HeapChunk* next;
+    size_t size;
+    char* mark;  // in a scratch region, the end of what its earlier passes kept
+    _Alignas(HEAP_ALIGN) char data[];
+};
+
+// The part of the current chunk this thread has not handed out yet. A
+// thread allocates for one heap at a time; switching heaps starts a new
+// chunk in the other one.
+static _Thread_local struct {
+    uint64_t heap_id;
+    char* next;
+    char* end;
+} cursor;
+
+static atomic_uint_fast64_t next_heap_id = 1;
+
+// The innermost scratch region this thread has open.
+static _Thread_local HeapScratch* scratch_top;
+
+void heap_init(Heap* heap) {
+    heap->id = atomic_fetch_add(&next_heap_id, 1);
+    pthread_mutex_init(&heap->lock, NULL);
+    heap->chunks = NULL;
+    heap->reserved = 0;
+    heap->strings = NULL;
+    heap->string_count = 0;
+    heap->string_capacity = 0;
+    heap->mappings = NULL;
+    heap->mapping_count = 0;
+    heap->mapping_capacity = 0;
+    heap->finalizers = NULL;
+    heap->finalizer_count = 0;
+    heap->finalizer_capacity = 0;
+}
+
+void heap_destroy(Heap* heap) {
+    while (heap->finalizer_count > 0) {
+        HeapFinalizer* finalizer = &heap->finalizers[--heap->finalizer_count];
+        finalizer->run(finalizer->data);
+    }
+    free(heap->finalizers);
+    heap->finalizers = NULL;
+    heap->finalizer_capacity = 0;
+
+    HeapChunk* chunk = heap->chunks;
+    while (chunk) {
+        HeapChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    heap->chunks = NULL;
+    heap->reserved = 0;
+    for (size_t i = 0; i < heap->string_count; i++) {
+        string_data_release(heap->strings[i]);
+    }
+    free(heap->strings);
+    heap->strings = NULL;
+    heap->string_count = heap->string_capacity = 0;
+    for (size_t i = 0; i < heap->mapping_count; i++) {
+        munmap(heap->mappings[i].address, heap->mappings[i].length);
+    }
+    free(heap->mappings);
+    heap->mappings = NULL;
+    heap->mapping_count = heap->mapping_capacity = 0;
+    pthread_mutex_destroy(&heap->lock);
+
+    // Other threads' cursors can only be stale for heaps that no longer
+    // exist, and ids are never reused, so they will not match again.
+    if (cursor.heap_id == heap->id) {
+        cursor.heap_id = 0;
+        cursor.next = cursor.end = NULL;
+    }
+}
+
+static HeapChunk* heap_new_chunk(Heap* heap, size_t size) {
+    HeapChunk* chunk = malloc(sizeof(HeapChunk) + size);
+    chunk->size = size;
+    chunk->mark = chunk->data;
+
+    pthread_mutex_lock(&heap->lock);
+    chunk->next = heap->chunks;
+    heap->chunks = chunk;
+    heap->reserved += size;
+    pthread_mutex_unlock(&heap->lock);
+    return chunk;
+}
+
+static void* scratch_alloc(HeapScratch* scratch, size_t size) {
+    if ((size_t)(scratch->end - scratch->next) >= size) {
+        void* result = scratch->next;
+        scratch->next += size;
+        return result;
+    }
+
+    size_t chunk_size = size > HEAP_CHUNK_SIZE / 4 ? size : HEAP_CHUNK_SIZE;
+    HeapChunk* chunk = malloc(sizeof(HeapChunk) + chunk_size);
+    chunk->size = chunk_size;
+    chunk->mark = chunk->data;
+    chunk->next = scratch->chunks;
+    scratch->chunks = chunk;
+    if (chunk_size == HEAP_CHUNK_SIZE) {
+        scratch->current = chunk;
+        scratch->next = chunk->data + size;
+        scratch->end = chunk->data + HEAP_CHUNK_SIZE;
+    }
+    return chunk->data;
+}
+
+static void* shared_alloc(Heap* heap, size_t size) {
+    if (cursor.heap_id == heap->id && (size_t)(cursor.end - cursor.next) >= size) {
+        void* result = cursor.next;
+        cursor.next += size;
+        return result;
+    }
+
+    // Big requests get a chunk of their own rather than wasting the rest
+    // of the current one.
+    if (size > HEAP_CHUNK_SIZE / 4) {
+        return heap_new_chunk(heap, size)->data;
+    }
+
+    HeapChunk* chunk = heap_new_chunk(heap, HEAP_CHUNK_SIZE);
+    cursor.heap_id = heap->id;
+    cursor.next = chunk->data + size;
+    cursor.end = chunk->data + HEAP_CHUNK_SIZE;
+    return chunk->data;
+}
+
+void* heap_alloc(Heap* heap, size_t size) {
+    size = (size + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1);
+    if (scratch_top && scratch_top->heap == heap) return scratch_alloc(scratch_top, size);
+    return shared_alloc(heap, size);
+}
+
+// Over-allocates by what rounding the address up can skip.
+void* heap_alloc_aligned(Heap* heap, size_t size, size_t alignment) {
+    if (alignment <= HEAP_ALIGN) return heap_alloc(heap, size);
+    uintptr_t address = (uintptr_t)heap_alloc(heap, size + alignment - HEAP_ALIGN);
+    return (void*)((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+char* heap_strdup(Heap* heap, const char* value) {
+    if (!value) return NULL;
+    size_t length = strlen(value);
+    char* copy = heap_alloc(heap, length + 1);
+    memcpy(copy, value, length + 1);
+    return copy;
+}
+
+void heap_retain_string(Heap* heap, struct StringData* data) {
+    string_data_retain(data);
+
+    pthread_mutex_lock(&heap->lock);
+    if (heap->string_count >= heap->string_capacity) {
+        heap->string_capacity = heap->string_capacity ? heap->string_capacity * 2 : 64;
+        heap->strings = realloc(heap->strings, sizeof(struct StringData*) * heap->string_capacity);
+    }
+    heap->strings[heap->string_count++] = data;
+    pthread_mutex_unlock(&heap->lock);
+}
+
+void heap_retain_mapping(Heap* heap, void* address, size_t length) {
+    pthread_mutex_lock(&heap->lock);
+    if (heap->mapping_count >= heap->mapping_capacity) {
+        heap->mapping_capacity = heap->mapping_capacity ? heap->mapping_capacity * 2 : 8;
+        heap->mappings = realloc(heap->mappings, sizeof(HeapMapping) * heap->mapping_capacity);
+    }
+    heap->mappings[heap->mapping_count++] = (HeapMapping){ address, length };
+    pthread_mutex_unlock(&heap->lock);
+}
+
+void heap_add_finalizer(Heap* heap, void (*run)(void* data), void* data) {
+    pthread_mutex_lock(&heap->lock);
+    if (heap->finalizer_count >= heap->finalizer_capacity) {
+        heap->finalizer_capacity = heap->finalizer_capacity ? heap->finalizer_capacity * 2 : 8;
+        heap->finalizers = realloc(heap->finalizers, sizeof(HeapFinalizer) * heap->finalizer_capacity);
+    }
+    heap->finalizers[heap->finalizer_count++] = (HeapFinalizer){ run, data };
+    pthread_mutex_unlock(&heap->lock);
+}
+
+void heap_scratch_begin(Heap* heap, HeapScratch* scratch) {
+    scratch->heap = heap;
+    scratch->outer = scratch_top;
+    scratch->chunks = scratch->current = NULL;
+    scratch->next = scratch->end = NULL;
+    scratch->escaped = 0;
+    scratch_top = scratch;
+}
+
+// Moves chunks to the enclosing region, whose pass they now belong to
+// whole, or to the heap when there is none.
+static void scratch_hand_over(HeapScratch* scratch, HeapChunk* first) {
+    if (!first) return;
+
+    HeapChunk* last = first;
+    size_t size = 0;
+    for (HeapChunk* chunk = first; chunk; chunk = chunk->next) {
+        chunk->mark = chunk->data;
+        size += chunk->size;
+        last = chunk;
+    }
+
+    if (scratch->outer) {
+        last->next = scratch->outer->chunks;
+        scratch->outer->chunks = first;
+    } else {
+        Heap* heap = scratch->heap;
+        pthread_mutex_lock(&heap->lock);
+        last->next = heap->chunks;
+        heap->chunks = first;
+        heap->reserved += size;
+        pthread_mutex_unlock(&heap->lock);
+    }
+}
+
+// Ends a pass: what an escaped pass made, and what earlier passes kept,
+// is handed over; the rest is freed. The current chunk may stay.
+static void scratch_sweep(HeapScratch* scratch, int keep_current) {
+    HeapChunk* handed = NULL;
+    HeapChunk* chunk = scratch->chunks;
+    scratch->chunks = NULL;
+    while (chunk) {
+        HeapChunk* next = chunk->next;
+        if (keep_current && chunk == scratch->current) {
+            chunk->next = NULL;
+            scratch->chunks = chunk;
+        } else if (scratch->escaped || chunk->mark > chunk->data) {
+            chunk->next = handed;
+            handed = chunk;
+        } else {
+            free(chunk);
+        }
+        chunk = next;
+    }
+    scratch_hand_over(scratch, handed);
+    if (!keep_current) scratch->current = NULL;
+}
+
+// The current chunk stays for the next pass, so a loop whose passes fit
+// in a chunk does not go back to malloc. An escaped pass keeps its part
+// of it, which counts as the enclosing region's from then on (see
+// heap_scratch_depth_of), and the next pass goes on after it; so a loop
+// whose every pass escapes packs them as tightly as the heap would.
+void heap_scratch_reset(HeapScratch* scratch) {
+    if (scratch->current && scratch->escaped) scratch->current->mark = scratch->next;
+    scratch_sweep(scratch, 1);
+    scratch->escaped = 0;
+    if (scratch->current) scratch->next = scratch->current->mark;
+}
+
+void heap_scratch_end(HeapScratch* scratch) {
+    scratch_sweep(scratch, 0);
+    scratch_top = scratch->outer;
+}
+
+int heap_scratch_depth(void) {
+    int depth = 0;
+    for (HeapScratch* scratch = scratch_top; scratch; scratch = scratch->outer) depth++;
+    return depth;
+}
+
+int heap_scratch_depth_of(const void* address) {
+    const char* byte = address;
+    int depth = heap_scratch_depth();
+    for (HeapScratch* scratch = scratch_top; scratch; scratch = scratch->outer, depth--) {
+        for (HeapChunk* chunk = scratch->chunks; chunk; chunk = chunk->next) {
+            if (byte >= chunk->data && byte < chunk->data + chunk->size) {
+                return byte < chunk->mark ? depth - 1 : depth;
+            }
+        }
+    }
+    return 0;
+}
+
+void heap_note_store(const void* holder, const void* value) {
+    if (!scratch_top || !value) return;
+
+    int value_depth = heap_scratch_depth_of(value);
+    if (value_depth == 0) return;
+    int holder_depth = holder ? heap_scratch_depth_of(holder) : 0;
+    if (value_depth <= holder_depth) return;
+
+    int depth = heap_scratch_depth();
+    for (HeapScratch* scratch = scratch_top; depth > holder_depth; scratch = scratch->outer, depth--) {
+        scratch->escaped = 1;
+    }
+}
+
+void heap_scratch_escape(void) {
+    for (HeapScratch* scratch = scratch_top; scratch; scratch = scratch->outer) {
+        scratch->escaped = 1;
+    }
+}
+
+HeapScratch* heap_scratch_suspend(void) {
+    HeapScratch* scratch = scratch_top;
+    scratch_top = NULL;
+    return scratch;
+}
+
+void heap_scratch_resume(HeapScratch* scratch) {
+    scratch_top = scratch;
+}
+
+void* heap_alloc_beside(Heap* heap, const void* holder, size_t size) {
+    if (!scratch_top || scratch_top->heap != heap) return heap_alloc(heap, size);
+
+    size = (size + HEAP_ALIGN - 1) & ~(size_t)(HEAP_ALIGN - 1);
+    int depth = heap_scratch_depth_of(holder);
+    if (depth == 0) return shared_alloc(heap, size);
+
+    HeapScratch* scratch = scratch_top;
+    for (int i = heap_scratch_depth(); i > depth; i--) scratch = scratch->outer;
+    return scratch_alloc(scratch, size);
+}
@@ -0,0 +1,233 @@
+#include "map.h"
+#include "vm.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define GROUP_WIDTH 16
+
+// Full slots hold the 7-bit tag of their hash, so exactly the free ones
+// are negative.
+#define CONTROL_EMPTY ((int8_t)-128)
+#define CONTROL_DELETED ((int8_t)-2)
+
+// Murmur3's finalizer: spreads every input bit over the whole word, so
+// the tag and the group index both see all of the key.
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// Strings keep their hash, so a key is hashed once however often it is
+// looked up.
+static uint64_t hash_key(Object* key) {
+    return key->type == OBJ_STRING ? string_hash(&key->value.string) : mix((uint64_t)key->value.integer);
+}
+
+static int8_t hash_tag(uint64_t hash) {
+    return (int8_t)(hash & 0x7f);
+}
+
+// Bit i is set for every control byte i of the group equal to tag.
+static uint32_t group_match(const int8_t* group, int8_t tag) {
+#ifdef __SSE2__
+    __m128i control = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(tag)));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == tag) bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+// Likewise for the empty and deleted bytes.
+static uint32_t group_match_free(const int8_t* group) {
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] < 0) bits |= 1u << i;
+    }
+    return bits;
+#endif
+}
+
+// At most 7/8 of the slots may be in use (tombstones count), which keeps
+// probe sequences short and guarantees every probe meets an empty slot.
+static int64_t max_load(int64_t capacity) {
+    return capacity - capacity / 8;
+}
+
+static void map_allocate(Map* map, int64_t capacity) {
+    Heap* heap = vm_heap();
+    map->capacity = capacity;
+    map->growth_left = max_load(capacity) - map->size;
+    map->control = heap_alloc_beside(heap, map, capacity);
+    map->slots = heap_alloc_beside(heap, map, sizeof(MapSlot) * capacity);
+    memset(map->control, CONTROL_EMPTY, capacity);
+}
+
+Map* map_new(int64_t capacity) {
+    Map* map = heap_alloc(vm_heap(), sizeof(Map));
+    int64_t size = GROUP_WIDTH;
+    while (max_load(size) < capacity) size *= 2;
+
+    map->key_kind = MAP_UNTYPED;
+    map->size = 0;
+    map_allocate(map, size);
+    return map;
+}
+
+Map* map_copy(const Map* map) {
+    Map* copy = heap_alloc(vm_heap(), sizeof(Map));
+    *copy = *map;
+    map_allocate(copy, map->capacity);
+    copy->growth_left = map->growth_left;
+    memcpy(copy->control, map->control, map->capacity);
+    memcpy(copy->slots, map->slots, sizeof(MapSlot) * map->capacity);
+    return copy;
+}
+
+static int map_accepts(const Map* map, Object* key) {
+    if (!key) return 0;
+    if (map->key_kind == MAP_STRING_KEYS) return key->type == OBJ_STRING;
+    if (map->key_kind == MAP_INT_KEYS) return key->type == OBJ_INTEGER;
+    return key->type == OBJ_STRING || key->type == OBJ_INTEGER;
+}
+
+static int slot_matches(const Map* map, const MapSlot* slot, Object* key, uint64_t hash) {
+    if (map->key_kind == MAP_STRING_KEYS) {
+        const char* chars = string_chars(&key->value.string);
+        return slot->key.string == chars || (slot->hash == hash && strcmp(slot->key.string, chars) == 0);
+    }
+    return slot->key.integer == key->value.integer;
+}
+
+// Groups are probed in triangular steps from the one the hash picks,
+// which visits every group of a power-of-two table.
+static int64_t map_find(const Map* map, Object* key, uint64_t hash) {
+    if (map->size == 0 || !map_accepts(map, key)) return -1;
+
+    int64_t group_mask = map->capacity / GROUP_WIDTH - 1;
+    int64_t group = (int64_t)(hash >> 7) & group_mask;
+    int8_t tag = hash_tag(hash);
+
+    for (int64_t step = 1;; step++) {
+        const int8_t* control = map->control + group * GROUP_WIDTH;
+        for (uint32_t bits = group_match(control, tag); bits; bits &= bits - 1) {
+            int64_t index = group * GROUP_WIDTH + __builtin_ctz(bits);
+            if (slot_matches(map, &map->slots[index], key, hash)) return index;
+        }
+        if (group_match(control, CONTROL_EMPTY)) return -1;
+        group = (group + step) & group_mask;
+    }
+}
+
+// The first empty or deleted slot on hash's probe sequence.
+static int64_t map_find_free(const Map* map, uint64_t hash) {
+    int64_t group_mask = map->capacity / GROUP_WIDTH - 1;
+    int64_t group = (int64_t)(hash >> 7) & group_mask;
+
+    for (int64_t step = 1;; step++) {
+        uint32_t bits = group_match_free(map->control + group * GROUP_WIDTH);
+        if (bits) return group * GROUP_WIDTH + __builtin_ctz(bits);
+        group = (group + step) & group_mask;
+    }
+}
+
+// Doubles the table, or just clears out the tombstones when the live
+// entries fill no more than half of it.
+static void map_rehash(Map* map) {
+    int8_t* control = map->control;
+    MapSlot* slots = map->slots;
+    int64_t capacity = map->capacity;
+
+    map_allocate(map, map->size * 2 > max_load(capacity) ? capacity * 2 : capacity);
+    for (int64_t i = 0; i < capacity; i++) {
+        if (control[i] < 0) continue;
+        int64_t index = map_find_free(map, slots[i].hash);
+        map->control[index] = control[i];
+        map->slots[index] = slots[i];
+    }
+}
+
+Object* map_get(const Map* map, Object* key) {
+    if (!map_accepts(map, key)) return NULL;
+    int64_t index = map_find(map, key, hash_key(key));
+    return index >= 0 ? map->slots[index].value : NULL;
+}
+
+int map_has(const Map* map, Object* key) {
+    if (!map_accepts(map, key)) return 0;
+    return map_find(map, key, hash_key(key)) >= 0;
+}
+
+void map_set(Map* map, Object* key, Object* value) {
+    if (!map_accepts(map, key)) return;
+    if (map->key_kind == MAP_UNTYPED) {
+        map->key_kind = key->type == OBJ_STRING ? MAP_STRING_KEYS : MAP_INT_KEYS;
+    }
+
+    uint64_t hash = hash_key(key);
+    int64_t index = map_find(map, key, hash);
+    heap_note_store(map, value);
+    if (index >= 0) {
+        map->slots[index].value = value;
+        return;
+    }
+
+    index = map_find_free(map, hash);
+    if (map->growth_left == 0 && map->control[index] == CONTROL_EMPTY) {
+        map_rehash(map);
+        index = map_find_free(map, hash);
+    }
+    if (map->control[index] == CONTROL_EMPTY) map->growth_left--;
+
+    MapSlot* slot = &map->slots[index];
+    map->control[index] = hash_tag(hash);
+    slot->hash = hash;
+    if (key->type == OBJ_STRING) {
+        slot->key.string = string_chars(&key->value.string);
+        heap_note_store(map, slot->key.string);
+    } else {
+        slot->key.integer = key->value.integer;
+    }
+    slot->value = value;
+    map->size++;
+}
+
+int map_delete(Map* map, Object* key) {
+    if (!map_accepts(map, key)) return 0;
+    int64_t index = map_find(map, key, hash_key(key));
+    if (index < 0) return 0;
+
+    if (group_match(map->control + (index & ~(int64_t)(GROUP_WIDTH - 1)), CONTROL_EMPTY)) {
+        map->control[index] = CONTROL_EMPTY;
+        map->growth_left++;
+    } else {
+        map->control[index] = CONTROL_DELETED;
+    }
+    map->slots[index].value = NULL;
+    map->size--;
+    return 1;
+}
+
+int64_t map_next(const Map* map, int64_t position) {
+    for (int64_t i = position; i < map->capacity; i++) {
+        if (map->control[i] >= 0) return i;
+    }
+    return -1;
+}
+
+Object* map_key(const Map* map, int64_t slot) {
+    if (map->key_kind == MAP_STRING_KEYS) return object_new_string(map->slots[slot].key.string);
+    return object_new_integer(map->slots[slot].key.integer);
+}
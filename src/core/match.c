@@ -0,0 +1,167 @@
+#include "match.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Spans wider than this take the binary search however full they are.
+#define MATCH_JUMP_LIMIT 65536
+
+typedef struct IntPattern {
+    int64_t value;
+    int32_t arm;
+} IntPattern;
+
+int match_pattern_is_wildcard(const Expression* pattern) {
+    return pattern->node_type == EXPR_IDENTIFIER && strcmp(pattern->data.identifier.value, "_") == 0;
+}
+
+// An integer literal, possibly negated.
+static int int_pattern_value(const Expression* pattern, int64_t* value) {
+    if (pattern->node_type == EXPR_INTEGER_LITERAL) {
+        *value = pattern->data.integer_literal.value;
+        return 1;
+    }
+    if (pattern->node_type == EXPR_PREFIX && strcmp(pattern->data.prefix.operator, "-") == 0 &&
+        pattern->data.prefix.right->node_type == EXPR_INTEGER_LITERAL) {
+        *value = -(int64_t)pattern->data.prefix.right->data.integer_literal.value;
+        return 1;
+    }
+    return 0;
+}
+
+// Keeps the first of equal values: the sort is by value and then by arm.
+static int compare_int_patterns(const void* a, const void* b) {
+    const IntPattern* x = a;
+    const IntPattern* y = b;
+    if (x->value != y->value) return x->value < y->value ? -1 : 1;
+    return x->arm - y->arm;
+}
+
+static void build_ints(MatchTable* table, IntPattern* patterns, uint32_t count) {
+    if (count == 0) return;
+    qsort(patterns, count, sizeof(IntPattern), compare_int_patterns);
+
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (unique == 0 || patterns[unique - 1].value != patterns[i].value) patterns[unique++] = patterns[i];
+    }
+
+    uint64_t span = (uint64_t)patterns[unique - 1].value - (uint64_t)patterns[0].value + 1;
+    if (span <= MATCH_JUMP_LIMIT && span <= (uint64_t)unique * 3) {
+        table->int_min = patterns[0].value;
+        table->jump_count = (uint32_t)span;
+        table->jump = malloc(sizeof(int32_t) * span);
+        for (uint64_t i = 0; i < span; i++) table->jump[i] = -1;
+        for (uint32_t i = 0; i < unique; i++) {
+            table->jump[(uint64_t)patterns[i].value - (uint64_t)table->int_min] = patterns[i].arm;
+        }
+        return;
+    }
+
+    table->int_count = unique;
+    table->int_keys = malloc(sizeof(int64_t) * unique);
+    table->int_arms = malloc(sizeof(int32_t) * unique);
+    for (uint32_t i = 0; i < unique; i++) {
+        table->int_keys[i] = patterns[i].value;
+        table->int_arms[i] = patterns[i].arm;
+    }
+}
+
+// At most half full, so probes stay short.
+static void build_strings(MatchTable* table, MatchCase** cases, int case_count, uint32_t count) {
+    if (count == 0) return;
+    uint32_t slots = 4;
+    while (slots < count * 2) slots *= 2;
+    table->string_mask = slots - 1;
+    table->strings = calloc(slots, sizeof(MatchString));
+
+    for (int arm = 0; arm < case_count; arm++) {
+        const Expression* pattern = cases[arm]->pattern;
+        if (pattern->node_type != EXPR_STRING_LITERAL) continue;
+
+        StringData* data = pattern->data.string_literal.literal.data;
+        uint32_t slot = (uint32_t)data->hash & table->string_mask;
+        while (table->strings[slot].data && table->strings[slot].data != data) {
+            slot = (slot + 1) & table->string_mask;
+        }
+        if (table->strings[slot].data) continue;
+        table->strings[slot].data = string_data_retain(data);
+        table->strings[slot].arm = arm;
+    }
+}
+
+MatchTable* match_table_new(MatchCase** cases, int case_count) {
+    MatchTable* table = calloc(1, sizeof(MatchTable));
+    table->default_arm = -1;
+    table->bool_arms[0] = table->bool_arms[1] = -1;
+
+    IntPattern* ints = malloc(sizeof(IntPattern) * (case_count > 0 ? case_count : 1));
+    uint32_t int_count = 0, string_count = 0;
+
+    for (int arm = 0; arm < case_count; arm++) {
+        const Expression* pattern = cases[arm]->pattern;
+        int64_t value;
+        if (match_pattern_is_wildcard(pattern)) {
+            if (table->default_arm < 0) table->default_arm = arm;
+        } else if (int_pattern_value(pattern, &value)) {
+            ints[int_count].value = value;
+            ints[int_count].arm = arm;
+            int_count++;
+        } else if (pattern->node_type == EXPR_STRING_LITERAL) {
+            string_count++;
+        } else if (pattern->node_type == EXPR_BOOLEAN_LITERAL) {
+            int index = pattern->data.boolean_literal.value ? 1 : 0;
+            if (table->bool_arms[index] < 0) table->bool_arms[index] = arm;
+        }
+    }
+
+    build_ints(table, ints, int_count);
+    build_strings(table, cases, case_count, string_count);
+    free(ints);
+    return table;
+}
+
+// The bytes are compared only once the hash and length agree; a subject
+// that views a long literal's pooled text shares its bytes outright.
+int match_table_find_string(const MatchTable* table, String* value) {
+    if (table->strings) {
+        uint64_t hash = string_hash(value);
+        const char* bytes = string_bytes(value);
+        for (uint32_t slot = (uint32_t)hash & table->string_mask; table->strings[slot].data;
+             slot = (slot + 1) & table->string_mask) {
+            const StringData* data = table->strings[slot].data;
+            if (data->hash == hash && data->length == value->length &&
+                (bytes == data->chars || memcmp(bytes, data->chars, data->length) == 0)) {
+                return table->strings[slot].arm;
+            }
+        }
+    }
+    return table->default_arm;
+}
+
+int match_table_pattern_arm(const MatchTable* table, const Expression* pattern) {
+    int64_t value;
+    if (int_pattern_value(pattern, &value)) return match_table_find_int(table, value);
+    if (pattern->node_type == EXPR_BOOLEAN_LITERAL) return match_table_find_bool(table, pattern->data.boolean_literal.value);
+    if (pattern->node_type == EXPR_STRING_LITERAL && table->strings) {
+        StringData* data = pattern->data.string_literal.literal.data;
+        for (uint32_t slot = (uint32_t)data->hash & table->string_mask; table->strings[slot].data;
+             slot = (slot + 1) & table->string_mask) {
+            if (table->strings[slot].data == data) return table->strings[slot].arm;
+        }
+    }
+    return -1;
+}
+
+void match_table_free(MatchTable* table) {
+    if (!table) return;
+    if (table->strings) {
+        for (uint32_t slot = 0; slot <= table->string_mask; slot++) {
+            if (table->strings[slot].data) string_data_release(table->strings[slot].data);
+        }
+        free(table->strings);
+    }
+    free(table->jump);
+    free(table->int_keys);
+    free(table->int_arms);
+    free(table);
+}
@@ -1,93 +1,274 @@
 #include "ast.h"
 #include "object.h"
-#include <stdio.h>
+#include "vm.h"
+#include "builtins.h"
+#include "array.h"
+#include "map.h"
+#include "record.h"
+#include "output.h"
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 
-static char* string_duplicate(const char* str) {
-    if (!str) return NULL;
-    size_t len = strlen(str);
-    char* dup = malloc(len + 1);
-    if (!dup) return NULL;
-    strcpy(dup, str);
-    return dup;
+// Objects are never freed one at a time; they live in the current VM's
+// heap until the VM goes away, or in a loop pass's scratch region until
+// the pass ends (heap.h).
+static Object* object_alloc(ObjectType type) {
+    Object* obj = heap_alloc(vm_heap(), sizeof(Object));
+    obj->type = type;
+    return obj;
 }
 
 Object* object_new_integer(int64_t value) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_INTEGER;
+    Object* obj = object_alloc(OBJ_INTEGER);
     obj->value.integer = value;
     return obj;
 }
 
 Object* object_new_float(double value) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_FLOAT;
+    Object* obj = object_alloc(OBJ_FLOAT);
     obj->value.float_val = value;
     return obj;
 }
 
 Object* object_new_boolean(int value) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_BOOLEAN;
+    Object* obj = object_alloc(OBJ_BOOLEAN);
     obj->value.boolean = value;
     return obj;
 }
 
 Object* object_new_string(const char* value) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_STRING;
-    obj->value.string = string_duplicate(value);
+    return object_new_string_length(value, (int64_t)strlen(value));
+}
+
+Object* object_new_string_length(const char* chars, int64_t length) {
+    Object* obj = object_alloc(OBJ_STRING);
+    String* string = &obj->value.string;
+    string->length = length;
+    string->hash = 0;
+
+    if (length <= STRING_INLINE_CAPACITY) {
+        memcpy(string->data.inline_chars, chars, length);
+        string->data.inline_chars[length] = '\0';
+    } else {
+        char* copy = heap_alloc(vm_heap(), length + 1);
+        memcpy(copy, chars, length);
+        copy[length] = '\0';
+        string->data.chars = copy;
+        string->data.builder = NULL;
+        string->data.terminated = 1;
+    }
     return obj;
 }
 
+Object* object_new_string_view(const char* bytes, int64_t length) {
+    if (length <= STRING_INLINE_CAPACITY) return object_new_string_length(bytes, length);
+
+    Object* obj = object_alloc(OBJ_STRING);
+    String* string = &obj->value.string;
+    string->length = length;
+    string->hash = 0;
+    string->data.chars = bytes;
+    string->data.builder = NULL;
+    string->data.terminated = 0;
+    return obj;
+}
+
+Object* object_new_string_concat(const String* left, const String* right) {
+    Object* obj = object_alloc(OBJ_STRING);
+    string_concat(vm_heap(), &obj->value.string, left, right);
+    return obj;
+}
+
+struct CachedLiteral {
+    uint64_t heap_id;
+    Object object;
+};
+
+// A long literal's object points into the pool, and its heap keeps the
+// pooled text alive. Threads that race on a literal's first evaluation
+// each build an object; any of them may stay cached. It outlives any
+// scratch region the first evaluation ran in.
+Object* object_new_string_literal(StringLiteral* literal) {
+    Heap* heap = vm_heap();
+    struct CachedLiteral* cached = atomic_load_explicit(&literal->cached, memory_order_acquire);
+    if (cached && cached->heap_id == heap->id) return &cached->object;
+
+    StringData* data = literal->data;
+    cached = heap_alloc_beside(heap, NULL, sizeof(struct CachedLiteral));
+    cached->heap_id = heap->id;
+    cached->object.type = OBJ_STRING;
+
+    String* string = &cached->object.value.string;
+    string->length = data->length;
+    string->hash = data->hash;
+    if (data->length <= STRING_INLINE_CAPACITY) {
+        memcpy(string->data.inline_chars, data->chars, data->length + 1);
+    } else {
+        heap_retain_string(heap, data);
+        string->data.chars = data->chars;
+        string->data.builder = NULL;
+        string->data.terminated = 1;
+    }
+
+    atomic_store_explicit(&literal->cached, cached, memory_order_release);
+    return &cached->object;
+}
+
 Object* object_new_null(void) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_NULL;
+    Object* obj = object_alloc(OBJ_NULL);
     return obj;
 }
 
 Object* object_new_return_value(Object* value) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_RETURN_VALUE;
+    Object* obj = object_alloc(OBJ_RETURN_VALUE);
     obj->value.return_value = value;
     return obj;
 }
 
 Object* object_new_function(Parameter** params, int p_count, Statement** body, int b_count, Environment* env) {
-    Object* obj = malloc(sizeof(Object));
-    obj->type = OBJ_FUNCTION;
+    Object* obj = object_alloc(OBJ_FUNCTION);
     obj->value.function.parameters = params;
     obj->value.function.parameter_count = p_count;
     obj->value.function.body = body;
     obj->value.function.body_count = b_count;
     obj->value.function.env = env;
+    environment_capture(env);
+    obj->value.function.memo_name = NULL;
+    obj->value.function.memo = NULL;
+    obj->value.function.is_memo = 0;
+    obj->value.function.is_generator = 0;
+    obj->value.function.flat = NULL;
+    obj->value.function.flat_function = 0;
+    return obj;
+}
+
+Object* object_new_future(Task* task) {
+    Object* obj = object_alloc(OBJ_FUTURE);
+    obj->value.task = task;
+    return obj;
+}
+
+Object* object_new_channel(Channel* channel) {
+    Object* obj = object_alloc(OBJ_CHANNEL);
+    obj->value.channel = channel;
+    return obj;
+}
+
+Object* object_new_sequence(Sequence* sequence) {
+    Object* obj = object_alloc(OBJ_SEQUENCE);
+    obj->value.sequence = sequence;
+    return obj;
+}
+
+Object* object_new_array(Array* array) {
+    Object* obj = object_alloc(OBJ_ARRAY);
+    obj->value.array = array;
+    return obj;
+}
+
+Object* object_new_map(Map* map) {
+    Object* obj = object_alloc(OBJ_MAP);
+    obj->value.map = map;
+    return obj;
+}
+
+Object* object_new_record(Record* record) {
+    Object* obj = object_alloc(OBJ_STRUCT);
+    obj->value.record = record;
+    return obj;
+}
+
+Object* object_new_struct_type(const StructLayout* layout) {
+    Object* obj = object_alloc(OBJ_STRUCT_TYPE);
+    obj->value.layout = layout;
     return obj;
 }
 
-void object_free(Object* obj) {
-    if (!obj) return;
-    if (obj->type == OBJ_STRING) {
-        free(obj->value.string);
+Object* object_bind_value(Object* value, int is_literal) {
+    if (!value || is_literal) return value;
+    if (value->type == OBJ_ARRAY) return object_new_array(array_copy(value->value.array));
+    if (value->type == OBJ_MAP) return object_new_map(map_copy(value->value.map));
+    if (value->type == OBJ_STRUCT) return object_new_record(record_copy(value->value.record));
+    return value;
+}
+
+static void array_print(const Array* array) {
+    output_write("[", 1);
+    for (int64_t i = 0; i < array->length; i++) {
+        if (i > 0) output_write(", ", 2);
+        if (array->kind == ARRAY_FLOAT) {
+            output_float(array->data.floats[i]);
+        } else {
+            output_int(array->data.ints[i]);
+        }
     }
-    free(obj);
+    output_write("]", 1);
+}
+
+static void map_print(const Map* map) {
+    output_write("{", 1);
+    for (int64_t i = map_next(map, 0), first = 1; i >= 0; i = map_next(map, i + 1), first = 0) {
+        if (!first) output_write(", ", 2);
+        object_print(map_key(map, i));
+        output_write(": ", 2);
+        object_print(map->slots[i].value);
+    }
+    output_write("}", 1);
+}
+
+static void record_print(const Record* record) {
+    const StructLayout* layout = record->layout;
+    output_string(layout->name);
+    output_write(" {", 2);
+    for (int i = 0; i < layout->field_count; i++) {
+        if (i > 0) output_write(", ", 2);
+        output_string(layout->field_names[i]);
+        output_write(": ", 2);
+        object_print(record_load(record, i));
+    }
+    output_write("}", 1);
+}
+
+static void function_print(const Object* obj) {
+    output_string("<func(");
+    output_int(obj->value.function.parameter_count);
+    output_string(" params)>");
 }
 
 void object_print(Object* obj) {
     if (!obj) {
-        printf("NULL object\n");
+        output_string("NULL object\n");
         return;
     }
     switch (obj->type) {
-        case OBJ_INTEGER: printf("%lld", (long long)obj->value.integer); break;
-        case OBJ_FLOAT:   printf("%f", obj->value.float_val); break;
-        case OBJ_BOOLEAN: printf("%s", obj->value.boolean ? "true" : "false"); break;
-        case OBJ_STRING:  printf("\"%s\"", obj->value.string); break;
-        case OBJ_NULL:    printf("null"); break;
+        case OBJ_INTEGER: output_int(obj->value.integer); break;
+        case OBJ_FLOAT:   output_float(obj->value.float_val); break;
+        case OBJ_BOOLEAN: output_string(obj->value.boolean ? "true" : "false"); break;
+        case OBJ_STRING:
+            output_write("\"", 1);
+            output_write(string_bytes(&obj->value.string), obj->value.string.length);
+            output_write("\"", 1);
+            break;
+        case OBJ_NULL:    output_string("null"); break;
         case OBJ_RETURN_VALUE: object_print(obj->value.return_value); break;
-        case OBJ_FUNCTION:
-            printf("<func(%d params)>", obj->value.function.parameter_count);
+        case OBJ_FUNCTION: function_print(obj); break;
+        case OBJ_FUTURE:  output_string("<future>"); break;
+        case OBJ_BUILTIN:
+            output_string("<builtin ");
+            output_string(obj->value.builtin->name);
+            output_write(">", 1);
+            break;
+        case OBJ_CHANNEL: output_string("<chan>"); break;
+        case OBJ_SEQUENCE: output_string("<seq>"); break;
+        case OBJ_ARRAY:   array_print(obj->value.array); break;
+        case OBJ_MAP:     map_print(obj->value.map); break;
+        case OBJ_STRUCT:  record_print(obj->value.record); break;
+        case OBJ_STRUCT_TYPE:
+            output_string("<type ");
+            output_string(obj->value.layout->name);
+            output_write(">", 1);
             break;
-        default:          printf("Unknown object type\n"); break;
+        default:          output_string("Unknown object type\n"); break;
     }
 }
@@ -0,0 +1,64 @@
+#include "parallel.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct ParallelJob {
+    ParallelTask task;
+    void* context;
+    int task_count;
+    atomic_int next;
+} ParallelJob;
+
+typedef struct ParallelWorker {
+    ParallelJob* job;
+    int worker;
+} ParallelWorker;
+
+static void* parallel_worker(void* arg) {
+    ParallelWorker* worker = arg;
+    ParallelJob* job = worker->job;
+    int index;
+    while ((index = atomic_fetch_add(&job->next, 1)) < job->task_count) {
+        job->task(job->context, index, worker->worker);
+    }
+    return NULL;
+}
+
+void parallel_for(int task_count, int thread_count, ParallelTask task, void* context) {
+    ParallelJob job;
+    job.task = task;
+    job.context = context;
+    job.task_count = task_count;
+    atomic_init(&job.next, 0);
+
+    if (thread_count > task_count) thread_count = task_count;
+    if (thread_count < 1) thread_count = 1;
+
+    pthread_t* threads = malloc(sizeof(pthread_t) * thread_count);
+    ParallelWorker* workers = malloc(sizeof(ParallelWorker) * thread_count);
+    int started = 0;
+    for (int i = 0; i < thread_count; i++) {
+        workers[i].job = &job;
+        workers[i].worker = i;
+    }
+    for (int i = 1; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, parallel_worker, &workers[i]) == 0) {
+            started++;
+        }
+    }
+
+    parallel_worker(&workers[0]);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    free(workers);
+}
+
+int parallel_cpu_count(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
@@ -0,0 +1,54 @@
+#include "record.h"
+#include "vm.h"
+#include <string.h>
+
+FieldKind record_field_kind(const Type* type) {
+    if (type && type->node_type == TYPE_IDENTIFIER) {
+        if (strcmp(type->data.identifier.name, "int") == 0) return FIELD_INT;
+        if (strcmp(type->data.identifier.name, "float") == 0) return FIELD_FLOAT;
+        if (strcmp(type->data.identifier.name, "bool") == 0) return FIELD_BOOL;
+    }
+    return FIELD_OBJECT;
+}
+
+StructLayout* struct_layout_new(const char* name, const char* const* field_names, const FieldKind* kinds, int field_count) {
+    Heap* heap = vm_heap();
+    StructLayout* layout = heap_alloc(heap, sizeof(StructLayout));
+    layout->name = heap_strdup(heap, name);
+    layout->field_count = field_count;
+    layout->field_names = heap_alloc(heap, sizeof(char*) * (field_count > 0 ? field_count : 1));
+    layout->kinds = heap_alloc(heap, sizeof(FieldKind) * (field_count > 0 ? field_count : 1));
+    for (int i = 0; i < field_count; i++) {
+        layout->field_names[i] = heap_strdup(heap, field_names[i]);
+        layout->kinds[i] = kinds[i];
+    }
+    return layout;
+}
+
+static Record* record_alloc(const StructLayout* layout) {
+    Record* record = heap_alloc(vm_heap(), sizeof(Record) + sizeof(RecordField) * layout->field_count);
+    record->layout = layout;
+    return record;
+}
+
+Record* record_new(const StructLayout* layout, Object** values) {
+    Record* record = record_alloc(layout);
+    for (int i = 0; i < layout->field_count; i++) {
+        Object* value = values[i] ? values[i] : object_new_null();
+        record_store(record, i, layout->kinds[i] == FIELD_OBJECT ? object_bind_value(value, 0) : value);
+    }
+    return record;
+}
+
+Object* record_construct(const StructLayout* layout, Object** args, int arg_count) {
+    if (arg_count != layout->field_count) return object_new_null();
+    return object_new_record(record_new(layout, args));
+}
+
+// Fields are shallow copies: a field's array or map can only be replaced,
+// never changed in place, so the two records may share it.
+Record* record_copy(const Record* record) {
+    Record* copy = record_alloc(record->layout);
+    memcpy(copy->fields, record->fields, sizeof(RecordField) * record->layout->field_count);
+    return copy;
+}
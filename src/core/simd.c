@@ -0,0 +1,290 @@
+#include "simd.h"
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+typedef struct SimdKernels {
+    double (*sum_f64)(const double*, int64_t);
+    int64_t (*sum_i64)(const int64_t*, int64_t);
+    double (*dot_f64)(const double*, const double*, int64_t);
+    int64_t (*dot_i64)(const int64_t*, const int64_t*, int64_t);
+    void (*add_f64)(double*, const double*, const double*, int64_t);
+    void (*add_i64)(int64_t*, const int64_t*, const int64_t*, int64_t);
+    void (*scale_f64)(double*, const double*, double, int64_t);
+    void (*scale_i64)(int64_t*, const int64_t*, int64_t, int64_t);
+    double (*min_f64)(const double*, int64_t);
+    int64_t (*min_i64)(const int64_t*, int64_t);
+    double (*max_f64)(const double*, int64_t);
+    int64_t (*max_i64)(const int64_t*, int64_t);
+    int64_t (*argmax_f64)(const double*, int64_t);
+    int64_t (*argmax_i64)(const int64_t*, int64_t);
+} SimdKernels;
+
+// The kernels are written once over GCC vector types and stamped out per
+// instruction set by DEFINE_KERNELS: `level` prefixes the names, `attr`
+// is the target attribute and `bytes` the vector width. The vector types
+// are only 8-byte aligned, so dereferencing one is an unaligned load;
+// array buffers are 16-byte aligned at best.
+//
+// A comparison of two vectors gives a mask vector of all-ones or zero
+// lanes, and SELECT blends two vectors with it. Each kernel finishes the
+// last n % lanes elements one at a time.
+
+#define SELECT(VT, VI, mask, x, y) ((VT)(((VI)(x) & (mask)) | ((VI)(y) & ~(mask))))
+
+#define DEFINE_REDUCTION(level, attr, suffix, T, VT, LANES)                         \
+    static attr T level##_sum_##suffix(const T* a, int64_t n) {                     \
+        VT acc0 = {0}, acc1 = {0};                                                  \
+        int64_t i = 0;                                                              \
+        for (; i + 2 * LANES <= n; i += 2 * LANES) {                                \
+            acc0 += *(const VT*)(a + i);                                            \
+            acc1 += *(const VT*)(a + i + LANES);                                    \
+        }                                                                           \
+        acc0 += acc1;                                                               \
+        T total = 0;                                                                \
+        for (int j = 0; j < LANES; j++) total += acc0[j];                           \
+        for (; i < n; i++) total += a[i];                                           \
+        return total;                                                               \
+    }                                                                               \
+    static attr T level##_dot_##suffix(const T* a, const T* b, int64_t n) {         \
+        VT acc0 = {0}, acc1 = {0};                                                  \
+        int64_t i = 0;                                                              \
+        for (; i + 2 * LANES <= n; i += 2 * LANES) {                                \
+            acc0 += *(const VT*)(a + i) * *(const VT*)(b + i);                      \
+            acc1 += *(const VT*)(a + i + LANES) * *(const VT*)(b + i + LANES);      \
+        }                                                                           \
+        acc0 += acc1;                                                               \
+        T total = 0;                                                                \
+        for (int j = 0; j < LANES; j++) total += acc0[j];                           \
+        for (; i < n; i++) total += a[i] * b[i];                                    \
+        return total;                                                               \
+    }
+
+#define DEFINE_ELEMENTWISE(level, attr, suffix, T, VT, LANES)                       \
+    static attr void level##_add_##suffix(T* out, const T* a, const T* b, int64_t n) { \
+        int64_t i = 0;                                                              \
+        for (; i + LANES <= n; i += LANES) {                                        \
+            *(VT*)(out + i) = *(const VT*)(a + i) + *(const VT*)(b + i);            \
+        }                                                                           \
+        for (; i < n; i++) out[i] = a[i] + b[i];                                    \
+    }                                                                               \
+    static attr void level##_scale_##suffix(T* out, const T* a, T k, int64_t n) {   \
+        int64_t i = 0;                                                              \
+        for (; i + LANES <= n; i += LANES) {                                        \
+            *(VT*)(out + i) = *(const VT*)(a + i) * k;                              \
+        }                                                                           \
+        for (; i < n; i++) out[i] = a[i] * k;                                       \
+    }
+
+// `name` is min or max and `op` the comparison that makes a lane win.
+#define DEFINE_EXTREMUM(level, attr, name, op, suffix, T, VT, VI, LANES)            \
+    static attr T level##_##name##_##suffix(const T* a, int64_t n) {                \
+        T best = a[0];                                                              \
+        int64_t i = 1;                                                              \
+        if (n >= LANES) {                                                           \
+            VT acc = *(const VT*)a;                                                 \
+            for (i = LANES; i + LANES <= n; i += LANES) {                           \
+                VT v = *(const VT*)(a + i);                                         \
+                VI wins = v op acc;                                                 \
+                acc = SELECT(VT, VI, wins, v, acc);                                 \
+            }                                                                       \
+            best = acc[0];                                                          \
+            for (int j = 1; j < LANES; j++) {                                       \
+                if (acc[j] op best) best = acc[j];                                  \
+            }                                                                       \
+        }                                                                           \
+        for (; i < n; i++) {                                                        \
+            if (a[i] op best) best = a[i];                                          \
+        }                                                                           \
+        return best;                                                                \
+    }
+
+// Each lane keeps its own maximum and the index it came from; a lane only
+// moves on for a strictly larger element, so it holds its first maximum.
+// Of the lanes that share the overall maximum, the lowest index wins.
+#define DEFINE_ARGMAX(level, attr, suffix, T, VT, VI, LANES)                        \
+    static attr int64_t level##_argmax_##suffix(const T* a, int64_t n) {            \
+        T best = a[0];                                                              \
+        int64_t index = 0;                                                          \
+        int64_t i = 1;                                                              \
+        if (n >= LANES) {                                                           \
+            VT acc = *(const VT*)a;                                                 \
+            VI lane = {0};                                                          \
+            for (int j = 0; j < LANES; j++) lane[j] = j;                            \
+            VI acc_index = lane;                                                    \
+            for (i = LANES; i + LANES <= n; i += LANES) {                           \
+                VT v = *(const VT*)(a + i);                                         \
+                VI wins = v > acc;                                                  \
+                lane += LANES;                                                      \
+                acc = SELECT(VT, VI, wins, v, acc);                                 \
+                acc_index = SELECT(VI, VI, wins, lane, acc_index);                  \
+            }                                                                       \
+            best = acc[0];                                                          \
+            index = acc_index[0];                                                   \
+            for (int j = 1; j < LANES; j++) {                                       \
+                if (acc[j] > best || (acc[j] == best && acc_index[j] < index)) {    \
+                    best = acc[j];                                                  \
+                    index = acc_index[j];                                           \
+                }                                                                   \
+            }                                                                       \
+        }                                                                           \
+        for (; i < n; i++) {                                                        \
+            if (a[i] > best) {                                                      \
+                best = a[i];                                                        \
+                index = i;                                                          \
+            }                                                                       \
+        }                                                                           \
+        return index;                                                               \
+    }
+
+#define DEFINE_TYPED_KERNELS(level, attr, suffix, T, VT, VI, LANES)                 \
+    DEFINE_REDUCTION(level, attr, suffix, T, VT, LANES)                             \
+    DEFINE_ELEMENTWISE(level, attr, suffix, T, VT, LANES)                           \
+    DEFINE_EXTREMUM(level, attr, min, <, suffix, T, VT, VI, LANES)                  \
+    DEFINE_EXTREMUM(level, attr, max, >, suffix, T, VT, VI, LANES)                  \
+    DEFINE_ARGMAX(level, attr, suffix, T, VT, VI, LANES)
+
+#define DEFINE_KERNELS(level, attr, bytes)                                          \
+    typedef double level##_f64 __attribute__((vector_size(bytes), aligned(8), may_alias)); \
+    typedef int64_t level##_i64 __attribute__((vector_size(bytes), aligned(8), may_alias)); \
+    DEFINE_TYPED_KERNELS(level, attr, f64, double, level##_f64, level##_i64, (bytes) / 8) \
+    DEFINE_TYPED_KERNELS(level, attr, i64, int64_t, level##_i64, level##_i64, (bytes) / 8) \
+    static const SimdKernels level##_kernels = {                                    \
+        level##_sum_f64, level##_sum_i64, level##_dot_f64, level##_dot_i64,         \
+        level##_add_f64, level##_add_i64, level##_scale_f64, level##_scale_i64,     \
+        level##_min_f64, level##_min_i64, level##_max_f64, level##_max_i64,         \
+        level##_argmax_f64, level##_argmax_i64                                      \
+    };
+
+// The fallback and the baseline the benchmarks compare against. One-lane
+// vectors would do, but GCC keeps them in memory.
+#define DEFINE_SCALAR_KERNELS(suffix, T)                                            \
+    static T scalar_sum_##suffix(const T* a, int64_t n) {                           \
+        T total = 0;                                                                \
+        for (int64_t i = 0; i < n; i++) total += a[i];                              \
+        return total;                                                               \
+    }                                                                               \
+    static T scalar_dot_##suffix(const T* a, const T* b, int64_t n) {               \
+        T total = 0;                                                                \
+        for (int64_t i = 0; i < n; i++) total += a[i] * b[i];                       \
+        return total;                                                               \
+    }                                                                               \
+    static void scalar_add_##suffix(T* out, const T* a, const T* b, int64_t n) {    \
+        for (int64_t i = 0; i < n; i++) out[i] = a[i] + b[i];                       \
+    }                                                                               \
+    static void scalar_scale_##suffix(T* out, const T* a, T k, int64_t n) {         \
+        for (int64_t i = 0; i < n; i++) out[i] = a[i] * k;                          \
+    }                                                                               \
+    static T scalar_min_##suffix(const T* a, int64_t n) {                           \
+        T best = a[0];                                                              \
+        for (int64_t i = 1; i < n; i++) {                                           \
+            if (a[i] < best) best = a[i];                                           \
+        }                                                                           \
+        return best;                                                                \
+    }                                                                               \
+    static T scalar_max_##suffix(const T* a, int64_t n) {                           \
+        T best = a[0];                                                              \
+        for (int64_t i = 1; i < n; i++) {                                           \
+            if (a[i] > best) best = a[i];                                           \
+        }                                                                           \
+        return best;                                                                \
+    }                                                                               \
+    static int64_t scalar_argmax_##suffix(const T* a, int64_t n) {                  \
+        int64_t index = 0;                                                          \
+        for (int64_t i = 1; i < n; i++) {                                           \
+            if (a[i] > a[index]) index = i;                                         \
+        }                                                                           \
+        return index;                                                               \
+    }
+
+DEFINE_SCALAR_KERNELS(f64, double)
+DEFINE_SCALAR_KERNELS(i64, int64_t)
+
+static const SimdKernels scalar_kernels = {
+    scalar_sum_f64, scalar_sum_i64, scalar_dot_f64, scalar_dot_i64,
+    scalar_add_f64, scalar_add_i64, scalar_scale_f64, scalar_scale_i64,
+    scalar_min_f64, scalar_min_i64, scalar_max_f64, scalar_max_i64,
+    scalar_argmax_f64, scalar_argmax_i64
+};
+
+#if SIMD_X86
+DEFINE_KERNELS(sse2, __attribute__((target("sse2"))), 16)
+DEFINE_KERNELS(avx2, __attribute__((target("avx2"))), 32)
+DEFINE_KERNELS(avx512, __attribute__((target("avx512f"))), 64)
+#endif
+
+static const SimdKernels* level_kernels(SimdLevel level) {
+#if SIMD_X86
+    switch (level) {
+        case SIMD_AVX512: return &avx512_kernels;
+        case SIMD_AVX2: return &avx2_kernels;
+        case SIMD_SSE2: return &sse2_kernels;
+        default: break;
+    }
+#endif
+    return &scalar_kernels;
+}
+
+static SimdLevel supported_level(void) {
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+// -1 until the first call picks a level. Racing first calls pick the same
+// one, so a plain store is enough.
+static atomic_int active_level = -1;
+
+SimdLevel simd_level(void) {
+    int level = atomic_load_explicit(&active_level, memory_order_relaxed);
+    if (level < 0) {
+        level = supported_level();
+        atomic_store_explicit(&active_level, level, memory_order_relaxed);
+    }
+    return (SimdLevel)level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_SSE2: return "sse2";
+        case SIMD_AVX2: return "avx2";
+        case SIMD_AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+SimdLevel simd_set_level(SimdLevel level) {
+    SimdLevel supported = supported_level();
+    if (level > supported) level = supported;
+    atomic_store_explicit(&active_level, level, memory_order_relaxed);
+    return level;
+}
+
+static const SimdKernels* kernels(void) {
+    return level_kernels(simd_level());
+}
+
+double simd_sum_f64(const double* a, int64_t n) { return kernels()->sum_f64(a, n); }
+int64_t simd_sum_i64(const int64_t* a, int64_t n) { return kernels()->sum_i64(a, n); }
+double simd_dot_f64(const double* a, const double* b, int64_t n) { return kernels()->dot_f64(a, b, n); }
+int64_t simd_dot_i64(const int64_t* a, const int64_t* b, int64_t n) { return kernels()->dot_i64(a, b, n); }
+
+void simd_add_f64(double* out, const double* a, const double* b, int64_t n) { kernels()->add_f64(out, a, b, n); }
+void simd_add_i64(int64_t* out, const int64_t* a, const int64_t* b, int64_t n) { kernels()->add_i64(out, a, b, n); }
+void simd_scale_f64(double* out, const double* a, double k, int64_t n) { kernels()->scale_f64(out, a, k, n); }
+void simd_scale_i64(int64_t* out, const int64_t* a, int64_t k, int64_t n) { kernels()->scale_i64(out, a, k, n); }
+
+double simd_min_f64(const double* a, int64_t n) { return kernels()->min_f64(a, n); }
+int64_t simd_min_i64(const int64_t* a, int64_t n) { return kernels()->min_i64(a, n); }
+double simd_max_f64(const double* a, int64_t n) { return kernels()->max_f64(a, n); }
+int64_t simd_max_i64(const int64_t* a, int64_t n) { return kernels()->max_i64(a, n); }
+int64_t simd_argmax_f64(const double* a, int64_t n) { return kernels()->argmax_f64(a, n); }
+int64_t simd_argmax_i64(const int64_t* a, int64_t n) { return kernels()->argmax_i64(a, n); }
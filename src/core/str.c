@@ -0,0 +1,194 @@
+#include "str.h"
+#include "heap.h"
+#include "vm.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Builders with room for more bytes than this are malloc'd.
+#define STRING_BUILDER_MALLOC_SIZE (16 * 1024)
+
+// The constant pool: a chained table that doubles when it is as full as
+// it has buckets.
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static StringData** pool_buckets;
+static uint64_t pool_bucket_count;
+static uint64_t pool_size;
+
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t string_hash_bytes(const char* chars, int64_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int64_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)chars[i];
+        hash *= 1099511628211ULL;
+    }
+    return mix(hash);
+}
+
+static void pool_grow(void) {
+    uint64_t count = pool_bucket_count ? pool_bucket_count * 2 : 256;
+    StringData** buckets = calloc(count, sizeof(StringData*));
+
+    for (uint64_t i = 0; i < pool_bucket_count; i++) {
+        StringData* next;
+        for (StringData* data = pool_buckets[i]; data; data = next) {
+            next = data->next;
+            data->next = buckets[data->hash & (count - 1)];
+            buckets[data->hash & (count - 1)] = data;
+        }
+    }
+    free(pool_buckets);
+    pool_buckets = buckets;
+    pool_bucket_count = count;
+}
+
+StringData* string_pool_intern(const char* chars, int64_t length) {
+    uint64_t hash = string_hash_bytes(chars, length);
+
+    pthread_mutex_lock(&pool_lock);
+    if (pool_size >= pool_bucket_count) pool_grow();
+
+    StringData** bucket = &pool_buckets[hash & (pool_bucket_count - 1)];
+    StringData* data = *bucket;
+    while (data && (data->hash != hash || data->length != length || memcmp(data->chars, chars, length) != 0)) {
+        data = data->next;
+    }
+    if (data) {
+        data->references++;
+    } else {
+        data = malloc(sizeof(StringData) + length + 1);
+        data->references = 1;
+        data->length = length;
+        data->hash = hash;
+        memcpy(data->chars, chars, length);
+        data->chars[length] = '\0';
+        data->next = *bucket;
+        *bucket = data;
+        pool_size++;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return data;
+}
+
+StringData* string_data_retain(StringData* data) {
+    pthread_mutex_lock(&pool_lock);
+    data->references++;
+    pthread_mutex_unlock(&pool_lock);
+    return data;
+}
+
+void string_data_release(StringData* data) {
+    if (!data) return;
+
+    pthread_mutex_lock(&pool_lock);
+    if (--data->references == 0) {
+        StringData** link = &pool_buckets[data->hash & (pool_bucket_count - 1)];
+        while (*link != data) link = &(*link)->next;
+        *link = data->next;
+        pool_size--;
+        free(data);
+    }
+    pthread_mutex_unlock(&pool_lock);
+}
+
+void string_literal_init(StringLiteral* literal, const char* text) {
+    if (!text) text = "";
+    literal->data = string_pool_intern(text, (int64_t)strlen(text));
+    literal->cached = NULL;
+}
+
+void string_literal_release(StringLiteral* literal) {
+    string_data_release(literal->data);
+    literal->data = NULL;
+}
+
+int string_equal(String* a, String* b) {
+    if (a->length != b->length) return 0;
+    uint64_t a_hash = __atomic_load_n(&a->hash, __ATOMIC_RELAXED);
+    uint64_t b_hash = __atomic_load_n(&b->hash, __ATOMIC_RELAXED);
+    if (a_hash && b_hash && a_hash != b_hash) return 0;
+    return memcmp(string_bytes(a), string_bytes(b), a->length) == 0;
+}
+
+int string_compare(const String* a, const String* b) {
+    int64_t length = a->length < b->length ? a->length : b->length;
+    int cmp = memcmp(string_bytes(a), string_bytes(b), length);
+    if (cmp != 0) return cmp;
+    return a->length < b->length ? -1 : a->length > b->length;
+}
+
+// A builder holding left with room to grow past length. Capacity doubles
+// over the longest string, so appends cost amortized constant time per
+// byte; the old buffers stay behind for the strings that still view them.
+// Big ones are malloc'd and freed with the heap rather than taken from a
+// scratch region (heap.h), so that a loop pass which only appends to a
+// string stored outside does not keep the region for the buffer's sake.
+static StringBuilder* string_builder_new(Heap* heap, const String* left, int64_t length) {
+    StringBuilder* builder;
+    if (length * 2 > STRING_BUILDER_MALLOC_SIZE) {
+        builder = malloc(sizeof(StringBuilder) + length * 2);
+        builder->chars = (char*)(builder + 1);
+        heap_add_finalizer(heap, free, builder);
+    } else {
+        builder = heap_alloc(heap, sizeof(StringBuilder));
+        builder->chars = heap_alloc(heap, length * 2);
+    }
+    builder->capacity = length * 2;
+    memcpy(builder->chars, string_bytes(left), left->length);
+    atomic_init(&builder->length, length);
+    return builder;
+}
+
+void string_concat(Heap* heap, String* result, const String* left, const String* right) {
+    int64_t length = left->length + right->length;
+    result->length = length;
+    result->hash = 0;
+
+    if (length <= STRING_INLINE_CAPACITY) {
+        memcpy(result->data.inline_chars, string_bytes(left), left->length);
+        memcpy(result->data.inline_chars + left->length, string_bytes(right), right->length);
+        result->data.inline_chars[length] = '\0';
+        return;
+    }
+
+    // In place only after the newest string of a builder, and only while
+    // a byte stays free for its terminator. Claiming the bytes first keeps
+    // two threads from extending the same string into the same bytes.
+    StringBuilder* builder = left->length > STRING_INLINE_CAPACITY ? left->data.builder : NULL;
+    int64_t expected = left->length;
+    if (!builder || length >= builder->capacity ||
+        !atomic_compare_exchange_strong(&builder->length, &expected, length)) {
+        builder = string_builder_new(heap, left, length);
+    }
+    memcpy(builder->chars + left->length, string_bytes(right), right->length);
+    result->data.chars = builder->chars;
+    result->data.builder = builder;
+    result->data.terminated = 0;
+}
+
+// Threads that race to flatten one string may each make a copy; any of
+// them may stay. The copy lives as long as the string.
+const char* string_flatten(String* string) {
+    StringBuilder* builder = string->data.builder;
+    int64_t expected = string->length;
+
+    if (builder && atomic_compare_exchange_strong(&builder->length, &expected, string->length + 1)) {
+        builder->chars[string->length] = '\0';
+    } else {
+        char* copy = heap_alloc_beside(vm_heap(), string, string->length + 1);
+        memcpy(copy, string->data.chars, string->length);
+        copy[string->length] = '\0';
+        __atomic_store_n(&string->data.chars, copy, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&string->data.terminated, 1, __ATOMIC_RELEASE);
+    return string->data.chars;
+}
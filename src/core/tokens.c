@@ -31,6 +31,8 @@ const char* token_type_string(TokenType type) {
         case TOKEN_MATCH: return "MATCH";
         case TOKEN_TYPE: return "TYPE";
         case TOKEN_RETURN: return "RETURN";
+        case TOKEN_SPAWN: return "SPAWN";
+        case TOKEN_AWAIT: return "AWAIT";
         
         case TOKEN_INT_TYPE: return "INT_TYPE";
         case TOKEN_FLOAT_TYPE: return "FLOAT_TYPE";
@@ -59,12 +61,14 @@ const char* token_type_string(TokenType type) {
         case TOKEN_COMMA: return "COMMA";
         case TOKEN_COLON: return "COLON";
         case TOKEN_DOT: return "DOT";
+        case TOKEN_RANGE: return "RANGE";
         case TOKEN_LPAREN: return "LPAREN";
         case TOKEN_RPAREN: return "RPAREN";
         case TOKEN_LBRACE: return "LBRACE";
         case TOKEN_RBRACE: return "RBRACE";
         case TOKEN_LBRACKET: return "LBRACKET";
         case TOKEN_RBRACKET: return "RBRACKET";
+        case TOKEN_AT: return "AT";
         
         case TOKEN_NEWLINE: return "NEWLINE";
         case TOKEN_EOF: return "EOF";
@@ -0,0 +1,737 @@
+#include "incremental.h"
+#include "lexer.h"
+#include "parser.h"
+#include "hkc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define INCREMENTAL_TABLE_SIZE 4096
+
+// Units re-checked only because something they use changed are dirty;
+// new or moved units are stale.
+#define UNIT_CLEAN 0
+#define UNIT_DIRTY 1
+#define UNIT_STALE 2
+
+struct NameUsers {
+    char* name;
+    IncrementalUnit** units;
+    int count;
+    int capacity;
+    struct NameUsers* next;
+};
+
+typedef struct NameList {
+    char** names;
+    int count;
+    int capacity;
+} NameList;
+
+static unsigned int name_hash(const char* str) {
+    unsigned int hash = 5381;
+    int c;
+    while ((c = *str++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash % INCREMENTAL_TABLE_SIZE;
+}
+
+static char* string_duplicate(const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str);
+    char* dup = malloc(len + 1);
+    if (!dup) return NULL;
+    strcpy(dup, str);
+    return dup;
+}
+
+// --- Name index ---
+
+static NameUsers* users_find(IncrementalSession* session, const char* name, int create) {
+    unsigned int hash = name_hash(name);
+    for (NameUsers* entry = session->users[hash]; entry; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) return entry;
+    }
+    if (!create) return NULL;
+
+    NameUsers* entry = calloc(1, sizeof(NameUsers));
+    entry->name = string_duplicate(name);
+    entry->next = session->users[hash];
+    session->users[hash] = entry;
+    return entry;
+}
+
+static void users_add(IncrementalSession* session, IncrementalUnit* unit) {
+    for (int i = 0; i < unit->name_count; i++) {
+        NameUsers* entry = users_find(session, unit->names[i], 1);
+        if (entry->count >= entry->capacity) {
+            entry->capacity = entry->capacity ? entry->capacity * 2 : 4;
+            entry->units = realloc(entry->units, sizeof(IncrementalUnit*) * entry->capacity);
+        }
+        entry->units[entry->count++] = unit;
+    }
+}
+
+static void users_remove(IncrementalSession* session, IncrementalUnit* unit) {
+    for (int i = 0; i < unit->name_count; i++) {
+        NameUsers* entry = users_find(session, unit->names[i], 0);
+        if (!entry) continue;
+        for (int j = 0; j < entry->count; j++) {
+            if (entry->units[j] == unit) {
+                entry->units[j] = entry->units[--entry->count];
+                break;
+            }
+        }
+    }
+}
+
+// The global a top-level statement declares, or NULL.
+static const char* declared_name(Statement* stmt) {
+    if (stmt->node_type == STMT_LET || stmt->node_type == STMT_CONST) return stmt->data.let_stmt.name;
+    if (stmt->node_type == STMT_TYPE) return stmt->data.type_decl.name;
+    return NULL;
+}
+
+// Marks every unit after `position` that mentions name.
+static void mark_users(IncrementalSession* session, const char* name, int position) {
+    NameUsers* entry = users_find(session, name, 0);
+    if (!entry) return;
+
+    for (int i = 0; i < entry->count; i++) {
+        IncrementalUnit* unit = entry->units[i];
+        if (unit->position > position && unit->dirty == UNIT_CLEAN) {
+            unit->dirty = UNIT_DIRTY;
+        }
+    }
+}
+
+static void mark_users_of_declarations(IncrementalSession* session, IncrementalUnit* unit, int position) {
+    for (int i = 0; i < unit->program->statement_count; i++) {
+        const char* name = declared_name(unit->program->statements[i]);
+        if (name) mark_users(session, name, position);
+    }
+}
+
+// --- Collecting names ---
+
+static void name_list_add(NameList* list, char* name) {
+    if (list->count >= list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 8;
+        list->names = realloc(list->names, sizeof(char*) * list->capacity);
+    }
+    list->names[list->count++] = name;
+}
+
+static void collect_statement(NameList* list, Statement* stmt, int in_function, int* borrows);
+
+// Struct names used in annotations.
+static void collect_type(NameList* list, Type* type) {
+    if (!type) return;
+
+    switch (type->node_type) {
+        case TYPE_IDENTIFIER:
+            name_list_add(list, type->data.identifier.name);
+            break;
+        case TYPE_FUNCTION:
+            for (int i = 0; i < type->data.function.param_count; i++) {
+                collect_type(list, type->data.function.params[i]);
+            }
+            collect_type(list, type->data.function.return_type);
+            break;
+        case TYPE_STRUCT:
+            for (int i = 0; i < type->data.struct_type.field_count; i++) {
+                collect_type(list, type->data.struct_type.field_types[i]);
+            }
+            break;
+        case TYPE_GENERIC:
+            for (int i = 0; i < type->data.generic.argument_count; i++) {
+                collect_type(list, type->data.generic.arguments[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void collect_block(NameList* list, Statement** statements, int count, int in_function, int* borrows) {
+    for (int i = 0; i < count; i++) {
+        collect_statement(list, statements[i], in_function, borrows);
+    }
+}
+
+// Every identifier counts, including locals that shadow a global; that
+// only makes the dependency set larger than strictly needed.
+static void collect_expression(NameList* list, Expression* expr, int in_function, int* borrows) {
+    if (!expr) return;
+
+    switch (expr->node_type) {
+        case EXPR_IDENTIFIER:
+            name_list_add(list, expr->data.identifier.value);
+            break;
+        case EXPR_FUNCTION_LITERAL:
+            for (int i = 0; i < expr->data.function_literal.parameter_count; i++) {
+                collect_type(list, expr->data.function_literal.parameters[i]->type);
+            }
+            collect_type(list, expr->data.function_literal.return_type);
+            collect_block(list, expr->data.function_literal.body, expr->data.function_literal.body_count, 1, borrows);
+            break;
+        case EXPR_CALL:
+            collect_expression(list, expr->data.call.function, in_function, borrows);
+            for (int i = 0; i < expr->data.call.argument_count; i++) {
+                collect_expression(list, expr->data.call.arguments[i], in_function, borrows);
+            }
+            break;
+        case EXPR_INFIX:
+            collect_expression(list, expr->data.infix.left, in_function, borrows);
+            collect_expression(list, expr->data.infix.right, in_function, borrows);
+            break;
+        case EXPR_PREFIX:
+            // A top-level borrow stays on the global it borrows, so it cannot
+            // be undone by re-checking just this declaration.
+            if (!in_function && expr->data.prefix.operator[0] == '&') {
+                *borrows = 1;
+            }
+            collect_expression(list, expr->data.prefix.right, in_function, borrows);
+            break;
+        case EXPR_IF:
+            collect_expression(list, expr->data.if_expr.condition, in_function, borrows);
+            collect_block(list, expr->data.if_expr.then_branch, expr->data.if_expr.then_count, in_function, borrows);
+            collect_block(list, expr->data.if_expr.else_branch, expr->data.if_expr.else_count, in_function, borrows);
+            break;
+        case EXPR_MATCH:
+            collect_expression(list, expr->data.match.expression, in_function, borrows);
+            for (int i = 0; i < expr->data.match.case_count; i++) {
+                collect_expression(list, expr->data.match.cases[i]->pattern, in_function, borrows);
+                collect_expression(list, expr->data.match.cases[i]->result, in_function, borrows);
+            }
+            break;
+        case EXPR_PIPE:
+            collect_expression(list, expr->data.pipe.left, in_function, borrows);
+            collect_expression(list, expr->data.pipe.right, in_function, borrows);
+            break;
+        case EXPR_ARRAY_LITERAL:
+            for (int i = 0; i < expr->data.array_literal.element_count; i++) {
+                collect_expression(list, expr->data.array_literal.elements[i], in_function, borrows);
+            }
+            break;
+        case EXPR_INDEX:
+            collect_expression(list, expr->data.index.array, in_function, borrows);
+            collect_expression(list, expr->data.index.index, in_function, borrows);
+            break;
+        case EXPR_MAP_LITERAL:
+            for (int i = 0; i < expr->data.map_literal.entry_count; i++) {
+                collect_expression(list, expr->data.map_literal.entries[i], in_function, borrows);
+            }
+            break;
+        case EXPR_FIELD:
+            collect_expression(list, expr->data.field.object, in_function, borrows);
+            break;
+        default:
+            break;
+    }
+}
+
+static void collect_statement(NameList* list, Statement* stmt, int in_function, int* borrows) {
+    if (!stmt) return;
+
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            name_list_add(list, stmt->data.let_stmt.name);
+            collect_type(list, stmt->data.let_stmt.type);
+            collect_expression(list, stmt->data.let_stmt.value, in_function, borrows);
+            break;
+        case STMT_RETURN:
+            collect_expression(list, stmt->data.return_stmt.return_value, in_function, borrows);
+            break;
+        case STMT_EXPRESSION:
+            collect_expression(list, stmt->data.expression_stmt.expression, in_function, borrows);
+            break;
+        case STMT_YIELD:
+            collect_expression(list, stmt->data.yield_stmt.value, in_function, borrows);
+            break;
+        case STMT_BLOCK:
+            collect_block(list, stmt->data.block_stmt.statements, stmt->data.block_stmt.statement_count, in_function, borrows);
+            break;
+        case STMT_WHILE:
+            collect_expression(list, stmt->data.while_stmt.condition, in_function, borrows);
+            collect_statement(list, stmt->data.while_stmt.body, in_function, borrows);
+            break;
+        case STMT_FOR:
+            name_list_add(list, stmt->data.for_stmt.variable);
+            for (int i = 0; i < stmt->data.for_stmt.reduce_count; i++) {
+                name_list_add(list, stmt->data.for_stmt.reduce_names[i]);
+            }
+            collect_expression(list, stmt->data.for_stmt.start, in_function, borrows);
+            collect_expression(list, stmt->data.for_stmt.end, in_function, borrows);
+            collect_statement(list, stmt->data.for_stmt.body, in_function, borrows);
+            break;
+        case STMT_TYPE:
+            name_list_add(list, stmt->data.type_decl.name);
+            collect_type(list, stmt->data.type_decl.type);
+            break;
+        default:
+            break;
+    }
+}
+
+static int compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static void collect_unit_names(IncrementalUnit* unit) {
+    NameList list = {0};
+    int borrows = 0;
+
+    collect_block(&list, unit->program->statements, unit->program->statement_count, 0, &borrows);
+
+    if (list.count > 1) {
+        qsort(list.names, list.count, sizeof(char*), compare_names);
+        int unique = 1;
+        for (int i = 1; i < list.count; i++) {
+            if (strcmp(list.names[i], list.names[unique - 1]) != 0) {
+                list.names[unique++] = list.names[i];
+            }
+        }
+        list.count = unique;
+    }
+
+    unit->names = list.names;
+    unit->name_count = list.count;
+    unit->borrows_globals = borrows;
+}
+
+// --- Units ---
+
+static void free_errors(SemanticError* error) {
+    while (error) {
+        SemanticError* next = error->next;
+        free(error->message);
+        free(error);
+        error = next;
+    }
+}
+
+static IncrementalUnit* unit_new(const char* source, SourceSpan span, uint64_t hash) {
+    IncrementalUnit* unit = calloc(1, sizeof(IncrementalUnit));
+    unit->hash = hash;
+    unit->length = span.end - span.start;
+    unit->text = malloc(unit->length + 1);
+    memcpy(unit->text, source + span.start, unit->length);
+    unit->text[unit->length] = '\0';
+    unit->line = span.line;
+    unit->column = span.column;
+    unit->parsed_line = span.line;
+    unit->dirty = UNIT_STALE;
+
+    Lexer* lexer = lexer_new_range(source, span.start, span.end, span.line, span.column);
+    Parser* parser = parser_new(lexer);
+    unit->program = parser_parse_program(parser);
+
+    unit->parse_errors = parser->errors;
+    unit->parse_error_count = parser->error_count;
+    parser->errors = NULL;
+    parser->error_count = 0;
+    lexer_free(lexer);
+    parser_free(parser);
+
+    collect_unit_names(unit);
+    unit->symbols = calloc(unit->program->statement_count + 1, sizeof(Symbol*));
+    return unit;
+}
+
+static void unit_release_symbols(SemanticAnalyzer* analyzer, IncrementalUnit* unit) {
+    for (int i = 0; i < unit->program->statement_count; i++) {
+        if (unit->symbols[i]) {
+            symbol_table_remove_global(analyzer, unit->symbols[i]);
+            symbol_free(unit->symbols[i]);
+            unit->symbols[i] = NULL;
+        }
+    }
+}
+
+static void unit_free(IncrementalUnit* unit) {
+    for (int i = 0; i < unit->parse_error_count; i++) {
+        free(unit->parse_errors[i]);
+    }
+    free(unit->parse_errors);
+    free_errors(unit->errors);
+    free(unit->names);
+    free(unit->symbols);
+    program_free(unit->program);
+    free(unit->text);
+    free(unit);
+}
+
+static int unit_matches(IncrementalUnit* unit, const char* source, SourceSpan span, uint64_t hash) {
+    if (unit->hash != hash || unit->length != span.end - span.start || unit->column != span.column) {
+        return 0;
+    }
+    // Parse errors carry their position in the message, so a unit that has
+    // them is only reused where it was.
+    if (unit->parse_error_count > 0 && unit->line != span.line) {
+        return 0;
+    }
+    return memcmp(unit->text, source + span.start, unit->length) == 0;
+}
+
+static int is_blank(const char* source, SourceSpan span) {
+    for (int i = span.start; i < span.end; i++) {
+        if (!isspace((unsigned char)source[i])) return 0;
+    }
+    return 1;
+}
+
+// --- Analysis ---
+
+// Struct types compare by name, so a type declaration's fields are
+// compared here.
+static int same_fields(TypeInfo* a, TypeInfo* b) {
+    if (a->category != TYPECAT_STRUCT) return 1;
+    if (a->data.struct_info.field_count != b->data.struct_info.field_count) return 0;
+    for (int i = 0; i < a->data.struct_info.field_count; i++) {
+        if (strcmp(a->data.struct_info.field_names[i], b->data.struct_info.field_names[i]) != 0 ||
+            !type_info_equals(a->data.struct_info.field_types[i], b->data.struct_info.field_types[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int same_interface(Symbol* a, Symbol* b) {
+    if (!a || !b) return a == b;
+    return a->kind == b->kind && a->is_const == b->is_const && a->is_mutable == b->is_mutable &&
+           a->is_pure == b->is_pure && type_info_equals(a->type, b->type) && same_fields(a->type, b->type);
+}
+
+// Re-checks one unit against the globals declared before it. Returns 1 if
+// what it declares looks different to the units after it.
+static int analyze_unit(IncrementalSession* session, IncrementalUnit* unit) {
+    SemanticAnalyzer* analyzer = session->analyzer;
+    int count = unit->program->statement_count;
+
+    Symbol** previous = unit->symbols;
+    unit->symbols = calloc(count + 1, sizeof(Symbol*));
+    for (int i = 0; i < count; i++) {
+        if (previous[i]) symbol_table_remove_global(analyzer, previous[i]);
+    }
+
+    free_errors(unit->errors);
+    analyzer->errors = NULL;
+    analyzer->error_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        Statement* stmt = unit->program->statements[i];
+        int index = unit->first_statement + i;
+
+        analyzer->global_visibility_limit = index;
+        analyzer->error_order = index;
+        int ok = semantic_analyze_statement(analyzer, stmt);
+
+        // A serial pass stops at the first failure; here the next unit is
+        // checked too, so leave the analyzer back at global scope.
+        while (analyzer->current_scope != analyzer->global_scope) {
+            semantic_pop_scope(analyzer);
+        }
+
+        if (declared_name(stmt)) {
+            unit->symbols[i] = symbol_table_lookup_global(analyzer, declared_name(stmt), index);
+        }
+        if (!ok) break;
+    }
+    analyzer->global_visibility_limit = -1;
+
+    unit->errors = analyzer->errors;
+    unit->error_count = analyzer->error_count;
+    analyzer->errors = NULL;
+    analyzer->error_count = 0;
+
+    int changed = 0;
+    for (int i = 0; i < count; i++) {
+        if (!same_interface(previous[i], unit->symbols[i])) changed = 1;
+        symbol_free(previous[i]);
+    }
+    free(previous);
+
+    unit->dirty = UNIT_CLEAN;
+    session->reanalyzed_count++;
+    return changed;
+}
+
+// Hands the global of a removed unit to the new unit that redeclares its
+// name in the same place, so checking the new unit can tell whether users
+// need to be re-checked.
+static int inherit_symbol(IncrementalSession* session, Symbol* symbol, IncrementalUnit** candidates, int count) {
+    for (int i = 0; i < count; i++) {
+        IncrementalUnit* unit = candidates[i];
+        for (int j = 0; j < unit->program->statement_count; j++) {
+            Statement* stmt = unit->program->statements[j];
+            if (declared_name(stmt) && !unit->symbols[j] && strcmp(declared_name(stmt), symbol->name) == 0) {
+                symbol_table_remove_global(session->analyzer, symbol);
+                unit->symbols[j] = symbol;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Checks dirty units in source order. Returns 0 without finishing if a
+// unit with a top-level borrow has to be re-checked incrementally.
+static int check_units(IncrementalSession* session, int full) {
+    for (int i = 0; i < session->unit_count; i++) {
+        IncrementalUnit* unit = session->units[i];
+        if (unit->dirty == UNIT_CLEAN) continue;
+        if (!full && unit->borrows_globals) return 0;
+
+        if (analyze_unit(session, unit)) {
+            mark_users_of_declarations(session, unit, unit->position);
+        }
+    }
+    return 1;
+}
+
+// Starts over with a fresh analyzer; needed when borrow state on globals
+// would otherwise carry over from a previous version of the source.
+static void check_all_units(IncrementalSession* session) {
+    semantic_analyzer_free(session->analyzer);
+    session->analyzer = semantic_analyzer_new();
+    session->reanalyzed_count = 0;
+    session->full_check = 1;
+
+    for (int i = 0; i < session->unit_count; i++) {
+        IncrementalUnit* unit = session->units[i];
+        memset(unit->symbols, 0, sizeof(Symbol*) * (unit->program->statement_count + 1));
+        unit->dirty = UNIT_STALE;
+    }
+    check_units(session, 1);
+}
+
+// --- Session ---
+
+IncrementalSession* incremental_session_new(void) {
+    IncrementalSession* session = calloc(1, sizeof(IncrementalSession));
+    session->analyzer = semantic_analyzer_new();
+    session->users = calloc(INCREMENTAL_TABLE_SIZE, sizeof(NameUsers*));
+    return session;
+}
+
+void incremental_session_free(IncrementalSession* session) {
+    if (!session) return;
+
+    for (int i = 0; i < session->unit_count; i++) {
+        unit_free(session->units[i]);
+    }
+    free(session->units);
+
+    for (int i = 0; i < INCREMENTAL_TABLE_SIZE; i++) {
+        NameUsers* entry = session->users[i];
+        while (entry) {
+            NameUsers* next = entry->next;
+            free(entry->name);
+            free(entry->units);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(session->users);
+
+    semantic_analyzer_free(session->analyzer);
+    free(session);
+}
+
+int incremental_update(IncrementalSession* session, const char* source, int length) {
+    int span_count;
+    SourceSpan* spans = parser_split_statements(source, length, &span_count);
+
+    IncrementalUnit** old_units = session->units;
+    int old_count = session->unit_count;
+
+    // Chains of old units by text hash, kept in source order so identical
+    // declarations are matched first to first.
+    int bucket_count = 1;
+    while (bucket_count < old_count * 2) bucket_count <<= 1;
+    int* heads = malloc(sizeof(int) * bucket_count);
+    int* next = malloc(sizeof(int) * (old_count + 1));
+    for (int i = 0; i < bucket_count; i++) heads[i] = -1;
+    for (int i = old_count - 1; i >= 0; i--) {
+        int bucket = (int)(old_units[i]->hash & (uint64_t)(bucket_count - 1));
+        next[i] = heads[bucket];
+        heads[bucket] = i;
+    }
+
+    IncrementalUnit** units = malloc(sizeof(IncrementalUnit*) * (span_count + 1));
+    IncrementalUnit** moved = malloc(sizeof(IncrementalUnit*) * (span_count + 1));
+    IncrementalUnit** added = malloc(sizeof(IncrementalUnit*) * (span_count + 1));
+    int* added_slots = malloc(sizeof(int) * (span_count + 1));
+    char* reused = calloc(old_count + 1, 1);
+    int unit_count = 0;
+    int moved_count = 0;
+    int added_count = 0;
+    int kept_count = 0;
+    int last_position = -1;
+    int needs_full_check = 0;
+
+    session->reparsed_count = 0;
+    session->reanalyzed_count = 0;
+    session->full_check = 0;
+
+    for (int i = 0; i < span_count; i++) {
+        SourceSpan span = spans[i];
+        if (is_blank(source, span)) continue;
+
+        uint64_t hash = hkc_hash_source(source + span.start, span.end - span.start, 0);
+        int bucket = (int)(hash & (uint64_t)(bucket_count - 1));
+        IncrementalUnit* unit = NULL;
+
+        for (int* link = &heads[bucket]; *link != -1; link = &next[*link]) {
+            if (unit_matches(old_units[*link], source, span, hash)) {
+                unit = old_units[*link];
+                reused[*link] = 1;
+                *link = next[*link];
+                break;
+            }
+        }
+
+        if (unit) {
+            // Reordering changes which globals a declaration can see. Units
+            // that stay in order form an increasing run of old positions;
+            // any pair whose order changed has at least one moved unit.
+            if (unit->program->statement_count > 0) {
+                if (unit->position < last_position) {
+                    unit->dirty = UNIT_STALE;
+                    moved[moved_count++] = unit;
+                } else {
+                    last_position = unit->position;
+                    kept_count++;
+                }
+            }
+            unit->line = span.line;
+        } else {
+            unit = unit_new(source, span, hash);
+            users_add(session, unit);
+            added_slots[added_count] = kept_count;
+            added[added_count++] = unit;
+            session->reparsed_count++;
+        }
+        if (unit->dirty == UNIT_STALE && unit->borrows_globals) needs_full_check = 1;
+        units[unit_count++] = unit;
+    }
+    free(spans);
+    free(heads);
+    free(next);
+
+    int statement_index = 0;
+    for (int i = 0; i < unit_count; i++) {
+        IncrementalUnit* unit = units[i];
+        unit->position = i;
+        unit->first_statement = statement_index;
+        for (int j = 0; j < unit->program->statement_count; j++) {
+            if (unit->symbols[j]) unit->symbols[j]->declaration_index = statement_index + j;
+        }
+        statement_index += unit->program->statement_count;
+    }
+
+    // A removed declaration affects its users wherever they are, unless a
+    // new one in the same place takes over its names; then the new one is
+    // compared with it once checked, like any edited declaration.
+    int slot = 0;
+    int first_added = 0;
+    for (int i = 0; i < old_count; i++) {
+        IncrementalUnit* unit = old_units[i];
+        if (reused[i]) {
+            if (unit->dirty != UNIT_STALE && unit->program->statement_count > 0) slot++;
+            continue;
+        }
+
+        while (first_added < added_count && added_slots[first_added] < slot) first_added++;
+        int last_added = first_added;
+        while (last_added < added_count && added_slots[last_added] == slot) last_added++;
+
+        if (unit->borrows_globals) needs_full_check = 1;
+        users_remove(session, unit);
+        for (int j = 0; j < unit->program->statement_count; j++) {
+            const char* name = declared_name(unit->program->statements[j]);
+            if (!name) continue;
+
+            if (!unit->symbols[j] || !inherit_symbol(session, unit->symbols[j], added + first_added, last_added - first_added)) {
+                mark_users(session, name, -1);
+            } else {
+                unit->symbols[j] = NULL;
+            }
+        }
+        unit_release_symbols(session->analyzer, unit);
+        unit_free(unit);
+    }
+
+    // Moving also changes which units can see a declaration.
+    for (int i = 0; i < moved_count; i++) {
+        mark_users_of_declarations(session, moved[i], -1);
+    }
+    free(reused);
+    free(moved);
+    free(added);
+    free(added_slots);
+    free(old_units);
+
+    session->units = units;
+    session->unit_count = unit_count;
+
+    if (needs_full_check || !check_units(session, 0)) {
+        check_all_units(session);
+    }
+
+    for (int i = 0; i < unit_count; i++) {
+        if (units[i]->parse_error_count > 0 || units[i]->error_count > 0) return 0;
+    }
+    return 1;
+}
+
+// Same layout as parser_print_errors and semantic_print_errors, in source
+// order. Reused units keep the positions they were parsed with, so their
+// lines are shifted by how far the unit has moved since.
+void incremental_print_errors(IncrementalSession* session) {
+    if (!session) return;
+
+    int parse_error_count = 0;
+    int error_count = 0;
+    for (int i = 0; i < session->unit_count; i++) {
+        parse_error_count += session->units[i]->parse_error_count;
+        error_count += session->units[i]->error_count;
+    }
+
+    if (parse_error_count > 0) {
+        printf("Parser errors:\n");
+        for (int i = 0; i < session->unit_count; i++) {
+            IncrementalUnit* unit = session->units[i];
+            for (int j = 0; j < unit->parse_error_count; j++) {
+                printf("  %s\n", unit->parse_errors[j]);
+            }
+        }
+        return;
+    }
+
+    if (error_count == 0) return;
+
+    printf("Semantic errors (%d):\n", error_count);
+    for (int i = 0; i < session->unit_count; i++) {
+        IncrementalUnit* unit = session->units[i];
+        if (unit->error_count == 0) continue;
+
+        // Each list is newest first.
+        SemanticError** errors = malloc(sizeof(SemanticError*) * unit->error_count);
+        int count = 0;
+        for (SemanticError* error = unit->errors; error; error = error->next) {
+            errors[count++] = error;
+        }
+
+        int shift = unit->line - unit->parsed_line;
+        for (int j = count - 1; j >= 0; j--) {
+            int line = errors[j]->line > 0 ? errors[j]->line + shift : errors[j]->line;
+            printf("  Line %d:%d - %s\n", line, errors[j]->column, errors[j]->message);
+        }
+        free(errors);
+    }
+}
@@ -28,6 +28,7 @@ Lexer* lexer_new(const char* input) {
     if (!lexer) return NULL;
     
     lexer->input = string_duplicate(input);
+    lexer->length = (int)strlen(lexer->input);
     lexer->position = 0;
     lexer->read_position = 0;
     lexer->line = 1;
@@ -38,6 +39,24 @@ Lexer* lexer_new(const char* input) {
     return lexer;
 }
 
+Lexer* lexer_new_range(const char* input, int start, int end, int line, int column) {
+    Lexer* lexer = malloc(sizeof(Lexer));
+    if (!lexer) return NULL;
+
+    lexer->length = end - start;
+    lexer->input = malloc(lexer->length + 1);
+    memcpy(lexer->input, input + start, lexer->length);
+    lexer->input[lexer->length] = '\0';
+    lexer->position = 0;
+    lexer->read_position = 0;
+    lexer->ch = 0;
+
+    lexer_read_char(lexer);
+    lexer->line = line;
+    lexer->column = column;
+    return lexer;
+}
+
 void lexer_free(Lexer* lexer) {
     if (lexer) {
         free(lexer->input);
@@ -46,7 +65,7 @@ void lexer_free(Lexer* lexer) {
 }
 
 static void lexer_read_char(Lexer* lexer) {
-    if (lexer->read_position >= (int)strlen(lexer->input)) {
+    if (lexer->read_position >= lexer->length) {
         lexer->ch = 0; 
     } else {
         lexer->ch = lexer->input[lexer->read_position];
@@ -64,7 +83,7 @@ static void lexer_read_char(Lexer* lexer) {
 }
 
 char lexer_peek_char(Lexer* lexer) {
-    if (lexer->read_position >= (int)strlen(lexer->input)) {
+    if (lexer->read_position >= lexer->length) {
         return 0;
     }
     return lexer->input[lexer->read_position];
@@ -240,7 +259,12 @@ Token* lexer_next_token(Lexer* lexer) {
             break;
             
         case '.':
-            tok = token_new(TOKEN_DOT, ".", lexer->line, lexer->column);
+            if (lexer_peek_char(lexer) == '.') {
+                lexer_read_char(lexer);
+                tok = token_new(TOKEN_RANGE, "..", lexer->line, lexer->column - 1);
+            } else {
+                tok = token_new(TOKEN_DOT, ".", lexer->line, lexer->column);
+            }
             break;
             
         case '(':
@@ -267,6 +291,10 @@ Token* lexer_next_token(Lexer* lexer) {
             tok = token_new(TOKEN_RBRACKET, "]", lexer->line, lexer->column);
             break;
             
+        case '@':
+            tok = token_new(TOKEN_AT, "@", lexer->line, lexer->column);
+            break;
+            
         case '"':
             {
                 char* literal = lexer_read_string(lexer);
@@ -325,7 +353,9 @@ static char* lexer_read_number(Lexer* lexer) {
     int position = lexer->position;
     int has_dot = 0;
     
-    while (is_digit(lexer->ch) || (lexer->ch == '.' && !has_dot)) {
+    // `0..n` is a range, not the float `0.` followed by `.n`.
+    while (is_digit(lexer->ch) ||
+           (lexer->ch == '.' && !has_dot && lexer_peek_char(lexer) != '.')) {
         if (lexer->ch == '.') {
             has_dot = 1;
         }
@@ -371,6 +401,8 @@ static TokenType lookup_identifier(const char* ident) {
         {"match", TOKEN_MATCH},
         {"type", TOKEN_TYPE},
         {"return", TOKEN_RETURN},
+        {"spawn", TOKEN_SPAWN},
+        {"await", TOKEN_AWAIT},
         {"true", TOKEN_BOOL_TRUE},
         {"false", TOKEN_BOOL_FALSE},
         {"int", TOKEN_INT_TYPE},
@@ -1,7 +1,12 @@
 #include "parser.h"
+#include "parallel.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+
+// Smallest chunk handed to a worker in parser_parse_program_parallel.
+#define PARSER_MIN_CHUNK_SIZE 4096
 
 static void parser_next_token(Parser* parser);
 static Statement* parser_parse_statement(Parser* parser);
@@ -9,9 +14,15 @@ static Statement* parser_parse_let_statement(Parser* parser);
 static Statement* parser_parse_const_statement(Parser* parser);
 static Statement* parser_parse_return_statement(Parser* parser);
 static Statement* parser_parse_while_statement(Parser* parser);
+static Statement* parser_parse_for_statement(Parser* parser, int is_parallel);
+static Statement* parser_parse_yield_statement(Parser* parser);
+static Statement* parser_parse_function_declaration(Parser* parser);
+static Statement* parser_parse_type_declaration(Parser* parser);
+static Statement* parser_parse_annotated_statement(Parser* parser);
 static Statement* parser_parse_expression_statement(Parser* parser);
 static Expression* parser_parse_expression(Parser* parser, Precedence precedence);
 static Expression* parser_parse_prefix_expression(Parser* parser);
+static Expression* parser_parse_task_expression(Parser* parser);
 static Expression* parser_parse_infix_expression(Parser* parser, Expression* left);
 static Expression* parser_parse_identifier(Parser* parser);
 static Expression* parser_parse_integer_literal(Parser* parser);
@@ -23,6 +34,10 @@ static Expression* parser_parse_if_expression(Parser* parser);
 static Expression* parser_parse_function_literal(Parser* parser);
 static Expression* parser_parse_call_expression(Parser* parser, Expression* function);
 static Expression* parser_parse_match_expression(Parser* parser);
+static Expression* parser_parse_array_literal(Parser* parser);
+static Expression* parser_parse_map_literal(Parser* parser);
+static Expression* parser_parse_index_expression(Parser* parser, Expression* array);
+static Expression* parser_parse_field_expression(Parser* parser, Expression* object);
 static Type* parser_parse_type(Parser* parser);
 static Parameter** parser_parse_function_parameters(Parser* parser, int* param_count);
 static Expression** parser_parse_call_arguments(Parser* parser, int* arg_count);
@@ -31,6 +46,7 @@ static Precedence parser_get_precedence(TokenType token_type);
 static int parser_current_token_is(Parser* parser, TokenType token_type);
 static int parser_peek_token_is(Parser* parser, TokenType token_type);
 static int parser_expect_peek(Parser* parser, TokenType token_type);
+static void parser_skip_peek_newlines(Parser* parser);
 
 static char* string_duplicate(const char* str) {
     if (!str) return NULL;
@@ -43,6 +59,12 @@ static char* string_duplicate(const char* str) {
     return dup;
 }
 
+static void parser_name_function(Expression* value, const char* name) {
+    if (value && value->node_type == EXPR_FUNCTION_LITERAL && !value->data.function_literal.name) {
+        value->data.function_literal.name = string_duplicate(name);
+    }
+}
+
 static Type** parser_parse_type_list(Parser* parser, int* type_count) {
     *type_count = 0;
     int capacity = 10;
@@ -81,6 +103,7 @@ Parser* parser_new(Lexer* lexer) {
     parser->lexer = lexer;
     parser->current_token = NULL;
     parser->peek_token = NULL;
+    parser->yield_count = 0;
     parser->errors = malloc(sizeof(char*) * 10);
     parser->error_count = 0;
     parser->error_capacity = 10;
@@ -112,16 +135,26 @@ static void parser_next_token(Parser* parser) {
     parser->peek_token = lexer_next_token(parser->lexer);
 }
 
-void parser_add_error(Parser* parser, const char* message) {
+static void parser_append_error(Parser* parser, char* message) {
     if (parser->error_count >= parser->error_capacity) {
         parser->error_capacity *= 2;
         parser->errors = realloc(parser->errors, sizeof(char*) * parser->error_capacity);
     }
     
-    parser->errors[parser->error_count] = string_duplicate(message);
+    parser->errors[parser->error_count] = message;
     parser->error_count++;
 }
 
+static void parser_add_error_at(Parser* parser, int line, int column, const char* message) {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "Line %d:%d - %s", line, column, message);
+    parser_append_error(parser, string_duplicate(buffer));
+}
+
+void parser_add_error(Parser* parser, const char* message) {
+    parser_add_error_at(parser, parser->current_token->line, parser->current_token->column, message);
+}
+
 void parser_print_errors(Parser* parser) {
     printf("Parser errors:\n");
     for (int i = 0; i < parser->error_count; i++) {
@@ -149,6 +182,244 @@ Program* parser_parse_program(Parser* parser) {
     return program;
 }
 
+typedef struct ParseChunk {
+    SourceSpan span;
+    Parser* parser;
+    Program* program;
+} ParseChunk;
+
+typedef struct ParallelParse {
+    const char* source;
+    ParseChunk* chunks;
+} ParallelParse;
+
+static int parser_is_identifier_char(char ch) {
+    return isalnum((unsigned char)ch) || ch == '_';
+}
+
+// Moves the pre-scan to source[i + 1], tracking line/column exactly like
+// lexer_read_char does.
+static void parser_scan_advance(const char* source, int* i, int* line, int* column) {
+    (*i)++;
+    if (source[*i] == '\n') {
+        (*line)++;
+        *column = 0;
+    } else {
+        (*column)++;
+    }
+}
+
+// Character-level pre-scan that cuts the source after a `;` or newline at
+// bracket depth zero, skipping strings and comments. An annotation keeps
+// its chunk open until the declaration it applies to has started.
+static SourceSpan* parser_split_source(const char* source, int length, int target_size, int* chunk_count) {
+    int capacity = 16;
+    int count = 0;
+    SourceSpan* chunks = malloc(sizeof(SourceSpan) * capacity);
+
+    int line = 1;
+    int column = 0;
+    int depth = 0;
+    int pending_annotation = 0;
+    int cut = 1;
+
+    for (int i = 0; i < length; i++) {
+        if (source[i] == '\n') {
+            line++;
+            column = 0;
+        } else {
+            column++;
+        }
+
+        if (cut) {
+            if (count >= capacity) {
+                capacity *= 2;
+                chunks = realloc(chunks, sizeof(SourceSpan) * capacity);
+            }
+            if (count > 0) chunks[count - 1].end = i;
+            chunks[count].start = i;
+            chunks[count].end = length;
+            chunks[count].line = line;
+            chunks[count].column = column;
+            count++;
+            cut = 0;
+        }
+
+        char ch = source[i];
+        switch (ch) {
+            case '"':
+                while (i + 1 < length && source[i + 1] != '"') {
+                    parser_scan_advance(source, &i, &line, &column);
+                }
+                if (i + 1 < length) parser_scan_advance(source, &i, &line, &column);
+                break;
+            case '/':
+                if (i + 1 < length && source[i + 1] == '/') {
+                    while (i + 1 < length && source[i + 1] != '\n') {
+                        parser_scan_advance(source, &i, &line, &column);
+                    }
+                }
+                break;
+            case '{':
+            case '(':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ')':
+            case ']':
+                if (depth > 0) depth--;
+                break;
+            case '@':
+                pending_annotation = 1;
+                break;
+            case ';':
+            case '\n':
+                if (depth == 0 && !pending_annotation && i + 1 - chunks[count - 1].start >= target_size) {
+                    cut = 1;
+                }
+                break;
+            default:
+                if (isalpha((unsigned char)ch) || ch == '_') {
+                    int start = i;
+                    while (i + 1 < length && parser_is_identifier_char(source[i + 1])) {
+                        parser_scan_advance(source, &i, &line, &column);
+                    }
+                    int word_length = i + 1 - start;
+                    if (depth == 0 &&
+                        ((word_length == 3 && strncmp(source + start, "let", 3) == 0) ||
+                         (word_length == 5 && strncmp(source + start, "const", 5) == 0) ||
+                         (word_length == 4 && strncmp(source + start, "func", 4) == 0))) {
+                        pending_annotation = 0;
+                    }
+                }
+                break;
+        }
+    }
+
+    *chunk_count = count;
+    return chunks;
+}
+
+SourceSpan* parser_split_statements(const char* source, int length, int* span_count) {
+    return parser_split_source(source, length, 1, span_count);
+}
+
+int parser_input_complete(const char* source, int length) {
+    int line = 1;
+    int column = 0;
+    int depth = 0;
+    int pending_annotation = 0;
+
+    for (int i = 0; i < length; i++) {
+        char ch = source[i];
+        switch (ch) {
+            case '"':
+                while (i + 1 < length && source[i + 1] != '"') {
+                    parser_scan_advance(source, &i, &line, &column);
+                }
+                if (i + 1 >= length) return 0;
+                parser_scan_advance(source, &i, &line, &column);
+                break;
+            case '/':
+                if (i + 1 < length && source[i + 1] == '/') {
+                    while (i + 1 < length && source[i + 1] != '\n') {
+                        parser_scan_advance(source, &i, &line, &column);
+                    }
+                }
+                break;
+            case '{':
+            case '(':
+            case '[':
+                depth++;
+                break;
+            case '}':
+            case ')':
+            case ']':
+                if (depth > 0) depth--;
+                break;
+            case '@':
+                pending_annotation = 1;
+                break;
+            default:
+                if (isalpha((unsigned char)ch) || ch == '_') {
+                    int start = i;
+                    while (i + 1 < length && parser_is_identifier_char(source[i + 1])) {
+                        parser_scan_advance(source, &i, &line, &column);
+                    }
+                    int word_length = i + 1 - start;
+                    if (depth == 0 &&
+                        ((word_length == 3 && strncmp(source + start, "let", 3) == 0) ||
+                         (word_length == 5 && strncmp(source + start, "const", 5) == 0) ||
+                         (word_length == 4 && strncmp(source + start, "func", 4) == 0))) {
+                        pending_annotation = 0;
+                    }
+                }
+                break;
+        }
+    }
+
+    return depth == 0 && !pending_annotation;
+}
+
+static void parser_parse_chunk(void* context, int index, int worker) {
+    (void)worker;
+    ParallelParse* job = context;
+    ParseChunk* chunk = &job->chunks[index];
+
+    SourceSpan* span = &chunk->span;
+    Lexer* lexer = lexer_new_range(job->source, span->start, span->end, span->line, span->column);
+    chunk->parser = parser_new(lexer);
+    chunk->program = parser_parse_program(chunk->parser);
+}
+
+Program* parser_parse_program_parallel(Parser* parser, int thread_count) {
+    const char* source = parser->lexer->input;
+    int length = parser->lexer->length;
+
+    int target_size = length / (thread_count * 8) + 1;
+    if (target_size < PARSER_MIN_CHUNK_SIZE) target_size = PARSER_MIN_CHUNK_SIZE;
+
+    ParallelParse job;
+    int chunk_count;
+    SourceSpan* spans = parser_split_source(source, length, target_size, &chunk_count);
+    job.source = source;
+    job.chunks = malloc(sizeof(ParseChunk) * chunk_count);
+    for (int i = 0; i < chunk_count; i++) {
+        job.chunks[i].span = spans[i];
+        job.chunks[i].parser = NULL;
+        job.chunks[i].program = NULL;
+    }
+    free(spans);
+
+    parallel_for(chunk_count, thread_count, parser_parse_chunk, &job);
+
+    // Chunks are in source order and each chunk reports absolute positions,
+    // so concatenating them gives the same statements and errors as a
+    // serial parse.
+    Program* program = program_new();
+    for (int i = 0; i < chunk_count; i++) {
+        ParseChunk* chunk = &job.chunks[i];
+
+        for (int j = 0; j < chunk->program->statement_count; j++) {
+            program_add_statement(program, chunk->program->statements[j]);
+        }
+        free(chunk->program->statements);
+        free(chunk->program);
+
+        for (int j = 0; j < chunk->parser->error_count; j++) {
+            parser_append_error(parser, chunk->parser->errors[j]);
+        }
+        chunk->parser->error_count = 0;
+
+        lexer_free(chunk->parser->lexer);
+        parser_free(chunk->parser);
+    }
+
+    free(job.chunks);
+    return program;
+}
+
 static Statement* parser_parse_statement(Parser* parser) {
     switch (parser->current_token->type) {
         case TOKEN_LET:
@@ -159,12 +430,34 @@ static Statement* parser_parse_statement(Parser* parser) {
             return parser_parse_return_statement(parser);
         case TOKEN_WHILE:
             return parser_parse_while_statement(parser);
+        case TOKEN_FOR:
+            return parser_parse_for_statement(parser, 0);
+        case TOKEN_IDENTIFIER:
+            // `par` is only a keyword in front of `for`.
+            if (strcmp(parser->current_token->literal, "par") == 0 && parser_peek_token_is(parser, TOKEN_FOR)) {
+                return parser_parse_for_statement(parser, 1);
+            }
+            // So is `yield` at the start of a statement, unless it is assigned to.
+            if (strcmp(parser->current_token->literal, "yield") == 0 && !parser_peek_token_is(parser, TOKEN_ASSIGN)) {
+                return parser_parse_yield_statement(parser);
+            }
+            return parser_parse_expression_statement(parser);
+        case TOKEN_AT:
+            return parser_parse_annotated_statement(parser);
+        case TOKEN_TYPE:
+            return parser_parse_type_declaration(parser);
+        case TOKEN_FUNC:
+            if (parser_peek_token_is(parser, TOKEN_IDENTIFIER)) {
+                return parser_parse_function_declaration(parser);
+            }
+            return parser_parse_expression_statement(parser);
         case TOKEN_LBRACE:
             {
-                Token* brace_token = parser->current_token;
+                int line = parser->current_token->line;
+                int column = parser->current_token->column;
                 int stmt_count;
                 Statement** stmts = parser_parse_block_statement(parser, &stmt_count);
-                return statement_new_block(stmts, stmt_count, brace_token->line, brace_token->column);
+                return statement_new_block(stmts, stmt_count, line, column);
             }  
         default:
             return parser_parse_expression_statement(parser);
@@ -172,7 +465,8 @@ static Statement* parser_parse_statement(Parser* parser) {
 }
 
 static Statement* parser_parse_let_statement(Parser* parser) {
-    Token* let_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     int is_mutable = 0;
     
     if (parser_peek_token_is(parser, TOKEN_IDENTIFIER) && strcmp(parser->peek_token->literal, "mut") == 0) {
@@ -199,17 +493,19 @@ static Statement* parser_parse_let_statement(Parser* parser) {
         parser_next_token(parser);
         parser_next_token(parser);
         value = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+        parser_name_function(value, name);
     }
 
     if (parser_peek_token_is(parser, TOKEN_SEMICOLON)) {
         parser_next_token(parser);
     }
     
-    return statement_new_let(name, type, value, !is_mutable, let_token->line, let_token->column);
+    return statement_new_let(name, type, value, !is_mutable, line, column);
 }
 
 static Statement* parser_parse_const_statement(Parser* parser) {
-    Token* const_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     
     if (parser_peek_token_is(parser, TOKEN_IDENTIFIER) && strcmp(parser->peek_token->literal, "mut") == 0) {
         char error_msg[256];
@@ -239,16 +535,18 @@ static Statement* parser_parse_const_statement(Parser* parser) {
     
     parser_next_token(parser);
     Expression* value = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+    parser_name_function(value, name);
     
     if (parser_peek_token_is(parser, TOKEN_SEMICOLON)) {
         parser_next_token(parser);
     }
     
-    return statement_new_let(name, type, value, 1, const_token->line, const_token->column);
+    return statement_new_let(name, type, value, 1, line, column);
 }
 
 static Statement* parser_parse_return_statement(Parser* parser) {
-    Token* return_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     parser_next_token(parser);
     
     Expression* return_value = parser_parse_expression(parser, PRECEDENCE_LOWEST);
@@ -257,11 +555,12 @@ static Statement* parser_parse_return_statement(Parser* parser) {
         parser_next_token(parser);
     }
     
-    return statement_new_return(return_value, return_token->line, return_token->column);
+    return statement_new_return(return_value, line, column);
 }
 
 static Statement* parser_parse_while_statement(Parser* parser) {
-    Token* while_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     
     if (!parser_expect_peek(parser, TOKEN_LPAREN)) {
         return NULL;
@@ -282,18 +581,269 @@ static Statement* parser_parse_while_statement(Parser* parser) {
     Statement** body_stmts = parser_parse_block_statement(parser, &body_count);
     Statement* body = statement_new_block(body_stmts, body_count, parser->current_token->line, parser->current_token->column);
 
-    return statement_new_while(condition, body, while_token->line, while_token->column);
+    return statement_new_while(condition, body, line, column);
+}
+
+static int parser_parse_reduce_clause(Parser* parser, Statement* stmt) {
+    if (!parser_expect_peek(parser, TOKEN_LPAREN)) {
+        return 0;
+    }
+
+    int capacity = 4;
+    stmt->data.for_stmt.reduce_operators = malloc(sizeof(char*) * capacity);
+    stmt->data.for_stmt.reduce_names = malloc(sizeof(char*) * capacity);
+
+    for (;;) {
+        parser_next_token(parser);
+        const char* operator = parser->current_token->literal;
+        int known = parser_current_token_is(parser, TOKEN_PLUS) || parser_current_token_is(parser, TOKEN_MULTIPLY) ||
+                    (parser_current_token_is(parser, TOKEN_IDENTIFIER) &&
+                     (strcmp(operator, "min") == 0 || strcmp(operator, "max") == 0));
+        if (!known) {
+            char error_msg[256];
+            snprintf(error_msg, sizeof(error_msg), "unknown reduction operator '%s', expected +, *, min or max", operator);
+            parser_add_error(parser, error_msg);
+            return 0;
+        }
+        char* reduce_operator = string_duplicate(operator);
+
+        if (!parser_expect_peek(parser, TOKEN_COLON) || !parser_expect_peek(parser, TOKEN_IDENTIFIER)) {
+            free(reduce_operator);
+            return 0;
+        }
+
+        int count = stmt->data.for_stmt.reduce_count;
+        if (count >= capacity) {
+            capacity *= 2;
+            stmt->data.for_stmt.reduce_operators = realloc(stmt->data.for_stmt.reduce_operators, sizeof(char*) * capacity);
+            stmt->data.for_stmt.reduce_names = realloc(stmt->data.for_stmt.reduce_names, sizeof(char*) * capacity);
+        }
+        stmt->data.for_stmt.reduce_operators[count] = reduce_operator;
+        stmt->data.for_stmt.reduce_names[count] = string_duplicate(parser->current_token->literal);
+        stmt->data.for_stmt.reduce_count++;
+
+        if (!parser_peek_token_is(parser, TOKEN_COMMA)) break;
+        parser_next_token(parser);
+    }
+
+    return parser_expect_peek(parser, TOKEN_RPAREN);
+}
+
+// `for i in a..b { ... }`, `for x in sequence { ... }` and
+// `par for i in a..b reduce(+: total) { ... }`.
+static Statement* parser_parse_for_statement(Parser* parser, int is_parallel) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    if (is_parallel) {
+        parser_next_token(parser);
+    }
+
+    if (!parser_expect_peek(parser, TOKEN_IDENTIFIER)) {
+        return NULL;
+    }
+    char* variable = string_duplicate(parser->current_token->literal);
+
+    if (!parser_peek_token_is(parser, TOKEN_IDENTIFIER) || strcmp(parser->peek_token->literal, "in") != 0) {
+        parser_add_error_at(parser, parser->peek_token->line, parser->peek_token->column,
+                            "expected 'in' after the for loop variable");
+        free(variable);
+        return NULL;
+    }
+    parser_next_token(parser);
+    parser_next_token(parser);
+
+    Expression* start = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+    Expression* end = NULL;
+    if (parser_peek_token_is(parser, TOKEN_RANGE)) {
+        parser_next_token(parser);
+        parser_next_token(parser);
+        end = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+    }
+
+    Statement* stmt = statement_new_for(variable, start, end, NULL, line, column);
+    stmt->data.for_stmt.is_parallel = is_parallel;
+
+    if (parser_peek_token_is(parser, TOKEN_IDENTIFIER) && strcmp(parser->peek_token->literal, "reduce") == 0) {
+        parser_next_token(parser);
+        if (!is_parallel) {
+            parser_add_error(parser, "reduce is only allowed on a par for loop");
+            statement_free(stmt);
+            return NULL;
+        }
+        if (!parser_parse_reduce_clause(parser, stmt)) {
+            statement_free(stmt);
+            return NULL;
+        }
+    }
+
+    if (!parser_expect_peek(parser, TOKEN_LBRACE)) {
+        statement_free(stmt);
+        return NULL;
+    }
+
+    int body_count;
+    Statement** body_stmts = parser_parse_block_statement(parser, &body_count);
+    stmt->data.for_stmt.body = statement_new_block(body_stmts, body_count, parser->current_token->line, parser->current_token->column);
+    return stmt;
+}
+
+// `yield value;` inside a function body makes that function a generator.
+static Statement* parser_parse_yield_statement(Parser* parser) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    parser_next_token(parser);
+    Expression* value = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+    if (!value) {
+        return NULL;
+    }
+    parser->yield_count++;
+
+    if (parser_peek_token_is(parser, TOKEN_SEMICOLON)) {
+        parser_next_token(parser);
+    }
+
+    return statement_new_yield(value, line, column);
+}
+
+// `func name(...) -> T { ... }` is sugar for `const name = func(...) -> T { ... }`.
+static Statement* parser_parse_function_declaration(Parser* parser) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    parser_next_token(parser);
+    char* name = string_duplicate(parser->current_token->literal);
+
+    Expression* function = parser_parse_function_literal(parser);
+    if (!function) {
+        free(name);
+        return NULL;
+    }
+    parser_name_function(function, name);
+
+    if (parser_peek_token_is(parser, TOKEN_SEMICOLON)) {
+        parser_next_token(parser);
+    }
+
+    return statement_new_let(name, NULL, function, 1, line, column);
+}
+
+// `type Name { field: T, ... }`. Fields are separated by commas or
+// newlines.
+static Statement* parser_parse_type_declaration(Parser* parser) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    if (!parser_expect_peek(parser, TOKEN_IDENTIFIER)) {
+        return NULL;
+    }
+    char* name = string_duplicate(parser->current_token->literal);
+    if (!parser_expect_peek(parser, TOKEN_LBRACE)) {
+        free(name);
+        return NULL;
+    }
+
+    int count = 0;
+    int capacity = 4;
+    char** field_names = malloc(sizeof(char*) * capacity);
+    Type** field_types = malloc(sizeof(Type*) * capacity);
+    int failed = 0;
+
+    for (;;) {
+        parser_skip_peek_newlines(parser);
+        if (parser_peek_token_is(parser, TOKEN_RBRACE)) break;
+
+        if (!parser_expect_peek(parser, TOKEN_IDENTIFIER)) {
+            failed = 1;
+            break;
+        }
+        char* field_name = string_duplicate(parser->current_token->literal);
+        if (!parser_expect_peek(parser, TOKEN_COLON)) {
+            free(field_name);
+            failed = 1;
+            break;
+        }
+        parser_next_token(parser);
+        Type* field_type = parser_parse_type(parser);
+        if (!field_type) {
+            free(field_name);
+            failed = 1;
+            break;
+        }
+
+        if (count >= capacity) {
+            capacity *= 2;
+            field_names = realloc(field_names, sizeof(char*) * capacity);
+            field_types = realloc(field_types, sizeof(Type*) * capacity);
+        }
+        field_names[count] = field_name;
+        field_types[count] = field_type;
+        count++;
+
+        if (parser_peek_token_is(parser, TOKEN_COMMA)) {
+            parser_next_token(parser);
+        } else if (!parser_peek_token_is(parser, TOKEN_NEWLINE) && !parser_peek_token_is(parser, TOKEN_RBRACE)) {
+            parser_add_error(parser, "expected ',' or a new line between struct fields");
+            failed = 1;
+            break;
+        }
+    }
+
+    Type* type = type_new_struct(field_names, field_types, count);
+    if (failed || !parser_expect_peek(parser, TOKEN_RBRACE)) {
+        type_free(type);
+        free(name);
+        return NULL;
+    }
+
+    return statement_new_type(name, type, line, column);
+}
+
+// Annotations attach to the function bound by the following statement:
+// `@memo func f(...)` or `@memo const f = func(...)`.
+static Statement* parser_parse_annotated_statement(Parser* parser) {
+    if (!parser_expect_peek(parser, TOKEN_IDENTIFIER)) {
+        return NULL;
+    }
+
+    if (strcmp(parser->current_token->literal, "memo") != 0) {
+        char error_msg[256];
+        snprintf(error_msg, sizeof(error_msg), "unknown annotation @%s", parser->current_token->literal);
+        parser_add_error(parser, error_msg);
+        return NULL;
+    }
+
+    parser_next_token(parser);
+    while (parser_current_token_is(parser, TOKEN_NEWLINE)) {
+        parser_next_token(parser);
+    }
+
+    Statement* stmt = parser_parse_statement(parser);
+    if (!stmt) return NULL;
+
+    if ((stmt->node_type != STMT_LET && stmt->node_type != STMT_CONST) ||
+        !stmt->data.let_stmt.value ||
+        stmt->data.let_stmt.value->node_type != EXPR_FUNCTION_LITERAL) {
+        parser_add_error(parser, "@memo can only annotate function declarations");
+        statement_free(stmt);
+        return NULL;
+    }
+
+    stmt->data.let_stmt.value->data.function_literal.is_memo = 1;
+    return stmt;
 }
 
 static Statement* parser_parse_expression_statement(Parser* parser) {
-    Token* start_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     Expression* expr = parser_parse_expression(parser, PRECEDENCE_LOWEST);
     
     if (parser_peek_token_is(parser, TOKEN_SEMICOLON)) {
         parser_next_token(parser);
     }
     
-    return statement_new_expression(expr, start_token->line, start_token->column);
+    return statement_new_expression(expr, line, column);
 }
 
 static Expression* parser_parse_expression(Parser* parser, Precedence precedence) {
@@ -326,6 +876,12 @@ static Expression* parser_parse_expression(Parser* parser, Precedence precedence
         case TOKEN_LPAREN:
             left = parser_parse_grouped_expression(parser);
             break;
+        case TOKEN_LBRACKET:
+            left = parser_parse_array_literal(parser);
+            break;
+        case TOKEN_LBRACE:
+            left = parser_parse_map_literal(parser);
+            break;
         case TOKEN_IF:
             left = parser_parse_if_expression(parser);
             break;
@@ -335,6 +891,10 @@ static Expression* parser_parse_expression(Parser* parser, Precedence precedence
         case TOKEN_MATCH:
             left = parser_parse_match_expression(parser);
             break;
+        case TOKEN_SPAWN:
+        case TOKEN_AWAIT:
+            left = parser_parse_task_expression(parser);
+            break;
         default:
             {
                 char error_msg[256];
@@ -366,17 +926,26 @@ static Expression* parser_parse_expression(Parser* parser, Precedence precedence
                 break;
             case TOKEN_PIPE:
                 {
-                    Token* pipe_token = parser->peek_token;
+                    int line = parser->peek_token->line;
+                    int column = parser->peek_token->column;
                     parser_next_token(parser);
                     parser_next_token(parser);
                     Expression* right = parser_parse_expression(parser, PRECEDENCE_PIPE);
-                    left = expression_new_pipe(left, right, pipe_token->line, pipe_token->column);
+                    left = expression_new_pipe(left, right, line, column);
                 }
                 break;
             case TOKEN_LPAREN:
                 parser_next_token(parser);
                 left = parser_parse_call_expression(parser, left);
                 break;
+            case TOKEN_LBRACKET:
+                parser_next_token(parser);
+                left = parser_parse_index_expression(parser, left);
+                break;
+            case TOKEN_DOT:
+                parser_next_token(parser);
+                left = parser_parse_field_expression(parser, left);
+                break;
             default:
                 return left;
         }
@@ -414,20 +983,36 @@ static Expression* parser_parse_string_literal(Parser* parser) {
 }
 
 static Expression* parser_parse_prefix_expression(Parser* parser) {
-    Token* operator_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     char* operator = string_duplicate(parser->current_token->literal);
     parser_next_token(parser);
     Expression* right = parser_parse_expression(parser, PRECEDENCE_PREFIX);
-    return expression_new_prefix(operator, right, operator_token->line, operator_token->column);
+    return expression_new_prefix(operator, right, line, column);
+}
+
+// `spawn f(args)` and `await e` are prefix operators; spawn needs the call
+// itself so the runtime can evaluate the arguments here and run f on a
+// worker.
+static Expression* parser_parse_task_expression(Parser* parser) {
+    Expression* expr = parser_parse_prefix_expression(parser);
+    if (expr && strcmp(expr->data.prefix.operator, "spawn") == 0 &&
+        (!expr->data.prefix.right || expr->data.prefix.right->node_type != EXPR_CALL)) {
+        parser_add_error_at(parser, expr->line, expr->column, "spawn expects a function call");
+        expression_free(expr);
+        return NULL;
+    }
+    return expr;
 }
 
 static Expression* parser_parse_infix_expression(Parser* parser, Expression* left) {
-    Token* operator_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     char* operator = string_duplicate(parser->current_token->literal);
     Precedence precedence = parser_get_precedence(parser->current_token->type);
     parser_next_token(parser);
     Expression* right = parser_parse_expression(parser, precedence);
-    return expression_new_infix(left, operator, right, operator_token->line, operator_token->column);
+    return expression_new_infix(left, operator, right, line, column);
 }
 
 static Expression* parser_parse_grouped_expression(Parser* parser) {
@@ -442,7 +1027,8 @@ static Expression* parser_parse_grouped_expression(Parser* parser) {
 }
 
 static Expression* parser_parse_if_expression(Parser* parser) {
-    Token* if_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     
     if (!parser_expect_peek(parser, TOKEN_LPAREN)) {
         return NULL;
@@ -473,11 +1059,12 @@ static Expression* parser_parse_if_expression(Parser* parser) {
         else_branch = parser_parse_block_statement(parser, &else_count);
     }
     
-    return expression_new_if(condition, then_branch, then_count, else_branch, else_count, if_token->line, if_token->column);
+    return expression_new_if(condition, then_branch, then_count, else_branch, else_count, line, column);
 }
 
 static Expression* parser_parse_function_literal(Parser* parser) {
-    Token* func_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     
     if (!parser_expect_peek(parser, TOKEN_LPAREN)) {
         return NULL;
@@ -497,10 +1084,16 @@ static Expression* parser_parse_function_literal(Parser* parser) {
         return NULL;
     }
     
+    int outer_yield_count = parser->yield_count;
+    parser->yield_count = 0;
+
     int body_count;
     Statement** body = parser_parse_block_statement(parser, &body_count);
-    
-    return expression_new_function_literal(parameters, param_count, return_type, body, body_count, func_token->line, func_token->column);
+
+    Expression* function = expression_new_function_literal(parameters, param_count, return_type, body, body_count, line, column);
+    function->data.function_literal.is_generator = parser->yield_count > 0;
+    parser->yield_count = outer_yield_count;
+    return function;
 }
 
 static Precedence parser_get_precedence(TokenType token_type) {
@@ -520,7 +1113,9 @@ static Precedence parser_get_precedence(TokenType token_type) {
         case TOKEN_DIVIDE:
         case TOKEN_MULTIPLY:
         case TOKEN_MODULO: return PRECEDENCE_PRODUCT;
-        case TOKEN_LPAREN: return PRECEDENCE_CALL;
+        case TOKEN_LPAREN:
+        case TOKEN_LBRACKET:
+        case TOKEN_DOT: return PRECEDENCE_CALL;
         default: return PRECEDENCE_LOWEST;
     }
 }
@@ -540,21 +1135,247 @@ static int parser_expect_peek(Parser* parser, TokenType token_type) {
     } else {
         char error_msg[256];
         snprintf(error_msg, sizeof(error_msg), "expected next token to be %s, got %s instead", token_type_string(token_type), token_type_string(parser->peek_token->type));
-        parser_add_error(parser, error_msg);
+        parser_add_error_at(parser, parser->peek_token->line, parser->peek_token->column, error_msg);
         return 0;
     }
 }
 
 static Expression* parser_parse_call_expression(Parser* parser, Expression* function) {
-    Token* lparen_token = parser->current_token;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
     int arg_count;
     Expression** arguments = parser_parse_call_arguments(parser, &arg_count);
-    return expression_new_call(function, arguments, arg_count, lparen_token->line, lparen_token->column);
+    return expression_new_call(function, arguments, arg_count, line, column);
+}
+
+static void parser_skip_peek_newlines(Parser* parser) {
+    while (parser_peek_token_is(parser, TOKEN_NEWLINE)) {
+        parser_next_token(parser);
+    }
+}
+
+// `[a, b, c]`, which may span lines, with the current token on `[`.
+static Expression* parser_parse_array_literal(Parser* parser) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+    int count = 0;
+    int capacity = 8;
+    Expression** elements = malloc(sizeof(Expression*) * capacity);
+
+    parser_skip_peek_newlines(parser);
+    if (!parser_peek_token_is(parser, TOKEN_RBRACKET)) {
+        for (;;) {
+            parser_next_token(parser);
+            Expression* element = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+            if (!element) break;
+
+            if (count >= capacity) {
+                capacity *= 2;
+                elements = realloc(elements, sizeof(Expression*) * capacity);
+            }
+            elements[count++] = element;
+
+            parser_skip_peek_newlines(parser);
+            if (!parser_peek_token_is(parser, TOKEN_COMMA)) break;
+            parser_next_token(parser);
+            parser_skip_peek_newlines(parser);
+            if (parser_peek_token_is(parser, TOKEN_RBRACKET)) break;
+        }
+    }
+
+    if (!parser_expect_peek(parser, TOKEN_RBRACKET)) {
+        for (int i = 0; i < count; i++) expression_free(elements[i]);
+        free(elements);
+        return NULL;
+    }
+
+    return expression_new_array_literal(elements, count, line, column);
+}
+
+// `{k1: v1, k2: v2}`, which may span lines, with the current token on
+// `{`. Only reached in expression position: a statement that starts with
+// `{` is a block.
+static Expression* parser_parse_map_literal(Parser* parser) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+    int count = 0;
+    int capacity = 8;
+    Expression** entries = malloc(sizeof(Expression*) * capacity);
+    int failed = 0;
+
+    parser_skip_peek_newlines(parser);
+    if (!parser_peek_token_is(parser, TOKEN_RBRACE)) {
+        for (;;) {
+            parser_next_token(parser);
+            Expression* key = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+            if (!key) {
+                failed = 1;
+                break;
+            }
+            if (!parser_expect_peek(parser, TOKEN_COLON)) {
+                expression_free(key);
+                failed = 1;
+                break;
+            }
+            parser_next_token(parser);
+            Expression* value = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+            if (!value) {
+                expression_free(key);
+                failed = 1;
+                break;
+            }
+
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                entries = realloc(entries, sizeof(Expression*) * capacity);
+            }
+            entries[count++] = key;
+            entries[count++] = value;
+
+            parser_skip_peek_newlines(parser);
+            if (!parser_peek_token_is(parser, TOKEN_COMMA)) break;
+            parser_next_token(parser);
+            parser_skip_peek_newlines(parser);
+            if (parser_peek_token_is(parser, TOKEN_RBRACE)) break;
+        }
+    }
+
+    if (failed || !parser_expect_peek(parser, TOKEN_RBRACE)) {
+        for (int i = 0; i < count; i++) expression_free(entries[i]);
+        free(entries);
+        return NULL;
+    }
+
+    return expression_new_map_literal(entries, count, line, column);
 }
 
+// `array[index]`, with the current token on `[`.
+static Expression* parser_parse_index_expression(Parser* parser, Expression* array) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    parser_next_token(parser);
+    Expression* index = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+
+    if (!index || !parser_expect_peek(parser, TOKEN_RBRACKET)) {
+        expression_free(index);
+        expression_free(array);
+        return NULL;
+    }
+
+    return expression_new_index(array, index, line, column);
+}
+
+// `object.name`, with the current token on `.`.
+static Expression* parser_parse_field_expression(Parser* parser, Expression* object) {
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    if (!parser_expect_peek(parser, TOKEN_IDENTIFIER)) {
+        expression_free(object);
+        return NULL;
+    }
+
+    return expression_new_field(object, string_duplicate(parser->current_token->literal), line, column);
+}
+
+static void free_match_cases(MatchCase** cases, int count) {
+    for (int i = 0; i < count; i++) match_case_free(cases[i]);
+    free(cases);
+}
+
+// `match (subject) { pattern -> result, ... }`, with the current token on
+// `match`. Arms are separated by commas or newlines and `_` matches
+// anything; the analyzer checks what the patterns may be.
 static Expression* parser_parse_match_expression(Parser* parser) {
-    parser_add_error(parser, "match expressions not yet implemented");
-    return NULL;
+    int line = parser->current_token->line;
+    int column = parser->current_token->column;
+
+    if (!parser_expect_peek(parser, TOKEN_LPAREN)) {
+        return NULL;
+    }
+    parser_next_token(parser);
+    Expression* subject = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+    if (!subject || !parser_expect_peek(parser, TOKEN_RPAREN) || !parser_expect_peek(parser, TOKEN_LBRACE)) {
+        expression_free(subject);
+        return NULL;
+    }
+
+    int count = 0;
+    int capacity = 8;
+    MatchCase** cases = malloc(sizeof(MatchCase*) * capacity);
+
+    parser_skip_peek_newlines(parser);
+    while (!parser_peek_token_is(parser, TOKEN_RBRACE)) {
+        parser_next_token(parser);
+        Expression* pattern = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+        if (!pattern || !parser_expect_peek(parser, TOKEN_ARROW)) {
+            expression_free(pattern);
+            free_match_cases(cases, count);
+            expression_free(subject);
+            return NULL;
+        }
+        parser_next_token(parser);
+        Expression* result = parser_parse_expression(parser, PRECEDENCE_LOWEST);
+        if (!result) {
+            expression_free(pattern);
+            free_match_cases(cases, count);
+            expression_free(subject);
+            return NULL;
+        }
+
+        if (count >= capacity) {
+            capacity *= 2;
+            cases = realloc(cases, sizeof(MatchCase*) * capacity);
+        }
+        cases[count++] = match_case_new(pattern, result);
+
+        if (parser_peek_token_is(parser, TOKEN_COMMA)) {
+            parser_next_token(parser);
+        } else if (!parser_peek_token_is(parser, TOKEN_NEWLINE) && !parser_peek_token_is(parser, TOKEN_RBRACE)) {
+            parser_add_error(parser, "expected ',' or a new line between match arms");
+            free_match_cases(cases, count);
+            expression_free(subject);
+            return NULL;
+        }
+        parser_skip_peek_newlines(parser);
+    }
+    parser_next_token(parser);
+
+    return expression_new_match(subject, cases, count, line, column);
+}
+
+// `name<T, ...>`, with the current token on name.
+static Type* parser_parse_generic_type(Parser* parser) {
+    char* name = string_duplicate(parser->current_token->literal);
+    int count = 0;
+    int capacity = 2;
+    Type** arguments = malloc(sizeof(Type*) * capacity);
+
+    parser_next_token(parser);
+    for (;;) {
+        parser_next_token(parser);
+        Type* argument = parser_parse_type(parser);
+        if (!argument) break;
+
+        if (count >= capacity) {
+            capacity *= 2;
+            arguments = realloc(arguments, sizeof(Type*) * capacity);
+        }
+        arguments[count++] = argument;
+
+        if (!parser_peek_token_is(parser, TOKEN_COMMA)) break;
+        parser_next_token(parser);
+    }
+
+    if (count == 0 || !parser_expect_peek(parser, TOKEN_GREATER_THAN)) {
+        for (int i = 0; i < count; i++) type_free(arguments[i]);
+        free(arguments);
+        free(name);
+        return NULL;
+    }
+
+    return type_new_generic(name, arguments, count);
 }
 
 static Type* parser_parse_type(Parser* parser) {
@@ -577,6 +1398,23 @@ static Type* parser_parse_type(Parser* parser) {
         return type_new_function(param_types, param_count, return_type);
     }
 
+    if (parser_current_token_is(parser, TOKEN_IDENTIFIER) && parser_peek_token_is(parser, TOKEN_LESS_THAN)) {
+        return parser_parse_generic_type(parser);
+    }
+
+    // `[T]` is an array of T, kept as the generic type array<T>.
+    if (parser_current_token_is(parser, TOKEN_LBRACKET)) {
+        parser_next_token(parser);
+        Type* element = parser_parse_type(parser);
+        if (!element || !parser_expect_peek(parser, TOKEN_RBRACKET)) {
+            type_free(element);
+            return NULL;
+        }
+        Type** arguments = malloc(sizeof(Type*));
+        arguments[0] = element;
+        return type_new_generic(string_duplicate("array"), arguments, 1);
+    }
+
     return type_new_identifier(string_duplicate(parser->current_token->literal));
 }
 
@@ -678,7 +1516,8 @@ static Expression** parser_parse_call_arguments(Parser* parser, int* arg_count)
 }
 
 static Statement** parser_parse_block_statement(Parser* parser, int* stmt_count) {
-    Statement** statements = malloc(sizeof(Statement*) * 20);
+    int capacity = 20;
+    Statement** statements = malloc(sizeof(Statement*) * capacity);
     *stmt_count = 0;
     
     parser_next_token(parser);
@@ -693,6 +1532,10 @@ static Statement** parser_parse_block_statement(Parser* parser, int* stmt_count)
         
         Statement* stmt = parser_parse_statement(parser);
         if (stmt) {
+            if (*stmt_count >= capacity) {
+                capacity *= 2;
+                statements = realloc(statements, sizeof(Statement*) * capacity);
+            }
             statements[*stmt_count] = stmt;
             (*stmt_count)++;
         }
@@ -1,4 +1,9 @@
 #include "semantic.h"
+#include "memo.h"
+#include "parallel.h"
+#include "builtins.h"
+#include "match.h"
+#include "vm.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,12 +30,21 @@ static char* string_duplicate(const char* str) {
     return dup;
 }
 
+// Types are shared freely between symbols, expressions and other types,
+// and the program's expressions keep pointing at them after analysis, so
+// they come from the current VM's heap and go away with it, along with the
+// arrays and names they hold.
+static TypeInfo* type_info_alloc(void) {
+    return heap_alloc(vm_heap(), sizeof(TypeInfo));
+}
+
 TypeInfo* type_info_new_builtin(BuiltinType builtin) {
-    TypeInfo* type = malloc(sizeof(TypeInfo));
-    if (!type) return NULL;
+    TypeInfo* type = type_info_alloc();
     
     type->category = TYPECAT_BUILTIN;
     type->data.builtin = builtin;
+    type->pointed_to = NULL;
+    type->key_type = NULL;
     type->is_owned = 1;
     type->is_borrowed = 0;
     type->lifetime_id = 0;
@@ -39,13 +53,14 @@ TypeInfo* type_info_new_builtin(BuiltinType builtin) {
 }
 
 TypeInfo* type_info_new_function(TypeInfo** params, int param_count, TypeInfo* return_type) {
-    TypeInfo* type = malloc(sizeof(TypeInfo));
-    if (!type) return NULL;
+    TypeInfo* type = type_info_alloc();
     
     type->category = TYPECAT_FUNCTION;
     type->data.function.param_types = params;
     type->data.function.param_count = param_count;
     type->data.function.return_type = return_type;
+    type->pointed_to = NULL;
+    type->key_type = NULL;
     type->is_owned = 1;
     type->is_borrowed = 0;
     type->lifetime_id = 0;
@@ -54,14 +69,15 @@ TypeInfo* type_info_new_function(TypeInfo** params, int param_count, TypeInfo* r
 }
 
 TypeInfo* type_info_new_struct(char* name, TypeInfo** field_types, char** field_names, int field_count) {
-    TypeInfo* type = malloc(sizeof(TypeInfo));
-    if (!type) return NULL;
+    TypeInfo* type = type_info_alloc();
     
     type->category = TYPECAT_STRUCT;
-    type->data.struct_info.name = string_duplicate(name);
+    type->data.struct_info.name = heap_strdup(vm_heap(), name);
     type->data.struct_info.field_types = field_types;
     type->data.struct_info.field_names = field_names;
     type->data.struct_info.field_count = field_count;
+    type->pointed_to = NULL;
+    type->key_type = NULL;
     type->is_owned = 1;
     type->is_borrowed = 0;
     type->lifetime_id = 0;
@@ -70,12 +86,12 @@ TypeInfo* type_info_new_struct(char* name, TypeInfo** field_types, char** field_
 }
 
 TypeInfo* type_info_new_reference(TypeInfo* pointed_to, int is_mutable) {
-    TypeInfo* type = malloc(sizeof(TypeInfo));
-    if (!type) return NULL;
+    TypeInfo* type = type_info_alloc();
     
     type->category = TYPECAT_BUILTIN;
     type->data.builtin = is_mutable ? BUILTIN_MUT_REF : BUILTIN_REF;
     type->pointed_to = pointed_to;
+    type->key_type = NULL;
     
     type->is_owned = 0;
     type->is_borrowed = 1;
@@ -84,37 +100,85 @@ TypeInfo* type_info_new_reference(TypeInfo* pointed_to, int is_mutable) {
     return type;
 }
 
-void type_info_free(TypeInfo* type) {
-    if (!type) return;
-    
-    switch (type->category) {
-        case TYPECAT_FUNCTION:
-            if (type->data.function.param_types) {
-                for (int i = 0; i < type->data.function.param_count; i++) {
-                    type_info_free(type->data.function.param_types[i]);
-                }
-                free(type->data.function.param_types);
-            }
-            type_info_free(type->data.function.return_type);
-            break;
-            
-        case TYPECAT_STRUCT:
-            free(type->data.struct_info.name);
-            if (type->data.struct_info.field_types) {
-                for (int i = 0; i < type->data.struct_info.field_count; i++) {
-                    type_info_free(type->data.struct_info.field_types[i]);
-                    free(type->data.struct_info.field_names[i]);
-                }
-                free(type->data.struct_info.field_types);
-                free(type->data.struct_info.field_names);
-            }
-            break;
-            
-        default:
-            break;
-    }
-    
-    free(type);
+TypeInfo* type_info_new_future(TypeInfo* result_type) {
+    TypeInfo* type = type_info_new_builtin(BUILTIN_FUTURE);
+    if (!type) return NULL;
+
+    type->pointed_to = result_type;
+    return type;
+}
+
+TypeInfo* type_info_new_channel(TypeInfo* element_type) {
+    TypeInfo* type = type_info_new_builtin(BUILTIN_CHAN);
+    if (!type) return NULL;
+
+    type->pointed_to = element_type;
+    return type;
+}
+
+TypeInfo* type_info_new_sequence(TypeInfo* element_type) {
+    TypeInfo* type = type_info_new_builtin(BUILTIN_SEQ);
+    if (!type) return NULL;
+
+    type->pointed_to = element_type;
+    return type;
+}
+
+TypeInfo* type_info_new_array(TypeInfo* element_type) {
+    TypeInfo* type = type_info_new_builtin(BUILTIN_ARRAY);
+    if (!type) return NULL;
+
+    type->pointed_to = element_type;
+    return type;
+}
+
+TypeInfo* type_info_new_map(TypeInfo* key_type, TypeInfo* value_type) {
+    TypeInfo* type = type_info_new_builtin(BUILTIN_MAP);
+    if (!type) return NULL;
+
+    type->key_type = key_type;
+    type->pointed_to = value_type;
+    return type;
+}
+
+static int is_array_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_ARRAY;
+}
+
+static int is_map_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_MAP;
+}
+
+static int is_struct_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_STRUCT;
+}
+
+// Arrays, maps and structs change in place, so a `let mut` one must not be
+// shared with another task. Returns what to call the type in an error, or
+// NULL.
+static const char* container_kind(TypeInfo* type) {
+    if (is_array_type(type)) return "array";
+    if (is_map_type(type)) return "map";
+    if (is_struct_type(type)) return "struct";
+    return NULL;
+}
+
+// What naming a struct type evaluates to: the function that builds one
+// from its fields, in declaration order.
+static TypeInfo* struct_constructor_type(TypeInfo* type) {
+    return type_info_new_function(type->data.struct_info.field_types, type->data.struct_info.field_count, type);
+}
+
+static int is_sequence_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_SEQ;
+}
+
+static int is_channel_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_CHAN;
+}
+
+static int is_unknown_type(TypeInfo* type) {
+    return !type || (type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_UNKNOWN);
 }
 
 int type_info_equals(TypeInfo* a, TypeInfo* b) {
@@ -123,6 +187,14 @@ int type_info_equals(TypeInfo* a, TypeInfo* b) {
     
     switch (a->category) {
         case TYPECAT_BUILTIN:
+            if ((a->data.builtin == BUILTIN_FUTURE || a->data.builtin == BUILTIN_CHAN ||
+                 a->data.builtin == BUILTIN_SEQ || a->data.builtin == BUILTIN_ARRAY) &&
+                a->data.builtin == b->data.builtin) {
+                return type_info_equals(a->pointed_to, b->pointed_to);
+            }
+            if (a->data.builtin == BUILTIN_MAP && b->data.builtin == BUILTIN_MAP) {
+                return type_info_equals(a->key_type, b->key_type) && type_info_equals(a->pointed_to, b->pointed_to);
+            }
             return a->data.builtin == b->data.builtin;
             
         case TYPECAT_FUNCTION:
@@ -145,6 +217,17 @@ int type_info_equals(TypeInfo* a, TypeInfo* b) {
 }
 
 int type_info_is_assignable(TypeInfo* from, TypeInfo* to) {
+    // channel() does not know its element type; the annotation supplies it.
+    if (is_channel_type(from) && is_channel_type(to) && is_unknown_type(from->pointed_to)) {
+        return 1;
+    }
+    // Likewise for the empty array and map literals.
+    if (is_array_type(from) && is_array_type(to) && is_unknown_type(from->pointed_to)) {
+        return 1;
+    }
+    if (is_map_type(from) && is_map_type(to) && is_unknown_type(from->key_type)) {
+        return 1;
+    }
     return type_info_equals(from, to);
 }
 
@@ -177,6 +260,43 @@ char* type_info_to_string(TypeInfo* type) {
                     free(pointed_to_str);
                 }
                 break;
+            case BUILTIN_FUTURE:
+                {
+                    char* pointed_to_str = type_info_to_string(type->pointed_to);
+                    snprintf(result, 256, "future<%s>", pointed_to_str);
+                    free(pointed_to_str);
+                }
+                break;
+            case BUILTIN_CHAN:
+                {
+                    char* pointed_to_str = type_info_to_string(type->pointed_to);
+                    snprintf(result, 256, "chan<%s>", pointed_to_str);
+                    free(pointed_to_str);
+                }
+                break;
+            case BUILTIN_SEQ:
+                {
+                    char* pointed_to_str = type_info_to_string(type->pointed_to);
+                    snprintf(result, 256, "seq<%s>", pointed_to_str);
+                    free(pointed_to_str);
+                }
+                break;
+            case BUILTIN_ARRAY:
+                {
+                    char* pointed_to_str = type_info_to_string(type->pointed_to);
+                    snprintf(result, 256, "[%s]", pointed_to_str);
+                    free(pointed_to_str);
+                }
+                break;
+            case BUILTIN_MAP:
+                {
+                    char* key_str = type_info_to_string(type->key_type);
+                    char* value_str = type_info_to_string(type->pointed_to);
+                    snprintf(result, 256, "map<%s, %s>", key_str, value_str);
+                    free(key_str);
+                    free(value_str);
+                }
+                break;
             }
             break;
             
@@ -221,6 +341,9 @@ Symbol* symbol_new(char* name, SymbolKind kind, TypeInfo* type) {
     symbol->last_use_line = 0;
     symbol->is_initialized = 0;
     symbol->is_used = 0;
+    symbol->is_pure = 0;
+    symbol->declaration_index = 0;
+    symbol->function_literal = NULL;
     symbol->next = NULL;
     symbol->is_mutable = (kind == SYMBOL_VARIABLE) ? 1 : 0;
 
@@ -235,8 +358,9 @@ Symbol* symbol_new(char* name, SymbolKind kind, TypeInfo* type) {
 void symbol_free(Symbol* symbol) {
     if (!symbol) return;
     
+    // Symbol types are shared with expressions and function signatures,
+    // so they live as long as the analyzer rather than the symbol.
     free(symbol->name);
-    type_info_free(symbol->type);
     free(symbol);
 }
 
@@ -294,8 +418,42 @@ SemanticAnalyzer* semantic_analyzer_new(void) {
     analyzer->errors = NULL;
     analyzer->error_count = 0;
     analyzer->current_function_return_type = NULL;
+    analyzer->current_yield_type = NULL;
+    analyzer->yield_allowed = 0;
+    analyzer->statement_expression = NULL;
+    analyzer->current_function_is_pure = 1;
+    analyzer->current_function_shares_state = 0;
+    analyzer->current_function_scope_level = 0;
+    analyzer->memoize_pure_functions = 0;
     analyzer->current_scope_level = 0;
+    analyzer->parallel_scope_level = 0;
+    analyzer->parallel_loop = NULL;
     analyzer->next_lifetime_id = 1;
+
+    analyzer->borrowed_symbols = NULL;
+    analyzer->borrowed_count = 0;
+    analyzer->borrowed_capacity = 0;
+
+    analyzer->defer_function_bodies = 0;
+    analyzer->defer_purity = 0;
+    analyzer->global_visibility_limit = -1;
+    analyzer->error_order = 0;
+    analyzer->current_function_literal = NULL;
+    analyzer->tasks = NULL;
+    analyzer->task_count = 0;
+    analyzer->task_capacity = 0;
+    analyzer->purity_edges = NULL;
+    analyzer->purity_edge_count = 0;
+    analyzer->purity_edge_capacity = 0;
+    analyzer->checked_literals = NULL;
+    analyzer->checked_literal_count = 0;
+    analyzer->checked_literal_capacity = 0;
+    analyzer->parallel_calls = NULL;
+    analyzer->parallel_call_count = 0;
+    analyzer->parallel_call_capacity = 0;
+    analyzer->spawn_calls = NULL;
+    analyzer->spawn_call_count = 0;
+    analyzer->spawn_call_capacity = 0;
     
     return analyzer;
 }
@@ -309,18 +467,14 @@ void semantic_analyzer_free(SemanticAnalyzer* analyzer) {
         analyzer->global_scope = next;
     }
     
-    for (int i = 0; i < 6; i++) {
-        type_info_free(analyzer->builtin_types[i]);
-    }
-    
-    SemanticError* error = analyzer->errors;
-    while (error) {
-        SemanticError* next = error->next;
-        free(error->message);
-        free(error);
-        error = next;
-    }
-    
+    semantic_clear_errors(analyzer);
+
+    free(analyzer->borrowed_symbols);
+    free(analyzer->tasks);
+    free(analyzer->purity_edges);
+    free(analyzer->checked_literals);
+    free(analyzer->parallel_calls);
+    free(analyzer->spawn_calls);
     free(analyzer);
 }
 
@@ -335,6 +489,13 @@ int symbol_table_add(SemanticAnalyzer* analyzer, Symbol* symbol) {
     
     unsigned int hash = hash_string(symbol->name);
     symbol->scope_level = analyzer->current_scope_level;
+    // While a single top-level statement is checked out of order, the
+    // globals it declares take that statement's position.
+    if (analyzer->current_scope == analyzer->global_scope && analyzer->global_visibility_limit >= 0) {
+        symbol->declaration_index = analyzer->global_visibility_limit;
+    } else {
+        symbol->declaration_index = analyzer->current_scope->symbol_count;
+    }
     symbol->next = analyzer->current_scope->symbols[hash];
     analyzer->current_scope->symbols[hash] = symbol;
     analyzer->current_scope->symbol_count++;
@@ -342,6 +503,14 @@ int symbol_table_add(SemanticAnalyzer* analyzer, Symbol* symbol) {
     return 1;
 }
 
+// A statement checked out of order (a deferred function body, or an edited
+// declaration in watch mode) must not see globals declared after it,
+// exactly as in a serial pass.
+static int symbol_hidden(SemanticAnalyzer* analyzer, Scope* scope, Symbol* symbol) {
+    return scope == analyzer->global_scope && analyzer->global_visibility_limit >= 0 &&
+           symbol->declaration_index > analyzer->global_visibility_limit;
+}
+
 Symbol* symbol_table_lookup(SemanticAnalyzer* analyzer, const char* name) {
     if (!analyzer || !name) return NULL;
     
@@ -351,7 +520,7 @@ Symbol* symbol_table_lookup(SemanticAnalyzer* analyzer, const char* name) {
     while (scope) {
         Symbol* symbol = scope->symbols[hash];
         while (symbol) {
-            if (strcmp(symbol->name, name) == 0) {
+            if (strcmp(symbol->name, name) == 0 && !symbol_hidden(analyzer, scope, symbol)) {
                 return symbol;
             }
             symbol = symbol->next;
@@ -369,7 +538,7 @@ Symbol* symbol_table_lookup_current_scope(SemanticAnalyzer* analyzer, const char
     Symbol* symbol = analyzer->current_scope->symbols[hash];
     
     while (symbol) {
-        if (strcmp(symbol->name, name) == 0) {
+        if (strcmp(symbol->name, name) == 0 && !symbol_hidden(analyzer, analyzer->current_scope, symbol)) {
             return symbol;
         }
         symbol = symbol->next;
@@ -378,6 +547,59 @@ Symbol* symbol_table_lookup_current_scope(SemanticAnalyzer* analyzer, const char
     return NULL;
 }
 
+Symbol* symbol_table_lookup_global(SemanticAnalyzer* analyzer, const char* name, int declaration_index) {
+    if (!analyzer || !name) return NULL;
+
+    Symbol* symbol = analyzer->global_scope->symbols[hash_string(name)];
+    while (symbol) {
+        if (symbol->declaration_index == declaration_index && strcmp(symbol->name, name) == 0) {
+            return symbol;
+        }
+        symbol = symbol->next;
+    }
+
+    return NULL;
+}
+
+void symbol_table_remove_global(SemanticAnalyzer* analyzer, Symbol* symbol) {
+    if (!analyzer || !symbol) return;
+
+    Symbol** link = &analyzer->global_scope->symbols[hash_string(symbol->name)];
+    while (*link && *link != symbol) {
+        link = &(*link)->next;
+    }
+    if (!*link) return;
+
+    *link = symbol->next;
+    symbol->next = NULL;
+    analyzer->global_scope->symbol_count--;
+
+    int kept = 0;
+    for (int i = 0; i < analyzer->borrowed_count; i++) {
+        if (analyzer->borrowed_symbols[i] != symbol) {
+            analyzer->borrowed_symbols[kept++] = analyzer->borrowed_symbols[i];
+        }
+    }
+    analyzer->borrowed_count = kept;
+}
+
+// Globals are numbered in declaration order, so everything declared since
+// the symbol count was first_index sits at or after it.
+void semantic_drop_globals_from(SemanticAnalyzer* analyzer, int first_index) {
+    Scope* scope = analyzer->global_scope;
+    for (int i = 0; i < scope->table_size; i++) {
+        Symbol* symbol = scope->symbols[i];
+        while (symbol) {
+            Symbol* next = symbol->next;
+            if (symbol->declaration_index >= first_index) {
+                symbol_table_remove_global(analyzer, symbol);
+                symbol_free(symbol);
+            }
+            symbol = next;
+        }
+    }
+}
+
 void semantic_push_scope(SemanticAnalyzer* analyzer) {
     if (!analyzer) return;
     
@@ -392,6 +614,16 @@ void semantic_pop_scope(SemanticAnalyzer* analyzer) {
     
     release_borrows_in_scope(analyzer, analyzer->current_scope);
 
+    // Symbols of the dying scope are about to be freed; forget any that are
+    // still marked borrowed.
+    int kept = 0;
+    for (int i = 0; i < analyzer->borrowed_count; i++) {
+        if (analyzer->borrowed_symbols[i]->scope_level < analyzer->current_scope_level) {
+            analyzer->borrowed_symbols[kept++] = analyzer->borrowed_symbols[i];
+        }
+    }
+    analyzer->borrowed_count = kept;
+
     Scope* old_scope = analyzer->current_scope;
     analyzer->current_scope = analyzer->current_scope->parent;
     analyzer->current_scope_level--;
@@ -407,6 +639,7 @@ void semantic_add_error(SemanticAnalyzer* analyzer, SemanticErrorType type, cons
     error->message = string_duplicate(message);
     error->line = line;
     error->column = column;
+    error->order = analyzer->error_order;
     error->next = analyzer->errors;
     
     analyzer->errors = error;
@@ -424,11 +657,30 @@ void semantic_print_errors(SemanticAnalyzer* analyzer) {
     }
 }
 
+void semantic_clear_errors(SemanticAnalyzer* analyzer) {
+    if (!analyzer) return;
+
+    SemanticError* error = analyzer->errors;
+    while (error) {
+        SemanticError* next = error->next;
+        free(error->message);
+        free(error);
+        error = next;
+    }
+    analyzer->errors = NULL;
+    analyzer->error_count = 0;
+}
+
 int is_numeric_type(TypeInfo* type) {
     return type && type->category == TYPECAT_BUILTIN &&
            (type->data.builtin == BUILTIN_INT || type->data.builtin == BUILTIN_FLOAT);
 }
 
+static int is_map_key_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN &&
+           (type->data.builtin == BUILTIN_INT || type->data.builtin == BUILTIN_STRING);
+}
+
 int is_comparable_type(TypeInfo* type) {
     return type && type->category == TYPECAT_BUILTIN &&
            (type->data.builtin == BUILTIN_INT || type->data.builtin == BUILTIN_FLOAT ||
@@ -442,6 +694,10 @@ TypeInfo* get_binary_operation_result_type(TypeInfo* left, TypeInfo* right, cons
         strcmp(operator, "*") == 0 || strcmp(operator, "/") == 0 ||
         strcmp(operator, "%") == 0) {
         
+        if (strcmp(operator, "+") == 0 && left->category == TYPECAT_BUILTIN && left->data.builtin == BUILTIN_STRING &&
+            right->category == TYPECAT_BUILTIN && right->data.builtin == BUILTIN_STRING) {
+            return type_info_new_builtin(BUILTIN_STRING);
+        }
         if (!is_numeric_type(left) || !is_numeric_type(right)) return NULL;
         
         if (left->data.builtin == BUILTIN_FLOAT || right->data.builtin == BUILTIN_FLOAT) {
@@ -484,24 +740,65 @@ TypeInfo* convert_ast_type_to_type_info(SemanticAnalyzer* analyzer, Type* ast_ty
                 return type_info_new_builtin(BUILTIN_STRING);
             } else if (strcmp(ast_type->data.identifier.name, "bool") == 0) {
                 return type_info_new_builtin(BUILTIN_BOOL);
+            } else if (strcmp(ast_type->data.identifier.name, "unit") == 0) {
+                return type_info_new_builtin(BUILTIN_UNIT);
+            }
+            {
+                Symbol* symbol = symbol_table_lookup(analyzer, ast_type->data.identifier.name);
+                if (symbol && symbol->kind == SYMBOL_TYPE) return symbol->type;
             }
             return analyzer->builtin_types[BUILTIN_UNKNOWN];
             
         case TYPE_FUNCTION:
             {
-                TypeInfo** param_types = malloc(sizeof(TypeInfo*) * ast_type->data.function.param_count);
+                TypeInfo** param_types = heap_alloc(vm_heap(), sizeof(TypeInfo*) * ast_type->data.function.param_count);
                 for (int i = 0; i < ast_type->data.function.param_count; i++) {
                     param_types[i] = convert_ast_type_to_type_info(analyzer, ast_type->data.function.params[i]);
                 }
                 TypeInfo* return_type = convert_ast_type_to_type_info(analyzer, ast_type->data.function.return_type);
                 return type_info_new_function(param_types, ast_type->data.function.param_count, return_type);
             }
+
+        case TYPE_GENERIC:
+            if (strcmp(ast_type->data.generic.name, "chan") == 0 && ast_type->data.generic.argument_count == 1) {
+                return type_info_new_channel(convert_ast_type_to_type_info(analyzer, ast_type->data.generic.arguments[0]));
+            }
+            if (strcmp(ast_type->data.generic.name, "seq") == 0 && ast_type->data.generic.argument_count == 1) {
+                return type_info_new_sequence(convert_ast_type_to_type_info(analyzer, ast_type->data.generic.arguments[0]));
+            }
+            if (strcmp(ast_type->data.generic.name, "array") == 0 && ast_type->data.generic.argument_count == 1) {
+                return type_info_new_array(convert_ast_type_to_type_info(analyzer, ast_type->data.generic.arguments[0]));
+            }
+            if (strcmp(ast_type->data.generic.name, "map") == 0 && ast_type->data.generic.argument_count == 2) {
+                return type_info_new_map(convert_ast_type_to_type_info(analyzer, ast_type->data.generic.arguments[0]),
+                                         convert_ast_type_to_type_info(analyzer, ast_type->data.generic.arguments[1]));
+            }
+            if (strcmp(ast_type->data.generic.name, "future") == 0 && ast_type->data.generic.argument_count == 1) {
+                return type_info_new_future(convert_ast_type_to_type_info(analyzer, ast_type->data.generic.arguments[0]));
+            }
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
             
         default:
             return analyzer->builtin_types[BUILTIN_UNKNOWN];
     }
 }
 
+static TypeInfo* function_literal_signature(SemanticAnalyzer* analyzer, Expression* expr) {
+    int param_count = expr->data.function_literal.parameter_count;
+    TypeInfo** param_types = heap_alloc(vm_heap(), sizeof(TypeInfo*) * (param_count > 0 ? param_count : 1));
+
+    for (int i = 0; i < param_count; i++) {
+        param_types[i] = convert_ast_type_to_type_info(analyzer, expr->data.function_literal.parameters[i]->type);
+    }
+
+    TypeInfo* return_type = analyzer->builtin_types[BUILTIN_UNIT];
+    if (expr->data.function_literal.return_type) {
+        return_type = convert_ast_type_to_type_info(analyzer, expr->data.function_literal.return_type);
+    }
+
+    return type_info_new_function(param_types, param_count, return_type);
+}
+
 int semantic_analyze_program(SemanticAnalyzer* analyzer, Program* program) {
     if (!analyzer || !program) return 0;
     
@@ -514,6 +811,76 @@ int semantic_analyze_program(SemanticAnalyzer* analyzer, Program* program) {
     return analyzer->error_count == 0;
 }
 
+static void queue_function_task(SemanticAnalyzer* analyzer, Expression* literal, Symbol* symbol) {
+    if (analyzer->task_count >= analyzer->task_capacity) {
+        analyzer->task_capacity = analyzer->task_capacity ? analyzer->task_capacity * 2 : 64;
+        analyzer->tasks = realloc(analyzer->tasks, sizeof(FunctionTask) * analyzer->task_capacity);
+    }
+
+    FunctionTask* task = &analyzer->tasks[analyzer->task_count++];
+    task->literal = literal;
+    task->symbol = symbol;
+    task->statement_index = analyzer->error_order;
+    task->errors = NULL;
+    task->error_count = 0;
+}
+
+static int analyze_for_statement(SemanticAnalyzer* analyzer, Statement* stmt);
+static int analyze_yield_statement(SemanticAnalyzer* analyzer, Statement* stmt);
+
+// `type Name { field: T, ... }` declares Name both as a type and as the
+// constructor Name(field, ...). Fields are numbered in declaration order,
+// which is the layout every field access is resolved against.
+static int analyze_type_declaration(SemanticAnalyzer* analyzer, Statement* stmt) {
+    Type* type = stmt->data.type_decl.type;
+    int count = type->data.struct_type.field_count;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (analyzer->current_scope != analyzer->global_scope) {
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "type declarations must be at the top level",
+                           stmt->line, stmt->column);
+        return 0;
+    }
+
+    TypeInfo** field_types = heap_alloc(vm_heap(), sizeof(TypeInfo*) * (count > 0 ? count : 1));
+    char** field_names = heap_alloc(vm_heap(), sizeof(char*) * (count > 0 ? count : 1));
+    for (int i = 0; i < count; i++) {
+        const char* field = type->data.struct_type.field_names[i];
+        for (int j = 0; j < i; j++) {
+            if (strcmp(field_names[j], field) == 0) {
+                snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "field '%s' appears more than once in type %s",
+                         field, stmt->data.type_decl.name);
+                semantic_add_error(analyzer, ERROR_REDEFINITION, error_msg, stmt->line, stmt->column);
+                return 0;
+            }
+        }
+
+        field_types[i] = convert_ast_type_to_type_info(analyzer, type->data.struct_type.field_types[i]);
+        if (is_unknown_type(field_types[i])) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "field '%s' of %s has an unknown type",
+                     field, stmt->data.type_decl.name);
+            semantic_add_error(analyzer, ERROR_UNDEFINED_TYPE, error_msg, stmt->line, stmt->column);
+            return 0;
+        }
+        field_names[i] = heap_strdup(vm_heap(), field);
+    }
+
+    Symbol* symbol = symbol_new(stmt->data.type_decl.name, SYMBOL_TYPE,
+                                type_info_new_struct(stmt->data.type_decl.name, field_types, field_names, count));
+    symbol->is_const = 1;
+    symbol->is_mutable = 0;
+    symbol->is_initialized = 1;
+    symbol->is_pure = 1;
+    symbol->declaration_line = stmt->line;
+    symbol->lifetime_id = analyzer->current_scope->lifetime_id;
+
+    if (!symbol_table_add(analyzer, symbol)) {
+        symbol_free(symbol);
+        return 0;
+    }
+    return 1;
+}
+
 int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
     if (!analyzer || !stmt) return 0;
     
@@ -521,12 +888,58 @@ int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
         case STMT_LET:
         case STMT_CONST:
             {
-                TypeInfo* value_type = semantic_analyze_expression(analyzer, stmt->data.let_stmt.value);
+                Symbol* function_symbol = NULL;
+                Expression* value = stmt->data.let_stmt.value;
+
+                // A `let mut` binding may be given another function later,
+                // so it is a variable like any other and is not declared
+                // early: its body cannot call it by name.
+                if (value && value->node_type == EXPR_FUNCTION_LITERAL && stmt->data.let_stmt.is_const) {
+                    // Declare the function before checking its body so it can call itself.
+                    function_symbol = symbol_new(stmt->data.let_stmt.name, SYMBOL_FUNCTION, function_literal_signature(analyzer, value));
+                    function_symbol->is_const = stmt->data.let_stmt.is_const;
+                    function_symbol->is_initialized = 1;
+                    function_symbol->is_pure = 1;
+                    function_symbol->declaration_line = stmt->line;
+                    function_symbol->lifetime_id = analyzer->current_scope->lifetime_id;
+                    function_symbol->function_literal = value;
+
+                    if (!symbol_table_add(analyzer, function_symbol)) {
+                        symbol_free(function_symbol);
+                        return 0;
+                    }
+                }
+
+                TypeInfo* value_type;
+                if (function_symbol && analyzer->defer_function_bodies && analyzer->current_scope == analyzer->global_scope) {
+                    value_type = function_symbol->type;
+                    value->resolved_type = value_type;
+                    queue_function_task(analyzer, value, function_symbol);
+                } else {
+                    value_type = semantic_analyze_expression(analyzer, value);
+                }
                 if (!value_type) return 0;
                 
                 TypeInfo* var_type;
                 if (stmt->data.let_stmt.type) {
                     var_type = convert_ast_type_to_type_info(analyzer, stmt->data.let_stmt.type);
+
+                    if (is_array_type(var_type) && !is_numeric_type(var_type->pointed_to)) {
+                        char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+                        char* element_str = type_info_to_string(var_type->pointed_to);
+                        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "arrays hold int or float elements, not %s", element_str);
+                        free(element_str);
+                        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, stmt->line, stmt->column);
+                        return 0;
+                    }
+                    if (is_map_type(var_type) && !is_map_key_type(var_type->key_type)) {
+                        char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+                        char* key_str = type_info_to_string(var_type->key_type);
+                        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "map keys must be int or string, not %s", key_str);
+                        free(key_str);
+                        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, stmt->line, stmt->column);
+                        return 0;
+                    }
                     
                     if (!type_info_is_assignable(value_type, var_type)) {
                         char error_msg[MAX_ERROR_MESSAGE_LENGTH];
@@ -541,6 +954,11 @@ int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
                 } else {
                     var_type = value_type;
                 }
+
+                if (function_symbol) {
+                    function_symbol->is_pure = value->data.function_literal.is_pure;
+                    return 1;
+                }
                 
                 Symbol* symbol = symbol_new(stmt->data.let_stmt.name, SYMBOL_VARIABLE, var_type);
 
@@ -566,6 +984,18 @@ int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
         case STMT_RETURN:
             {
                 TypeInfo* return_type = analyzer->builtin_types[BUILTIN_UNIT];
+
+                if (analyzer->parallel_scope_level > analyzer->current_function_scope_level) {
+                    semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "cannot return from inside a par for body",
+                                       stmt->line, stmt->column);
+                    return 0;
+                }
+                if (analyzer->current_yield_type) {
+                    semantic_add_error(analyzer, ERROR_INVALID_OPERATION,
+                                       "cannot return from a generator; it finishes when its body does",
+                                       stmt->line, stmt->column);
+                    return 0;
+                }
                 
                 if (stmt->data.return_stmt.return_value) {
                     return_type = semantic_analyze_expression(analyzer, stmt->data.return_stmt.return_value);
@@ -589,7 +1019,11 @@ int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
             }
             
         case STMT_EXPRESSION:
+            analyzer->statement_expression = stmt->data.expression_stmt.expression;
             return semantic_analyze_expression(analyzer, stmt->data.expression_stmt.expression) != NULL;
+
+        case STMT_YIELD:
+            return analyze_yield_statement(analyzer, stmt);
         
         case STMT_BLOCK:
             {
@@ -615,90 +1049,1831 @@ int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
                 
                 return semantic_analyze_statement(analyzer, stmt->data.while_stmt.body);
             }
+        case STMT_FOR:
+            return analyze_for_statement(analyzer, stmt);
+        case STMT_TYPE:
+            return analyze_type_declaration(analyzer, stmt);
         default:
             semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "Unknown statement type", 0, 0);
             return 0;
     }
 }
 
-TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* expr) {
-    if (!analyzer || !expr) return NULL;
-    
-    switch (expr->node_type) {
-        case EXPR_IDENTIFIER:
-            {
-                Symbol* symbol = symbol_table_lookup(analyzer, expr->data.identifier.value);
-                if (!symbol) {
-                    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
-                    snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Undefined variable: %s", expr->data.identifier.value);
-                    semantic_add_error(analyzer, ERROR_UNDEFINED_VARIABLE, error_msg, 0, 0);
-                    return analyzer->builtin_types[BUILTIN_UNKNOWN];
-                }
+static TypeInfo* analyze_expression(SemanticAnalyzer* analyzer, Expression* expr);
 
-                if (!symbol->is_initialized) {
-                    char error_msg[256];
-                    snprintf(error_msg, sizeof(error_msg), "use of uninitialized variable '%s'", symbol->name);
-                    semantic_add_error(analyzer, ERROR_UNINITIALIZED_VARIABLE, error_msg, 0, 0);
-                    return analyzer->builtin_types[BUILTIN_UNKNOWN];
-                }
-            
-                symbol->is_used = 1;
-                return symbol->type;
-            }
-            
-        case EXPR_INTEGER_LITERAL:
-            return type_info_new_builtin(BUILTIN_INT);
-            
-        case EXPR_FLOAT_LITERAL:
-            return type_info_new_builtin(BUILTIN_FLOAT);
-            
-        case EXPR_STRING_LITERAL:
-            return type_info_new_builtin(BUILTIN_STRING);
-            
-        case EXPR_BOOLEAN_LITERAL:
-            return type_info_new_builtin(BUILTIN_BOOL);
-            
+static void add_purity_edge(SemanticAnalyzer* analyzer, Expression* from, Expression* to) {
+    if (analyzer->purity_edge_count >= analyzer->purity_edge_capacity) {
+        analyzer->purity_edge_capacity = analyzer->purity_edge_capacity ? analyzer->purity_edge_capacity * 2 : 64;
+        analyzer->purity_edges = realloc(analyzer->purity_edges, sizeof(PurityEdge) * analyzer->purity_edge_capacity);
+    }
+    analyzer->purity_edges[analyzer->purity_edge_count].from = from;
+    analyzer->purity_edges[analyzer->purity_edge_count].to = to;
+    analyzer->purity_edge_count++;
+}
+
+static void add_checked_literal(SemanticAnalyzer* analyzer, Expression* literal, TypeInfo* function_type) {
+    if (analyzer->checked_literal_count >= analyzer->checked_literal_capacity) {
+        analyzer->checked_literal_capacity = analyzer->checked_literal_capacity ? analyzer->checked_literal_capacity * 2 : 64;
+        analyzer->checked_literals = realloc(analyzer->checked_literals, sizeof(CheckedLiteral) * analyzer->checked_literal_capacity);
+    }
+    analyzer->checked_literals[analyzer->checked_literal_count].literal = literal;
+    analyzer->checked_literals[analyzer->checked_literal_count].function_type = function_type;
+    analyzer->checked_literal_count++;
+}
+
+// Only direct calls to functions already known to be pure keep the caller
+// pure; calls through parameters or other values are assumed to have effects.
+static int is_pure_callee(SemanticAnalyzer* analyzer, Expression* callee) {
+    if (!callee || callee->node_type != EXPR_IDENTIFIER) return 0;
+
+    Symbol* symbol = symbol_table_lookup(analyzer, callee->data.identifier.value);
+    if (symbol && symbol->kind == SYMBOL_TYPE) return 1;
+    if (!symbol || symbol->kind != SYMBOL_FUNCTION) return 0;
+
+    // The callee's body may still be unchecked (or checked on another
+    // thread); assume it is pure and let resolve_deferred_purity decide.
+    if (analyzer->defer_purity && symbol->function_literal) {
+        if (analyzer->current_function_literal) {
+            add_purity_edge(analyzer, analyzer->current_function_literal, symbol->function_literal);
+        }
+        return 1;
+    }
+    return symbol->is_pure;
+}
+
+// The sharing counterpart of is_pure_callee, once the callee has been
+// checked: a call passes on whatever mutable state its callee reaches. A
+// call through a function value might reach anything. Under defer_purity
+// the edge is_pure_callee recorded carries it once the callee's body has
+// been checked.
+static void note_callee_sharing(SemanticAnalyzer* analyzer, Expression* callee) {
+    if (callee && callee->node_type == EXPR_FUNCTION_LITERAL) {
+        if (analyzer->defer_purity && analyzer->current_function_literal) {
+            add_purity_edge(analyzer, analyzer->current_function_literal, callee);
+        }
+        if (callee->data.function_literal.shares_mutable_state) analyzer->current_function_shares_state = 1;
+        return;
+    }
+    if (!callee || callee->node_type != EXPR_IDENTIFIER) {
+        analyzer->current_function_shares_state = 1;
+        return;
+    }
+
+    Symbol* symbol = symbol_table_lookup(analyzer, callee->data.identifier.value);
+    if (symbol && symbol->kind == SYMBOL_TYPE) return;
+    if (!symbol || symbol->kind != SYMBOL_FUNCTION) {
+        analyzer->current_function_shares_state = 1;
+        return;
+    }
+    if (!analyzer->defer_purity && symbol->function_literal &&
+        symbol->function_literal->data.function_literal.shares_mutable_state) {
+        analyzer->current_function_shares_state = 1;
+    }
+}
+
+// Declared with let mut outside the function being checked, so a task
+// spawned to run it would share the variable with the one that spawned it.
+static int is_captured_mutable(SemanticAnalyzer* analyzer, Symbol* symbol) {
+    return symbol->is_mutable && symbol->scope_level < analyzer->current_function_scope_level;
+}
+
+static int is_builtin_call(SemanticAnalyzer* analyzer, Expression* callee);
+
+static void push_call(ParallelCall** calls, int* count, int* capacity, Expression* call, Expression* callee, int order) {
+    if (*count >= *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 16;
+        *calls = realloc(*calls, sizeof(ParallelCall) * *capacity);
+    }
+    (*calls)[*count].call = call;
+    (*calls)[*count].callee = callee;
+    (*calls)[*count].order = order;
+    (*count)++;
+}
+
+static void report_spawn_call(SemanticAnalyzer* analyzer, Expression* call) {
+    Expression* callee = call->data.call.function;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+    snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+             "cannot spawn '%s', which may use let mut state the spawning task can change",
+             callee->node_type == EXPR_IDENTIFIER ? callee->data.identifier.value : "<expression>");
+    semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, call->line, call->column);
+}
+
+// The callee of a spawned call must not share mutable state with the
+// spawner (see current_function_shares_state). A function spawning itself
+// waits for the rest of its body (settle_spawn_calls), and under
+// defer_purity every named callee waits for resolve_deferred_purity.
+static void check_spawn_callee(SemanticAnalyzer* analyzer, Expression* call) {
+    Expression* callee = call->data.call.function;
+    if (is_builtin_call(analyzer, callee)) return;
+
+    Expression* literal = callee->node_type == EXPR_FUNCTION_LITERAL ? callee : NULL;
+    if (callee->node_type == EXPR_IDENTIFIER) {
+        Symbol* symbol = symbol_table_lookup(analyzer, callee->data.identifier.value);
+        if (symbol && symbol->kind == SYMBOL_TYPE) return;
+        if (symbol && symbol->kind == SYMBOL_FUNCTION) literal = symbol->function_literal;
+    }
+
+    if (literal && (analyzer->defer_purity || literal == analyzer->current_function_literal)) {
+        push_call(&analyzer->spawn_calls, &analyzer->spawn_call_count, &analyzer->spawn_call_capacity,
+                  call, literal, analyzer->error_order);
+        return;
+    }
+    if (!literal || literal->data.function_literal.shares_mutable_state) report_spawn_call(analyzer, call);
+}
+
+// Reports the waiting spawned calls of literal, or of every literal when it
+// is NULL, whose callee turned out to share mutable state.
+static void settle_spawn_calls(SemanticAnalyzer* analyzer, Expression* literal) {
+    int order = analyzer->error_order;
+    int kept = 0;
+    for (int i = 0; i < analyzer->spawn_call_count; i++) {
+        ParallelCall* call = &analyzer->spawn_calls[i];
+        if (literal && call->callee != literal) {
+            analyzer->spawn_calls[kept++] = *call;
+            continue;
+        }
+        if (call->callee->data.function_literal.shares_mutable_state) {
+            analyzer->error_order = call->order;
+            report_spawn_call(analyzer, call->call);
+        }
+    }
+    analyzer->spawn_call_count = kept;
+    analyzer->error_order = order;
+}
+
+static int is_memo_key_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN &&
+           (type->data.builtin == BUILTIN_INT || type->data.builtin == BUILTIN_FLOAT ||
+            type->data.builtin == BUILTIN_BOOL || type->data.builtin == BUILTIN_STRING);
+}
+
+// Decides whether a function literal gets a result cache: explicitly via
+// @memo (an error if it cannot be honoured) or for every eligible pure
+// function when memoize_pure_functions is set.
+static void check_memoization(SemanticAnalyzer* analyzer, Expression* expr, TypeInfo* function_type) {
+    // Each call to a generator must start a fresh sequence.
+    int eligible = expr->data.function_literal.is_pure && !expr->data.function_literal.is_generator &&
+                   function_type->data.function.param_count <= MEMO_MAX_ARGS;
+
+    for (int i = 0; eligible && i < function_type->data.function.param_count; i++) {
+        eligible = is_memo_key_type(function_type->data.function.param_types[i]);
+    }
+
+    if (expr->data.function_literal.is_memo && !eligible) {
+        char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+        const char* name = expr->data.function_literal.name ? expr->data.function_literal.name : "<anonymous>";
+        if (expr->data.function_literal.is_generator) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot memoize generator '%s'", name);
+        } else if (!expr->data.function_literal.is_pure) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot memoize impure function '%s'", name);
+        } else {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                     "cannot memoize '%s': parameters must be at most %d int, float, bool or string values",
+                     name, MEMO_MAX_ARGS);
+        }
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, error_msg, expr->line, expr->column);
+        return;
+    }
+
+    if (analyzer->memoize_pure_functions && eligible) {
+        expr->data.function_literal.is_memo = 1;
+    }
+}
+
+static TypeInfo* analyze_function_literal(SemanticAnalyzer* analyzer, Expression* expr) {
+    TypeInfo** param_types = heap_alloc(vm_heap(), sizeof(TypeInfo*) * expr->data.function_literal.parameter_count);
+    
+    semantic_push_scope(analyzer);
+    
+    for (int i = 0; i < expr->data.function_literal.parameter_count; i++) {
+        Parameter* param = expr->data.function_literal.parameters[i];
+        TypeInfo* param_type = convert_ast_type_to_type_info(analyzer, param->type);
+        param_types[i] = param_type;
+        
+        Symbol* param_symbol = symbol_new(param->name, SYMBOL_PARAMETER, param_type);
+        param_symbol->is_initialized = 1;
+        symbol_table_add(analyzer, param_symbol);
+    }
+    
+    TypeInfo* return_type = analyzer->builtin_types[BUILTIN_UNIT];
+    if (expr->data.function_literal.return_type) {
+        return_type = convert_ast_type_to_type_info(analyzer, expr->data.function_literal.return_type);
+    }
+    
+    TypeInfo* yield_type = NULL;
+    if (expr->data.function_literal.is_generator) {
+        if (!is_sequence_type(return_type) || is_unknown_type(return_type->pointed_to)) {
+            char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+            const char* name = expr->data.function_literal.name ? expr->data.function_literal.name : "<anonymous>";
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                     "generator '%s' must declare its return type as seq<T>", name);
+            semantic_add_error(analyzer, ERROR_RETURN_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+            semantic_pop_scope(analyzer);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        yield_type = return_type->pointed_to;
+    }
+    
+    TypeInfo* old_return_type = analyzer->current_function_return_type;
+    TypeInfo* old_yield_type = analyzer->current_yield_type;
+    int old_yield_allowed = analyzer->yield_allowed;
+    int old_is_pure = analyzer->current_function_is_pure;
+    int old_shares_state = analyzer->current_function_shares_state;
+    int old_function_scope_level = analyzer->current_function_scope_level;
+    Expression* old_function_literal = analyzer->current_function_literal;
+    analyzer->current_function_return_type = return_type;
+    analyzer->current_yield_type = yield_type;
+    analyzer->yield_allowed = yield_type != NULL;
+    analyzer->current_function_is_pure = 1;
+    analyzer->current_function_shares_state = 0;
+    analyzer->current_function_scope_level = analyzer->current_scope_level;
+    analyzer->current_function_literal = expr;
+
+    int ok = 1;
+    for (int i = 0; ok && i < expr->data.function_literal.body_count; i++) {
+        ok = semantic_analyze_statement(analyzer, expr->data.function_literal.body[i]);
+    }
+    
+    if (ok) {
+        expr->data.function_literal.is_pure = analyzer->current_function_is_pure;
+        expr->data.function_literal.shares_mutable_state = analyzer->current_function_shares_state;
+        if (!analyzer->defer_purity) settle_spawn_calls(analyzer, expr);
+    }
+    analyzer->current_function_return_type = old_return_type;
+    analyzer->current_yield_type = old_yield_type;
+    analyzer->yield_allowed = old_yield_allowed;
+    analyzer->current_function_is_pure = old_is_pure;
+    analyzer->current_function_shares_state = old_shares_state;
+    analyzer->current_function_scope_level = old_function_scope_level;
+    analyzer->current_function_literal = old_function_literal;
+    semantic_pop_scope(analyzer);
+
+    if (!ok) {
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* function_type = type_info_new_function(param_types, expr->data.function_literal.parameter_count, return_type);
+    if (analyzer->defer_purity) {
+        add_checked_literal(analyzer, expr, function_type);
+    } else {
+        check_memoization(analyzer, expr, function_type);
+    }
+    return function_type;
+}
+
+static int is_mutable_reference(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_MUT_REF;
+}
+
+// A spawned call runs concurrently with the task that spawned it, so a
+// mutable borrow must not reach it: neither as an argument nor as the
+// result handed back through the future. Nor may a `let mut` variable,
+// array, map or struct, which the caller could change while the task
+// uses it: not as an argument, and not through the callee.
+static TypeInfo* analyze_spawn(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression* call = expr->data.prefix.right;
+    analyzer->current_function_is_pure = 0;
+
+    // Checked before the call itself so the error names the real problem
+    // rather than an argument type mismatch.
+    for (int i = 0; i < call->data.call.argument_count; i++) {
+        Expression* arg = call->data.call.arguments[i];
+        const char* borrowed = NULL;
+
+        if (arg->node_type == EXPR_PREFIX && strcmp(arg->data.prefix.operator, "&mut") == 0) {
+            borrowed = arg->data.prefix.right->node_type == EXPR_IDENTIFIER ? arg->data.prefix.right->data.identifier.value : "";
+        } else if (arg->node_type == EXPR_IDENTIFIER) {
+            Symbol* symbol = symbol_table_lookup(analyzer, arg->data.identifier.value);
+            if (symbol && is_mutable_reference(symbol->type)) borrowed = symbol->name;
+            if (symbol && symbol->is_mutable && container_kind(symbol->type)) {
+                char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+                snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                         "cannot pass mutable %s '%s' to a spawned task; bind it with let first",
+                         container_kind(symbol->type), symbol->name);
+                semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, arg->line, arg->column);
+                return analyzer->builtin_types[BUILTIN_UNKNOWN];
+            }
+        }
+
+        if (borrowed) {
+            char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot send mutable borrow '%s' to a spawned task", borrowed);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, arg->line, arg->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    TypeInfo* result_type = semantic_analyze_expression(analyzer, call);
+    if (!result_type || result_type == analyzer->builtin_types[BUILTIN_UNKNOWN]) {
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    // Reported without giving up the future's type, as when the callee's
+    // verdict has to wait, so that uses of the result check the same way.
+    check_spawn_callee(analyzer, call);
+
+    for (int i = 0; i < call->data.call.argument_count; i++) {
+        if (is_mutable_reference(call->data.call.arguments[i]->resolved_type)) {
+            char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot send a mutable borrow to a spawned task (argument %d)", i + 1);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    if (is_mutable_reference(result_type)) {
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, "a spawned task cannot return a mutable borrow", expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    return type_info_new_future(result_type);
+}
+
+static TypeInfo* analyze_await(SemanticAnalyzer* analyzer, Expression* expr) {
+    TypeInfo* operand_type = semantic_analyze_expression(analyzer, expr->data.prefix.right);
+    if (!operand_type || operand_type->category != TYPECAT_BUILTIN || operand_type->data.builtin != BUILTIN_FUTURE) {
+        char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+        char* type_str = type_info_to_string(operand_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "await expects a future, got %s", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    return operand_type->pointed_to;
+}
+
+static int is_int_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_INT;
+}
+
+static int is_string_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN && type->data.builtin == BUILTIN_STRING;
+}
+
+static int is_reduction_variable(SemanticAnalyzer* analyzer, const char* name) {
+    Statement* loop = analyzer->parallel_loop;
+    for (int i = 0; loop && i < loop->data.for_stmt.reduce_count; i++) {
+        if (strcmp(loop->data.for_stmt.reduce_names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+// Declared outside the innermost par for body, so every chunk sees the same one.
+static int is_shared_with_chunks(SemanticAnalyzer* analyzer, Symbol* symbol) {
+    return analyzer->parallel_scope_level > 0 && symbol->scope_level < analyzer->parallel_scope_level;
+}
+
+static void add_parallel_call(SemanticAnalyzer* analyzer, Expression* call, Expression* callee, int order) {
+    push_call(&analyzer->parallel_calls, &analyzer->parallel_call_count, &analyzer->parallel_call_capacity,
+              call, callee, order);
+}
+
+static void report_parallel_call(SemanticAnalyzer* analyzer, Expression* call) {
+    Expression* callee = call->data.call.function;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+    snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "par for body cannot call '%s', which may have side effects",
+             callee->node_type == EXPR_IDENTIFIER ? callee->data.identifier.value : "<expression>");
+    semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, call->line, call->column);
+}
+
+// Chunks of a par for body run at the same time, so only calls to
+// functions known to be pure are allowed there. A callee whose body is
+// still being checked is settled by resolve_deferred_purity.
+static int check_parallel_call(SemanticAnalyzer* analyzer, Expression* call) {
+    Expression* callee = call->data.call.function;
+    Symbol* symbol = NULL;
+    if (callee->node_type == EXPR_IDENTIFIER) {
+        symbol = symbol_table_lookup(analyzer, callee->data.identifier.value);
+    }
+
+    if (symbol && symbol->kind == SYMBOL_TYPE) return 1;
+    if (symbol && symbol->kind == SYMBOL_FUNCTION) {
+        if (analyzer->defer_purity && symbol->function_literal) {
+            add_parallel_call(analyzer, call, symbol->function_literal, analyzer->error_order);
+            return 1;
+        }
+        if (symbol->is_pure) return 1;
+    }
+
+    report_parallel_call(analyzer, call);
+    return 0;
+}
+
+static int is_reference_type(TypeInfo* type) {
+    return type && type->category == TYPECAT_BUILTIN &&
+           (type->data.builtin == BUILTIN_REF || type->data.builtin == BUILTIN_MUT_REF);
+}
+
+static int is_builtin_call(SemanticAnalyzer* analyzer, Expression* callee) {
+    if (callee->node_type != EXPR_IDENTIFIER) return 0;
+    const char* name = callee->data.identifier.value;
+    return builtin_lookup(name) && !symbol_table_lookup(analyzer, name);
+}
+
+static int is_pipe_stage(const char* name) {
+    return strcmp(name, "filter") == 0 || strcmp(name, "map") == 0 || strcmp(name, "take") == 0;
+}
+
+// The channel operand of send and recv must have a known element type;
+// channel() alone does not give it one.
+static TypeInfo* analyze_channel_operand(SemanticAnalyzer* analyzer, Expression* expr, const char* name) {
+    TypeInfo* type = semantic_analyze_expression(analyzer, expr);
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (!is_channel_type(type)) {
+        char* type_str = type_info_to_string(type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s expects a channel, got %s", name, type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return NULL;
+    }
+    if (is_unknown_type(type->pointed_to)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                 "%s needs the channel's element type; annotate it, e.g. let c: chan<int> = channel(16)", name);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return NULL;
+    }
+    return type;
+}
+
+// A value sent on a channel is received by another task, possibly on
+// another worker, so only owned values may cross: no borrows, and nothing
+// that is currently lent out.
+static int check_sendable(SemanticAnalyzer* analyzer, Expression* value, TypeInfo* value_type) {
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (is_reference_type(value_type)) {
+        char* type_str = type_info_to_string(value_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot send %s on a channel: only owned values can be sent", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, value->line, value->column);
+        return 0;
+    }
+    if (value->node_type == EXPR_IDENTIFIER) {
+        Symbol* symbol = symbol_table_lookup(analyzer, value->data.identifier.value);
+        if (symbol && symbol->borrow_state != BORROW_STATE_NONE) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot send '%s' on a channel while it is borrowed", symbol->name);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, value->line, value->column);
+            return 0;
+        }
+        if (symbol && symbol->is_mutable && container_kind(symbol->type)) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                     "cannot send mutable %s '%s' on a channel; bind it with let first",
+                     container_kind(symbol->type), symbol->name);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, value->line, value->column);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int is_async_builtin(const char* name) {
+    return strcmp(name, "read_file_async") == 0 || strcmp(name, "write_async") == 0 || strcmp(name, "sleep") == 0;
+}
+
+// read_file_async(path) -> future<string>, write_async(path, data) ->
+// future<int> and sleep(ms) -> future<unit>. The operation starts at the
+// call; await picks up its result.
+static TypeInfo* analyze_async_call(SemanticAnalyzer* analyzer, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression** args = expr->data.call.arguments;
+    TypeInfo* string_type = analyzer->builtin_types[BUILTIN_STRING];
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (strcmp(name, "sleep") == 0) {
+        if (!is_int_type(semantic_analyze_expression(analyzer, args[0]))) {
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, "sleep duration must be an int (milliseconds)", args[0]->line, args[0]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        return type_info_new_future(analyzer->builtin_types[BUILTIN_UNIT]);
+    }
+
+    for (int i = 0; i < expr->data.call.argument_count; i++) {
+        TypeInfo* type = semantic_analyze_expression(analyzer, args[i]);
+        if (!type_info_equals(type, string_type)) {
+            char* type_str = type_info_to_string(type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s %s must be a string, got %s",
+                     name, i == 0 ? "path" : "data", type_str);
+            free(type_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[i]->line, args[i]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    if (strcmp(name, "read_file_async") == 0) return type_info_new_future(string_type);
+    return type_info_new_future(analyzer->builtin_types[BUILTIN_INT]);
+}
+
+static int is_output_builtin(const char* name) {
+    return strcmp(name, "print") == 0 || strcmp(name, "write") == 0 || strcmp(name, "flush") == 0;
+}
+
+// print(value), write(s) and flush(), all -> unit. print takes a value of
+// any type; write only a string.
+static TypeInfo* analyze_output_call(SemanticAnalyzer* analyzer, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression** args = expr->data.call.arguments;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (expr->data.call.argument_count == 1) {
+        TypeInfo* type = semantic_analyze_expression(analyzer, args[0]);
+        if (strcmp(name, "write") == 0 && !is_string_type(type)) {
+            char* type_str = type_info_to_string(type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "write expects a string, got %s", type_str);
+            free(type_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[0]->line, args[0]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+    return analyzer->builtin_types[BUILTIN_UNIT];
+}
+
+static int is_input_builtin(const char* name) {
+    return strcmp(name, "lines") == 0 || strcmp(name, "stdin_lines") == 0;
+}
+
+// lines(path) and stdin_lines() -> seq<string>.
+static TypeInfo* analyze_input_call(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression** args = expr->data.call.arguments;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (expr->data.call.argument_count == 1) {
+        TypeInfo* type = semantic_analyze_expression(analyzer, args[0]);
+        if (!is_string_type(type)) {
+            char* type_str = type_info_to_string(type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "lines path must be a string, got %s", type_str);
+            free(type_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[0]->line, args[0]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+    return type_info_new_sequence(analyzer->builtin_types[BUILTIN_STRING]);
+}
+
+// Whole-array operations run by the vector kernels in simd.c. They read
+// their operands and return a fresh value, so like len they are pure.
+static int is_array_kernel(const char* name) {
+    return strcmp(name, "sum") == 0 || strcmp(name, "dot") == 0 || strcmp(name, "map_add") == 0 ||
+           strcmp(name, "scale") == 0 || strcmp(name, "min") == 0 || strcmp(name, "max") == 0 ||
+           strcmp(name, "argmax") == 0;
+}
+
+static int is_array_builtin(const char* name) {
+    return strcmp(name, "push") == 0 || is_array_kernel(name);
+}
+
+static int is_map_builtin(const char* name) {
+    return strcmp(name, "get") == 0 || strcmp(name, "set") == 0 || strcmp(name, "has") == 0 ||
+           strcmp(name, "delete") == 0;
+}
+
+// push, set, delete and element assignment change an array or map in
+// place, so it has to be named by a `let mut` variable that is not lent
+// out. kind is "array" or "map". Returns the variable, or NULL after
+// reporting why not.
+static Symbol* analyze_container_target(SemanticAnalyzer* analyzer, Expression* target, const char* kind, const char* action) {
+    const char* article = kind[0] == 'a' ? "an" : "a";
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (target->node_type != EXPR_IDENTIFIER) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "can only %s %s %s held in a variable", action, article, kind);
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, error_msg, target->line, target->column);
+        return NULL;
+    }
+
+    TypeInfo* type = semantic_analyze_expression(analyzer, target);
+    Symbol* symbol = symbol_table_lookup(analyzer, target->data.identifier.value);
+    if (!symbol) return NULL;
+
+    if (!container_kind(type) || strcmp(container_kind(type), kind) != 0) {
+        char* type_str = type_info_to_string(type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot %s '%s': it is %s, not %s %s",
+                 action, symbol->name, type_str, article, kind);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, target->line, target->column);
+        return NULL;
+    }
+    if (symbol->kind != SYMBOL_VARIABLE || !symbol->is_mutable) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot %s immutable %s '%s'; declare it with let mut",
+                 action, kind, symbol->name);
+        semantic_add_error(analyzer, ERROR_IMMUTABLE_ASSIGNMENT, error_msg, target->line, target->column);
+        return NULL;
+    }
+    if (symbol->borrow_state != BORROW_STATE_NONE) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot %s '%s' because it is borrowed", action, symbol->name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, target->line, target->column);
+        return NULL;
+    }
+    if (symbol->scope_level < analyzer->current_function_scope_level) {
+        analyzer->current_function_is_pure = 0;
+        analyzer->current_function_shares_state = 1;
+    }
+    return symbol;
+}
+
+// sum, min and max of a [T] give a T, dot(a, b) of two [T] too, and
+// argmax gives the int index. map_add(a, b) and scale(a, k) build a new
+// [T]; k must be a T. operands are the arguments, with the left side of
+// `|>` first when the kernel is a pipeline stage.
+static TypeInfo* analyze_array_kernel(SemanticAnalyzer* analyzer, Expression* expr, const char* name,
+                                      Expression** operands, int operand_count) {
+    int expected_count = strcmp(name, "dot") == 0 || strcmp(name, "map_add") == 0 || strcmp(name, "scale") == 0 ? 2 : 1;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (operand_count != expected_count) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to %s: expected %d, got %d",
+                 name, expected_count, operand_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* array_type = semantic_analyze_expression(analyzer, operands[0]);
+    if (!is_array_type(array_type) || is_unknown_type(array_type->pointed_to)) {
+        char* type_str = type_info_to_string(array_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s expects an array with a known element type, got %s", name, type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, operands[0]->line, operands[0]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    TypeInfo* element_type = array_type->pointed_to;
+
+    if (expected_count == 2) {
+        int is_scale = strcmp(name, "scale") == 0;
+        TypeInfo* expected_type = is_scale ? element_type : array_type;
+        TypeInfo* operand_type = semantic_analyze_expression(analyzer, operands[1]);
+        if (!type_info_equals(operand_type, expected_type)) {
+            char* operand_str = type_info_to_string(operand_type);
+            char* expected_str = type_info_to_string(expected_type);
+            if (is_scale) {
+                char* array_str = type_info_to_string(array_type);
+                snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "scale factor for %s must be %s, got %s",
+                         array_str, expected_str, operand_str);
+                free(array_str);
+            } else {
+                snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s needs two arrays of the same type, got %s and %s",
+                         name, expected_str, operand_str);
+            }
+            free(operand_str);
+            free(expected_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, operands[1]->line, operands[1]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    if (strcmp(name, "argmax") == 0) return analyzer->builtin_types[BUILTIN_INT];
+    if (strcmp(name, "map_add") == 0 || strcmp(name, "scale") == 0) return array_type;
+    return element_type;
+}
+
+// The kernel named by a pipeline stage `a |> sum`, `a |> sum()` or
+// `a |> scale(k)`, or NULL if the stage is something else.
+static const char* piped_array_kernel(SemanticAnalyzer* analyzer, Expression* stage) {
+    Expression* callee = stage->node_type == EXPR_CALL ? stage->data.call.function : stage;
+    if (!is_builtin_call(analyzer, callee) || !is_array_kernel(callee->data.identifier.value)) return NULL;
+    return callee->data.identifier.value;
+}
+
+// The array on the left of |> becomes the kernel's first argument.
+static TypeInfo* analyze_piped_array_kernel(SemanticAnalyzer* analyzer, Expression* expr, const char* name) {
+    Expression* stage = expr->data.pipe.right;
+    Expression* operands[3];
+    int operand_count = 1;
+
+    operands[0] = expr->data.pipe.left;
+    if (stage->node_type == EXPR_CALL) {
+        if (stage->data.call.argument_count > 2) {
+            return analyze_array_kernel(analyzer, stage, name, operands, stage->data.call.argument_count + 1);
+        }
+        for (int i = 0; i < stage->data.call.argument_count; i++) {
+            operands[operand_count++] = stage->data.call.arguments[i];
+        }
+    }
+
+    stage->resolved_type = analyze_array_kernel(analyzer, stage, name, operands, operand_count);
+    return stage->resolved_type;
+}
+
+// len(a) -> int counts the elements of an array or the entries of a map.
+// It only reads, so it is pure and allowed in par for bodies.
+static TypeInfo* analyze_len(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression** args = expr->data.call.arguments;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (expr->data.call.argument_count != 1) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to len: expected 1, got %d",
+                 expr->data.call.argument_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* type = semantic_analyze_expression(analyzer, args[0]);
+    if (!is_array_type(type) && !is_map_type(type) && !is_string_type(type)) {
+        char* type_str = type_info_to_string(type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "len expects an array, a map or a string, got %s", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[0]->line, args[0]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    return analyzer->builtin_types[BUILTIN_INT];
+}
+
+static int is_string_builtin(const char* name) {
+    return strcmp(name, "substring") == 0 || strcmp(name, "trim") == 0 || strcmp(name, "split") == 0;
+}
+
+// substring(s, start, end) and trim(s) -> string, split(s, separator) ->
+// seq<string>. Their results are views of s, so like len they are pure.
+// A view needs no borrow of s: the bytes of every string live as long as
+// the heap that holds the string, so no view can outlive them.
+static TypeInfo* analyze_string_builtin(SemanticAnalyzer* analyzer, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression** args = expr->data.call.arguments;
+    int arg_count = expr->data.call.argument_count;
+    int is_substring = strcmp(name, "substring") == 0;
+    int expected_count = is_substring ? 3 : strcmp(name, "split") == 0 ? 2 : 1;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (arg_count != expected_count) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to %s: expected %d, got %d",
+                 name, expected_count, arg_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    for (int i = 0; i < arg_count; i++) {
+        TypeInfo* type = semantic_analyze_expression(analyzer, args[i]);
+        int wants_int = is_substring && i > 0;
+        if (wants_int ? !is_int_type(type) : !is_string_type(type)) {
+            char* type_str = type_info_to_string(type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s expects %s as argument %d, got %s",
+                     name, wants_int ? "an int" : "a string", i + 1, type_str);
+            free(type_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[i]->line, args[i]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    if (strcmp(name, "split") == 0) return type_info_new_sequence(analyzer->builtin_types[BUILTIN_STRING]);
+    return analyzer->builtin_types[BUILTIN_STRING];
+}
+
+// push(a, value) and the kernels above. push appends in amortized
+// constant time but cannot touch an array that the chunks of a par for
+// share.
+static TypeInfo* analyze_array_builtin(SemanticAnalyzer* analyzer, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression** args = expr->data.call.arguments;
+    int arg_count = expr->data.call.argument_count;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (is_array_kernel(name)) return analyze_array_kernel(analyzer, expr, name, args, arg_count);
+
+    if (arg_count != 2) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to push: expected 2, got %d", arg_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    Symbol* symbol = analyze_container_target(analyzer, args[0], "array", "push to");
+    if (!symbol) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    if (is_shared_with_chunks(analyzer, symbol)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot push to '%s' inside a par for body: every chunk shares it", symbol->name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (is_unknown_type(symbol->type->pointed_to)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                 "push needs the array's element type; annotate it, e.g. let mut %s: [int] = []", symbol->name);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[0]->line, args[0]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, args[1]);
+    if (!type_info_equals(value_type, symbol->type->pointed_to)) {
+        char* value_type_str = type_info_to_string(value_type);
+        char* array_type_str = type_info_to_string(symbol->type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot push %s onto %s", value_type_str, array_type_str);
+        free(value_type_str);
+        free(array_type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[1]->line, args[1]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    return analyzer->builtin_types[BUILTIN_UNIT];
+}
+
+// get(m, k) -> V and has(m, k) -> bool read a map<K, V> and are pure.
+// set(m, k, value) and delete(m, k) -> bool change it, so like push they
+// need a `let mut` map that no par for chunks share.
+static TypeInfo* analyze_map_builtin(SemanticAnalyzer* analyzer, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression** args = expr->data.call.arguments;
+    int arg_count = expr->data.call.argument_count;
+    int is_set = strcmp(name, "set") == 0;
+    int changes_map = is_set || strcmp(name, "delete") == 0;
+    int expected_count = is_set ? 3 : 2;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (arg_count != expected_count) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to %s: expected %d, got %d",
+                 name, expected_count, arg_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* map_type;
+    if (changes_map) {
+        Symbol* symbol = analyze_container_target(analyzer, args[0], "map", is_set ? "set a key of" : "delete from");
+        if (!symbol) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        if (is_shared_with_chunks(analyzer, symbol)) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot %s '%s' inside a par for body: every chunk shares it",
+                     is_set ? "set a key of" : "delete from", symbol->name);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        map_type = symbol->type;
+    } else {
+        map_type = semantic_analyze_expression(analyzer, args[0]);
+        if (!is_map_type(map_type)) {
+            char* type_str = type_info_to_string(map_type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s expects a map, got %s", name, type_str);
+            free(type_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[0]->line, args[0]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+    if (is_unknown_type(map_type->key_type) || is_unknown_type(map_type->pointed_to)) {
+        const char* map_name = args[0]->node_type == EXPR_IDENTIFIER ? args[0]->data.identifier.value : "m";
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                 "%s needs the map's key and value types; annotate it, e.g. let mut %s: map<string, int> = {}",
+                 name, map_name);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[0]->line, args[0]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* key_type = semantic_analyze_expression(analyzer, args[1]);
+    if (!type_info_equals(key_type, map_type->key_type)) {
+        char* key_type_str = type_info_to_string(key_type);
+        char* expected_str = type_info_to_string(map_type->key_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s key must be %s, got %s", name, expected_str, key_type_str);
+        free(key_type_str);
+        free(expected_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[1]->line, args[1]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    if (is_set) {
+        TypeInfo* value_type = semantic_analyze_expression(analyzer, args[2]);
+        if (!type_info_is_assignable(value_type, map_type->pointed_to)) {
+            char* value_type_str = type_info_to_string(value_type);
+            char* map_type_str = type_info_to_string(map_type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot set a %s value in %s", value_type_str, map_type_str);
+            free(value_type_str);
+            free(map_type_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[2]->line, args[2]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        return analyzer->builtin_types[BUILTIN_UNIT];
+    }
+    if (strcmp(name, "get") == 0) return map_type->pointed_to;
+    return analyzer->builtin_types[BUILTIN_BOOL];
+}
+
+// channel([capacity]), send(c, value), recv(c), close(c), the
+// asynchronous I/O, output and line reading calls and the string, array
+// and map calls above. They are resolved here rather than through symbols because their
+// types depend on the element type of the channel, array or map. len, the
+// string slices, get, has and the array kernels are pure; the rest have
+// effects.
+static TypeInfo* analyze_builtin_call(SemanticAnalyzer* analyzer, Expression* expr) {
+    const char* name = expr->data.call.function->data.identifier.value;
+    Expression** args = expr->data.call.arguments;
+    int arg_count = expr->data.call.argument_count;
+    int expected_count = strcmp(name, "send") == 0 || strcmp(name, "write_async") == 0 ? 2 :
+                         strcmp(name, "flush") == 0 || strcmp(name, "stdin_lines") == 0 ? 0 : 1;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (is_pipe_stage(name)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s is a pipeline stage; use it as `s |> %s(...)`", name, name);
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (strcmp(name, "len") == 0) return analyze_len(analyzer, expr);
+    if (is_string_builtin(name)) return analyze_string_builtin(analyzer, expr);
+    if (is_array_builtin(name)) return analyze_array_builtin(analyzer, expr);
+    if (is_map_builtin(name)) return analyze_map_builtin(analyzer, expr);
+
+    analyzer->current_function_is_pure = 0;
+    if (analyzer->parallel_scope_level > 0) {
+        report_parallel_call(analyzer, expr);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    if (strcmp(name, "channel") == 0 ? arg_count > 1 : arg_count != expected_count) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to %s: expected %s%d, got %d",
+                 name, strcmp(name, "channel") == 0 ? "at most " : "", expected_count, arg_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    if (strcmp(name, "channel") == 0) {
+        if (arg_count == 1 && !is_int_type(semantic_analyze_expression(analyzer, args[0]))) {
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, "channel capacity must be an int", args[0]->line, args[0]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        return type_info_new_channel(analyzer->builtin_types[BUILTIN_UNKNOWN]);
+    }
+    if (is_async_builtin(name)) return analyze_async_call(analyzer, expr);
+    if (is_output_builtin(name)) return analyze_output_call(analyzer, expr);
+    if (is_input_builtin(name)) return analyze_input_call(analyzer, expr);
+
+    TypeInfo* channel_type = analyze_channel_operand(analyzer, args[0], name);
+    if (!channel_type) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    if (strcmp(name, "recv") == 0) return channel_type->pointed_to;
+    if (strcmp(name, "close") == 0) return analyzer->builtin_types[BUILTIN_UNIT];
+
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, args[1]);
+    if (!check_sendable(analyzer, args[1], value_type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    if (!type_info_is_assignable(value_type, channel_type->pointed_to)) {
+        char* value_type_str = type_info_to_string(value_type);
+        char* channel_type_str = type_info_to_string(channel_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot send %s on %s", value_type_str, channel_type_str);
+        free(value_type_str);
+        free(channel_type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, args[1]->line, args[1]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    return analyzer->builtin_types[BUILTIN_UNIT];
+}
+
+// `s |> filter(p)`, `s |> map(f)` and `s |> take(n)` over a seq<T>. The
+// stage receives the sequence as its first argument, so its type depends
+// on T: filter needs func(T) -> bool, map func(T) -> U and gives seq<U>.
+// Building a stage runs nothing, but pulling from it calls the function,
+// so stages count as effects.
+static TypeInfo* analyze_pipe_stage(SemanticAnalyzer* analyzer, Expression* call, TypeInfo* source_type) {
+    const char* name = call->data.call.function->data.identifier.value;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (!is_pipe_stage(name)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s cannot be used as a pipeline stage", name);
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, error_msg, call->line, call->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    analyzer->current_function_is_pure = 0;
+    if (analyzer->parallel_scope_level > 0) {
+        report_parallel_call(analyzer, call);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    if (!is_sequence_type(source_type) || is_unknown_type(source_type->pointed_to)) {
+        char* type_str = type_info_to_string(source_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s needs a sequence on the left of |>, got %s", name, type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, call->line, call->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (call->data.call.argument_count != 1) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Wrong number of arguments to %s: expected 1, got %d",
+                 name, call->data.call.argument_count);
+        semantic_add_error(analyzer, ERROR_WRONG_ARGUMENT_COUNT, error_msg, call->line, call->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    Expression* argument = call->data.call.arguments[0];
+    TypeInfo* argument_type = semantic_analyze_expression(analyzer, argument);
+    TypeInfo* element_type = source_type->pointed_to;
+
+    if (strcmp(name, "take") == 0) {
+        if (!is_int_type(argument_type)) {
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, "take count must be an int", argument->line, argument->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        return source_type;
+    }
+
+    // Pulling from the stage calls the function; is_pure_callee only
+    // records the call for resolve_deferred_purity, the stage being impure
+    // anyway.
+    is_pure_callee(analyzer, argument);
+    note_callee_sharing(analyzer, argument);
+
+    int is_filter = strcmp(name, "filter") == 0;
+    if (!argument_type || argument_type->category != TYPECAT_FUNCTION ||
+        argument_type->data.function.param_count != 1 ||
+        !type_info_is_assignable(element_type, argument_type->data.function.param_types[0]) ||
+        (is_filter && !type_info_equals(argument_type->data.function.return_type, analyzer->builtin_types[BUILTIN_BOOL]))) {
+        char* argument_str = type_info_to_string(argument_type);
+        char* element_str = type_info_to_string(element_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "%s over seq<%s> needs a func(%s) -> %s, got %s",
+                 name, element_str, element_str, is_filter ? "bool" : "U", argument_str);
+        free(argument_str);
+        free(element_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, argument->line, argument->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    return is_filter ? source_type : type_info_new_sequence(argument_type->data.function.return_type);
+}
+
+// `a[i] = value` stores into a `let mut` array. Chunks of a par for may
+// share the array as long as each one writes only at its own loop index.
+static TypeInfo* analyze_element_assignment(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression* target = expr->data.infix.left;
+    Expression* index = target->data.index.index;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    Symbol* symbol = analyze_container_target(analyzer, target->data.index.array, "array", "assign to an element of");
+    if (!symbol) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    if (is_shared_with_chunks(analyzer, symbol)) {
+        const char* variable = analyzer->parallel_loop->data.for_stmt.variable;
+        Symbol* index_symbol = index->node_type == EXPR_IDENTIFIER ? symbol_table_lookup(analyzer, index->data.identifier.value) : NULL;
+        if (!index_symbol || strcmp(index_symbol->name, variable) != 0 ||
+            index_symbol->scope_level != analyzer->parallel_scope_level) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                     "inside a par for body '%s' can only be assigned at the loop index, as %s[%s] = ...",
+                     symbol->name, symbol->name, variable);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    TypeInfo* element_type = semantic_analyze_expression(analyzer, target);
+    if (is_unknown_type(element_type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, expr->data.infix.right);
+    if (!type_info_equals(value_type, element_type)) {
+        char* value_type_str = type_info_to_string(value_type);
+        char* array_type_str = type_info_to_string(symbol->type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Cannot assign value of type %s to an element of %s", value_type_str, array_type_str);
+        free(value_type_str);
+        free(array_type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    return analyzer->builtin_types[BUILTIN_UNIT];
+}
+
+// `p.x` of a struct resolves to x's position in p's layout, so running it
+// never looks the name up.
+static TypeInfo* analyze_field(SemanticAnalyzer* analyzer, Expression* expr) {
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+    TypeInfo* type = semantic_analyze_expression(analyzer, expr->data.field.object);
+    if (is_unknown_type(type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    if (!is_struct_type(type)) {
+        char* type_str = type_info_to_string(type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot read field '%s' of %s, which is not a struct",
+                 expr->data.field.name, type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    for (int i = 0; i < type->data.struct_info.field_count; i++) {
+        if (strcmp(type->data.struct_info.field_names[i], expr->data.field.name) == 0) {
+            expr->data.field.offset = i;
+            return type->data.struct_info.field_types[i];
+        }
+    }
+
+    snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "struct %s has no field '%s'",
+             type->data.struct_info.name, expr->data.field.name);
+    semantic_add_error(analyzer, ERROR_UNDEFINED_VARIABLE, error_msg, expr->line, expr->column);
+    return analyzer->builtin_types[BUILTIN_UNKNOWN];
+}
+
+static int is_literal_pattern(Expression* pattern, TypeInfo* subject_type) {
+    switch (subject_type->data.builtin) {
+        case BUILTIN_INT:
+            return pattern->node_type == EXPR_INTEGER_LITERAL ||
+                   (pattern->node_type == EXPR_PREFIX && strcmp(pattern->data.prefix.operator, "-") == 0 &&
+                    pattern->data.prefix.right->node_type == EXPR_INTEGER_LITERAL);
+        case BUILTIN_STRING:
+            return pattern->node_type == EXPR_STRING_LITERAL;
+        case BUILTIN_BOOL:
+            return pattern->node_type == EXPR_BOOLEAN_LITERAL;
+        default:
+            return 0;
+    }
+}
+
+// A match takes an int, string or bool and its patterns are literals of
+// that type or `_`, which is what lets its table find the arm. All arms
+// have one type; without a `_` (or both booleans) nothing may match, so
+// then that type must be unit, as for an if without an else.
+static TypeInfo* analyze_match(SemanticAnalyzer* analyzer, Expression* expr) {
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+    TypeInfo* subject_type = semantic_analyze_expression(analyzer, expr->data.match.expression);
+    if (is_unknown_type(subject_type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    if (subject_type->category != TYPECAT_BUILTIN ||
+        (subject_type->data.builtin != BUILTIN_INT && subject_type->data.builtin != BUILTIN_STRING &&
+         subject_type->data.builtin != BUILTIN_BOOL)) {
+        char* type_str = type_info_to_string(subject_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot match on %s: expected int, string or bool", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* result_type = NULL;
+    for (int i = 0; i < expr->data.match.case_count; i++) {
+        Expression* pattern = expr->data.match.cases[i]->pattern;
+        if (i > 0 && match_pattern_is_wildcard(expr->data.match.cases[i - 1]->pattern)) {
+            semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "unreachable match arm after '_'",
+                               pattern->line, pattern->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+        if (!match_pattern_is_wildcard(pattern)) {
+            if (!is_literal_pattern(pattern, subject_type)) {
+                char* type_str = type_info_to_string(subject_type);
+                snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "patterns matching %s must be literals of it or '_'", type_str);
+                free(type_str);
+                semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, pattern->line, pattern->column);
+                return analyzer->builtin_types[BUILTIN_UNKNOWN];
+            }
+            if (match_table_pattern_arm(expr->data.match.table, pattern) != i) {
+                semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "unreachable match arm: its pattern repeats an earlier one",
+                                   pattern->line, pattern->column);
+                return analyzer->builtin_types[BUILTIN_UNKNOWN];
+            }
+            semantic_analyze_expression(analyzer, pattern);
+        }
+
+        TypeInfo* arm_type = semantic_analyze_expression(analyzer, expr->data.match.cases[i]->result);
+        if (is_unknown_type(arm_type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        if (!result_type) {
+            result_type = arm_type;
+        } else if (!type_info_equals(result_type, arm_type)) {
+            char* expected_str = type_info_to_string(result_type);
+            char* actual_str = type_info_to_string(arm_type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Match arms have different types: %s vs %s",
+                     expected_str, actual_str);
+            free(expected_str);
+            free(actual_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, pattern->line, pattern->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    TypeInfo* unit_type = analyzer->builtin_types[BUILTIN_UNIT];
+    const MatchTable* table = expr->data.match.table;
+    int exhaustive = table->default_arm >= 0 ||
+                     (subject_type->data.builtin == BUILTIN_BOOL && table->bool_arms[0] >= 0 && table->bool_arms[1] >= 0);
+    if (!result_type) return unit_type;
+    if (!exhaustive && !type_info_equals(result_type, unit_type)) {
+        char* type_str = type_info_to_string(result_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "match with %s arms needs a '_' arm for when no pattern matches",
+                 type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    return result_type;
+}
+
+// `p.x = value` stores into a `let mut` struct. Chunks of a par for body
+// would all write the same record, so a shared one cannot be assigned.
+static TypeInfo* analyze_field_assignment(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression* target = expr->data.infix.left;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    Symbol* symbol = analyze_container_target(analyzer, target->data.field.object, "struct", "assign to a field of");
+    if (!symbol) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    if (is_shared_with_chunks(analyzer, symbol)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot assign to a field of '%s' inside a par for body",
+                 symbol->name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    TypeInfo* field_type = semantic_analyze_expression(analyzer, target);
+    if (is_unknown_type(field_type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, expr->data.infix.right);
+    if (!type_info_is_assignable(value_type, field_type)) {
+        char* value_type_str = type_info_to_string(value_type);
+        char* field_type_str = type_info_to_string(field_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Cannot assign value of type %s to field '%s' of type %s",
+                 value_type_str, target->data.field.name, field_type_str);
+        free(value_type_str);
+        free(field_type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    return analyzer->builtin_types[BUILTIN_UNIT];
+}
+
+// `name = value` rebinds a `let mut` variable and has type unit. Inside a
+// par for body, variables declared outside it can only be assigned when
+// they are listed in its reduce clause, where each chunk gets its own copy.
+static TypeInfo* analyze_assignment(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression* target = expr->data.infix.left;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (target->node_type == EXPR_INDEX) {
+        return analyze_element_assignment(analyzer, expr);
+    }
+    if (target->node_type == EXPR_FIELD) {
+        return analyze_field_assignment(analyzer, expr);
+    }
+
+    if (target->node_type != EXPR_IDENTIFIER) {
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "left side of '=' must be a variable", expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    const char* name = target->data.identifier.value;
+    Symbol* symbol = symbol_table_lookup(analyzer, name);
+    if (!symbol) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Undefined variable: %s", name);
+        semantic_add_error(analyzer, ERROR_UNDEFINED_VARIABLE, error_msg, target->line, target->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    target->resolved_type = symbol->type;
+
+    if (symbol->kind != SYMBOL_VARIABLE || !symbol->is_mutable) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot assign twice to immutable variable '%s'", name);
+        semantic_add_error(analyzer, ERROR_IMMUTABLE_ASSIGNMENT, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (symbol->borrow_state != BORROW_STATE_NONE) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot assign to '%s' because it is borrowed", name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (is_shared_with_chunks(analyzer, symbol) && !is_reduction_variable(analyzer, name)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                 "cannot assign to '%s' inside a par for body; list it in reduce(...) instead", name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (symbol->scope_level < analyzer->current_function_scope_level) {
+        analyzer->current_function_is_pure = 0;
+        analyzer->current_function_shares_state = 1;
+    }
+
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, expr->data.infix.right);
+    if (!value_type || value_type == analyzer->builtin_types[BUILTIN_UNKNOWN]) {
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (!type_info_is_assignable(value_type, symbol->type)) {
+        char* value_type_str = type_info_to_string(value_type);
+        char* var_type_str = type_info_to_string(symbol->type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Cannot assign value of type %s to variable of type %s", value_type_str, var_type_str);
+        free(value_type_str);
+        free(var_type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    return analyzer->builtin_types[BUILTIN_UNIT];
+}
+
+static int check_reduction(SemanticAnalyzer* analyzer, Statement* stmt, int index) {
+    const char* name = stmt->data.for_stmt.reduce_names[index];
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    for (int i = 0; i < index; i++) {
+        if (strcmp(stmt->data.for_stmt.reduce_names[i], name) == 0) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "'%s' appears more than once in reduce(...)", name);
+            semantic_add_error(analyzer, ERROR_REDEFINITION, error_msg, stmt->line, stmt->column);
+            return 0;
+        }
+    }
+
+    Symbol* symbol = symbol_table_lookup(analyzer, name);
+    if (!symbol) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Undefined variable: %s", name);
+        semantic_add_error(analyzer, ERROR_UNDEFINED_VARIABLE, error_msg, stmt->line, stmt->column);
+        return 0;
+    }
+    if (symbol->kind != SYMBOL_VARIABLE || !symbol->is_mutable) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "reduction variable '%s' must be declared with let mut", name);
+        semantic_add_error(analyzer, ERROR_IMMUTABLE_ASSIGNMENT, error_msg, stmt->line, stmt->column);
+        return 0;
+    }
+    if (!is_numeric_type(symbol->type)) {
+        char* type_str = type_info_to_string(symbol->type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "reduction variable '%s' must be int or float, got %s", name, type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, stmt->line, stmt->column);
+        return 0;
+    }
+    if (symbol->borrow_state != BORROW_STATE_NONE) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot reduce into '%s' because it is borrowed", name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, stmt->line, stmt->column);
+        return 0;
+    }
+    // A nested par for may only reduce into its own chunk's variables or
+    // into a reduction variable of the enclosing loop.
+    if (is_shared_with_chunks(analyzer, symbol) && !is_reduction_variable(analyzer, name)) {
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                 "cannot reduce into '%s', which the enclosing par for shares between chunks", name);
+        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, stmt->line, stmt->column);
+        return 0;
+    }
+    if (symbol->scope_level < analyzer->current_function_scope_level) {
+        analyzer->current_function_is_pure = 0;
+        analyzer->current_function_shares_state = 1;
+    }
+    return 1;
+}
+
+// `for x in s` pulls from a sequence until it is exhausted. It cannot be a
+// par for, and inside a par for body it cannot drain a sequence that every
+// chunk shares.
+static TypeInfo* analyze_sequence_loop(SemanticAnalyzer* analyzer, Statement* stmt) {
+    Expression* source = stmt->data.for_stmt.start;
+    TypeInfo* source_type = semantic_analyze_expression(analyzer, source);
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (!is_sequence_type(source_type) || is_unknown_type(source_type->pointed_to)) {
+        char* type_str = type_info_to_string(source_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "for loop needs an int..int range or a sequence, got %s", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, stmt->line, stmt->column);
+        return NULL;
+    }
+    if (stmt->data.for_stmt.is_parallel) {
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "par for needs an int..int range, not a sequence",
+                           stmt->line, stmt->column);
+        return NULL;
+    }
+    if (source->node_type == EXPR_IDENTIFIER) {
+        Symbol* symbol = symbol_table_lookup(analyzer, source->data.identifier.value);
+        if (symbol && is_shared_with_chunks(analyzer, symbol)) {
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                     "cannot iterate '%s' inside a par for body: every chunk would pull from the same sequence",
+                     symbol->name);
+            semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, source->line, source->column);
+            return NULL;
+        }
+    }
+    // Pulling an item runs the generator or pipeline behind the sequence.
+    analyzer->current_function_is_pure = 0;
+    return source_type->pointed_to;
+}
+
+// Looks for `array[index]` in a loop body over `for index in k..len(array)`.
+// Those accesses are in bounds for as long as `array` names the same array:
+// arrays never shrink, and neither name can be shadowed in the body. An
+// immutable array is never rebound. A mutable one could be, by an
+// assignment in the body or by code the body runs that captured it, so
+// then the body may only call builtins and must not suspend.
+typedef struct BoundsScan {
+    SemanticAnalyzer* analyzer;
+    const char* array;
+    const char* index;
+    int array_mutable;
+    int in_bounds;
+    Expression** accesses;
+    int access_count;
+    int access_capacity;
+} BoundsScan;
+
+static void scan_bounds_statement(BoundsScan* scan, Statement* stmt);
+
+static int names_either(BoundsScan* scan, const char* name) {
+    return strcmp(name, scan->array) == 0 || strcmp(name, scan->index) == 0;
+}
+
+static void scan_bounds_expression(BoundsScan* scan, Expression* expr) {
+    if (!expr || !scan->in_bounds) return;
+
+    switch (expr->node_type) {
         case EXPR_FUNCTION_LITERAL:
+            scan->in_bounds = 0;
+            break;
+        case EXPR_CALL:
+            if (scan->array_mutable && !is_builtin_call(scan->analyzer, expr->data.call.function)) {
+                scan->in_bounds = 0;
+            }
+            scan_bounds_expression(scan, expr->data.call.function);
+            for (int i = 0; i < expr->data.call.argument_count; i++) {
+                scan_bounds_expression(scan, expr->data.call.arguments[i]);
+            }
+            break;
+        case EXPR_INFIX:
+            if (strcmp(expr->data.infix.operator, "=") == 0 &&
+                expr->data.infix.left->node_type == EXPR_IDENTIFIER &&
+                strcmp(expr->data.infix.left->data.identifier.value, scan->array) == 0) {
+                scan->in_bounds = 0;
+            }
+            scan_bounds_expression(scan, expr->data.infix.left);
+            scan_bounds_expression(scan, expr->data.infix.right);
+            break;
+        case EXPR_PREFIX:
+            if (scan->array_mutable &&
+                (strcmp(expr->data.prefix.operator, "spawn") == 0 || strcmp(expr->data.prefix.operator, "await") == 0)) {
+                scan->in_bounds = 0;
+            }
+            scan_bounds_expression(scan, expr->data.prefix.right);
+            break;
+        case EXPR_IF:
+            scan_bounds_expression(scan, expr->data.if_expr.condition);
+            for (int i = 0; i < expr->data.if_expr.then_count; i++) {
+                scan_bounds_statement(scan, expr->data.if_expr.then_branch[i]);
+            }
+            for (int i = 0; i < expr->data.if_expr.else_count; i++) {
+                scan_bounds_statement(scan, expr->data.if_expr.else_branch[i]);
+            }
+            break;
+        case EXPR_MATCH:
+            scan_bounds_expression(scan, expr->data.match.expression);
+            for (int i = 0; i < expr->data.match.case_count; i++) {
+                scan_bounds_expression(scan, expr->data.match.cases[i]->result);
+            }
+            break;
+        case EXPR_PIPE:
+            if (scan->array_mutable) scan->in_bounds = 0;
+            scan_bounds_expression(scan, expr->data.pipe.left);
+            scan_bounds_expression(scan, expr->data.pipe.right);
+            break;
+        case EXPR_ARRAY_LITERAL:
+            for (int i = 0; i < expr->data.array_literal.element_count; i++) {
+                scan_bounds_expression(scan, expr->data.array_literal.elements[i]);
+            }
+            break;
+        case EXPR_MAP_LITERAL:
+            for (int i = 0; i < expr->data.map_literal.entry_count; i++) {
+                scan_bounds_expression(scan, expr->data.map_literal.entries[i]);
+            }
+            break;
+        case EXPR_INDEX:
+            {
+                Expression* array = expr->data.index.array;
+                Expression* index = expr->data.index.index;
+                if (array->node_type == EXPR_IDENTIFIER && strcmp(array->data.identifier.value, scan->array) == 0 &&
+                    index->node_type == EXPR_IDENTIFIER && strcmp(index->data.identifier.value, scan->index) == 0) {
+                    if (scan->access_count >= scan->access_capacity) {
+                        scan->access_capacity = scan->access_capacity ? scan->access_capacity * 2 : 8;
+                        scan->accesses = realloc(scan->accesses, sizeof(Expression*) * scan->access_capacity);
+                    }
+                    scan->accesses[scan->access_count++] = expr;
+                }
+                scan_bounds_expression(scan, array);
+                scan_bounds_expression(scan, index);
+            }
+            break;
+        case EXPR_FIELD:
+            scan_bounds_expression(scan, expr->data.field.object);
+            break;
+        default:
+            break;
+    }
+}
+
+static void scan_bounds_statement(BoundsScan* scan, Statement* stmt) {
+    if (!stmt || !scan->in_bounds) return;
+
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            if (names_either(scan, stmt->data.let_stmt.name)) scan->in_bounds = 0;
+            scan_bounds_expression(scan, stmt->data.let_stmt.value);
+            break;
+        case STMT_RETURN:
+            scan_bounds_expression(scan, stmt->data.return_stmt.return_value);
+            break;
+        case STMT_EXPRESSION:
+            scan_bounds_expression(scan, stmt->data.expression_stmt.expression);
+            break;
+        case STMT_YIELD:
+            if (scan->array_mutable) scan->in_bounds = 0;
+            scan_bounds_expression(scan, stmt->data.yield_stmt.value);
+            break;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->data.block_stmt.statement_count; i++) {
+                scan_bounds_statement(scan, stmt->data.block_stmt.statements[i]);
+            }
+            break;
+        case STMT_WHILE:
+            scan_bounds_expression(scan, stmt->data.while_stmt.condition);
+            scan_bounds_statement(scan, stmt->data.while_stmt.body);
+            break;
+        case STMT_FOR:
+            if (names_either(scan, stmt->data.for_stmt.variable)) scan->in_bounds = 0;
+            // Pulling from a sequence runs a generator or pipeline stage.
+            if (scan->array_mutable && !stmt->data.for_stmt.end) scan->in_bounds = 0;
+            scan_bounds_expression(scan, stmt->data.for_stmt.start);
+            scan_bounds_expression(scan, stmt->data.for_stmt.end);
+            scan_bounds_statement(scan, stmt->data.for_stmt.body);
+            break;
+        default:
+            break;
+    }
+}
+
+// Marks the accesses `a[i]` of `for i in k..len(a)` as unchecked when k is
+// a non-negative literal and the scan above finds `a` cannot be rebound.
+static void hoist_bounds_checks(SemanticAnalyzer* analyzer, Statement* stmt) {
+    Expression* start = stmt->data.for_stmt.start;
+    Expression* end = stmt->data.for_stmt.end;
+
+    if (!end || start->node_type != EXPR_INTEGER_LITERAL || start->data.integer_literal.value < 0) return;
+    if (end->node_type != EXPR_CALL || end->data.call.argument_count != 1 ||
+        !is_builtin_call(analyzer, end->data.call.function) ||
+        strcmp(end->data.call.function->data.identifier.value, "len") != 0 ||
+        end->data.call.arguments[0]->node_type != EXPR_IDENTIFIER) {
+        return;
+    }
+
+    Symbol* symbol = symbol_table_lookup(analyzer, end->data.call.arguments[0]->data.identifier.value);
+    if (!symbol || !is_array_type(symbol->type)) return;
+
+    BoundsScan scan = {0};
+    scan.analyzer = analyzer;
+    scan.array = symbol->name;
+    scan.index = stmt->data.for_stmt.variable;
+    scan.array_mutable = symbol->is_mutable;
+    scan.in_bounds = strcmp(scan.array, scan.index) != 0;
+    scan_bounds_statement(&scan, stmt->data.for_stmt.body);
+
+    for (int i = 0; scan.in_bounds && i < scan.access_count; i++) {
+        scan.accesses[i]->data.index.unchecked = 1;
+    }
+    free(scan.accesses);
+}
+
+// The loop variable is an immutable int (or the sequence's element type) in
+// a scope of its own around the body. Bounds are evaluated once, before the
+// first iteration.
+static int analyze_for_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
+    TypeInfo* variable_type;
+    if (stmt->data.for_stmt.end) {
+        TypeInfo* start_type = semantic_analyze_expression(analyzer, stmt->data.for_stmt.start);
+        TypeInfo* end_type = semantic_analyze_expression(analyzer, stmt->data.for_stmt.end);
+        if (!is_int_type(start_type) || !is_int_type(end_type)) {
+            char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+            char* start_str = type_info_to_string(start_type);
+            char* end_str = type_info_to_string(end_type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "for loop range must be int..int, got %s..%s", start_str, end_str);
+            free(start_str);
+            free(end_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, stmt->line, stmt->column);
+            return 0;
+        }
+        variable_type = type_info_new_builtin(BUILTIN_INT);
+    } else {
+        variable_type = analyze_sequence_loop(analyzer, stmt);
+        if (!variable_type) return 0;
+    }
+
+    for (int i = 0; i < stmt->data.for_stmt.reduce_count; i++) {
+        if (!check_reduction(analyzer, stmt, i)) return 0;
+    }
+
+    int old_parallel_scope_level = analyzer->parallel_scope_level;
+    Statement* old_parallel_loop = analyzer->parallel_loop;
+
+    semantic_push_scope(analyzer);
+    Symbol* variable = symbol_new(stmt->data.for_stmt.variable, SYMBOL_VARIABLE, variable_type);
+    variable->is_const = 1;
+    variable->is_mutable = 0;
+    variable->is_initialized = 1;
+    variable->lifetime_id = analyzer->current_scope->lifetime_id;
+    symbol_table_add(analyzer, variable);
+
+    if (stmt->data.for_stmt.is_parallel) {
+        analyzer->parallel_scope_level = analyzer->current_scope_level;
+        analyzer->parallel_loop = stmt;
+    }
+
+    int ok = semantic_analyze_statement(analyzer, stmt->data.for_stmt.body);
+
+    analyzer->parallel_scope_level = old_parallel_scope_level;
+    analyzer->parallel_loop = old_parallel_loop;
+    semantic_pop_scope(analyzer);
+
+    if (ok) hoist_bounds_checks(analyzer, stmt);
+    return ok;
+}
+
+static int analyze_yield_statement(SemanticAnalyzer* analyzer, Statement* stmt) {
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (!analyzer->current_yield_type) {
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "yield is only allowed inside a generator function",
+                           stmt->line, stmt->column);
+        return 0;
+    }
+    if (analyzer->parallel_scope_level > analyzer->current_function_scope_level) {
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "cannot yield from inside a par for body",
+                           stmt->line, stmt->column);
+        return 0;
+    }
+    if (!analyzer->yield_allowed) {
+        semantic_add_error(analyzer, ERROR_INVALID_OPERATION,
+                           "yield must be a statement of the generator body, its loops or an if statement",
+                           stmt->line, stmt->column);
+        return 0;
+    }
+
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, stmt->data.yield_stmt.value);
+    if (!value_type) return 0;
+    if (!type_info_is_assignable(value_type, analyzer->current_yield_type)) {
+        char* value_type_str = type_info_to_string(value_type);
+        char* yield_type_str = type_info_to_string(analyzer->current_yield_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot yield %s from a generator of seq<%s>",
+                 value_type_str, yield_type_str);
+        free(value_type_str);
+        free(yield_type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, stmt->line, stmt->column);
+        return 0;
+    }
+    return 1;
+}
+
+// `[a, b, ...]` holds ints or floats, all of one type; `[]` gets its
+// element type from the variable or parameter it is bound to.
+static TypeInfo* analyze_array_literal(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression** elements = expr->data.array_literal.elements;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (expr->data.array_literal.element_count == 0) {
+        return type_info_new_array(analyzer->builtin_types[BUILTIN_UNKNOWN]);
+    }
+
+    TypeInfo* element_type = semantic_analyze_expression(analyzer, elements[0]);
+    if (!is_numeric_type(element_type)) {
+        char* type_str = type_info_to_string(element_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "arrays hold int or float elements, not %s", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, elements[0]->line, elements[0]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    for (int i = 1; i < expr->data.array_literal.element_count; i++) {
+        TypeInfo* type = semantic_analyze_expression(analyzer, elements[i]);
+        if (!type_info_equals(type, element_type)) {
+            char* type_str = type_info_to_string(type);
+            char* element_str = type_info_to_string(element_type);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "array elements must all be %s, got %s", element_str, type_str);
+            free(type_str);
+            free(element_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, elements[i]->line, elements[i]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    return type_info_new_array(element_type);
+}
+
+// `{k: v, ...}` has int or string keys and values of any one type; `{}`
+// gets both from the variable or parameter it is bound to. An empty `[]`
+// or `{}` value takes its type from the other values.
+static TypeInfo* analyze_map_literal(SemanticAnalyzer* analyzer, Expression* expr) {
+    Expression** entries = expr->data.map_literal.entries;
+    int entry_count = expr->data.map_literal.entry_count;
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (entry_count == 0) {
+        return type_info_new_map(analyzer->builtin_types[BUILTIN_UNKNOWN], analyzer->builtin_types[BUILTIN_UNKNOWN]);
+    }
+
+    TypeInfo* key_type = semantic_analyze_expression(analyzer, entries[0]);
+    if (!is_map_key_type(key_type)) {
+        char* type_str = type_info_to_string(key_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "map keys must be int or string, not %s", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, entries[0]->line, entries[0]->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    TypeInfo* value_type = semantic_analyze_expression(analyzer, entries[1]);
+    if (is_unknown_type(value_type)) return analyzer->builtin_types[BUILTIN_UNKNOWN];
+
+    for (int i = 2; i < entry_count; i++) {
+        TypeInfo* expected = i % 2 == 0 ? key_type : value_type;
+        TypeInfo* type = semantic_analyze_expression(analyzer, entries[i]);
+        if (i % 2 == 1 && !type_info_is_assignable(type, value_type) && type_info_is_assignable(value_type, type)) {
+            value_type = type;
+            continue;
+        }
+        if (i % 2 == 0 ? !type_info_equals(type, expected) : !type_info_is_assignable(type, expected)) {
+            char* type_str = type_info_to_string(type);
+            char* expected_str = type_info_to_string(expected);
+            snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "map %s must all be %s, got %s",
+                     i % 2 == 0 ? "keys" : "values", expected_str, type_str);
+            free(type_str);
+            free(expected_str);
+            semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, entries[i]->line, entries[i]->column);
+            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+        }
+    }
+
+    return type_info_new_map(key_type, value_type);
+}
+
+static TypeInfo* analyze_index(SemanticAnalyzer* analyzer, Expression* expr) {
+    // Set again by hoist_bounds_checks once the enclosing loop is checked.
+    expr->data.index.unchecked = 0;
+
+    TypeInfo* array_type = semantic_analyze_expression(analyzer, expr->data.index.array);
+    TypeInfo* index_type = semantic_analyze_expression(analyzer, expr->data.index.index);
+    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+
+    if (!is_array_type(array_type) || is_unknown_type(array_type->pointed_to)) {
+        char* type_str = type_info_to_string(array_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "cannot index %s; only arrays with a known element type can be indexed", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->line, expr->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+    if (!is_int_type(index_type)) {
+        char* type_str = type_info_to_string(index_type);
+        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "array index must be an int, got %s", type_str);
+        free(type_str);
+        semantic_add_error(analyzer, ERROR_TYPE_MISMATCH, error_msg, expr->data.index.index->line, expr->data.index.index->column);
+        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+    }
+
+    return array_type->pointed_to;
+}
+
+TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* expr) {
+    // Only an if that is itself a statement may yield from its branches;
+    // anywhere else the generator could not be suspended mid-expression.
+    int old_yield_allowed = analyzer->yield_allowed;
+    if (!expr || expr->node_type != EXPR_IF || expr != analyzer->statement_expression) {
+        analyzer->yield_allowed = 0;
+    }
+    analyzer->statement_expression = NULL;
+
+    TypeInfo* type = analyze_expression(analyzer, expr);
+    analyzer->yield_allowed = old_yield_allowed;
+    if (expr) {
+        expr->resolved_type = type;
+    }
+    return type;
+}
+
+static TypeInfo* analyze_expression(SemanticAnalyzer* analyzer, Expression* expr) {
+    if (!analyzer || !expr) return NULL;
+    
+    switch (expr->node_type) {
+        case EXPR_IDENTIFIER:
             {
-                TypeInfo** param_types = malloc(sizeof(TypeInfo*) * expr->data.function_literal.parameter_count);
-                
-                semantic_push_scope(analyzer);
-                
-                for (int i = 0; i < expr->data.function_literal.parameter_count; i++) {
-                    Parameter* param = expr->data.function_literal.parameters[i];
-                    TypeInfo* param_type = convert_ast_type_to_type_info(analyzer, param->type);
-                    param_types[i] = param_type;
-                    
-                    Symbol* param_symbol = symbol_new(param->name, SYMBOL_PARAMETER, param_type);
-                    param_symbol->is_initialized = 1;
-                    symbol_table_add(analyzer, param_symbol);
+                Symbol* symbol = symbol_table_lookup(analyzer, expr->data.identifier.value);
+                if (!symbol) {
+                    char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+                    snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH, "Undefined variable: %s", expr->data.identifier.value);
+                    semantic_add_error(analyzer, ERROR_UNDEFINED_VARIABLE, error_msg, 0, 0);
+                    return analyzer->builtin_types[BUILTIN_UNKNOWN];
                 }
-                
-                TypeInfo* return_type = analyzer->builtin_types[BUILTIN_UNIT];
-                if (expr->data.function_literal.return_type) {
-                    return_type = convert_ast_type_to_type_info(analyzer, expr->data.function_literal.return_type);
+
+                if (!symbol->is_initialized) {
+                    char error_msg[256];
+                    snprintf(error_msg, sizeof(error_msg), "use of uninitialized variable '%s'", symbol->name);
+                    semantic_add_error(analyzer, ERROR_UNINITIALIZED_VARIABLE, error_msg, 0, 0);
+                    return analyzer->builtin_types[BUILTIN_UNKNOWN];
                 }
-                
-                TypeInfo* old_return_type = analyzer->current_function_return_type;
-                analyzer->current_function_return_type = return_type;
-                
-                for (int i = 0; i < expr->data.function_literal.body_count; i++) {
-                    if (!semantic_analyze_statement(analyzer, expr->data.function_literal.body[i])) {
-                        semantic_pop_scope(analyzer);
-                        analyzer->current_function_return_type = old_return_type;
-                        return analyzer->builtin_types[BUILTIN_UNKNOWN];
-                    }
+            
+                symbol->is_used = 1;
+                if (symbol->kind == SYMBOL_TYPE) {
+                    return struct_constructor_type(symbol->type);
                 }
-                
-                analyzer->current_function_return_type = old_return_type;
-                semantic_pop_scope(analyzer);
-                
-                return type_info_new_function(param_types, expr->data.function_literal.parameter_count, return_type);
+                if (symbol->is_mutable && symbol->scope_level < analyzer->current_function_scope_level) {
+                    analyzer->current_function_is_pure = 0;
+                    if (container_kind(symbol->type)) analyzer->current_function_shares_state = 1;
+                }
+                return symbol->type;
             }
             
+        case EXPR_INTEGER_LITERAL:
+            return type_info_new_builtin(BUILTIN_INT);
+            
+        case EXPR_FLOAT_LITERAL:
+            return type_info_new_builtin(BUILTIN_FLOAT);
+            
+        case EXPR_STRING_LITERAL:
+            return type_info_new_builtin(BUILTIN_STRING);
+            
+        case EXPR_BOOLEAN_LITERAL:
+            return type_info_new_builtin(BUILTIN_BOOL);
+            
+        case EXPR_FUNCTION_LITERAL:
+            return analyze_function_literal(analyzer, expr);
+            
         case EXPR_CALL:
             {
+                if (is_builtin_call(analyzer, expr->data.call.function)) {
+                    return analyze_builtin_call(analyzer, expr);
+                }
+                if (!is_pure_callee(analyzer, expr->data.call.function)) {
+                    analyzer->current_function_is_pure = 0;
+                }
+                if (analyzer->parallel_scope_level > 0 && !check_parallel_call(analyzer, expr)) {
+                    return analyzer->builtin_types[BUILTIN_UNKNOWN];
+                }
+
                 TypeInfo* function_type = semantic_analyze_expression(analyzer, expr->data.call.function);
+                note_callee_sharing(analyzer, expr->data.call.function);
                 if (!function_type || function_type->category != TYPECAT_FUNCTION) {
                     semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "Cannot call non-function", 0, 0);
                     return analyzer->builtin_types[BUILTIN_UNKNOWN];
@@ -736,6 +2911,10 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
             
         case EXPR_INFIX:
             {
+                if (strcmp(expr->data.infix.operator, "=") == 0) {
+                    return analyze_assignment(analyzer, expr);
+                }
+
                 TypeInfo* left_type = semantic_analyze_expression(analyzer, expr->data.infix.left);
                 TypeInfo* right_type = semantic_analyze_expression(analyzer, expr->data.infix.right);
                 
@@ -761,10 +2940,20 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
             }
             
         case EXPR_PREFIX:
+            if (strcmp(expr->data.prefix.operator, "spawn") == 0) {
+                return analyze_spawn(analyzer, expr);
+            }
+            if (strcmp(expr->data.prefix.operator, "await") == 0) {
+                return analyze_await(analyzer, expr);
+            }
             {
                 int is_mutable_borrow = (strcmp(expr->data.prefix.operator, "&mut") == 0);
                 int is_ref_op = is_mutable_borrow || (strcmp(expr->data.prefix.operator, "&") == 0);
 
+                if (is_mutable_borrow) {
+                    analyzer->current_function_is_pure = 0;
+                }
+
                 if (is_ref_op) {
                     if (expr->data.prefix.right->node_type != EXPR_IDENTIFIER) {
                         semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "reference operator can only be used on variables", 0, 0);
@@ -777,6 +2966,17 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
                         return analyzer->builtin_types[BUILTIN_UNKNOWN];
                     }
 
+                    if (is_mutable_borrow && is_captured_mutable(analyzer, symbol)) {
+                        analyzer->current_function_shares_state = 1;
+                    }
+                    if (is_mutable_borrow && is_shared_with_chunks(analyzer, symbol)) {
+                        char error_msg[MAX_ERROR_MESSAGE_LENGTH];
+                        snprintf(error_msg, MAX_ERROR_MESSAGE_LENGTH,
+                                 "cannot borrow '%s' as mutable inside a par for body", var_name);
+                        semantic_add_error(analyzer, ERROR_MEMORY_SAFETY, error_msg, expr->line, expr->column);
+                        return analyzer->builtin_types[BUILTIN_UNKNOWN];
+                    }
+
                     if (!check_borrowing_rules(analyzer, symbol, is_mutable_borrow, 0, 0)) {
                         return analyzer->builtin_types[BUILTIN_UNKNOWN];
                     }
@@ -846,8 +3046,7 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
                     
                     if (i == expr->data.if_expr.then_count - 1 &&
                         expr->data.if_expr.then_branch[i]->node_type == STMT_EXPRESSION) {
-                        then_type = semantic_analyze_expression(analyzer, 
-                            expr->data.if_expr.then_branch[i]->data.expression_stmt.expression);
+                        then_type = expr->data.if_expr.then_branch[i]->data.expression_stmt.expression->resolved_type;
                     }
                 }
                 semantic_pop_scope(analyzer);
@@ -864,8 +3063,7 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
                         
                         if (i == expr->data.if_expr.else_count - 1 &&
                             expr->data.if_expr.else_branch[i]->node_type == STMT_EXPRESSION) {
-                            else_type = semantic_analyze_expression(analyzer,
-                                expr->data.if_expr.else_branch[i]->data.expression_stmt.expression);
+                            else_type = expr->data.if_expr.else_branch[i]->data.expression_stmt.expression->resolved_type;
                         }
                     }
                     semantic_pop_scope(analyzer);
@@ -887,14 +3085,41 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
                 return then_type;
             }
             
+        case EXPR_ARRAY_LITERAL:
+            return analyze_array_literal(analyzer, expr);
+
+        case EXPR_MAP_LITERAL:
+            return analyze_map_literal(analyzer, expr);
+
+        case EXPR_INDEX:
+            return analyze_index(analyzer, expr);
+
+        case EXPR_FIELD:
+            return analyze_field(analyzer, expr);
+
         case EXPR_PIPE:
             {
+                const char* kernel = piped_array_kernel(analyzer, expr->data.pipe.right);
+                if (kernel) {
+                    return analyze_piped_array_kernel(analyzer, expr, kernel);
+                }
+                if (!is_pure_callee(analyzer, expr->data.pipe.right)) {
+                    analyzer->current_function_is_pure = 0;
+                }
+
                 TypeInfo* left_type = semantic_analyze_expression(analyzer, expr->data.pipe.left);
                 if (!left_type) {
                     return analyzer->builtin_types[BUILTIN_UNKNOWN];
                 }
+
+                Expression* stage = expr->data.pipe.right;
+                if (stage->node_type == EXPR_CALL && is_builtin_call(analyzer, stage->data.call.function)) {
+                    stage->resolved_type = analyze_pipe_stage(analyzer, stage, left_type);
+                    return stage->resolved_type;
+                }
                 
                 TypeInfo* right_type = semantic_analyze_expression(analyzer, expr->data.pipe.right);
+                note_callee_sharing(analyzer, expr->data.pipe.right);
                 if (!right_type || right_type->category != TYPECAT_FUNCTION) {
                     semantic_add_error(analyzer, ERROR_INVALID_OPERATION,
                                      "Right side of pipe must be a function", 0, 0);
@@ -924,8 +3149,7 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
             }
             
         case EXPR_MATCH:
-            semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "Match expressions not yet implemented", 0, 0);
-            return analyzer->builtin_types[BUILTIN_UNKNOWN];
+            return analyze_match(analyzer, expr);
             
         default:
             semantic_add_error(analyzer, ERROR_INVALID_OPERATION, "Unknown expression type", 0, 0);
@@ -933,7 +3157,19 @@ TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* ex
     }
 }
 
+static void track_borrow(SemanticAnalyzer* analyzer, Symbol* symbol) {
+    if (symbol->borrow_state != BORROW_STATE_NONE) return;
+
+    if (analyzer->borrowed_count >= analyzer->borrowed_capacity) {
+        analyzer->borrowed_capacity = analyzer->borrowed_capacity ? analyzer->borrowed_capacity * 2 : 16;
+        analyzer->borrowed_symbols = realloc(analyzer->borrowed_symbols, sizeof(Symbol*) * analyzer->borrowed_capacity);
+    }
+    analyzer->borrowed_symbols[analyzer->borrowed_count++] = symbol;
+}
+
 int check_borrowing_rules(SemanticAnalyzer* analyzer, Symbol* symbol, int is_mutable_borrow, int line, int col) {
+    track_borrow(analyzer, symbol);
+
     if (is_mutable_borrow) {
         if (symbol->borrow_state != BORROW_STATE_NONE) {
             char msg[MAX_ERROR_MESSAGE_LENGTH];
@@ -963,29 +3199,29 @@ int check_borrowing_rules(SemanticAnalyzer* analyzer, Symbol* symbol, int is_mut
     return 1;
 }
 
+// Only symbols in borrowed_symbols can hold a borrow, so this no longer
+// walks every symbol of every enclosing scope on each pop.
 void release_borrows_in_scope(SemanticAnalyzer* analyzer, Scope* dying_scope) {
-    Scope* scope_to_check = analyzer->current_scope;
-    
-    while (scope_to_check != NULL) {
-        for (int i = 0; i < scope_to_check->table_size; i++) {
-            Symbol* symbol = scope_to_check->symbols[i];
-            while (symbol) {
-                if (symbol->borrow_lifetime_id == dying_scope->lifetime_id) {
-                    if (symbol->borrow_state == BORROW_STATE_MUTABLE) {
-                        symbol->borrow_state = BORROW_STATE_NONE;
-                    } else if (symbol->borrow_state == BORROW_STATE_SHARED) {
-                        symbol->shared_borrow_count--;
-                        if (symbol->shared_borrow_count == 0) {
-                            symbol->borrow_state = BORROW_STATE_NONE;
-                        }
-                    }
-                    symbol->borrow_lifetime_id = 0;
+    int kept = 0;
+
+    for (int i = 0; i < analyzer->borrowed_count; i++) {
+        Symbol* symbol = analyzer->borrowed_symbols[i];
+        if (symbol->borrow_lifetime_id == dying_scope->lifetime_id) {
+            if (symbol->borrow_state == BORROW_STATE_MUTABLE) {
+                symbol->borrow_state = BORROW_STATE_NONE;
+            } else if (symbol->borrow_state == BORROW_STATE_SHARED) {
+                symbol->shared_borrow_count--;
+                if (symbol->shared_borrow_count == 0) {
+                    symbol->borrow_state = BORROW_STATE_NONE;
                 }
-                symbol = symbol->next;
             }
+            symbol->borrow_lifetime_id = 0;
+        }
+        if (symbol->borrow_state != BORROW_STATE_NONE) {
+            analyzer->borrowed_symbols[kept++] = symbol;
         }
-        scope_to_check = scope_to_check->parent;
     }
+    analyzer->borrowed_count = kept;
 }
 
 int check_lifetime_safety(SemanticAnalyzer* analyzer, Expression* expr) {
@@ -996,4 +3232,234 @@ int check_lifetime_safety(SemanticAnalyzer* analyzer, Expression* expr) {
 int check_borrow_safety(SemanticAnalyzer* analyzer, Expression* expr) {
     (void)analyzer; (void)expr;
     return 1;
-}
\ No newline at end of file
+}
+// --- Parallel analysis ---
+
+typedef struct ParallelAnalysis {
+    SemanticAnalyzer** workers;
+    FunctionTask* tasks;
+    HunickVM* vm;  // whose heap the workers' types come from
+} ParallelAnalysis;
+
+typedef struct OrderedError {
+    SemanticError* error;
+    int sequence;
+} OrderedError;
+
+static Scope* scope_copy(Scope* scope) {
+    Scope* copy = scope_new(scope->scope_level, scope->lifetime_id);
+
+    for (int i = 0; i < scope->table_size; i++) {
+        Symbol** tail = &copy->symbols[i];
+        for (Symbol* symbol = scope->symbols[i]; symbol; symbol = symbol->next) {
+            Symbol* clone = malloc(sizeof(Symbol));
+            *clone = *symbol;
+            clone->name = string_duplicate(symbol->name);
+            clone->next = NULL;
+            *tail = clone;
+            tail = &clone->next;
+        }
+    }
+    copy->symbol_count = scope->symbol_count;
+
+    return copy;
+}
+
+// A worker gets its own copy of the global symbols (borrow state and use
+// flags are per-symbol) but shares the builtin types, which expressions
+// keep pointing to after the worker is freed.
+static SemanticAnalyzer* semantic_worker_new(SemanticAnalyzer* analyzer) {
+    SemanticAnalyzer* worker = semantic_analyzer_new();
+
+    for (int i = 0; i < 8; i++) {
+        worker->builtin_types[i] = analyzer->builtin_types[i];
+    }
+    scope_free(worker->global_scope);
+    worker->global_scope = scope_copy(analyzer->global_scope);
+    worker->current_scope = worker->global_scope;
+    worker->next_lifetime_id = analyzer->next_lifetime_id;
+    worker->memoize_pure_functions = analyzer->memoize_pure_functions;
+    worker->defer_purity = 1;
+
+    return worker;
+}
+
+
+
+static void analyze_function_task(void* context, int index, int worker_index) {
+    ParallelAnalysis* job = context;
+    SemanticAnalyzer* worker = job->workers[worker_index];
+    FunctionTask* task = &job->tasks[index];
+
+    vm_bind(job->vm);
+    worker->global_visibility_limit = task->symbol->declaration_index;
+    worker->error_order = task->statement_index;
+    analyze_function_literal(worker, task->literal);
+
+    task->errors = worker->errors;
+    task->error_count = worker->error_count;
+    worker->errors = NULL;
+    worker->error_count = 0;
+}
+
+static void check_function_tasks(SemanticAnalyzer* analyzer, int thread_count) {
+    if (analyzer->task_count == 0) return;
+
+    int worker_count = thread_count < analyzer->task_count ? thread_count : analyzer->task_count;
+    if (worker_count < 1) worker_count = 1;
+
+    ParallelAnalysis job;
+    job.tasks = analyzer->tasks;
+    job.vm = vm_current();
+    job.workers = malloc(sizeof(SemanticAnalyzer*) * worker_count);
+    for (int i = 0; i < worker_count; i++) {
+        job.workers[i] = semantic_worker_new(analyzer);
+    }
+
+    parallel_for(analyzer->task_count, worker_count, analyze_function_task, &job);
+
+    for (int i = 0; i < worker_count; i++) {
+        SemanticAnalyzer* worker = job.workers[i];
+        for (int j = 0; j < worker->purity_edge_count; j++) {
+            add_purity_edge(analyzer, worker->purity_edges[j].from, worker->purity_edges[j].to);
+        }
+        for (int j = 0; j < worker->checked_literal_count; j++) {
+            add_checked_literal(analyzer, worker->checked_literals[j].literal, worker->checked_literals[j].function_type);
+        }
+        for (int j = 0; j < worker->parallel_call_count; j++) {
+            ParallelCall* call = &worker->parallel_calls[j];
+            add_parallel_call(analyzer, call->call, call->callee, call->order);
+        }
+        for (int j = 0; j < worker->spawn_call_count; j++) {
+            ParallelCall* call = &worker->spawn_calls[j];
+            push_call(&analyzer->spawn_calls, &analyzer->spawn_call_count, &analyzer->spawn_call_capacity,
+                      call->call, call->callee, call->order);
+        }
+        semantic_analyzer_free(worker);
+    }
+    free(job.workers);
+}
+
+// Purity starts from each body's local verdict and is withdrawn from any
+// function that calls an impure one until nothing changes; sharing of
+// mutable state spreads along the same calls. Memoization, par for calls
+// and spawned calls are decided afterwards, once every verdict is final.
+static void resolve_deferred_purity(SemanticAnalyzer* analyzer) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < analyzer->purity_edge_count; i++) {
+            Expression* from = analyzer->purity_edges[i].from;
+            Expression* to = analyzer->purity_edges[i].to;
+            if (from->data.function_literal.is_pure && !to->data.function_literal.is_pure) {
+                from->data.function_literal.is_pure = 0;
+                changed = 1;
+            }
+            if (!from->data.function_literal.shares_mutable_state && to->data.function_literal.shares_mutable_state) {
+                from->data.function_literal.shares_mutable_state = 1;
+                changed = 1;
+            }
+        }
+    }
+
+    Scope* global = analyzer->global_scope;
+    for (int i = 0; i < global->table_size; i++) {
+        for (Symbol* symbol = global->symbols[i]; symbol; symbol = symbol->next) {
+            if (symbol->function_literal) {
+                symbol->is_pure = symbol->function_literal->data.function_literal.is_pure;
+            }
+        }
+    }
+
+    for (int i = 0; i < analyzer->checked_literal_count; i++) {
+        CheckedLiteral* checked = &analyzer->checked_literals[i];
+        check_memoization(analyzer, checked->literal, checked->function_type);
+    }
+
+    int order = analyzer->error_order;
+    for (int i = 0; i < analyzer->parallel_call_count; i++) {
+        ParallelCall* call = &analyzer->parallel_calls[i];
+        if (!call->callee->data.function_literal.is_pure) {
+            analyzer->error_order = call->order;
+            report_parallel_call(analyzer, call->call);
+        }
+    }
+    analyzer->error_order = order;
+    settle_spawn_calls(analyzer, NULL);
+}
+
+static int compare_ordered_errors(const void* a, const void* b) {
+    const OrderedError* x = a;
+    const OrderedError* y = b;
+
+    if (x->error->line != y->error->line) return x->error->line < y->error->line ? -1 : 1;
+    if (x->error->column != y->error->column) return x->error->column < y->error->column ? -1 : 1;
+    if (x->error->order != y->error->order) return x->error->order < y->error->order ? -1 : 1;
+    return x->sequence - y->sequence;
+}
+
+static int collect_errors(OrderedError* out, SemanticError* list, int count) {
+    // Lists are newest first; sequence restores the order they were raised in.
+    int i = count - 1;
+    for (SemanticError* error = list; error; error = error->next) {
+        out[i].error = error;
+        out[i].sequence = i;
+        i--;
+    }
+    return count;
+}
+
+// Errors from the serial pass and every task end up in one list sorted by
+// line, column and statement, which does not depend on thread timing.
+static void merge_errors_by_line(SemanticAnalyzer* analyzer) {
+    int total = analyzer->error_count;
+    for (int i = 0; i < analyzer->task_count; i++) {
+        total += analyzer->tasks[i].error_count;
+    }
+    if (total == 0) return;
+
+    OrderedError* errors = malloc(sizeof(OrderedError) * total);
+    int count = collect_errors(errors, analyzer->errors, analyzer->error_count);
+    for (int i = 0; i < analyzer->task_count; i++) {
+        FunctionTask* task = &analyzer->tasks[i];
+        count += collect_errors(errors + count, task->errors, task->error_count);
+        task->errors = NULL;
+        task->error_count = 0;
+    }
+
+    qsort(errors, total, sizeof(OrderedError), compare_ordered_errors);
+
+    // Same shape as a serial run: the most recent error heads the list.
+    analyzer->errors = NULL;
+    for (int i = 0; i < total; i++) {
+        errors[i].error->next = analyzer->errors;
+        analyzer->errors = errors[i].error;
+    }
+    analyzer->error_count = total;
+    free(errors);
+}
+
+int semantic_analyze_program_parallel(SemanticAnalyzer* analyzer, Program* program, int thread_count) {
+    if (!analyzer || !program) return 0;
+
+    analyzer->defer_function_bodies = 1;
+    analyzer->defer_purity = 1;
+
+    int ok = 1;
+    for (int i = 0; ok && i < program->statement_count; i++) {
+        analyzer->error_order = i;
+        ok = semantic_analyze_statement(analyzer, program->statements[i]);
+    }
+    analyzer->defer_function_bodies = 0;
+
+    // Bodies queued before a failing statement are still checked, as they
+    // would have been by a serial pass.
+    check_function_tasks(analyzer, thread_count);
+
+    analyzer->defer_purity = 0;
+    analyzer->error_order = program->statement_count;
+    resolve_deferred_purity(analyzer);
+    merge_errors_by_line(analyzer);
+
+    return ok && analyzer->error_count == 0;
+}
@@ -0,0 +1,52 @@
+#ifndef AIO_H
+#define AIO_H
+
+#include "scheduler.h"
+#include <stdint.h>
+
+// Non-blocking file I/O and timers behind read_file_async, write_async and
+// sleep. Each call starts the operation and returns a task at once; the
+// task completes when the kernel reports the operation finished, so one
+// thread can keep thousands of them in flight and pick up their results
+// with await.
+//
+// Operations go through an io_uring when the kernel offers one. Otherwise
+// a small thread pool runs the blocking calls and timers become timerfds,
+// with completions gathered by epoll. Either way results are turned into
+// objects by whichever thread reaps them, on its current VM's heap.
+//
+// Each VM has its own reactor; the functions below work on the one of the
+// calling thread's current VM. Nothing is set up before the first
+// operation.
+
+typedef struct AsyncIO AsyncIO;
+
+AsyncIO* aio_new(void);
+
+// Releases the ring or the pool. Outstanding operations must have been
+// drained (scheduler_shutdown does).
+void aio_free(AsyncIO* aio);
+
+// Forces the thread pool fallback. Only has an effect before the first
+// operation.
+void aio_set_uring(int enabled);
+
+// The task resolves to the file's contents, or "" if it cannot be read.
+Task* aio_read_file(const char* path);
+
+// Replaces the file's contents with data. The task resolves to the number
+// of bytes written, or -1 on failure.
+Task* aio_write_file(const char* path, const char* data);
+
+// The task resolves to unit after about `milliseconds`.
+Task* aio_sleep(int64_t milliseconds);
+
+// Completes every operation that has finished, first waiting up to
+// timeout_ms for one if none has. Returns how many completed; returns 0
+// at once when nothing is in flight.
+int aio_poll(int timeout_ms);
+
+// Polls until no operation is in flight.
+void aio_drain(void);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include "object.h"
+#include <stdint.h>
+
+// Growable contiguous buffer behind `[int]` and `[float]`. Elements are
+// stored unboxed, so an element is one load away and a whole array can be
+// handed to a C loop as a plain int64_t* or double*. Buffers come from the
+// current VM's heap; push doubles the capacity when the array is full and
+// leaves the old buffer to the heap, so pushes cost amortized O(1).
+//
+// Arrays never shrink, which the analyzer relies on when it drops bounds
+// checks. Arrays take no lock: chunks of a par for may store to distinct
+// elements of one array, but push must not race with other accesses.
+
+typedef enum {
+    ARRAY_UNTYPED,  // `[]` before its first push
+    ARRAY_INT,
+    ARRAY_FLOAT
+} ArrayKind;
+
+typedef struct Array {
+    ArrayKind kind;
+    int64_t length;
+    int64_t capacity;
+    union {
+        int64_t* ints;
+        double* floats;
+    } data;
+} Array;
+
+Array* array_new(ArrayKind kind, int64_t capacity);
+Array* array_copy(const Array* array);
+
+// The element at index, or null if index is out of range.
+Object* array_get(const Array* array, int64_t index);
+
+// Stores value at index; does nothing if index is out of range.
+void array_set(Array* array, int64_t index, Object* value);
+
+// Appends value. An untyped array takes its kind from the first value.
+void array_push(Array* array, Object* value);
+
+// Element access without the range test, for accesses the analyzer has
+// proven in bounds.
+static inline Object* array_load(const Array* array, int64_t index) {
+    return array->kind == ARRAY_FLOAT ? object_new_float(array->data.floats[index])
+                                      : object_new_integer(array->data.ints[index]);
+}
+
+static inline void array_store(Array* array, int64_t index, Object* value) {
+    if (array->kind == ARRAY_FLOAT) {
+        array->data.floats[index] = value->type == OBJ_FLOAT ? value->value.float_val : (double)value->value.integer;
+    } else {
+        array->data.ints[index] = value->value.integer;
+    }
+}
+
+#endif
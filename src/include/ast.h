@@ -2,10 +2,12 @@
 #define AST_H
 
 #include "tokens.h"
+#include "str.h"
 
 typedef struct Expression Expression;
 typedef struct Statement Statement;
 typedef struct Program Program;
+struct TypeInfo;
 
 typedef enum {
     EXPR_IDENTIFIER,
@@ -31,7 +33,17 @@ typedef enum {
 
     TYPE_IDENTIFIER,
     TYPE_FUNCTION,
-    TYPE_STRUCT
+    TYPE_STRUCT,
+    TYPE_GENERIC,
+
+    STMT_YIELD,
+
+    EXPR_ARRAY_LITERAL,
+    EXPR_INDEX,
+    EXPR_MAP_LITERAL,
+
+    STMT_TYPE,
+    EXPR_FIELD
 } NodeType;
 
 typedef struct Type {
@@ -52,6 +64,13 @@ typedef struct Type {
             struct Type** field_types;
             int field_count;
         } struct_type;
+
+        // `name<arguments>`, e.g. chan<int>
+        struct {
+            char* name;
+            struct Type** arguments;
+            int argument_count;
+        } generic;
     } data;
 } Type;
 
@@ -64,6 +83,7 @@ typedef struct Expression {
     NodeType node_type;
     int line;
     int column;
+    struct TypeInfo* resolved_type;
     union {
         struct {
             char* value;
@@ -79,6 +99,7 @@ typedef struct Expression {
 
         struct {
             char* value;
+            StringLiteral literal;  // value, pooled
         } string_literal;
 
         struct {
@@ -91,6 +112,11 @@ typedef struct Expression {
             Type* return_type;
             struct Statement** body;
             int body_count;
+            char* name;
+            int is_pure;
+            int is_memo;
+            int is_generator;   // its body contains a yield
+            int shares_mutable_state;  // set by the analyzer; see analyze_spawn
         } function_literal;
 
         struct {
@@ -118,16 +144,49 @@ typedef struct Expression {
             int else_count;
         } if_expr;
 
+        // `match (subject) { pattern -> result, ... }`. The table, built
+        // from the patterns by expression_new_match, picks the arm.
         struct {
             Expression* expression;
             struct MatchCase** cases;
             int case_count;
+            struct MatchTable* table;
         } match;
 
         struct {
             Expression* left;
             Expression* right;
         } pipe;
+
+        // `[a, b, c]`; `[]` takes its element type from the context
+        struct {
+            Expression** elements;
+            int element_count;
+        } array_literal;
+
+        // `array[index]`. The analyzer sets unchecked when the index is
+        // known to be in bounds, so the evaluators skip the range test.
+        struct {
+            Expression* array;
+            Expression* index;
+            int unchecked;
+        } index;
+
+        // `{k1: v1, k2: v2}`; keys and values alternate in entries, so
+        // entry_count is twice the number of pairs. `{}` takes its types
+        // from the context.
+        struct {
+            Expression** entries;
+            int entry_count;
+        } map_literal;
+
+        // `object.name`. The analyzer sets offset to the field's position
+        // in the struct's layout; it is -1 until then.
+        struct {
+            Expression* object;
+            char* name;
+            int offset;
+        } field;
     } data;
 } Expression;
 
@@ -156,6 +215,16 @@ typedef struct Statement {
             Expression* expression;
         } expression_stmt;
 
+        struct {
+            Expression* value;
+        } yield_stmt;
+
+        // `type name { field: T, ... }`; type is a TYPE_STRUCT.
+        struct {
+            char* name;
+            Type* type;
+        } type_decl;
+
         struct {
             struct Statement** statements;
             int statement_count;
@@ -165,6 +234,22 @@ typedef struct Statement {
             Expression* condition;
             struct Statement* body;
         } while_stmt;
+
+        // `for variable in start..end body`, end exclusive, or `for variable
+        // in start body` over a sequence, with end NULL. A `par for`
+        // runs chunks of the range concurrently; each reduce_names[i] is
+        // then private to a chunk and folded back with reduce_operators[i]
+        // ("+", "*", "min" or "max").
+        struct {
+            char* variable;
+            Expression* start;
+            Expression* end;
+            struct Statement* body;
+            int is_parallel;
+            char** reduce_operators;
+            char** reduce_names;
+            int reduce_count;
+        } for_stmt;
     } data;
 } Statement;
 
@@ -183,6 +268,9 @@ Statement* statement_new_return(Expression* return_value, int line, int column);
 Statement* statement_new_expression(Expression* expression, int line, int column);
 Statement* statement_new_block(Statement** statements, int statement_count, int line, int column);
 Statement* statement_new_while(Expression* condition, Statement* body, int line, int column);
+Statement* statement_new_for(char* variable, Expression* start, Expression* end, Statement* body, int line, int column);
+Statement* statement_new_yield(Expression* value, int line, int column);
+Statement* statement_new_type(char* name, Type* type, int line, int column);
 void statement_free(Statement* stmt);
 
 Expression* expression_new_identifier(char* value, int line, int column);
@@ -197,6 +285,10 @@ Expression* expression_new_prefix(char* operator, Expression* right, int line, i
 Expression* expression_new_if(Expression* condition, Statement** then_branch, int then_count, Statement** else_branch, int else_count, int line, int column);
 Expression* expression_new_match(Expression* expression, MatchCase** cases, int case_count, int line, int column);
 Expression* expression_new_pipe(Expression* left, Expression* right, int line, int column);
+Expression* expression_new_array_literal(Expression** elements, int element_count, int line, int column);
+Expression* expression_new_index(Expression* array, Expression* index, int line, int column);
+Expression* expression_new_map_literal(Expression** entries, int entry_count, int line, int column);
+Expression* expression_new_field(Expression* object, char* name, int line, int column);
 void expression_free(Expression* expr);
 
 Parameter* parameter_new(Type* type, char* name);
@@ -207,6 +299,8 @@ void match_case_free(MatchCase* match_case);
 
 Type* type_new_identifier(char* name);
 Type* type_new_function(Type** params, int param_count, Type* return_type);
+Type* type_new_generic(char* name, Type** arguments, int argument_count);
+Type* type_new_struct(char** field_names, Type** field_types, int field_count);
 void type_free(Type* type);
 
 void ast_print_program(Program* program, int indent);
@@ -0,0 +1,87 @@
+#ifndef ASTBIN_H
+#define ASTBIN_H
+
+#include "ast.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// Position-independent binary encoding of the AST (.hka files).
+//
+//   AstBinHeader
+//   nodes     node_count fixed-size AstBinNode records
+//   indices   index_count uint32 node indices; child lists are ranges here
+//   strings   string table of NUL-terminated strings
+//
+// Nodes refer to children by node index, to lists by (start, count) into the
+// index pool and to text by byte offset into the string table, so the file
+// can be mapped read-only at any address and walked in place.
+
+#define ASTBIN_MAGIC "HKA"
+#define ASTBIN_VERSION 1
+#define ASTBIN_NONE 0xFFFFFFFFu
+
+// Node kinds beyond NodeType for the pieces that are not Expression/Statement/Type.
+#define ASTBIN_PARAMETER 200
+#define ASTBIN_MATCH_CASE 201
+#define ASTBIN_FIELD 202
+#define ASTBIN_REDUCTION 203
+
+#define ASTBIN_FLAG_CONST 0x1
+#define ASTBIN_FLAG_PURE 0x2
+#define ASTBIN_FLAG_MEMO 0x4
+#define ASTBIN_FLAG_HAS_ELSE 0x8
+#define ASTBIN_FLAG_PARALLEL 0x10
+#define ASTBIN_FLAG_GENERATOR 0x20
+#define ASTBIN_FLAG_UNCHECKED 0x40
+
+typedef struct AstBinHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t node_count;
+    uint32_t index_count;
+    uint32_t strings_size;
+    uint32_t root_start;
+    uint32_t root_count;
+    uint32_t reserved;
+} AstBinHeader;
+
+// Operand meaning depends on kind, e.g. for EXPR_INFIX op[0] = left node,
+// op[1] = operator string, op[2] = right node; int and float literals keep
+// their value in op[0..1].
+typedef struct AstBinNode {
+    uint16_t kind;
+    uint16_t flags;
+    int32_t line;
+    int32_t column;
+    uint32_t op[6];
+} AstBinNode;
+
+typedef struct AstBinView {
+    const AstBinHeader* header;
+    const AstBinNode* nodes;
+    const uint32_t* indices;
+    const char* strings;
+    void* mapping;
+    size_t mapping_size;
+} AstBinView;
+
+int astbin_write(const char* path, Program* program);
+
+// Maps a .hka file read-only and validates its layout. The view can be
+// walked directly with the accessors below without building a Program.
+AstBinView* astbin_open(const char* path);
+void astbin_close(AstBinView* view);
+
+const AstBinNode* astbin_node(const AstBinView* view, uint32_t index);
+const char* astbin_string(const AstBinView* view, uint32_t offset);
+uint32_t astbin_child(const AstBinView* view, uint32_t start, uint32_t i);
+int64_t astbin_integer(const AstBinNode* node);
+double astbin_float(const AstBinNode* node);
+
+// Rebuilds an ordinary heap Program from a view.
+Program* astbin_to_program(const AstBinView* view);
+
+// Same output as ast_print_program, produced straight from the mapping.
+void astbin_print_program(const AstBinView* view, int indent);
+
+#endif
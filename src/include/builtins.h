@@ -0,0 +1,23 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "object.h"
+
+// Functions every program can call without declaring them. They are not
+// bound in any environment: an identifier that no environment defines is
+// looked up here, so a user binding of the same name shadows the builtin.
+// The analyzer types each call itself (analyze_builtin_call, or
+// analyze_pipe_stage for the stages used after `|>`).
+
+typedef Object* (*BuiltinFunction)(Object** args, int arg_count);
+
+struct Builtin {
+    const char* name;
+    BuiltinFunction function;
+};
+
+// The builtin called name as a callable object, or NULL. The objects are
+// immutable and shared by every VM.
+Object* builtin_lookup(const char* name);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef CGEN_H
+#define CGEN_H
+
+#include "ast.h"
+#include <stdio.h>
+
+// Translates a program that already passed semantic_analyze_program into a
+// standalone C file. Expressions must carry their resolved_type.
+// Returns 1 on success; on failure an error is printed to stderr.
+int cgen_emit_program(Program* program, FILE* out);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <stdint.h>
+
+// Multi-producer multi-consumer queue behind `chan<T>`. A bounded channel
+// is a ring of cells with per-cell sequence numbers (Vyukov's bounded
+// MPMC queue); an unbounded one is a Michael-Scott linked queue. Neither
+// takes a lock: producers and consumers only contend on an atomic
+// position or link. Nodes and rings come from the current VM's heap and
+// are never reused, which rules out ABA on the linked queue.
+//
+// Items are opaque non-NULL pointers.
+//
+// Once a channel is closed, sends drop their item and return, and
+// receives take what was sent before and then return NULL.
+
+typedef struct Channel Channel;
+
+// capacity > 0 makes a bounded channel of at least that many items
+// (rounded up to a power of two); 0 makes an unbounded one.
+Channel* channel_new(int64_t capacity);
+int64_t channel_capacity(const Channel* channel);
+
+// Return at once: 0 if the channel is full, NULL if it is empty.
+int channel_try_send(Channel* channel, void* item);
+void* channel_try_recv(Channel* channel);
+
+// Block until they succeed. They never run queued tasks while waiting
+// (see scheduler_block), so a producer and consumer on one worker still
+// make progress: the scheduler adds a spare worker for the other side.
+void channel_send(Channel* channel, void* item);
+void* channel_recv(Channel* channel);
+
+// Also wakes every send and recv blocked on the channel.
+void channel_close(Channel* channel);
+
+#endif
@@ -2,25 +2,55 @@
 #define ENVIRONMENT_H
 
 typedef struct Object Object;
+struct Heap;
 
 #define HASH_TABLE_SIZE 128
+// Heap environments belong to calls and blocks, which bind a few names at
+// most; their table is this small and only made on the first binding.
+#define HEAP_TABLE_SIZE 8
 
 typedef struct EnvEntry {
     char* key;
     Object* value;
     struct EnvEntry* next;
+    Object* cell;       // where values stored from a scratch region are copied
 } EnvEntry;
 
 typedef struct Environment {
-    EnvEntry** entries;
+    EnvEntry** entries;   // NULL in a heap environment with no bindings yet
+    unsigned int table_size;
     struct Environment* outer;
+    struct Heap* heap;  // where the table and entries live, or NULL for malloc
+    EnvEntry* spare;    // entries environment_clear took out, for reuse
+    int captured;       // a closure or generator may still refer to it
 } Environment;
 
 Environment* environment_new(void);
-Environment* environment_new_enclosed(Environment* outer);
 
+// A call's, block's or loop's environment. Closures made while it is in
+// scope can keep it for as long as the VM lives, so it and its entries come
+// from heap and go away with it; environment_free leaves it alone.
+Environment* environment_new_on_heap(struct Heap* heap, Environment* outer);
+// The same, living as long as holder (see heap_alloc_beside).
+Environment* environment_new_beside(struct Heap* heap, const void* holder, Environment* outer);
+
+// Marks env and the environments around it as kept by a closure.
+void environment_capture(Environment* env);
+
+// Drops every binding, keeping the entries to reuse for the next ones.
+void environment_clear(Environment* env);
+
+// Storing into an environment older than the calling thread's innermost
+// scratch region (heap.h) a value made in it copies an int, float, bool,
+// null or short string into the entry's cell, which later stores reuse,
+// so a counter bumped once per item does not keep the item's region
+// alive; other values escape the region. Reading a cell inside a region
+// returns a copy, and outside one gives the cell up to the reader.
 Object* environment_get(Environment* env, const char* name);
 Object* environment_set(Environment* env, const char* name, Object* value);
+// Rebinds name in the innermost environment that defines it; returns NULL
+// when no enclosing environment does.
+Object* environment_assign(Environment* env, const char* name, Object* value);
 void environment_free(Environment* env);
 
 #endif
\ No newline at end of file
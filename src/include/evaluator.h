@@ -4,8 +4,23 @@
 #include "ast.h"
 #include "object.h"
 #include "environment.h"
+#include "flatast.h"
 
 Object* Eval(Statement* stmt, Environment* env);
 Object* eval_program(Program* program, Environment* env);
+Object* flat_eval_program(const FlatAst* ast, Environment* env);
+// Calls a function object, from either evaluator, with evaluated arguments.
+Object* eval_apply_function(Object* fn, Object** args, int arg_count);
+Object* flat_apply_function(Object* fn, Object** args, int arg_count);
+
+// Runs iterations [start, end) of a loop body in env; returns a
+// OBJ_RETURN_VALUE if the body returned.
+typedef Object* (*LoopBody)(void* loop, Environment* env, int64_t start, int64_t end);
+
+// `par for` for either evaluator: every chunk runs body in its own
+// environment where each names[i] starts at the identity of operators[i];
+// the partial results are then folded into the variables of env.
+void eval_parallel_for(LoopBody body, void* loop, Environment* env, int64_t start, int64_t end,
+                       char** operators, char** names, int reduce_count);
 
 #endif
\ No newline at end of file
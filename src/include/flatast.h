@@ -0,0 +1,140 @@
+#ifndef FLATAST_H
+#define FLATAST_H
+
+#include "ast.h"
+#include <stdint.h>
+
+struct TypeInfo;
+struct MatchTable;
+
+// Flattened AST: every node is a 32-bit index into parallel arrays
+// (structure of arrays), child lists are (start, count) ranges in a shared
+// index pool and literal payloads live in per-kind arrays. A traversal
+// touches a few dense arrays instead of chasing heap pointers.
+//
+// Operands by kind (a, b, c):
+//   EXPR_IDENTIFIER        name string, -, -
+//   EXPR_INTEGER_LITERAL   integers[] index, -, -
+//   EXPR_FLOAT_LITERAL     floats[] index, -, -
+//   EXPR_STRING_LITERAL    literals[] index, -, -
+//   EXPR_BOOLEAN_LITERAL   value, -, -
+//   EXPR_FUNCTION_LITERAL  functions[] index, -, -
+//   EXPR_CALL              callee, args start, args count
+//   EXPR_INFIX             left, FlatOperator, right
+//   EXPR_PREFIX            FlatOperator, right, -
+//   EXPR_IF                condition, then block, else block or FLAT_NONE
+//   EXPR_MATCH             subject, cases start (pattern/result pairs), matches[] index
+//   EXPR_PIPE              left, right, -
+//   STMT_LET               name string, value, is_const
+//   STMT_RETURN            value, -, -
+//   STMT_EXPRESSION        expression, -, -
+//   STMT_BLOCK             statements start, statements count, -
+//   STMT_WHILE             condition, body, -
+//   STMT_FOR               variable string, operands start, reduce count << 1 | is_parallel
+//                          (operands: range start, range end, body block, then
+//                          an operator string and a name string per reduction;
+//                          over a sequence, the sequence and FLAT_NONE)
+//   STMT_YIELD             value, -, -
+//   EXPR_ARRAY_LITERAL     elements start, elements count, -
+//   EXPR_INDEX             array, index, unchecked
+//   EXPR_MAP_LITERAL       entries start, entries count (key/value pairs), -
+//   STMT_TYPE              name string, fields start, field count
+//                          (fields: a name string and a FieldKind each)
+//   EXPR_FIELD             object, name string, offset
+
+#define FLAT_NONE 0xFFFFFFFFu
+
+typedef uint32_t FlatRef;
+
+typedef enum {
+    FLAT_OP_ADD,
+    FLAT_OP_SUB,
+    FLAT_OP_MUL,
+    FLAT_OP_DIV,
+    FLAT_OP_MOD,
+    FLAT_OP_LT,
+    FLAT_OP_GT,
+    FLAT_OP_LE,
+    FLAT_OP_GE,
+    FLAT_OP_EQ,
+    FLAT_OP_NE,
+    FLAT_OP_AND,
+    FLAT_OP_OR,
+    FLAT_OP_NOT,
+    FLAT_OP_NEG,
+    FLAT_OP_REF,
+    FLAT_OP_MUT_REF,
+    FLAT_OP_ASSIGN,
+    FLAT_OP_SPAWN,
+    FLAT_OP_AWAIT,
+    FLAT_OP_UNKNOWN
+} FlatOperator;
+
+typedef struct FlatFunction {
+    uint32_t params_start;   // string indices in the pool
+    uint32_t param_count;
+    FlatRef body;            // STMT_BLOCK node
+    char* name;
+    int is_pure;
+    int is_memo;
+    int is_generator;
+} FlatFunction;
+
+typedef struct FlatAst {
+    uint8_t* kinds;
+    int32_t* lines;
+    int32_t* columns;
+    uint32_t* a;
+    uint32_t* b;
+    uint32_t* c;
+    struct TypeInfo** types;  // resolved types copied from the analyzed tree
+    uint32_t node_count;
+    uint32_t node_capacity;
+
+    uint32_t* pool;
+    uint32_t pool_count;
+    uint32_t pool_capacity;
+
+    int64_t* integers;
+    uint32_t integer_count;
+    uint32_t integer_capacity;
+
+    double* floats;
+    uint32_t float_count;
+    uint32_t float_capacity;
+
+    StringLiteral* literals;
+    uint32_t literal_count;
+    uint32_t literal_capacity;
+
+    char** strings;           // interned, so equal names share an index
+    uint32_t string_count;
+    uint32_t string_capacity;
+    uint32_t* string_buckets;
+    uint32_t string_bucket_count;
+
+    FlatFunction* functions;
+    uint32_t function_count;
+    uint32_t function_capacity;
+
+    struct MatchTable** matches;  // one per match, built as the tree's are
+    uint32_t match_count;
+    uint32_t match_capacity;
+
+    FlatRef root;             // STMT_BLOCK holding the top-level statements
+} FlatAst;
+
+// Lowers a parsed (and optionally analyzed) Program. The Program can be
+// freed afterwards; the flat tree owns copies of every string.
+FlatAst* flat_ast_from_program(Program* program);
+void flat_ast_free(FlatAst* ast);
+
+FlatOperator flat_operator_from_string(const char* operator);
+const char* flat_operator_to_string(FlatOperator op);
+
+// Pool helper: the i-th child of a range.
+static inline FlatRef flat_child(const FlatAst* ast, uint32_t start, uint32_t i) {
+    return ast->pool[start + i];
+}
+
+#endif
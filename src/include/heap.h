@@ -0,0 +1,123 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Object heap of one VM. Values are never freed one by one, so the heap
+// is a list of chunks that each allocating thread bumps through; the lock
+// is only taken when a thread needs a fresh chunk, and everything goes
+// away at once in heap_destroy. Loop passes allocate from scratch regions
+// instead, which are emptied pass by pass (below).
+
+#define HEAP_CHUNK_SIZE (64 * 1024)
+
+typedef struct HeapChunk HeapChunk;
+struct StringData;
+
+typedef struct HeapMapping {
+    void* address;
+    size_t length;
+} HeapMapping;
+
+typedef struct HeapFinalizer {
+    void (*run)(void* data);
+    void* data;
+} HeapFinalizer;
+
+typedef struct Heap {
+    uint64_t id;          // tells thread-local cursors of different heaps apart
+    pthread_mutex_t lock;
+    HeapChunk* chunks;
+    size_t reserved;      // bytes in all chunks
+
+    // Pooled strings that objects in this heap point at.
+    struct StringData** strings;
+    size_t string_count;
+    size_t string_capacity;
+
+    // Files mapped for string views into them.
+    struct HeapMapping* mappings;
+    size_t mapping_count;
+    size_t mapping_capacity;
+
+    // Run by heap_destroy, newest first.
+    struct HeapFinalizer* finalizers;
+    size_t finalizer_count;
+    size_t finalizer_capacity;
+} Heap;
+
+void heap_init(Heap* heap);
+void heap_destroy(Heap* heap);
+
+// Returns size bytes aligned to 16, enough for any standard type but not
+// for one declared with a stricter _Alignas. Safe to call from every
+// thread working for the VM.
+void* heap_alloc(Heap* heap, size_t size);
+
+// The same with the given alignment, a power of two, for types such as
+// Channel that keep fields on cache lines of their own.
+void* heap_alloc_aligned(Heap* heap, size_t size, size_t alignment);
+char* heap_strdup(Heap* heap, const char* value);
+
+// Keeps a reference to data until heap_destroy.
+void heap_retain_string(Heap* heap, struct StringData* data);
+
+// Unmaps the region in heap_destroy, so objects may point into it.
+void heap_retain_mapping(Heap* heap, void* address, size_t length);
+
+// Calls run(data) in heap_destroy, for what a value holds outside the heap
+// (malloc'd buffers, file descriptors) and may not give back itself. data
+// must outlive every scratch region, so it is not heap memory.
+void heap_add_finalizer(Heap* heap, void (*run)(void* data), void* data);
+
+// Scratch regions. Between heap_scratch_begin and heap_scratch_end, the
+// calling thread's allocations from heap come from a region of its own,
+// which heap_scratch_reset empties for reuse: a loop over a sequence runs
+// each item in one, so what an item's pass makes goes away with it.
+// Regions nest, and only the thread that began one allocates from it.
+//
+// That is only sound while nothing older points into the region, so code
+// that stores a pointer into something that may be older (an environment,
+// a map, a channel) calls heap_note_store, and gives such a thing any
+// memory it grows by with heap_alloc_beside. A store that points outward
+// marks the regions escaped: resetting an escaped region hands what it
+// holds to the enclosing region, or to the heap, instead of freeing it.
+typedef struct HeapScratch {
+    Heap* heap;
+    struct HeapScratch* outer;
+    HeapChunk* chunks;    // newest first
+    HeapChunk* current;   // the one next and end are in
+    char* next;
+    char* end;
+    int escaped;
+} HeapScratch;
+
+void heap_scratch_begin(Heap* heap, HeapScratch* scratch);
+void heap_scratch_reset(HeapScratch* scratch);
+void heap_scratch_end(HeapScratch* scratch);
+
+// How many of the calling thread's regions are open, and which of them
+// holds address: 1 for the outermost, 0 for none (the heap itself, or
+// memory that is not the heap's). What earlier, escaped passes of a region
+// kept counts as the enclosing region's.
+int heap_scratch_depth(void);
+int heap_scratch_depth_of(const void* address);
+
+// Records that holder now points at value, escaping the regions between.
+void heap_note_store(const void* holder, const void* value);
+
+// Escapes every open region, for a pointer leaving the thread.
+void heap_scratch_escape(void);
+
+// Closes the thread's regions to allocation until heap_scratch_resume is
+// given what this returned, for work the thread does on behalf of others.
+HeapScratch* heap_scratch_suspend(void);
+void heap_scratch_resume(HeapScratch* scratch);
+
+// Memory that lives as long as holder, in holder's region or the heap;
+// with holder NULL, as long as the heap.
+void* heap_alloc_beside(Heap* heap, const void* holder, size_t size);
+
+#endif
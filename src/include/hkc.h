@@ -0,0 +1,49 @@
+#ifndef HKC_H
+#define HKC_H
+
+#include "ast.h"
+#include <stdint.h>
+#include <stddef.h>
+
+// A .hkc file caches a program that already passed semantic analysis so
+// later runs can skip the lexer, parser and analyzer. Layout:
+//
+//   HkcHeader
+//   constant pool   constant_count x (uint32 length, bytes, '\0')
+//   code            pre-order node stream, one opcode byte per node
+//   line table      line_count x (int32 line, int32 column), in code order
+//
+// The file is only valid on a machine with the same endianness; the
+// version and source hash in the header reject anything else. The payload
+// hash covers everything after the header, so a cache that was truncated
+// or damaged on disk is rejected rather than decoded.
+
+#define HKC_MAGIC "HKC"
+#define HKC_VERSION 4
+
+typedef struct HkcHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint64_t payload_hash;
+    uint32_t constant_count;
+    uint32_t constants_size;
+    uint32_t code_size;
+    uint32_t line_count;
+} HkcHeader;
+
+// Hash of the source text plus any option that changes the analyzed
+// program (e.g. --memo), so a cache built with other options is stale.
+uint64_t hkc_hash_source(const char* source, size_t length, uint32_t options);
+
+// Returns "<source>c" for "*.hk" paths, otherwise "<source>.hkc".
+char* hkc_path_for(const char* source_path);
+
+int hkc_write(const char* path, Program* program, uint64_t source_hash);
+
+// Maps the cache with mmap and rebuilds the program from it. Returns NULL
+// if the file is missing, malformed, damaged or was built from different
+// source; the caller then parses the source again.
+Program* hkc_load(const char* path, uint64_t source_hash);
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef HUNICK_H
+#define HUNICK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Embedding API. A HunickVM is a whole interpreter: its own object heap,
+// memo caches, spawn/par for workers, analyzer state and globals, so
+// every thread of a host can run its own VM. One VM must not be used by
+// two threads at the same time.
+//
+// A VM's memory comes from its heap, which is released all at once by
+// hunick_vm_free. What each pass of a loop makes is reclaimed when the
+// pass ends, unless the pass stores it somewhere older (sequence.h), so
+// a loop that adds up a million floats runs in a few MB. Everything else
+// a run makes (globals, what loops let out, call environments outside
+// loops, every type the analyzer builds) stays until the VM goes, and
+// runs on one VM add up: a host that runs long or many scripts should
+// give them fresh VMs.
+//
+// Two things are shared by every VM in the process, each behind a lock of
+// its own. The text of string literals is interned in one pool (str.h):
+// VMs running the same literal share its bytes, and an entry is freed
+// when the last program or VM heap that refers to it is, while the
+// pool's bucket array lives until exit. And print and write go through
+// the process's one standard output (output.h), where each thread
+// buffers on its own.
+//
+//   HunickVM* vm = hunick_vm_new();
+//   if (hunick_vm_run(vm, source, strlen(source)) == HUNICK_OK) {
+//       HunickValue result = hunick_vm_result(vm);
+//   } else {
+//       fputs(hunick_vm_error(vm), stderr);
+//   }
+//   hunick_vm_free(vm);
+
+typedef struct HunickVM HunickVM;
+
+typedef enum {
+    HUNICK_OK,
+    HUNICK_PARSE_ERROR,
+    HUNICK_SEMANTIC_ERROR
+} HunickStatus;
+
+typedef enum {
+    HUNICK_NONE,      // the script ended in a statement without a value
+    HUNICK_INT,
+    HUNICK_FLOAT,
+    HUNICK_BOOL,
+    HUNICK_STRING,
+    HUNICK_OTHER      // functions and futures
+} HunickType;
+
+// Strings point into the VM's heap and stay valid until the VM is freed.
+typedef struct HunickValue {
+    HunickType type;
+    int64_t integer;
+    double number;
+    int boolean;
+    const char* string;
+} HunickValue;
+
+HunickVM* hunick_vm_new(void);
+
+// Stops the VM's worker threads and releases everything it allocated.
+void hunick_vm_free(HunickVM* vm);
+
+// Workers (the calling thread included) that spawn and par for may use.
+// Defaults to 1, so that one VM per core is the natural way to scale.
+// Takes effect before the first spawn or par for.
+void hunick_vm_set_thread_count(HunickVM* vm, int thread_count);
+void hunick_vm_set_memoize(HunickVM* vm, int enabled);
+void hunick_vm_set_flat(HunickVM* vm, int enabled);
+
+// Parses, checks and runs source. Like the REPL, every run sees the
+// globals of the runs before it; a run that fails to parse or check
+// executes nothing and leaves the globals as they were.
+HunickStatus hunick_vm_run(HunickVM* vm, const char* source, size_t length);
+
+// Value of the last successful run.
+HunickValue hunick_vm_result(HunickVM* vm);
+
+// Current value of a global, or HUNICK_NONE if it is not defined.
+HunickValue hunick_vm_get(HunickVM* vm, const char* name);
+
+// Diagnostics of the last failed run, one per line; empty after success.
+const char* hunick_vm_error(HunickVM* vm);
+
+#endif
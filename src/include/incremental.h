@@ -0,0 +1,61 @@
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "ast.h"
+#include "semantic.h"
+#include <stdint.h>
+
+// Incremental checking for --watch. The source is cut into top-level
+// declarations, each identified by a hash of its text and keeping its
+// parse and analysis results between updates. An update re-parses only
+// declarations whose text is new and re-analyzes those plus the
+// declarations that mention a name whose signature, purity or position
+// changed, so the work done follows the size of the edit.
+
+typedef struct IncrementalUnit {
+    uint64_t hash;
+    char* text;
+    int length;
+    int line;              // where the declaration starts in the current source
+    int column;
+    int parsed_line;       // where it started when parsed; AST positions are relative to this
+    int first_statement;   // index of its first statement in the whole program
+    int position;          // index among the session's units
+
+    Program* program;
+    char** parse_errors;
+    int parse_error_count;
+
+    SemanticError* errors;
+    int error_count;
+
+    char** names;          // identifiers it mentions or declares, sorted and unique
+    int name_count;
+    Symbol** symbols;      // global declared by each statement, or NULL
+    int borrows_globals;   // has a `&`/`&mut` outside any function body
+    int dirty;
+} IncrementalUnit;
+
+typedef struct NameUsers NameUsers;
+
+typedef struct IncrementalSession {
+    SemanticAnalyzer* analyzer;
+    IncrementalUnit** units;
+    int unit_count;
+    NameUsers** users;     // name -> units that mention it
+
+    // What the last update did.
+    int reparsed_count;
+    int reanalyzed_count;
+    int full_check;
+} IncrementalSession;
+
+IncrementalSession* incremental_session_new(void);
+void incremental_session_free(IncrementalSession* session);
+
+// Brings the session up to date with source. Returns 1 when the program
+// has no parse or semantic errors.
+int incremental_update(IncrementalSession* session, const char* source, int length);
+void incremental_print_errors(IncrementalSession* session);
+
+#endif
@@ -5,6 +5,7 @@
 
 typedef struct {
     char* input;
+    int length;
     int position;
     int read_position;
     char ch;
@@ -13,6 +14,10 @@ typedef struct {
 } Lexer;
 
 Lexer* lexer_new(const char* input);
+// Lexes input[start, end) as if it were still embedded in the whole source:
+// (line, column) is the position of input[start], so tokens keep their
+// absolute positions.
+Lexer* lexer_new_range(const char* input, int start, int end, int line, int column);
 void lexer_free(Lexer* lexer);
 Token* lexer_next_token(Lexer* lexer);
 void lexer_skip_whitespace(Lexer* lexer);
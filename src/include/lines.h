@@ -0,0 +1,27 @@
+#ifndef LINES_H
+#define LINES_H
+
+#include "sequence.h"
+
+// Line readers behind lines(path) and stdin_lines(): sequences of strings,
+// one per line, without the "\n" (or "\r\n") that ends it. A last line
+// without one is still a line.
+//
+// A file is mapped whole and its lines are views into the mapping, so a
+// line's bytes are never copied; the current VM's heap owns the mapping.
+// The reader releases the pages it has gone 16 MB past, so a loop over a
+// big file does not keep it all in memory. Standard input, a pipe or a
+// file that cannot be mapped is read through one malloc'd buffer per
+// reader, reused by every read; buffer and descriptor are given back at
+// the end of the input, or with the VM's heap by a reader left before it.
+// Their lines are copied out of the buffer, into their object when they
+// are short, so the heap grows by the lines a program makes rather than
+// by buffers.
+//
+// A path that cannot be opened is reported on stderr and exits with
+// status 74, as for the program's own source file.
+
+Sequence* lines_open(const char* path);
+Sequence* lines_stdin(void);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "object.h"
+#include <stdint.h>
+
+// Open-addressing hash table behind `map<K, V>`, laid out like Abseil's
+// SwissTable. Keys are ints or strings. Every slot has a control byte:
+// empty, deleted, or the low 7 bits of the key's hash when full. A lookup
+// compares a group of 16 control bytes against those 7 bits at once
+// (one SSE2 compare where available) and only looks at the slots that
+// match, so most misses never touch a key.
+//
+// Deletion leaves a tombstone only when the slot's group is full. Probes
+// stop at the first group with an empty slot, so a group that still has
+// one cannot hide a later key and the slot can simply become empty.
+//
+// A string key is kept as the pointer it was stored with, next to its full
+// hash. Looking it up with that same pointer never compares bytes; other
+// strings are compared only when all 64 hash bits agree.
+//
+// Slots come from the current VM's heap, and a table that grows leaves the
+// old slots to the heap. Maps take no lock.
+
+typedef enum {
+    MAP_UNTYPED,  // `{}` before its first set
+    MAP_INT_KEYS,
+    MAP_STRING_KEYS
+} MapKeyKind;
+
+typedef struct MapSlot {
+    uint64_t hash;
+    union {
+        int64_t integer;
+        const char* string;
+    } key;
+    Object* value;
+} MapSlot;
+
+typedef struct Map {
+    MapKeyKind key_kind;
+    int64_t size;
+    int64_t capacity;     // a power of two, at least one group
+    int64_t growth_left;  // empty slots that may fill before a rehash
+    int8_t* control;
+    MapSlot* slots;
+} Map;
+
+Map* map_new(int64_t capacity);
+Map* map_copy(const Map* map);
+
+// key must be an int or a string, matching keys already in the map.
+// map_get returns NULL when the key is missing.
+Object* map_get(const Map* map, Object* key);
+int map_has(const Map* map, Object* key);
+void map_set(Map* map, Object* key, Object* value);
+
+// Returns whether the key was there.
+int map_delete(Map* map, Object* key);
+
+// The first full slot at or after position, or -1. Walks the map as
+// `for (i = map_next(m, 0); i >= 0; i = map_next(m, i + 1))`.
+int64_t map_next(const Map* map, int64_t position);
+
+// The key of a full slot as an object.
+Object* map_key(const Map* map, int64_t slot);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "ast.h"
+#include "object.h"
+#include <stdint.h>
+
+// Dispatch for a `match`: which arm a subject value selects, found without
+// trying the arms in turn. It is built once from the arms' patterns, which
+// are literals. Except over sparse integers, a lookup costs the same for
+// 3 arms as for 300:
+//
+//   integers  a jump table indexed by value - min when the patterns are
+//             dense (they fill at least a third of their range), otherwise
+//             a binary search over the sorted values
+//   strings   open addressing on the pattern's pooled StringData, probed
+//             with the subject's cached hash
+//   booleans  one arm for each value
+//
+// The first arm with a given pattern wins, like the first `_`. Patterns
+// that are none of these are left for the analyzer to report and never
+// match.
+
+typedef struct MatchString {
+    StringData* data;  // NULL in an empty slot
+    int arm;
+} MatchString;
+
+typedef struct MatchTable {
+    int default_arm;   // the first `_`, or -1
+    int bool_arms[2];  // for false and true, or -1
+
+    int64_t int_min;
+    uint32_t jump_count;  // values from int_min the jump table covers
+    int32_t* jump;        // arm per value, -1 for none
+
+    uint32_t int_count;   // when not dense: patterns in value order
+    int64_t* int_keys;
+    int32_t* int_arms;
+
+    uint32_t string_mask;  // slots - 1, a power of two minus one
+    MatchString* strings;
+} MatchTable;
+
+// `_` in pattern position.
+int match_pattern_is_wildcard(const Expression* pattern);
+
+MatchTable* match_table_new(MatchCase** cases, int case_count);
+void match_table_free(MatchTable* table);
+
+// The arm a literal pattern's own value selects: an earlier arm than the
+// pattern's when it repeats one. -1 for anything else.
+int match_table_pattern_arm(const MatchTable* table, const Expression* pattern);
+
+static inline int match_table_find_int(const MatchTable* table, int64_t value) {
+    if (table->jump) {
+        uint64_t offset = (uint64_t)value - (uint64_t)table->int_min;
+        if (offset < table->jump_count && table->jump[offset] >= 0) return table->jump[offset];
+        return table->default_arm;
+    }
+    uint32_t low = 0, high = table->int_count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (table->int_keys[middle] < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < table->int_count && table->int_keys[low] == value) return table->int_arms[low];
+    return table->default_arm;
+}
+
+static inline int match_table_find_bool(const MatchTable* table, int value) {
+    int arm = table->bool_arms[value ? 1 : 0];
+    return arm >= 0 ? arm : table->default_arm;
+}
+
+int match_table_find_string(const MatchTable* table, String* value);
+
+// The arm value selects, or -1 when none does.
+static inline int match_table_find(const MatchTable* table, Object* value) {
+    switch (value->type) {
+        case OBJ_INTEGER:
+            return match_table_find_int(table, value->value.integer);
+        case OBJ_STRING:
+            return match_table_find_string(table, &value->value.string);
+        case OBJ_BOOLEAN:
+            return match_table_find_bool(table, value->value.boolean);
+        default:
+            return table->default_arm;
+    }
+}
+
+#endif
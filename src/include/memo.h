@@ -0,0 +1,59 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include "object.h"
+#include <stdio.h>
+#include <pthread.h>
+
+#define MEMO_MAX_ARGS 4
+#define MEMO_TABLE_INITIAL_CAPACITY 16
+#define MEMO_TABLE_CAPACITY 4096
+
+typedef struct MemoKey {
+    ObjectType type;
+    union {
+        int64_t integer;
+        double float_val;
+        int boolean;
+        char* string;
+    } value;
+} MemoKey;
+
+typedef struct MemoEntry {
+    uint64_t hash;
+    int used;
+    MemoKey keys[MEMO_MAX_ARGS];
+    Object* result;
+} MemoEntry;
+
+// Direct-mapped result cache for one pure function. It starts small and
+// doubles as it fills, up to MEMO_TABLE_CAPACITY entries; past that a
+// colliding store evicts the previous entry. Spawned tasks can call the
+// same function concurrently, so lookups and stores hold the table's lock.
+typedef struct MemoTable {
+    char* name;
+    pthread_mutex_t lock;
+    int arg_count;
+    int capacity;
+    int size;
+    MemoEntry* entries;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+
+    struct MemoTable* next;
+} MemoTable;
+
+// A memoized function's table, made on its first call, so that a closure
+// created and never called costs nothing. Tables register with the current
+// VM and are freed along with it. NULL when out of memory, and the call
+// then goes unmemoized.
+MemoTable* memo_table_of(Object* function);
+Object* memo_lookup(MemoTable* table, Object** args, int arg_count);
+void memo_store(MemoTable* table, Object** args, int arg_count, Object* result);
+void memo_tables_free(MemoTable* tables);
+// Statistics of every table of the current VM.
+void memo_print_stats(FILE* out);
+
+#endif
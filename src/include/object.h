@@ -5,6 +5,15 @@
 #include <stdint.h>
 
 typedef struct Environment Environment; 
+typedef struct MemoTable MemoTable;
+typedef struct Task Task;
+typedef struct Builtin Builtin;
+typedef struct Channel Channel;
+typedef struct Sequence Sequence;
+typedef struct Array Array;
+typedef struct Map Map;
+typedef struct Record Record;
+typedef struct StructLayout StructLayout;
 
 typedef enum {
     OBJ_INTEGER,
@@ -13,7 +22,15 @@ typedef enum {
     OBJ_STRING,
     OBJ_NULL,
     OBJ_RETURN_VALUE,
-    OBJ_FUNCTION
+    OBJ_FUNCTION,
+    OBJ_FUTURE,
+    OBJ_BUILTIN,
+    OBJ_CHANNEL,
+    OBJ_SEQUENCE,
+    OBJ_ARRAY,
+    OBJ_MAP,
+    OBJ_STRUCT,       // an instance
+    OBJ_STRUCT_TYPE   // what a `type` declaration binds; calling it builds an instance
 } ObjectType;
 
 typedef struct Object {
@@ -22,7 +39,7 @@ typedef struct Object {
         int64_t integer;
         double float_val;
         int boolean;
-        char* string;
+        String string;
         struct Object* return_value;
         struct {
             Parameter** parameters;
@@ -30,7 +47,24 @@ typedef struct Object {
             Statement** body;
             int body_count;
             Environment* env;
+            // A memoized function's name, for --stats, and its table,
+            // which its first call makes (see memo_table_of).
+            const char* memo_name;
+            _Atomic(MemoTable*) memo;
+            int is_memo;
+            int is_generator;  // calling it returns a sequence
+            // Set instead of parameters/body for functions from a FlatAst.
+            const struct FlatAst* flat;
+            uint32_t flat_function;
         } function;
+        Task* task;  // OBJ_FUTURE: the spawned call it will resolve to
+        const Builtin* builtin;
+        Channel* channel;
+        Sequence* sequence;
+        Array* array;
+        Map* map;
+        Record* record;
+        const StructLayout* layout;
     } value;
 } Object;
 
@@ -38,10 +72,31 @@ Object* object_new_integer(int64_t value);
 Object* object_new_float(double value);
 Object* object_new_boolean(int value);
 Object* object_new_string(const char* value);
+Object* object_new_string_length(const char* chars, int64_t length);
+// A string of bytes that the current VM's heap keeps alive, e.g. from a
+// mapping it owns. Long ones are not copied.
+Object* object_new_string_view(const char* bytes, int64_t length);
+Object* object_new_string_concat(const String* left, const String* right);
+// The object for a literal, made once per VM: evaluating the literal
+// again allocates nothing.
+Object* object_new_string_literal(StringLiteral* literal);
 Object* object_new_null(void);
 Object* object_new_return_value(Object* value);
 Object* object_new_function(Parameter** params, int p_count, Statement** body, int b_count, Environment* env);
-void object_free(Object* obj);
+Object* object_new_future(Task* task);
+Object* object_new_channel(Channel* channel);
+Object* object_new_sequence(Sequence* sequence);
+Object* object_new_array(Array* array);
+Object* object_new_map(Map* map);
+Object* object_new_record(Record* record);
+Object* object_new_struct_type(const StructLayout* layout);
+// Writes obj to standard output through the output buffer, strings in
+// quotes.
 void object_print(Object* obj);
 
+// Arrays, maps and records are values: binding one to a variable copies
+// it, so no other name sees the variable's changes. A literal is already a fresh
+// value and is bound as is. Other objects are returned unchanged.
+Object* object_bind_value(Object* value, int is_literal);
+
 #endif
@@ -0,0 +1,40 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Standard output behind print, write and flush, and behind the `=> value`
+// a run ends with. Each thread appends to a buffer of its own and the
+// buffer goes out in one write(2) when it fills, on output_flush, when the
+// thread exits, and at process exit; nothing is allocated per call, and
+// the buffer's lock is only ever contended by flush(). Threads' output
+// therefore only interleaves where a buffer is written. Numbers are
+// formatted here rather than by printf.
+//
+// The scheduler flushes a thread's buffer before it spawns a task, when it
+// starts to await one and when it finishes running one, so what a program
+// prints before a spawn comes out before anything the task prints, and
+// what a task prints comes out before anything printed after its await.
+//
+// Bytes that stdio holds for stdout are flushed ahead of a buffer, so
+// printf output that came first stays first.
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+void output_write(const char* bytes, size_t length);
+void output_string(const char* string);
+void output_int(int64_t value);
+
+// The same digits as printf's "%f".
+void output_float(double value);
+
+// Writes out the calling thread's buffer.
+void output_flush(void);
+
+// Writes out every thread's buffer, the flush() builtin. Safe while other
+// threads are writing; what they add afterwards waits for their next
+// flush.
+void output_flush_all(void);
+
+#endif
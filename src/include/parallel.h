@@ -0,0 +1,17 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// Runs task(context, i, worker) for every i in [0, task_count) on up to
+// thread_count threads (the caller counts as one). worker is in
+// [0, thread_count) and identifies the calling thread, so tasks can use
+// per-worker state without locking. Tasks are claimed from a shared atomic
+// counter, so uneven tasks still balance. Returns once every task has
+// finished.
+typedef void (*ParallelTask)(void* context, int index, int worker);
+
+void parallel_for(int task_count, int thread_count, ParallelTask task, void* context);
+
+// Number of online processors, at least 1.
+int parallel_cpu_count(void);
+
+#endif
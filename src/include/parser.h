@@ -18,11 +18,20 @@ typedef enum {
     PRECEDENCE_CALL        
 } Precedence;
 
+// A run of source text holding whole top-level statements, with the
+// position of its first character.
+typedef struct SourceSpan {
+    int start;
+    int end;
+    int line;
+    int column;
+} SourceSpan;
+
 typedef struct Parser {
     Lexer* lexer;
     Token* current_token;
     Token* peek_token;
-    
+    int yield_count;       // yields seen in the innermost function body
     
     char** errors;
     int error_count;
@@ -32,6 +41,16 @@ typedef struct Parser {
 Parser* parser_new(Lexer* lexer);
 void parser_free(Parser* parser);
 Program* parser_parse_program(Parser* parser);
+// Splits the lexer's source at top-level statement boundaries and parses
+// the pieces on thread_count threads. Produces the same Program and errors
+// as parser_parse_program.
+Program* parser_parse_program_parallel(Parser* parser, int thread_count);
+// Cuts source into one span per top-level statement, using the same
+// pre-scan as the parallel parser.
+SourceSpan* parser_split_statements(const char* source, int length, int* span_count);
+// Whether source ends outside any bracket, string or pending annotation,
+// so an interactive reader knows to stop asking for more lines.
+int parser_input_complete(const char* source, int length);
 
 void parser_add_error(Parser* parser, const char* message);
 void parser_print_errors(Parser* parser);
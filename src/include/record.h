@@ -0,0 +1,84 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "heap.h"
+#include "object.h"
+#include <stdint.h>
+
+// Flat records behind `type Name { ... }` structs. A record is a single
+// allocation: a pointer to the struct's layout, then one eight-byte slot
+// per field in declaration order. int, float and bool fields are stored
+// unboxed in their slot; any other field holds its object. The analyzer
+// resolves `p.x` to the slot's offset, so reading a field is one load at
+// a fixed distance from the record, with no name lookup.
+//
+// Records are values, like arrays: binding one copies it. Records come
+// from the current VM's heap and take no lock.
+
+typedef enum {
+    FIELD_INT,
+    FIELD_FLOAT,
+    FIELD_BOOL,
+    FIELD_OBJECT
+} FieldKind;
+
+typedef struct StructLayout {
+    const char* name;
+    int field_count;
+    const char** field_names;
+    FieldKind* kinds;
+} StructLayout;
+
+typedef union RecordField {
+    int64_t integer;   // FIELD_INT and FIELD_BOOL
+    double number;
+    Object* object;
+} RecordField;
+
+typedef struct Record {
+    const StructLayout* layout;
+    RecordField fields[];
+} Record;
+
+// How a field of the given declared type is stored.
+FieldKind record_field_kind(const Type* type);
+
+// Copies name, field_names and kinds into the heap.
+StructLayout* struct_layout_new(const char* name, const char* const* field_names, const FieldKind* kinds, int field_count);
+
+// A record holding values[0 .. field_count); arrays, maps and records among
+// them are copied, as a let would.
+Record* record_new(const StructLayout* layout, Object** values);
+Record* record_copy(const Record* record);
+
+// Calls the constructor a `type` declaration binds: a new instance, or
+// null when the argument count is wrong.
+Object* record_construct(const StructLayout* layout, Object** args, int arg_count);
+
+static inline Object* record_load(const Record* record, int offset) {
+    const RecordField* field = &record->fields[offset];
+    switch (record->layout->kinds[offset]) {
+        case FIELD_INT: return object_new_integer(field->integer);
+        case FIELD_FLOAT: return object_new_float(field->number);
+        case FIELD_BOOL: return object_new_boolean((int)field->integer);
+        default: return field->object;
+    }
+}
+
+// value must already be bound (copied) if it is a container.
+static inline void record_store(Record* record, int offset, Object* value) {
+    RecordField* field = &record->fields[offset];
+    switch (record->layout->kinds[offset]) {
+        case FIELD_INT: field->integer = value->value.integer; break;
+        case FIELD_FLOAT:
+            field->number = value->type == OBJ_FLOAT ? value->value.float_val : (double)value->value.integer;
+            break;
+        case FIELD_BOOL: field->integer = value->value.boolean; break;
+        default:
+            heap_note_store(record, value);
+            field->object = value;
+            break;
+    }
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef REPL_H
+#define REPL_H
+
+#include <stdio.h>
+
+#include "ast.h"
+#include "semantic.h"
+#include "environment.h"
+#include "flatast.h"
+
+// Interactive session. One analyzer and one global Environment live for
+// the whole session, so each input is lexed, parsed, analyzed and run on
+// its own against everything defined before it. Functions keep pointing
+// into the AST (or FlatAst) of the input that defined them, along with
+// their memo tables, so those inputs stay alive until the session ends.
+typedef struct ReplSession {
+    SemanticAnalyzer* analyzer;
+    Environment* env;
+    int use_flat_ast;
+    int line;              // lines read so far; inputs keep session-wide line numbers
+
+    Program** programs;
+    FlatAst** flats;
+    int input_count;
+    int input_capacity;
+} ReplSession;
+
+ReplSession* repl_session_new(int memoize_pure_functions, int use_flat_ast);
+void repl_session_free(ReplSession* session);
+
+// Runs one complete input. On a parse or semantic error nothing runs and
+// the globals the input declared are dropped again. Returns 1 on success.
+int repl_eval(ReplSession* session, const char* input);
+
+// Reads inputs from in until EOF or `:quit`, asking for more lines while
+// an input is incomplete. Prompts are only shown on a terminal.
+int repl_run(ReplSession* session, FILE* in);
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "object.h"
+#include "hunick.h"
+#include <stdint.h>
+
+// Runtime behind `spawn f(args)`, `await` and `par for`. Every worker
+// thread owns a Chase-Lev deque: it pushes and pops spawned tasks at the
+// bottom while idle workers steal from the top of a random victim. The thread that
+// started the program is worker 0; a thread blocked in await keeps running
+// queued tasks instead of sleeping, so nested spawns cannot deadlock even
+// with a single worker.
+//
+// Each VM has its own scheduler; the functions below work on the one of
+// the calling thread's current VM.
+
+typedef struct Task Task;
+typedef struct Scheduler Scheduler;
+
+// Worker threads are only started by the first spawn or par for, and are
+// bound to vm. thread_count 0 means one per online processor.
+Scheduler* scheduler_new(HunickVM* vm, int thread_count);
+void scheduler_free(Scheduler* scheduler);
+
+// Number of workers (the calling thread included) used once the first task
+// is spawned.
+void scheduler_set_thread_count(int thread_count);
+
+// Queues fn(args) and returns at once. The task takes ownership of args,
+// which must already be evaluated.
+Task* scheduler_spawn(Object* fn, Object** args, int arg_count);
+
+// Waits for task to finish, running other queued tasks meanwhile, and
+// returns its result. A task may be awaited any number of times.
+Object* scheduler_await(Task* task);
+
+// A task no worker runs: something else (an I/O completion) finishes it
+// with scheduler_complete. It is awaited like a spawned one.
+Task* scheduler_task_new(void);
+void scheduler_complete(Task* task, Object* result);
+
+// One step of a wait for another task that must not run queued tasks on
+// the waiting stack (a blocked channel send or recv: the task it would run
+// could be the one it waits for, and that task could never return). Yields
+// the processor; when the wait goes on while tasks stay queued and no
+// worker is idle, starts a spare worker so they still get a thread. spins
+// starts at 0 and is kept by the caller across steps.
+void scheduler_block(int* spins);
+
+// Body of a parallel loop: runs iterations [start, end), which make up
+// chunk number `chunk` of the range.
+typedef void (*RangeTask)(void* context, int64_t chunk, int64_t start, int64_t end);
+
+// How many chunks scheduler_parallel_range should cut `iterations` into:
+// enough for several per worker so uneven chunks still balance, never more
+// than there are iterations. It depends on nothing but `iterations`, so a
+// par for reduction combines the same partials in the same order, and a
+// float sum comes out the same, whatever --jobs is.
+int64_t scheduler_range_chunks(int64_t iterations);
+
+// Splits [start, end) into chunk_count contiguous chunks of near-equal
+// size and runs task on each. The caller and up to one helper task per
+// other worker claim chunks from a shared counter; returns once every
+// chunk has finished. May be nested.
+void scheduler_parallel_range(int64_t start, int64_t end, int64_t chunk_count, RangeTask task, void* context);
+
+// Runs whatever is still queued and waits for outstanding I/O, then stops
+// the worker threads.
+void scheduler_shutdown(void);
+
+#endif
@@ -17,7 +17,12 @@ typedef enum {
     BUILTIN_UNIT,      
     BUILTIN_UNKNOWN,
     BUILTIN_REF,       
-    BUILTIN_MUT_REF 
+    BUILTIN_MUT_REF,
+    BUILTIN_FUTURE,    // pointed_to is the result type
+    BUILTIN_CHAN,      // pointed_to is the element type
+    BUILTIN_SEQ,       // pointed_to is the element type
+    BUILTIN_ARRAY,     // pointed_to is the element type, int or float
+    BUILTIN_MAP        // pointed_to is the value type, key_type int or string
 } BuiltinType;
 
 typedef enum {
@@ -45,6 +50,7 @@ typedef struct TypeInfo {
         } struct_info;
     } data;
     struct TypeInfo* pointed_to;
+    struct TypeInfo* key_type;  // BUILTIN_MAP only
     
     int is_owned;      
     int is_borrowed;   
@@ -78,6 +84,9 @@ typedef struct Symbol {
     
     int is_initialized;
     int is_used;
+    int is_pure;
+    int declaration_index;         // position among the symbols of its scope
+    Expression* function_literal;  // for SYMBOL_FUNCTION, the literal it binds
     
     BorrowState borrow_state;
     int shared_borrow_count;
@@ -117,9 +126,40 @@ typedef struct SemanticError {
     char* message;
     int line;
     int column;
+    int order;  // top-level statement that produced it, for merging
     struct SemanticError* next;
 } SemanticError;
 
+// A top-level function whose body is checked on a worker thread.
+typedef struct FunctionTask {
+    Expression* literal;
+    Symbol* symbol;
+    int statement_index;
+    SemanticError* errors;
+    int error_count;
+} FunctionTask;
+
+// `from` stays pure only if `to` turns out pure.
+typedef struct PurityEdge {
+    Expression* from;
+    Expression* to;
+} PurityEdge;
+
+typedef struct CheckedLiteral {
+    Expression* literal;
+    TypeInfo* function_type;
+} CheckedLiteral;
+
+// A call made inside a `par for` body to a function whose purity was not
+// final yet; it is reported once purity is resolved if the callee turns out
+// to have side effects. Spawned calls are kept the same way until it is
+// known whether the callee shares mutable state.
+typedef struct ParallelCall {
+    Expression* call;
+    Expression* callee;  // the function literal
+    int order;
+} ParallelCall;
+
 typedef struct SemanticAnalyzer {
     Scope* current_scope;
     Scope* global_scope;
@@ -130,23 +170,86 @@ typedef struct SemanticAnalyzer {
     int error_count;
     
     TypeInfo* current_function_return_type;
+
+    // Element type of the generator being checked (NULL outside one). A
+    // yield is only allowed where the generator can be suspended: directly
+    // in its body, loops and blocks, or in the branches of an if used as a
+    // statement (statement_expression).
+    TypeInfo* current_yield_type;
+    int yield_allowed;
+    Expression* statement_expression;
+    
+    // Purity of the function body being checked: no `&mut`, no assignment,
+    // no reads of mutable captures and no calls to impure functions.
+    int current_function_is_pure;
+    // Whether it reaches `let mut` state from outside its body: assigns such
+    // a variable, uses such an array, map or struct, or calls a function
+    // that does. A spawned task could not run it without a race.
+    int current_function_shares_state;
+    int current_function_scope_level;
+    int memoize_pure_functions;
     
     int current_scope_level;
+
+    // Innermost `par for` being checked: the scope level of its loop
+    // variable (0 outside any) and the loop, for its reduce list. Symbols
+    // below that level are shared between chunks.
+    int parallel_scope_level;
+    Statement* parallel_loop;
     
     int next_lifetime_id; 
+
+    // Symbols currently borrowed, so popping a scope only revisits these.
+    Symbol** borrowed_symbols;
+    int borrowed_count;
+    int borrowed_capacity;
+
+    // Two-phase analysis (semantic_analyze_program_parallel). While
+    // defer_function_bodies is set, top-level function bodies are queued as
+    // tasks; while defer_purity is set, calls to named functions record a
+    // PurityEdge and memoization checks wait until purity is resolved.
+    int defer_function_bodies;
+    int defer_purity;
+    int global_visibility_limit;     // -1, or last visible global declaration_index
+    int error_order;
+    Expression* current_function_literal;
+
+    FunctionTask* tasks;
+    int task_count;
+    int task_capacity;
+    PurityEdge* purity_edges;
+    int purity_edge_count;
+    int purity_edge_capacity;
+    CheckedLiteral* checked_literals;
+    int checked_literal_count;
+    int checked_literal_capacity;
+    ParallelCall* parallel_calls;
+    int parallel_call_count;
+    int parallel_call_capacity;
+    ParallelCall* spawn_calls;
+    int spawn_call_count;
+    int spawn_call_capacity;
 } SemanticAnalyzer;
 
 SemanticAnalyzer* semantic_analyzer_new(void);
 void semantic_analyzer_free(SemanticAnalyzer* analyzer);
 
 int semantic_analyze_program(SemanticAnalyzer* analyzer, Program* program);
+// Collects global symbols and function signatures serially, then checks
+// top-level function bodies on thread_count threads. Errors are merged in
+// line order.
+int semantic_analyze_program_parallel(SemanticAnalyzer* analyzer, Program* program, int thread_count);
 TypeInfo* semantic_analyze_expression(SemanticAnalyzer* analyzer, Expression* expr);
 int semantic_analyze_statement(SemanticAnalyzer* analyzer, Statement* stmt);
 
 TypeInfo* type_info_new_builtin(BuiltinType builtin);
 TypeInfo* type_info_new_function(TypeInfo** params, int param_count, TypeInfo* return_type);
 TypeInfo* type_info_new_struct(char* name, TypeInfo** field_types, char** field_names, int field_count);
-void type_info_free(TypeInfo* type);
+TypeInfo* type_info_new_future(TypeInfo* result_type);
+TypeInfo* type_info_new_channel(TypeInfo* element_type);
+TypeInfo* type_info_new_sequence(TypeInfo* element_type);
+TypeInfo* type_info_new_array(TypeInfo* element_type);
+TypeInfo* type_info_new_map(TypeInfo* key_type, TypeInfo* value_type);
 int type_info_equals(TypeInfo* a, TypeInfo* b);
 int type_info_is_assignable(TypeInfo* from, TypeInfo* to);
 char* type_info_to_string(TypeInfo* type);
@@ -156,12 +259,20 @@ void symbol_free(Symbol* symbol);
 int symbol_table_add(SemanticAnalyzer* analyzer, Symbol* symbol);
 Symbol* symbol_table_lookup(SemanticAnalyzer* analyzer, const char* name);
 Symbol* symbol_table_lookup_current_scope(SemanticAnalyzer* analyzer, const char* name);
+// The global declared by the top-level statement at declaration_index.
+Symbol* symbol_table_lookup_global(SemanticAnalyzer* analyzer, const char* name, int declaration_index);
+// Unlinks a global without freeing it, for incremental re-analysis.
+void symbol_table_remove_global(SemanticAnalyzer* analyzer, Symbol* symbol);
+// Removes and frees the globals declared since the global symbol count
+// was first_index, undoing a rejected REPL input or embedded run.
+void semantic_drop_globals_from(SemanticAnalyzer* analyzer, int first_index);
 
 void semantic_push_scope(SemanticAnalyzer* analyzer);
 void semantic_pop_scope(SemanticAnalyzer* analyzer);
 
 void semantic_add_error(SemanticAnalyzer* analyzer, SemanticErrorType type, const char* message, int line, int column);
 void semantic_print_errors(SemanticAnalyzer* analyzer);
+void semantic_clear_errors(SemanticAnalyzer* analyzer);
 
 TypeInfo* convert_ast_type_to_type_info(SemanticAnalyzer* analyzer, Type* ast_type);
 int is_numeric_type(TypeInfo* type);
@@ -0,0 +1,46 @@
+#ifndef SEQUENCE_H
+#define SEQUENCE_H
+
+#include "object.h"
+
+// A lazy stream of values behind `seq<T>`: a suspended generator, or a
+// pipeline stage such as `|> filter(f)` wrapped around another sequence.
+// Nothing runs until a consumer pulls, and each stage pulls one item at a
+// time from its source, so a pipeline never builds intermediate lists.
+// A `for x in s` loop, like a range or while loop, runs each item's pass
+// in a scratch region (heap.h), and what the pass and the pulls it made
+// allocated is reclaimed before the next item: `nat() |> take(3000000)`
+// runs in about 10 MB. Ints, floats, bools and strings whose bytes are
+// older than the pass (short ones, literals, lines of a file, big `+`
+// buffers) that it stores in older variables are copied out. Anything
+// else it lets out (a map stored outside, an item set into an older map
+// or sent on a channel, a closure, a spawn, a return) keeps what the pass
+// made, and a generator's own loop over another sequence keeps each such
+// item it binds.
+//
+// A sequence has one consumer and is not safe to pull from two threads.
+
+typedef struct Sequence Sequence;
+
+struct Sequence {
+    // The next item, or NULL when there are no more.
+    Object* (*next)(Sequence* sequence);
+    int done;
+};
+
+// Once a sequence has returned NULL it keeps returning NULL without
+// calling next again.
+Object* sequence_next(Sequence* sequence);
+
+// Stages over source, allocated from the current VM's heap. Functions are
+// called with eval_apply_function, so they may come from either evaluator.
+Sequence* sequence_filter(Sequence* source, Object* predicate);
+Sequence* sequence_map(Sequence* source, Object* function);
+Sequence* sequence_take(Sequence* source, int64_t count);
+
+// The parts of a string between occurrences of separator, as views of its
+// bytes: "a,,b" split on "," gives "a", "" and "b". An empty separator
+// gives the whole string.
+Sequence* sequence_split(Object* string, Object* separator);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+// Vector kernels behind the array builtins sum, dot, map_add, scale, min,
+// max and argmax. Every kernel is compiled once per instruction set and
+// the widest one the processor (and the OS, for the AVX register state)
+// supports is picked on the first call, so one binary runs everywhere and
+// still uses AVX-512 where it exists. Off x86 only the scalar kernels are
+// built.
+//
+// sum and dot keep several partial sums, so a float result can differ in
+// the last bits from a left-to-right loop. Integer arithmetic wraps. With
+// NaNs in the input, min, max and argmax return an unspecified element.
+
+typedef enum {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_AVX512
+} SimdLevel;
+
+// The level the kernels below run at.
+SimdLevel simd_level(void);
+const char* simd_level_name(SimdLevel level);
+
+// Caps the level at `level` (benchmarks use it to compare the kernels).
+// Returns the level now in use, which is lower if the CPU lacks `level`.
+SimdLevel simd_set_level(SimdLevel level);
+
+double simd_sum_f64(const double* a, int64_t n);
+int64_t simd_sum_i64(const int64_t* a, int64_t n);
+double simd_dot_f64(const double* a, const double* b, int64_t n);
+int64_t simd_dot_i64(const int64_t* a, const int64_t* b, int64_t n);
+
+// out[i] = a[i] + b[i] and out[i] = a[i] * k. out may be a or b.
+void simd_add_f64(double* out, const double* a, const double* b, int64_t n);
+void simd_add_i64(int64_t* out, const int64_t* a, const int64_t* b, int64_t n);
+void simd_scale_f64(double* out, const double* a, double k, int64_t n);
+void simd_scale_i64(int64_t* out, const int64_t* a, int64_t k, int64_t n);
+
+// These need n > 0. argmax is the index of the first largest element.
+double simd_min_f64(const double* a, int64_t n);
+int64_t simd_min_i64(const int64_t* a, int64_t n);
+double simd_max_f64(const double* a, int64_t n);
+int64_t simd_max_i64(const int64_t* a, int64_t n);
+int64_t simd_argmax_f64(const double* a, int64_t n);
+int64_t simd_argmax_i64(const int64_t* a, int64_t n);
+
+#endif
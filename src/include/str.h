@@ -0,0 +1,124 @@
+#ifndef STR_H
+#define STR_H
+
+#include <stdint.h>
+
+// String values carry their length and a hash computed on first use.
+// Strings of up to STRING_INLINE_CAPACITY bytes live inside the String
+// itself, so they cost nothing beyond the object holding them; longer ones
+// point at bytes elsewhere, which are never written once the string exists.
+//
+// A long string may also be a view of bytes that something else owns and
+// that are not NUL-terminated, such as a line of a mapped file. Anything
+// a heap owns lives as long as the objects in it, so views need no
+// reference to their parent. Such a string is flattened, given the
+// terminating NUL that string_chars promises, only when something asks
+// for its chars; string_bytes reads it as it is.
+//
+// `+` appends to a StringBuilder, a buffer that successive results share:
+// each one views a longer prefix of it. Appending to the newest of them
+// extends the buffer in place, so a loop that keeps appending to one
+// string takes time linear in what it builds. The newest string of a
+// builder is flattened by claiming the byte after it for the NUL; any
+// other view gets a copy. Outgrown buffers stay until the VM goes, since
+// older strings may view them; with the capacity doubling, building a
+// string costs two to four times its length (a 40 MB one built 10 bytes
+// at a time peaks near 100 MB). Big buffers are malloc'd, so the
+// loop pass that appends does not keep the objects it made (heap.h).
+//
+// The text of every string literal is interned in a process-wide constant
+// pool as a reference-counted StringData, shared by all VMs and guarded by
+// one lock. Each literal node holds one
+// reference, and a VM heap holds one for every StringData its objects point
+// at, so a program can be freed while strings from its literals live on.
+
+#define STRING_INLINE_CAPACITY 22
+
+typedef struct StringData {
+    int references;           // guarded by the pool's lock
+    int64_t length;
+    uint64_t hash;
+    struct StringData* next;  // in the pool's bucket
+    char chars[];
+} StringData;
+
+struct Heap;
+
+typedef struct StringBuilder {
+    _Atomic int64_t length;  // bytes claimed by strings so far
+    int64_t capacity;
+    char* chars;
+} StringBuilder;
+
+typedef struct String {
+    int64_t length;
+    uint64_t hash;  // 0 until string_hash computes it
+    union {
+        char inline_chars[STRING_INLINE_CAPACITY + 1];
+        struct {
+            const char* chars;       // the first byte
+            StringBuilder* builder;  // set on strings made by `+`
+            uint8_t terminated;      // whether chars[length] is a NUL
+        };
+    } data;
+} String;
+
+struct CachedLiteral;
+
+// A string literal in a program: its pooled text and the object every
+// evaluation of it returns (see object_new_string_literal).
+typedef struct StringLiteral {
+    StringData* data;
+    _Atomic(struct CachedLiteral*) cached;
+} StringLiteral;
+
+// FNV-1a with a 64-bit finalizer; maps hash string keys with it too.
+uint64_t string_hash_bytes(const char* chars, int64_t length);
+
+// Returns the pooled copy of chars with a new reference to it.
+StringData* string_pool_intern(const char* chars, int64_t length);
+StringData* string_data_retain(StringData* data);
+void string_data_release(StringData* data);
+
+void string_literal_init(StringLiteral* literal, const char* text);
+void string_literal_release(StringLiteral* literal);
+
+// Sets result to left followed by right, taking any new buffer from heap.
+void string_concat(struct Heap* heap, String* result, const String* left, const String* right);
+
+// Gives an unterminated string its NUL; see string_chars. Copies come
+// from the current VM's heap and live as long as the string.
+const char* string_flatten(String* string);
+
+// The bytes of string, NUL-terminated.
+static inline const char* string_chars(const String* string) {
+    if (string->length <= STRING_INLINE_CAPACITY) return string->data.inline_chars;
+    if (__atomic_load_n(&string->data.terminated, __ATOMIC_ACQUIRE)) {
+        return __atomic_load_n(&string->data.chars, __ATOMIC_RELAXED);
+    }
+    return string_flatten((String*)string);
+}
+
+// The bytes of string, without flattening it: only the first length of
+// them are the string's.
+static inline const char* string_bytes(const String* string) {
+    if (string->length <= STRING_INLINE_CAPACITY) return string->data.inline_chars;
+    return __atomic_load_n(&string->data.chars, __ATOMIC_RELAXED);
+}
+
+// Threads that race to fill in the hash store the same value.
+static inline uint64_t string_hash(String* string) {
+    uint64_t hash = __atomic_load_n(&string->hash, __ATOMIC_RELAXED);
+    if (hash == 0) {
+        hash = string_hash_bytes(string_bytes(string), string->length);
+        __atomic_store_n(&string->hash, hash, __ATOMIC_RELAXED);
+    }
+    return hash;
+}
+
+int string_equal(String* a, String* b);
+
+// Byte-wise order, like strcmp.
+int string_compare(const String* a, const String* b);
+
+#endif
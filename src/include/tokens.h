@@ -20,6 +20,8 @@ typedef enum {
     TOKEN_MATCH,
     TOKEN_TYPE,
     TOKEN_RETURN,
+    TOKEN_SPAWN,
+    TOKEN_AWAIT,
     
     TOKEN_INT_TYPE,
     TOKEN_FLOAT_TYPE,
@@ -51,12 +53,14 @@ typedef enum {
     TOKEN_COMMA,       		
     TOKEN_COLON,       		
     TOKEN_DOT,         		
+    TOKEN_RANGE,
     TOKEN_LPAREN,      		
     TOKEN_RPAREN,      		
     TOKEN_LBRACE,      		
     TOKEN_RBRACE,      		
     TOKEN_LBRACKET,   		
     TOKEN_RBRACKET,    		
+    TOKEN_AT,
     
     TOKEN_NEWLINE,     		
     TOKEN_EOF,         		
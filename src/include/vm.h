@@ -0,0 +1,55 @@
+#ifndef VM_H
+#define VM_H
+
+#include "hunick.h"
+#include "heap.h"
+#include "ast.h"
+#include "object.h"
+#include "environment.h"
+#include "semantic.h"
+#include "flatast.h"
+#include <pthread.h>
+
+typedef struct Scheduler Scheduler;
+typedef struct AsyncIO AsyncIO;
+
+// Everything one interpreter instance owns. The runtime reaches it through
+// the thread's current VM: hunick_vm_run binds the VM for the duration of
+// the run and scheduler workers are bound to the VM that started them.
+// Code that never binds one (the command line tools) uses a default VM
+// created on first use.
+struct HunickVM {
+    Heap heap;
+    Scheduler* scheduler;
+    AsyncIO* aio;
+
+    pthread_mutex_t memo_lock;
+    MemoTable* memo_tables;      // every memo table created, for --stats
+
+    SemanticAnalyzer* analyzer;
+    Environment* globals;
+    int use_flat_ast;
+
+    // Functions point into the AST (or FlatAst) that defined them, so
+    // every run's program stays alive with the VM.
+    Program** programs;
+    FlatAst** flats;
+    int run_count;
+    int run_capacity;
+
+    Object* result;
+    char* error;
+    size_t error_length;
+    size_t error_capacity;
+};
+
+HunickVM* vm_current(void);
+
+// Makes vm the calling thread's current VM and returns the previous one.
+HunickVM* vm_bind(HunickVM* vm);
+
+static inline Heap* vm_heap(void) {
+    return &vm_current()->heap;
+}
+
+#endif
@@ -0,0 +1,622 @@
+#include "aio.h"
+#include "object.h"
+#include "vm.h"
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define RING_ENTRIES 256
+#define RING_COMPLETIONS 65536
+#define RING_OPEN_FILES 256
+#define POOL_THREADS 4
+#define READ_CHUNK 65536
+#define EPOLL_BATCH 64
+#define DRAIN_POLL_MS 10
+
+typedef enum {
+    AIO_READ,
+    AIO_WRITE,
+    AIO_SLEEP
+} AsyncKind;
+
+// Where a ring operation is. A file is opened, then read or written one
+// submission at a time until it is done; a sleep is a single timeout.
+typedef enum {
+    STEP_OPEN,
+    STEP_TRANSFER,
+    STEP_WAIT
+} AsyncStep;
+
+typedef struct AsyncOp {
+    AsyncKind kind;
+    AsyncStep step;
+    Task* task;
+    const char* path;
+    const char* data;        // write: the new contents
+    size_t length;           // write: bytes in data
+    char* buffer;            // read: the contents so far
+    size_t capacity;
+    size_t done;             // bytes read or written so far
+    int fd;                  // the file, or the pool's timerfd for a sleep
+    int failed;
+    int64_t milliseconds;
+    struct __kernel_timespec timeout;
+    struct AsyncOp* next;
+} AsyncOp;
+
+typedef struct Ring {
+    int fd;
+    _Atomic unsigned* sq_head;
+    _Atomic unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    _Atomic unsigned* cq_head;
+    _Atomic unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+
+    // At most `completions` operations are in the kernel at once, so the
+    // completion queue never overflows, and at most RING_OPEN_FILES of them
+    // hold a file descriptor; the rest wait here in order. Submissions are
+    // handed over one by one, so a small submission queue is enough.
+    unsigned completions;
+    unsigned in_flight;
+    unsigned open_files;
+    AsyncOp* backlog;
+    AsyncOp* backlog_tail;
+} Ring;
+
+typedef struct Pool {
+    int epoll_fd;
+    int event_fd;            // bumped by a pool thread after each job
+    pthread_t threads[POOL_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    AsyncOp* jobs;
+    AsyncOp* jobs_tail;
+    AsyncOp* finished;
+    int stopping;
+} Pool;
+
+struct AsyncIO {
+    int use_uring;
+    atomic_int started;
+    int uring;               // the ring is in use, else the pool
+    pthread_mutex_t lock;    // start-up, and the ring's queues
+    Ring ring;
+    Pool pool;
+    atomic_int outstanding;
+};
+
+static AsyncIO* current_aio(void) {
+    return vm_current()->aio;
+}
+
+AsyncIO* aio_new(void) {
+    AsyncIO* aio = calloc(1, sizeof(AsyncIO));
+    aio->use_uring = 1;
+    pthread_mutex_init(&aio->lock, NULL);
+    return aio;
+}
+
+void aio_set_uring(int enabled) {
+    current_aio()->use_uring = enabled;
+}
+
+// --- Completion ---------------------------------------------------------
+
+static void op_finish(AsyncOp* op) {
+    if (op->fd >= 0) close(op->fd);
+
+    Object* result = NULL;
+    switch (op->kind) {
+        case AIO_READ:
+            if (op->failed || !op->buffer) {
+                result = object_new_string("");
+            } else {
+                result = object_new_string_length(op->buffer, (int64_t)op->done);
+            }
+            break;
+        case AIO_WRITE:
+            result = object_new_integer(op->failed ? -1 : (int64_t)op->done);
+            break;
+        case AIO_SLEEP:
+            break;
+    }
+
+    AsyncIO* aio = current_aio();
+    scheduler_complete(op->task, result);
+    free(op->buffer);
+    free(op);
+    atomic_fetch_sub(&aio->outstanding, 1);
+}
+
+// Leaves room for at least one more chunk and the terminating NUL.
+static void read_buffer_reserve(AsyncOp* op) {
+    if (op->capacity - op->done > READ_CHUNK / 2) return;
+    op->capacity = op->capacity ? op->capacity * 2 : READ_CHUNK;
+    op->buffer = realloc(op->buffer, op->capacity);
+}
+
+// --- io_uring -----------------------------------------------------------
+
+static int ring_enter(Ring* ring, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+// Operations are submitted as opcodes the kernel has had since 5.6; a ring
+// without IORING_FEAT_EXT_ARG (5.11) is not used, which also guarantees
+// them and lets a waiter block with a timeout.
+static int ring_setup(Ring* ring) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = RING_COMPLETIONS;
+    int fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (fd < 0) return 0;
+    if (!(params.features & IORING_FEAT_EXT_ARG)) {
+        close(fd);
+        return 0;
+    }
+
+    ring->fd = fd;
+    ring->completions = params.cq_entries;
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ring->sq_map == MAP_FAILED || ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED) {
+        if (ring->sq_map != MAP_FAILED) munmap(ring->sq_map, ring->sq_map_size);
+        if (ring->cq_map != MAP_FAILED) munmap(ring->cq_map, ring->cq_map_size);
+        if (ring->sqes != MAP_FAILED) munmap(ring->sqes, ring->sqes_size);
+        close(fd);
+        return 0;
+    }
+
+    char* sq = ring->sq_map;
+    char* cq = ring->cq_map;
+    ring->sq_head = (_Atomic unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (_Atomic unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (_Atomic unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (_Atomic unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->in_flight = 0;
+    ring->open_files = 0;
+    ring->backlog = NULL;
+    ring->backlog_tail = NULL;
+    return 1;
+}
+
+static void ring_free(Ring* ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->cq_map, ring->cq_map_size);
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+}
+
+static void ring_prepare(struct io_uring_sqe* sqe, AsyncOp* op) {
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+
+    switch (op->step) {
+        case STEP_OPEN:
+            sqe->opcode = IORING_OP_OPENAT;
+            sqe->fd = AT_FDCWD;
+            sqe->addr = (uint64_t)(uintptr_t)op->path;
+            sqe->len = 0644;
+            sqe->open_flags = op->kind == AIO_READ ? O_RDONLY | O_CLOEXEC : O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+            break;
+        case STEP_TRANSFER:
+            sqe->fd = op->fd;
+            sqe->off = op->done;
+            if (op->kind == AIO_READ) {
+                sqe->opcode = IORING_OP_READ;
+                sqe->addr = (uint64_t)(uintptr_t)(op->buffer + op->done);
+                sqe->len = (unsigned)(op->capacity - op->done - 1);
+            } else {
+                size_t left = op->length - op->done;
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->addr = (uint64_t)(uintptr_t)(op->data + op->done);
+                sqe->len = left > READ_CHUNK * 16 ? READ_CHUNK * 16 : (unsigned)left;
+            }
+            break;
+        case STEP_WAIT:
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->addr = (uint64_t)(uintptr_t)&op->timeout;
+            sqe->len = 1;
+            break;
+    }
+}
+
+// Caller holds aio->lock. Every queued entry is handed to the kernel
+// straight away, so the submission queue never fills up.
+static int ring_has_room(Ring* ring, AsyncOp* op) {
+    return ring->in_flight < ring->completions && (op->step != STEP_OPEN || ring->open_files < RING_OPEN_FILES);
+}
+
+static void ring_submit(Ring* ring, AsyncOp* op) {
+    if (!ring_has_room(ring, op)) {
+        op->next = NULL;
+        if (ring->backlog_tail) {
+            ring->backlog_tail->next = op;
+        } else {
+            ring->backlog = op;
+        }
+        ring->backlog_tail = op;
+        return;
+    }
+
+    unsigned tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+    unsigned index = tail & ring->sq_mask;
+    ring_prepare(&ring->sqes[index], op);
+    ring->sq_array[index] = index;
+    atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+    ring->in_flight++;
+    if (op->step == STEP_OPEN) ring->open_files++;
+
+    unsigned queued = tail + 1 - atomic_load_explicit(ring->sq_head, memory_order_acquire);
+    ring_enter(ring, queued, 0, 0, NULL, 0);
+}
+
+// Moves op on after one of its submissions completed with res. Returns 1
+// once the operation is finished.
+static int ring_advance(Ring* ring, AsyncOp* op, int res) {
+    switch (op->step) {
+        case STEP_WAIT:
+            op_finish(op);   // -ETIME is the normal outcome
+            return 1;
+
+        case STEP_OPEN:
+            if (res < 0) {
+                op->failed = 1;
+                op_finish(op);
+                return 1;
+            }
+            op->fd = res;
+            op->step = STEP_TRANSFER;
+            if (op->kind == AIO_WRITE && op->length == 0) {
+                op_finish(op);
+                return 1;
+            }
+            if (op->kind == AIO_READ) read_buffer_reserve(op);
+            ring_submit(ring, op);
+            return 0;
+
+        case STEP_TRANSFER:
+            if (res < 0 || (res == 0 && op->kind == AIO_WRITE)) {
+                op->failed = 1;
+                op_finish(op);
+                return 1;
+            }
+            if (res == 0) {
+                op_finish(op);
+                return 1;
+            }
+            op->done += res;
+            if (op->kind == AIO_WRITE && op->done == op->length) {
+                op_finish(op);
+                return 1;
+            }
+            if (op->kind == AIO_READ) read_buffer_reserve(op);
+            ring_submit(ring, op);
+            return 0;
+    }
+    return 0;
+}
+
+// Caller holds aio->lock.
+static int ring_reap(Ring* ring) {
+    int finished = 0;
+    unsigned head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+        AsyncOp* op = (AsyncOp*)(uintptr_t)cqe->user_data;
+        int res = cqe->res;
+        head++;
+        atomic_store_explicit(ring->cq_head, head, memory_order_release);
+        ring->in_flight--;
+        int is_file = op->kind != AIO_SLEEP;
+        if (ring_advance(ring, op, res)) {
+            if (is_file) ring->open_files--;
+            finished++;
+        }
+
+        if (head == tail) tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+    }
+
+    while (ring->backlog && ring_has_room(ring, ring->backlog)) {
+        AsyncOp* op = ring->backlog;
+        ring->backlog = op->next;
+        if (!ring->backlog) ring->backlog_tail = NULL;
+        ring_submit(ring, op);
+    }
+    return finished;
+}
+
+// Another thread already reaping is as good as reaping here, so a busy
+// lock just reports nothing. The wait itself happens outside the lock.
+static int ring_poll(AsyncIO* aio, int timeout_ms) {
+    if (pthread_mutex_trylock(&aio->lock) != 0) return 0;
+    int finished = ring_reap(&aio->ring);
+    pthread_mutex_unlock(&aio->lock);
+    if (finished || timeout_ms <= 0) return finished;
+
+    struct __kernel_timespec timeout = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000LL };
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts = (uint64_t)(uintptr_t)&timeout;
+    ring_enter(&aio->ring, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+
+    pthread_mutex_lock(&aio->lock);
+    finished = ring_reap(&aio->ring);
+    pthread_mutex_unlock(&aio->lock);
+    return finished;
+}
+
+// --- Thread pool and epoll ----------------------------------------------
+
+static void run_blocking(AsyncOp* op) {
+    op->fd = op->kind == AIO_READ ? open(op->path, O_RDONLY | O_CLOEXEC)
+                                  : open(op->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (op->fd < 0) {
+        op->failed = 1;
+        return;
+    }
+
+    for (;;) {
+        ssize_t count;
+        if (op->kind == AIO_READ) {
+            read_buffer_reserve(op);
+            count = read(op->fd, op->buffer + op->done, op->capacity - op->done - 1);
+            if (count == 0) return;
+        } else {
+            if (op->done == op->length) return;
+            count = write(op->fd, op->data + op->done, op->length - op->done);
+            if (count == 0) count = -1;
+        }
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            op->failed = 1;
+            return;
+        }
+        op->done += count;
+    }
+}
+
+static void* pool_main(void* arg) {
+    Pool* pool = arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->jobs && !pool->stopping) {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        AsyncOp* op = pool->jobs;
+        if (!op) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pool->jobs = op->next;
+        if (!pool->jobs) pool->jobs_tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        run_blocking(op);
+
+        pthread_mutex_lock(&pool->lock);
+        op->next = pool->finished;
+        pool->finished = op;
+        pthread_mutex_unlock(&pool->lock);
+
+        uint64_t one = 1;
+        while (write(pool->event_fd, &one, sizeof(one)) < 0 && errno == EINTR) {}
+    }
+    return NULL;
+}
+
+static void pool_start(Pool* pool) {
+    pool->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    pool->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pool->jobs = NULL;
+    pool->jobs_tail = NULL;
+    pool->finished = NULL;
+    pool->stopping = 0;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(pool->epoll_fd, EPOLL_CTL_ADD, pool->event_fd, &event);
+
+    for (int i = 0; i < POOL_THREADS; i++) {
+        pthread_create(&pool->threads[i], NULL, pool_main, pool);
+    }
+}
+
+static void pool_free(Pool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 0; i < POOL_THREADS; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    close(pool->event_fd);
+    close(pool->epoll_fd);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+}
+
+// Regular files are always "ready" to epoll, so file operations go to the
+// pool; sleeps are one-shot timerfds watched directly.
+static void pool_submit(Pool* pool, AsyncOp* op) {
+    if (op->kind == AIO_SLEEP) {
+        op->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        struct itimerspec when;
+        memset(&when, 0, sizeof(when));
+        when.it_value.tv_sec = op->milliseconds / 1000;
+        when.it_value.tv_nsec = (op->milliseconds % 1000) * 1000000;
+        if (when.it_value.tv_sec == 0 && when.it_value.tv_nsec == 0) when.it_value.tv_nsec = 1;  // zero disarms
+        timerfd_settime(op->fd, 0, &when, NULL);
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLONESHOT;
+        event.data.ptr = op;
+        epoll_ctl(pool->epoll_fd, EPOLL_CTL_ADD, op->fd, &event);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    op->next = NULL;
+    if (pool->jobs_tail) {
+        pool->jobs_tail->next = op;
+    } else {
+        pool->jobs = op;
+    }
+    pool->jobs_tail = op;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static int pool_poll(Pool* pool, int timeout_ms) {
+    struct epoll_event events[EPOLL_BATCH];
+    int count = epoll_wait(pool->epoll_fd, events, EPOLL_BATCH, timeout_ms > 0 ? timeout_ms : 0);
+    int finished = 0;
+
+    for (int i = 0; i < count; i++) {
+        AsyncOp* op = events[i].data.ptr;
+        if (op) {
+            op_finish(op);
+            finished++;
+            continue;
+        }
+
+        uint64_t value;
+        if (read(pool->event_fd, &value, sizeof(value)) < 0) continue;  // another poller got it
+        pthread_mutex_lock(&pool->lock);
+        AsyncOp* done = pool->finished;
+        pool->finished = NULL;
+        pthread_mutex_unlock(&pool->lock);
+        while (done) {
+            AsyncOp* next = done->next;
+            op_finish(done);
+            finished++;
+            done = next;
+        }
+    }
+    return finished;
+}
+
+// --- Operations ---------------------------------------------------------
+
+static AsyncIO* started_aio(void) {
+    AsyncIO* aio = current_aio();
+    if (!atomic_load_explicit(&aio->started, memory_order_acquire)) {
+        pthread_mutex_lock(&aio->lock);
+        if (!atomic_load_explicit(&aio->started, memory_order_relaxed)) {
+            aio->uring = aio->use_uring && ring_setup(&aio->ring);
+            if (!aio->uring) pool_start(&aio->pool);
+            atomic_store_explicit(&aio->started, 1, memory_order_release);
+        }
+        pthread_mutex_unlock(&aio->lock);
+    }
+    return aio;
+}
+
+static Task* submit(AsyncOp* op) {
+    AsyncIO* aio = started_aio();
+    Task* task = op->task;
+    atomic_fetch_add(&aio->outstanding, 1);
+
+    if (aio->uring) {
+        pthread_mutex_lock(&aio->lock);
+        ring_submit(&aio->ring, op);
+        pthread_mutex_unlock(&aio->lock);
+    } else {
+        pool_submit(&aio->pool, op);
+    }
+    return task;
+}
+
+static AsyncOp* op_new(AsyncKind kind, AsyncStep step) {
+    AsyncOp* op = calloc(1, sizeof(AsyncOp));
+    op->kind = kind;
+    op->step = step;
+    op->task = scheduler_task_new();
+    op->fd = -1;
+    return op;
+}
+
+Task* aio_read_file(const char* path) {
+    AsyncOp* op = op_new(AIO_READ, STEP_OPEN);
+    op->path = path;
+    return submit(op);
+}
+
+Task* aio_write_file(const char* path, const char* data) {
+    AsyncOp* op = op_new(AIO_WRITE, STEP_OPEN);
+    op->path = path;
+    op->data = data;
+    op->length = strlen(data);
+    return submit(op);
+}
+
+Task* aio_sleep(int64_t milliseconds) {
+    AsyncOp* op = op_new(AIO_SLEEP, STEP_WAIT);
+    if (milliseconds < 0) milliseconds = 0;
+    op->milliseconds = milliseconds;
+    op->timeout.tv_sec = milliseconds / 1000;
+    op->timeout.tv_nsec = (milliseconds % 1000) * 1000000;
+    return submit(op);
+}
+
+int aio_poll(int timeout_ms) {
+    AsyncIO* aio = current_aio();
+    if (atomic_load(&aio->outstanding) == 0) return 0;
+    return aio->uring ? ring_poll(aio, timeout_ms) : pool_poll(&aio->pool, timeout_ms);
+}
+
+void aio_drain(void) {
+    while (atomic_load(&current_aio()->outstanding) > 0) {
+        if (!aio_poll(DRAIN_POLL_MS)) sched_yield();
+    }
+}
+
+void aio_free(AsyncIO* aio) {
+    if (!aio) return;
+    if (atomic_load(&aio->started)) {
+        if (aio->uring) {
+            ring_free(&aio->ring);
+        } else {
+            pool_free(&aio->pool);
+        }
+    }
+    pthread_mutex_destroy(&aio->lock);
+    free(aio);
+}
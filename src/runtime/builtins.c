@@ -0,0 +1,340 @@
+#include "builtins.h"
+#include "aio.h"
+#include "array.h"
+#include "channel.h"
+#include "lines.h"
+#include "map.h"
+#include "output.h"
+#include "sequence.h"
+#include "simd.h"
+#include <string.h>
+
+// channel() is unbounded, channel(n) holds at most n values (at least one).
+static Object* builtin_channel(Object** args, int arg_count) {
+    int64_t capacity = 0;
+    if (arg_count == 1 && args[0] && args[0]->type == OBJ_INTEGER) {
+        capacity = args[0]->value.integer > 0 ? args[0]->value.integer : 1;
+    }
+    return object_new_channel(channel_new(capacity));
+}
+
+static Object* builtin_send(Object** args, int arg_count) {
+    if (arg_count != 2 || !args[0] || args[0]->type != OBJ_CHANNEL) return object_new_null();
+    channel_send(args[0]->value.channel, args[1] ? args[1] : object_new_null());
+    return NULL;
+}
+
+// null once the channel is closed and empty.
+static Object* builtin_recv(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0] || args[0]->type != OBJ_CHANNEL) return object_new_null();
+    Object* item = channel_recv(args[0]->value.channel);
+    return item ? item : object_new_null();
+}
+
+static Object* builtin_close(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0] || args[0]->type != OBJ_CHANNEL) return object_new_null();
+    channel_close(args[0]->value.channel);
+    return NULL;
+}
+
+// Asynchronous I/O: each starts the operation and returns a future for
+// its result at once.
+static Object* builtin_read_file_async(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0] || args[0]->type != OBJ_STRING) return object_new_null();
+    return object_new_future(aio_read_file(string_chars(&args[0]->value.string)));
+}
+
+static Object* builtin_write_async(Object** args, int arg_count) {
+    if (arg_count != 2 || !args[0] || args[0]->type != OBJ_STRING ||
+        !args[1] || args[1]->type != OBJ_STRING) {
+        return object_new_null();
+    }
+    return object_new_future(aio_write_file(string_chars(&args[0]->value.string), string_chars(&args[1]->value.string)));
+}
+
+static Object* builtin_sleep(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0] || args[0]->type != OBJ_INTEGER) return object_new_null();
+    return object_new_future(aio_sleep(args[0]->value.integer));
+}
+
+static Object* builtin_len(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0]) return object_new_null();
+    if (args[0]->type == OBJ_MAP) return object_new_integer(args[0]->value.map->size);
+    if (args[0]->type == OBJ_STRING) return object_new_integer(args[0]->value.string.length);
+    if (args[0]->type != OBJ_ARRAY) return object_new_null();
+    return object_new_integer(args[0]->value.array->length);
+}
+
+static Object* builtin_push(Object** args, int arg_count) {
+    if (arg_count != 2 || !args[0] || args[0]->type != OBJ_ARRAY) return object_new_null();
+    array_push(args[0]->value.array, args[1]);
+    return NULL;
+}
+
+// Whole-array operations, run by the vector kernels. Mismatched operands
+// give null, as do min, max and argmax of an empty array. An empty `[]`
+// that was never pushed to has no kind and counts as [int].
+static int is_array_call(Object** args, int arg_count, int expected_count) {
+    if (arg_count != expected_count || !args[0] || args[0]->type != OBJ_ARRAY) return 0;
+    return expected_count == 1 || args[1] != NULL;
+}
+
+static int is_float_array(const Array* array) {
+    return array->kind == ARRAY_FLOAT;
+}
+
+// Two arrays a kernel can combine: equal lengths and, unless empty, the
+// same kind.
+static int is_matching_array(const Array* a, Object* other) {
+    if (other->type != OBJ_ARRAY || other->value.array->length != a->length) return 0;
+    return a->length == 0 || other->value.array->kind == a->kind;
+}
+
+static Object* builtin_sum(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 1)) return object_new_null();
+    Array* a = args[0]->value.array;
+    if (is_float_array(a)) return object_new_float(simd_sum_f64(a->data.floats, a->length));
+    return object_new_integer(simd_sum_i64(a->data.ints, a->length));
+}
+
+static Object* builtin_dot(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 2) || !is_matching_array(args[0]->value.array, args[1])) {
+        return object_new_null();
+    }
+    Array* a = args[0]->value.array;
+    Array* b = args[1]->value.array;
+    if (is_float_array(a) || is_float_array(b)) {
+        return object_new_float(simd_dot_f64(a->data.floats, b->data.floats, a->length));
+    }
+    return object_new_integer(simd_dot_i64(a->data.ints, b->data.ints, a->length));
+}
+
+static Object* builtin_map_add(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 2) || !is_matching_array(args[0]->value.array, args[1])) {
+        return object_new_null();
+    }
+    Array* a = args[0]->value.array;
+    Array* b = args[1]->value.array;
+    Array* out = array_new(a->kind != ARRAY_UNTYPED ? a->kind : b->kind, a->length);
+    out->length = a->length;
+    if (is_float_array(out)) {
+        simd_add_f64(out->data.floats, a->data.floats, b->data.floats, a->length);
+    } else {
+        simd_add_i64(out->data.ints, a->data.ints, b->data.ints, a->length);
+    }
+    return object_new_array(out);
+}
+
+static Object* builtin_scale(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 2)) return object_new_null();
+    Array* a = args[0]->value.array;
+    Object* k = args[1];
+    Array* out = array_new(a->kind, a->length);
+    out->length = a->length;
+    if (is_float_array(a) && (k->type == OBJ_FLOAT || k->type == OBJ_INTEGER)) {
+        double factor = k->type == OBJ_FLOAT ? k->value.float_val : (double)k->value.integer;
+        simd_scale_f64(out->data.floats, a->data.floats, factor, a->length);
+    } else if (!is_float_array(a) && k->type == OBJ_INTEGER) {
+        simd_scale_i64(out->data.ints, a->data.ints, k->value.integer, a->length);
+    } else {
+        return object_new_null();
+    }
+    return object_new_array(out);
+}
+
+static Object* builtin_min(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 1) || args[0]->value.array->length == 0) return object_new_null();
+    Array* a = args[0]->value.array;
+    if (is_float_array(a)) return object_new_float(simd_min_f64(a->data.floats, a->length));
+    return object_new_integer(simd_min_i64(a->data.ints, a->length));
+}
+
+static Object* builtin_max(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 1) || args[0]->value.array->length == 0) return object_new_null();
+    Array* a = args[0]->value.array;
+    if (is_float_array(a)) return object_new_float(simd_max_f64(a->data.floats, a->length));
+    return object_new_integer(simd_max_i64(a->data.ints, a->length));
+}
+
+static Object* builtin_argmax(Object** args, int arg_count) {
+    if (!is_array_call(args, arg_count, 1) || args[0]->value.array->length == 0) return object_new_null();
+    Array* a = args[0]->value.array;
+    if (is_float_array(a)) return object_new_integer(simd_argmax_f64(a->data.floats, a->length));
+    return object_new_integer(simd_argmax_i64(a->data.ints, a->length));
+}
+
+// get(m, k) is null for a missing key. set stores its own copy of an
+// array or map value, as a let would.
+static int is_map_call(Object** args, int arg_count, int expected_count) {
+    return arg_count == expected_count && args[0] && args[0]->type == OBJ_MAP && args[1];
+}
+
+static Object* builtin_get(Object** args, int arg_count) {
+    if (!is_map_call(args, arg_count, 2)) return object_new_null();
+    Object* value = map_get(args[0]->value.map, args[1]);
+    return value ? value : object_new_null();
+}
+
+static Object* builtin_set(Object** args, int arg_count) {
+    if (!is_map_call(args, arg_count, 3) || !args[2]) return object_new_null();
+    map_set(args[0]->value.map, args[1], object_bind_value(args[2], 0));
+    return NULL;
+}
+
+static Object* builtin_has(Object** args, int arg_count) {
+    if (!is_map_call(args, arg_count, 2)) return object_new_null();
+    return object_new_boolean(map_has(args[0]->value.map, args[1]));
+}
+
+static Object* builtin_delete(Object** args, int arg_count) {
+    if (!is_map_call(args, arg_count, 2)) return object_new_null();
+    return object_new_boolean(map_delete(args[0]->value.map, args[1]));
+}
+
+// Standard output, buffered per thread (see output.h). print writes a
+// value and a newline, strings without quotes; write writes a string's
+// bytes as they are.
+static Object* builtin_print(Object** args, int arg_count) {
+    if (arg_count != 1) return object_new_null();
+    Object* value = args[0] ? args[0] : object_new_null();
+    if (value->type == OBJ_STRING) {
+        output_write(string_bytes(&value->value.string), value->value.string.length);
+    } else {
+        object_print(value);
+    }
+    output_write("\n", 1);
+    return NULL;
+}
+
+static Object* builtin_write(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0] || args[0]->type != OBJ_STRING) return object_new_null();
+    output_write(string_bytes(&args[0]->value.string), args[0]->value.string.length);
+    return NULL;
+}
+
+static Object* builtin_flush(Object** args, int arg_count) {
+    if (arg_count != 0) return object_new_null();
+    output_flush_all();
+    return NULL;
+}
+
+// Slices of a string are views of its bytes, which its heap keeps alive;
+// see object_new_string_view. Offsets are in bytes and clamped to the
+// string.
+static int is_string_call(Object** args, int arg_count, int expected) {
+    return arg_count == expected && args[0] && args[0]->type == OBJ_STRING;
+}
+
+static int64_t clamp_offset(int64_t offset, int64_t low, int64_t high) {
+    return offset < low ? low : offset > high ? high : offset;
+}
+
+static Object* builtin_substring(Object** args, int arg_count) {
+    if (!is_string_call(args, arg_count, 3) || !args[1] || args[1]->type != OBJ_INTEGER ||
+        !args[2] || args[2]->type != OBJ_INTEGER) {
+        return object_new_null();
+    }
+    const String* string = &args[0]->value.string;
+    int64_t start = clamp_offset(args[1]->value.integer, 0, string->length);
+    int64_t end = clamp_offset(args[2]->value.integer, start, string->length);
+    if (start == 0 && end == string->length) return args[0];
+    return object_new_string_view(string_bytes(string) + start, end - start);
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static Object* builtin_trim(Object** args, int arg_count) {
+    if (!is_string_call(args, arg_count, 1)) return object_new_null();
+    const String* string = &args[0]->value.string;
+    const char* start = string_bytes(string);
+    const char* end = start + string->length;
+    while (start < end && is_space(*start)) start++;
+    while (end > start && is_space(end[-1])) end--;
+    if (end - start == string->length) return args[0];
+    return object_new_string_view(start, end - start);
+}
+
+static Object* builtin_split(Object** args, int arg_count) {
+    if (!is_string_call(args, arg_count, 2) || !args[1] || args[1]->type != OBJ_STRING) return object_new_null();
+    return object_new_sequence(sequence_split(args[0], args[1]));
+}
+
+// Lazy line readers; see lines.h.
+static Object* builtin_lines(Object** args, int arg_count) {
+    if (arg_count != 1 || !args[0] || args[0]->type != OBJ_STRING) return object_new_null();
+    return object_new_sequence(lines_open(string_chars(&args[0]->value.string)));
+}
+
+static Object* builtin_stdin_lines(Object** args, int arg_count) {
+    if (arg_count != 0) return object_new_null();
+    return object_new_sequence(lines_stdin());
+}
+
+// Pipeline stages: `s |> filter(p)` calls filter(s, p) and returns a new
+// sequence that pulls from s on demand.
+static int is_stage_call(Object** args, int arg_count) {
+    return arg_count == 2 && args[0] && args[0]->type == OBJ_SEQUENCE && args[1];
+}
+
+static Object* builtin_filter(Object** args, int arg_count) {
+    if (!is_stage_call(args, arg_count)) return object_new_null();
+    return object_new_sequence(sequence_filter(args[0]->value.sequence, args[1]));
+}
+
+static Object* builtin_map(Object** args, int arg_count) {
+    if (!is_stage_call(args, arg_count)) return object_new_null();
+    return object_new_sequence(sequence_map(args[0]->value.sequence, args[1]));
+}
+
+static Object* builtin_take(Object** args, int arg_count) {
+    if (!is_stage_call(args, arg_count) || args[1]->type != OBJ_INTEGER) return object_new_null();
+    return object_new_sequence(sequence_take(args[0]->value.sequence, args[1]->value.integer));
+}
+
+#define BUILTIN(name, function) \
+    { .type = OBJ_BUILTIN, .value.builtin = &(const Builtin){ name, function } }
+
+static Object builtins[] = {
+    BUILTIN("channel", builtin_channel),
+    BUILTIN("send", builtin_send),
+    BUILTIN("recv", builtin_recv),
+    BUILTIN("close", builtin_close),
+    BUILTIN("read_file_async", builtin_read_file_async),
+    BUILTIN("write_async", builtin_write_async),
+    BUILTIN("sleep", builtin_sleep),
+    BUILTIN("print", builtin_print),
+    BUILTIN("write", builtin_write),
+    BUILTIN("flush", builtin_flush),
+    BUILTIN("lines", builtin_lines),
+    BUILTIN("stdin_lines", builtin_stdin_lines),
+    BUILTIN("len", builtin_len),
+    BUILTIN("substring", builtin_substring),
+    BUILTIN("trim", builtin_trim),
+    BUILTIN("split", builtin_split),
+    BUILTIN("push", builtin_push),
+    BUILTIN("sum", builtin_sum),
+    BUILTIN("dot", builtin_dot),
+    BUILTIN("map_add", builtin_map_add),
+    BUILTIN("scale", builtin_scale),
+    BUILTIN("min", builtin_min),
+    BUILTIN("max", builtin_max),
+    BUILTIN("argmax", builtin_argmax),
+    BUILTIN("get", builtin_get),
+    BUILTIN("set", builtin_set),
+    BUILTIN("has", builtin_has),
+    BUILTIN("delete", builtin_delete),
+    BUILTIN("filter", builtin_filter),
+    BUILTIN("map", builtin_map),
+    BUILTIN("take", builtin_take),
+};
+
+#define BUILTIN_COUNT (int)(sizeof(builtins) / sizeof(builtins[0]))
+
+Object* builtin_lookup(const char* name) {
+    for (int i = 0; i < BUILTIN_COUNT; i++) {
+        if (strcmp(builtins[i].value.builtin->name, name) == 0) return &builtins[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,211 @@
+#include "channel.h"
+#include "scheduler.h"
+#include "vm.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+typedef struct ChannelCell {
+    atomic_size_t sequence;
+    void* item;
+} ChannelCell;
+
+typedef struct ChannelNode {
+    _Atomic(struct ChannelNode*) next;
+    void* item;
+} ChannelNode;
+
+struct Channel {
+    int64_t capacity;    // 0 for the linked variant
+
+    // Bounded: cell i is free for the send at position p when its
+    // sequence is p, and holds an item for the recv at p when it is p + 1.
+    ChannelCell* cells;
+    size_t mask;
+    _Alignas(64) atomic_size_t send_position;
+    _Alignas(64) atomic_size_t recv_position;
+
+    // Unbounded: head is a dummy node whose successor is the oldest item.
+    _Alignas(64) _Atomic(ChannelNode*) head;
+    _Alignas(64) _Atomic(ChannelNode*) tail;
+
+    atomic_int closed;
+};
+
+static ChannelNode* node_new(Channel* channel, void* item) {
+    ChannelNode* node = heap_alloc_beside(vm_heap(), channel, sizeof(ChannelNode));
+    atomic_init(&node->next, NULL);
+    node->item = item;
+    return node;
+}
+
+Channel* channel_new(int64_t capacity) {
+    Heap* heap = vm_heap();
+    Channel* channel = heap_alloc_aligned(heap, sizeof(Channel), _Alignof(Channel));
+    channel->capacity = capacity > 0 ? capacity : 0;
+    channel->cells = NULL;
+    channel->mask = 0;
+    atomic_init(&channel->send_position, 0);
+    atomic_init(&channel->recv_position, 0);
+    atomic_init(&channel->closed, 0);
+
+    if (capacity > 0) {
+        size_t size = 1;
+        while (size < (size_t)capacity) size <<= 1;
+        channel->capacity = (int64_t)size;
+        channel->mask = size - 1;
+        channel->cells = heap_alloc(heap, sizeof(ChannelCell) * size);
+        for (size_t i = 0; i < size; i++) {
+            atomic_init(&channel->cells[i].sequence, i);
+            channel->cells[i].item = NULL;
+        }
+        atomic_init(&channel->head, NULL);
+        atomic_init(&channel->tail, NULL);
+    } else {
+        ChannelNode* dummy = node_new(channel, NULL);
+        atomic_init(&channel->head, dummy);
+        atomic_init(&channel->tail, dummy);
+    }
+    return channel;
+}
+
+int64_t channel_capacity(const Channel* channel) {
+    return channel->capacity;
+}
+
+static int ring_send(Channel* channel, void* item) {
+    size_t position = atomic_load_explicit(&channel->send_position, memory_order_relaxed);
+    ChannelCell* cell;
+
+    for (;;) {
+        cell = &channel->cells[position & channel->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&channel->send_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return 0;  // the cell still holds an item from a lap ago: full
+        } else {
+            position = atomic_load_explicit(&channel->send_position, memory_order_relaxed);
+        }
+    }
+
+    cell->item = item;
+    atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+    return 1;
+}
+
+static void* ring_recv(Channel* channel) {
+    size_t position = atomic_load_explicit(&channel->recv_position, memory_order_relaxed);
+    ChannelCell* cell;
+
+    for (;;) {
+        cell = &channel->cells[position & channel->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&channel->recv_position, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return NULL;  // not written yet: empty
+        } else {
+            position = atomic_load_explicit(&channel->recv_position, memory_order_relaxed);
+        }
+    }
+
+    void* item = cell->item;
+    atomic_store_explicit(&cell->sequence, position + channel->mask + 1, memory_order_release);
+    return item;
+}
+
+static void linked_send(Channel* channel, void* item) {
+    ChannelNode* node = node_new(channel, item);
+
+    for (;;) {
+        ChannelNode* tail = atomic_load_explicit(&channel->tail, memory_order_acquire);
+        ChannelNode* next = atomic_load_explicit(&tail->next, memory_order_acquire);
+        if (tail != atomic_load_explicit(&channel->tail, memory_order_acquire)) continue;
+
+        if (next == NULL) {
+            if (atomic_compare_exchange_weak_explicit(&tail->next, &next, node,
+                                                      memory_order_release, memory_order_relaxed)) {
+                atomic_compare_exchange_strong_explicit(&channel->tail, &tail, node,
+                                                        memory_order_release, memory_order_relaxed);
+                return;
+            }
+        } else {
+            // Another send linked its node but has not swung tail yet.
+            atomic_compare_exchange_strong_explicit(&channel->tail, &tail, next,
+                                                    memory_order_release, memory_order_relaxed);
+        }
+    }
+}
+
+static void* linked_recv(Channel* channel) {
+    for (;;) {
+        ChannelNode* head = atomic_load_explicit(&channel->head, memory_order_acquire);
+        ChannelNode* tail = atomic_load_explicit(&channel->tail, memory_order_acquire);
+        ChannelNode* next = atomic_load_explicit(&head->next, memory_order_acquire);
+        if (head != atomic_load_explicit(&channel->head, memory_order_acquire)) continue;
+
+        if (head == tail) {
+            if (next == NULL) return NULL;
+            atomic_compare_exchange_strong_explicit(&channel->tail, &tail, next,
+                                                    memory_order_release, memory_order_relaxed);
+        } else {
+            // next->item was written before next was linked and is never
+            // changed, so reading it before winning the race is safe.
+            void* item = next->item;
+            if (atomic_compare_exchange_weak_explicit(&channel->head, &head, next,
+                                                      memory_order_acq_rel, memory_order_relaxed)) {
+                return item;
+            }
+        }
+    }
+}
+
+int channel_try_send(Channel* channel, void* item) {
+    heap_note_store(channel, item);
+    if (channel->cells) return ring_send(channel, item);
+    linked_send(channel, item);
+    return 1;
+}
+
+void* channel_try_recv(Channel* channel) {
+    return channel->cells ? ring_recv(channel) : linked_recv(channel);
+}
+
+static int is_closed(Channel* channel) {
+    return atomic_load_explicit(&channel->closed, memory_order_acquire);
+}
+
+void channel_send(Channel* channel, void* item) {
+    int spins = 0;
+    while (!is_closed(channel) && !channel_try_send(channel, item)) {
+        scheduler_block(&spins);
+    }
+}
+
+// A send finished before the close is seen is still taken: the channel
+// is tried once more after seeing it closed.
+void* channel_recv(Channel* channel) {
+    void* item;
+    int spins = 0;
+    while ((item = channel_try_recv(channel)) == NULL) {
+        if (is_closed(channel)) return channel_try_recv(channel);
+        scheduler_block(&spins);
+    }
+    return item;
+}
+
+// Blocked sends and receives poll (see scheduler_block), so setting the
+// flag is all it takes to wake them.
+void channel_close(Channel* channel) {
+    atomic_store_explicit(&channel->closed, 1, memory_order_release);
+}
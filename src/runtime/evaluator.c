@@ -1,11 +1,26 @@
 #include "evaluator.h"
+#include "memo.h"
+#include "scheduler.h"
+#include "builtins.h"
+#include "sequence.h"
+#include "array.h"
+#include "map.h"
+#include "match.h"
+#include "record.h"
+#include "vm.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <math.h>
 
 static Object* eval_statement(Statement* stmt, Environment* env);
+static int is_container_literal(Expression* expr);
 static Object* eval_expression(Expression* expr, Environment* env);
+static Object* eval_statements(Statement** statements, int count, Environment* env);
 static Object* eval_block_statement(Statement** statements, int count, Environment* env);
+static Object* eval_for_statement(Statement* stmt, Environment* env);
+static Object* eval_while_statement(Statement* stmt, Environment* env);
+static Sequence* generator_new(Statement** body, int count, Environment* env);
 
 static int is_truthy(Object* obj) {
     if (obj == NULL) return 0;
@@ -20,7 +35,7 @@ static int is_truthy(Object* obj) {
 }
 
 static Environment* extend_function_env(Object* fn, Object** args, int arg_count) {
-    Environment* env = environment_new_enclosed(fn->value.function.env);
+    Environment* env = environment_new_on_heap(vm_heap(), fn->value.function.env);
 
     for (int i = 0; i < fn->value.function.parameter_count; i++) {
         char* param_name = fn->value.function.parameters[i]->name;
@@ -32,27 +47,53 @@ static Environment* extend_function_env(Object* fn, Object** args, int arg_count
 }
 
 static Object* apply_function(Object* fn, Object** args, int arg_count) {
+    if (fn->type == OBJ_BUILTIN) {
+        return fn->value.builtin->function(args, arg_count);
+    }
+    if (fn->type == OBJ_STRUCT_TYPE) {
+        return record_construct(fn->value.layout, args, arg_count);
+    }
     if (fn->type != OBJ_FUNCTION) {
         return object_new_null();
     }
+    if (fn->value.function.flat) {
+        return flat_apply_function(fn, args, arg_count);
+    }
     
     if (fn->value.function.parameter_count != arg_count) {
         return object_new_null();
     }
+
+    MemoTable* memo = fn->value.function.is_memo ? memo_table_of(fn) : NULL;
+    if (memo) {
+        Object* cached = memo_lookup(memo, args, arg_count);
+        if (cached) return cached;
+    }
     
     Environment* extended_env = extend_function_env(fn, args, arg_count);
-    Object* evaluated = eval_block_statement(fn->value.function.body, fn->value.function.body_count, extended_env);
+    if (fn->value.function.is_generator) {
+        return object_new_sequence(generator_new(fn->value.function.body, fn->value.function.body_count, extended_env));
+    }
+    // The body runs in the call's own environment, which closures it makes
+    // may keep.
+    Object* evaluated = eval_statements(fn->value.function.body, fn->value.function.body_count, extended_env);
     
     if (evaluated && evaluated->type == OBJ_RETURN_VALUE) {
-        Object* unwrapped_value = evaluated->value.return_value;
-        evaluated->value.return_value = NULL; 
-        object_free(evaluated);
-        return unwrapped_value;
+        evaluated = evaluated->value.return_value;
+    }
+
+    if (memo) {
+        memo_store(memo, args, arg_count, evaluated);
     }
     
     return evaluated;
 }
 
+Object* eval_apply_function(Object* fn, Object** args, int arg_count) {
+    if (fn == NULL) return object_new_null();
+    return apply_function(fn, args, arg_count);
+}
+
 Object* Eval(Statement* stmt, Environment* env) {
     return eval_statement(stmt, env);
 }
@@ -68,12 +109,29 @@ Object* eval_program(Program* program, Environment* env) {
     return result;
 }
 
+// Binds the struct's name to its layout, which the name then constructs.
+static Object* eval_type_declaration(Statement* stmt, Environment* env) {
+    Type* type = stmt->data.type_decl.type;
+    int count = type->data.struct_type.field_count;
+    FieldKind* kinds = malloc(sizeof(FieldKind) * (count > 0 ? count : 1));
+
+    for (int i = 0; i < count; i++) {
+        kinds[i] = record_field_kind(type->data.struct_type.field_types[i]);
+    }
+    StructLayout* layout = struct_layout_new(stmt->data.type_decl.name, (const char* const*)type->data.struct_type.field_names,
+                                             kinds, count);
+    free(kinds);
+    environment_set(env, stmt->data.type_decl.name, object_new_struct_type(layout));
+    return NULL;
+}
+
 static Object* eval_statement(Statement* stmt, Environment* env) {
     switch (stmt->node_type) {
         case STMT_EXPRESSION:
             return eval_expression(stmt->data.expression_stmt.expression, env);
         case STMT_LET: {
-            Object* val = eval_expression(stmt->data.let_stmt.value, env);
+            Expression* value = stmt->data.let_stmt.value;
+            Object* val = object_bind_value(eval_expression(value, env), is_container_literal(value));
             if (val) {
                 environment_set(env, stmt->data.let_stmt.name, val);
             }
@@ -86,25 +144,11 @@ static Object* eval_statement(Statement* stmt, Environment* env) {
         case STMT_BLOCK:
             return eval_block_statement(stmt->data.block_stmt.statements, stmt->data.block_stmt.statement_count, env);
         case STMT_WHILE:
-            {
-                Object* result = NULL;
-                while (1) {
-                    Object* condition = eval_expression(stmt->data.while_stmt.condition, env);
-                    if (!is_truthy(condition)) {
-                        // TODO: Liberar memória da condição se necessário
-                        break;
-                    }
-                    // TODO: Liberar memória da condição se necessário
-                    
-                    result = eval_statement(stmt->data.while_stmt.body, env);
-                    
-                    if (result != NULL && result->type == OBJ_RETURN_VALUE) {
-                        return result;
-                    }
-                    // TODO: Liberar memória do result se necessário
-                }
-                return NULL;
-            }
+            return eval_while_statement(stmt, env);
+        case STMT_FOR:
+            return eval_for_statement(stmt, env);
+        case STMT_TYPE:
+            return eval_type_declaration(stmt, env);
         default:
             return NULL;
     }
@@ -127,10 +171,20 @@ static Object* eval_minus_prefix_operator_expression(Object* right) {
     if (right->type == OBJ_INTEGER) {
         return object_new_integer(-right->value.integer);
     }
-    return object_new_null();
+    return object_new_float(-right->value.float_val);
+}
+
+static Object* eval_await_expression(Object* right) {
+    if (right == NULL || right->type != OBJ_FUTURE) {
+        return object_new_null();
+    }
+    return scheduler_await(right->value.task);
 }
 
 static Object* eval_prefix_expression(const char* operator, Object* right) {
+    if (strcmp(operator, "await") == 0) {
+        return eval_await_expression(right);
+    }
     if (strcmp(operator, "!") == 0) {
         return eval_bang_operator_expression(right);
     }
@@ -147,15 +201,170 @@ static Object* eval_integer_infix_expression(const char* operator, Object* left,
     if (strcmp(operator, "+") == 0) return object_new_integer(left_val + right_val);
     if (strcmp(operator, "-") == 0) return object_new_integer(left_val - right_val);
     if (strcmp(operator, "*") == 0) return object_new_integer(left_val * right_val);
-    if (strcmp(operator, "/") == 0) return object_new_integer(left_val / right_val);
+    // Dividing by -1 negates, wrapping instead of trapping at INT64_MIN.
+    if (strcmp(operator, "/") == 0) {
+        if (right_val == 0) return object_new_null();
+        return object_new_integer(right_val == -1 ? (int64_t)(0 - (uint64_t)left_val) : left_val / right_val);
+    }
+    if (strcmp(operator, "%") == 0) {
+        if (right_val == 0) return object_new_null();
+        return object_new_integer(right_val == -1 ? 0 : left_val % right_val);
+    }
     if (strcmp(operator, "<") == 0) return object_new_boolean(left_val < right_val);
     if (strcmp(operator, ">") == 0) return object_new_boolean(left_val > right_val);
+    if (strcmp(operator, "<=") == 0) return object_new_boolean(left_val <= right_val);
+    if (strcmp(operator, ">=") == 0) return object_new_boolean(left_val >= right_val);
     if (strcmp(operator, "==") == 0) return object_new_boolean(left_val == right_val);
     if (strcmp(operator, "!=") == 0) return object_new_boolean(left_val != right_val);
 
     return object_new_null();
 }
 
+static Object* eval_float_infix_expression(const char* operator, double left_val, double right_val) {
+    if (strcmp(operator, "+") == 0) return object_new_float(left_val + right_val);
+    if (strcmp(operator, "-") == 0) return object_new_float(left_val - right_val);
+    if (strcmp(operator, "*") == 0) return object_new_float(left_val * right_val);
+    if (strcmp(operator, "/") == 0) return object_new_float(left_val / right_val);
+    if (strcmp(operator, "%") == 0) return object_new_float(fmod(left_val, right_val));
+    if (strcmp(operator, "<") == 0) return object_new_boolean(left_val < right_val);
+    if (strcmp(operator, ">") == 0) return object_new_boolean(left_val > right_val);
+    if (strcmp(operator, "<=") == 0) return object_new_boolean(left_val <= right_val);
+    if (strcmp(operator, ">=") == 0) return object_new_boolean(left_val >= right_val);
+    if (strcmp(operator, "==") == 0) return object_new_boolean(left_val == right_val);
+    if (strcmp(operator, "!=") == 0) return object_new_boolean(left_val != right_val);
+
+    return object_new_null();
+}
+
+static Object* eval_boolean_infix_expression(const char* operator, int left_val, int right_val) {
+    if (strcmp(operator, "&&") == 0) return object_new_boolean(left_val && right_val);
+    if (strcmp(operator, "||") == 0) return object_new_boolean(left_val || right_val);
+    if (strcmp(operator, "==") == 0) return object_new_boolean(left_val == right_val);
+    if (strcmp(operator, "!=") == 0) return object_new_boolean(left_val != right_val);
+
+    return object_new_null();
+}
+
+static Object* eval_string_infix_expression(const char* operator, const String* left_val, const String* right_val) {
+    if (strcmp(operator, "+") == 0) return object_new_string_concat(left_val, right_val);
+
+    int cmp = string_compare(left_val, right_val);
+
+    if (strcmp(operator, "==") == 0) return object_new_boolean(cmp == 0);
+    if (strcmp(operator, "!=") == 0) return object_new_boolean(cmp != 0);
+    if (strcmp(operator, "<") == 0) return object_new_boolean(cmp < 0);
+    if (strcmp(operator, ">") == 0) return object_new_boolean(cmp > 0);
+    if (strcmp(operator, "<=") == 0) return object_new_boolean(cmp <= 0);
+    if (strcmp(operator, ">=") == 0) return object_new_boolean(cmp >= 0);
+
+    return object_new_null();
+}
+
+static double number_value(Object* obj) {
+    return obj->type == OBJ_INTEGER ? (double)obj->value.integer : obj->value.float_val;
+}
+
+// Callee and arguments are evaluated here, in the spawning task; only the
+// call itself runs on a worker.
+static Object* eval_spawn_expression(Expression* call, Environment* env) {
+    Object* function_obj = eval_expression(call->data.call.function, env);
+    int arg_count = call->data.call.argument_count;
+
+    Object** args = malloc(sizeof(Object*) * (arg_count > 0 ? arg_count : 1));
+    for (int i = 0; i < arg_count; i++) {
+        args[i] = eval_expression(call->data.call.arguments[i], env);
+    }
+
+    return object_new_future(scheduler_spawn(function_obj, args, arg_count));
+}
+
+// `x |> f` is f(x). When the stage is a call to a builtin, as in
+// `s |> filter(p)`, x becomes its first argument instead: filter(s, p).
+static Object* eval_pipe_expression(Expression* expr, Environment* env) {
+    Object* left = eval_expression(expr->data.pipe.left, env);
+    Expression* right = expr->data.pipe.right;
+    Object* stage;
+
+    if (right->node_type == EXPR_CALL) {
+        Object* function_obj = eval_expression(right->data.call.function, env);
+        int is_builtin = function_obj && function_obj->type == OBJ_BUILTIN;
+        int offset = is_builtin ? 1 : 0;
+        int arg_count = right->data.call.argument_count + offset;
+
+        Object** args = malloc(sizeof(Object*) * (arg_count > 0 ? arg_count : 1));
+        args[0] = left;
+        for (int i = 0; i < right->data.call.argument_count; i++) {
+            args[i + offset] = eval_expression(right->data.call.arguments[i], env);
+        }
+        stage = eval_apply_function(function_obj, args, arg_count);
+        free(args);
+        if (is_builtin) return stage;
+    } else {
+        stage = eval_expression(right, env);
+    }
+
+    return eval_apply_function(stage, &left, 1);
+}
+
+static int is_container_literal(Expression* expr) {
+    return expr->node_type == EXPR_ARRAY_LITERAL || expr->node_type == EXPR_MAP_LITERAL;
+}
+
+// The element type comes from the first element; `[]` stays untyped
+// until its first push.
+static Object* eval_array_literal(Expression* expr, Environment* env) {
+    int count = expr->data.array_literal.element_count;
+    Array* array = array_new(ARRAY_UNTYPED, count);
+
+    for (int i = 0; i < count; i++) {
+        array_push(array, eval_expression(expr->data.array_literal.elements[i], env));
+    }
+    return object_new_array(array);
+}
+
+// A later entry with an equal key replaces the earlier one.
+static Object* eval_map_literal(Expression* expr, Environment* env) {
+    int count = expr->data.map_literal.entry_count;
+    Map* map = map_new(count / 2);
+
+    for (int i = 0; i < count; i += 2) {
+        Expression* value = expr->data.map_literal.entries[i + 1];
+        Object* key = eval_expression(expr->data.map_literal.entries[i], env);
+        map_set(map, key, object_bind_value(eval_expression(value, env), is_container_literal(value)));
+    }
+    return object_new_map(map);
+}
+
+// `a[i] = value`; out-of-range stores are dropped.
+static Object* eval_element_assignment(Expression* expr, Environment* env) {
+    Expression* target = expr->data.infix.left;
+    Object* array = eval_expression(target->data.index.array, env);
+    Object* index = eval_expression(target->data.index.index, env);
+    Object* value = eval_expression(expr->data.infix.right, env);
+
+    if (array && index && value && array->type == OBJ_ARRAY && index->type == OBJ_INTEGER) {
+        if (target->data.index.unchecked) {
+            array_store(array->value.array, index->value.integer, value);
+        } else {
+            array_set(array->value.array, index->value.integer, value);
+        }
+    }
+    return NULL;
+}
+
+// `p.x = value` stores into the record p holds.
+static Object* eval_field_assignment(Expression* expr, Environment* env) {
+    Expression* target = expr->data.infix.left;
+    Expression* right = expr->data.infix.right;
+    Object* object = eval_expression(target->data.field.object, env);
+    Object* value = object_bind_value(eval_expression(right, env), is_container_literal(right));
+
+    if (object && value && object->type == OBJ_STRUCT && target->data.field.offset >= 0) {
+        record_store(object->value.record, target->data.field.offset, value);
+    }
+    return NULL;
+}
+
 static Object* eval_expression(Expression* expr, Environment* env) {
     switch (expr->node_type) {
         case EXPR_INTEGER_LITERAL:
@@ -163,22 +372,59 @@ static Object* eval_expression(Expression* expr, Environment* env) {
         case EXPR_FLOAT_LITERAL:
             return object_new_float(expr->data.float_literal.value);
         case EXPR_STRING_LITERAL:
-            return object_new_string(expr->data.string_literal.value);
+            return object_new_string_literal(&expr->data.string_literal.literal);
         case EXPR_BOOLEAN_LITERAL:
             return object_new_boolean(expr->data.boolean_literal.value);
         case EXPR_IDENTIFIER:
-            return environment_get(env, expr->data.identifier.value);
+            {
+                Object* value = environment_get(env, expr->data.identifier.value);
+                return value ? value : builtin_lookup(expr->data.identifier.value);
+            }
         case EXPR_PREFIX: {
+            if (strcmp(expr->data.prefix.operator, "spawn") == 0) {
+                return eval_spawn_expression(expr->data.prefix.right, env);
+            }
             Object* right = eval_expression(expr->data.prefix.right, env);
             return eval_prefix_expression(expr->data.prefix.operator, right);
         }
         case EXPR_INFIX: {
+            if (strcmp(expr->data.infix.operator, "=") == 0) {
+                if (expr->data.infix.left->node_type == EXPR_INDEX) {
+                    return eval_element_assignment(expr, env);
+                }
+                if (expr->data.infix.left->node_type == EXPR_FIELD) {
+                    return eval_field_assignment(expr, env);
+                }
+                Expression* right = expr->data.infix.right;
+                Object* value = object_bind_value(eval_expression(right, env), is_container_literal(right));
+                if (value) {
+                    environment_assign(env, expr->data.infix.left->data.identifier.value, value);
+                }
+                return NULL;
+            }
             Object* left = eval_expression(expr->data.infix.left, env);
+            if (left && left->type == OBJ_BOOLEAN) {
+                if (strcmp(expr->data.infix.operator, "&&") == 0 && !left->value.boolean) return object_new_boolean(0);
+                if (strcmp(expr->data.infix.operator, "||") == 0 && left->value.boolean) return object_new_boolean(1);
+            }
             Object* right = eval_expression(expr->data.infix.right, env);
             
+            if (left == NULL || right == NULL) {
+                return object_new_null();
+            }
             if (left->type == OBJ_INTEGER && right->type == OBJ_INTEGER) {
                 return eval_integer_infix_expression(expr->data.infix.operator, left, right);
             }
+            if ((left->type == OBJ_INTEGER || left->type == OBJ_FLOAT) &&
+                (right->type == OBJ_INTEGER || right->type == OBJ_FLOAT)) {
+                return eval_float_infix_expression(expr->data.infix.operator, number_value(left), number_value(right));
+            }
+            if (left->type == OBJ_BOOLEAN && right->type == OBJ_BOOLEAN) {
+                return eval_boolean_infix_expression(expr->data.infix.operator, left->value.boolean, right->value.boolean);
+            }
+            if (left->type == OBJ_STRING && right->type == OBJ_STRING) {
+                return eval_string_infix_expression(expr->data.infix.operator, &left->value.string, &right->value.string);
+            }
             
             return object_new_null();
         }
@@ -193,13 +439,24 @@ static Object* eval_expression(Expression* expr, Environment* env) {
                 return object_new_null();
             }
         }
+        case EXPR_MATCH: {
+            int arm = match_table_find(expr->data.match.table, eval_expression(expr->data.match.expression, env));
+            if (arm < 0) return object_new_null();
+            return eval_expression(expr->data.match.cases[arm]->result, env);
+        }
         case EXPR_FUNCTION_LITERAL: {
             Parameter** params = expr->data.function_literal.parameters;
             int p_count = expr->data.function_literal.parameter_count;
             Statement** body = expr->data.function_literal.body;
             int b_count = expr->data.function_literal.body_count;
             
-            return object_new_function(params, p_count, body, b_count, env);
+            Object* function = object_new_function(params, p_count, body, b_count, env);
+            function->value.function.is_generator = expr->data.function_literal.is_generator;
+            if (expr->data.function_literal.is_memo && expr->data.function_literal.is_pure) {
+                function->value.function.is_memo = 1;
+                function->value.function.memo_name = expr->data.function_literal.name;
+            }
+            return function;
         }
         case EXPR_CALL: {
             Object* function_obj = eval_expression(expr->data.call.function, env);
@@ -213,25 +470,450 @@ static Object* eval_expression(Expression* expr, Environment* env) {
             free(args);
             return result;
         }
+        case EXPR_PIPE:
+            return eval_pipe_expression(expr, env);
+        case EXPR_ARRAY_LITERAL:
+            return eval_array_literal(expr, env);
+        case EXPR_MAP_LITERAL:
+            return eval_map_literal(expr, env);
+        case EXPR_INDEX: {
+            Object* array = eval_expression(expr->data.index.array, env);
+            Object* index = eval_expression(expr->data.index.index, env);
+            if (!array || !index || array->type != OBJ_ARRAY || index->type != OBJ_INTEGER) {
+                return object_new_null();
+            }
+            if (expr->data.index.unchecked) return array_load(array->value.array, index->value.integer);
+            return array_get(array->value.array, index->value.integer);
+        }
+        case EXPR_FIELD: {
+            Object* object = eval_expression(expr->data.field.object, env);
+            if (!object || object->type != OBJ_STRUCT || expr->data.field.offset < 0) {
+                return object_new_null();
+            }
+            return record_load(object->value.record, expr->data.field.offset);
+        }
         default:
             return NULL;
     }
 }
 
-static Object* eval_block_statement(Statement** statements, int count, Environment* env) {
+static Object* eval_statements(Statement** statements, int count, Environment* env) {
     Object* result = NULL;
-    
-    Environment* enclosed_env = environment_new_enclosed(env);
-
     for (int i = 0; i < count; i++) {
-        result = eval_statement(statements[i], enclosed_env);
+        result = eval_statement(statements[i], env);
+        if (result != NULL && result->type == OBJ_RETURN_VALUE) break;
+    }
+    return result;
+}
+
+static Object* eval_block_statement(Statement** statements, int count, Environment* env) {
+    return eval_statements(statements, count, environment_new_on_heap(vm_heap(), env));
+}
+
+// --- for loops ---
+
+static Object* eval_reduce_identity(const char* operator, Object* current) {
+    int is_float = current && current->type == OBJ_FLOAT;
+
+    if (strcmp(operator, "+") == 0) return is_float ? object_new_float(0.0) : object_new_integer(0);
+    if (strcmp(operator, "*") == 0) return is_float ? object_new_float(1.0) : object_new_integer(1);
+    if (strcmp(operator, "min") == 0) return is_float ? object_new_float(INFINITY) : object_new_integer(INT64_MAX);
+    return is_float ? object_new_float(-INFINITY) : object_new_integer(INT64_MIN);
+}
+
+static Object* eval_reduce_combine(const char* operator, Object* left, Object* right) {
+    if (left == NULL || right == NULL) return left ? left : right;
+
+    if (left->type == OBJ_INTEGER && right->type == OBJ_INTEGER) {
+        int64_t a = left->value.integer;
+        int64_t b = right->value.integer;
+        if (strcmp(operator, "+") == 0) return object_new_integer(a + b);
+        if (strcmp(operator, "*") == 0) return object_new_integer(a * b);
+        if (strcmp(operator, "min") == 0) return a <= b ? left : right;
+        return a >= b ? left : right;
+    }
+
+    double a = number_value(left);
+    double b = number_value(right);
+    if (strcmp(operator, "+") == 0) return object_new_float(a + b);
+    if (strcmp(operator, "*") == 0) return object_new_float(a * b);
+    if (strcmp(operator, "min") == 0) return object_new_float(a <= b ? a : b);
+    return object_new_float(a >= b ? a : b);
+}
+
+typedef struct ParallelFor {
+    LoopBody body;
+    void* loop;
+    Environment* env;
+    char** names;
+    int reduce_count;
+    Object** identities;
+    Object** partials;  // chunk-major, reduce_count per chunk
+} ParallelFor;
+
+static void eval_parallel_chunk(void* context, int64_t chunk, int64_t start, int64_t end) {
+    ParallelFor* job = context;
+    Environment* chunk_env = environment_new_on_heap(vm_heap(), job->env);
+
+    for (int i = 0; i < job->reduce_count; i++) {
+        environment_set(chunk_env, job->names[i], job->identities[i]);
+    }
+
+    job->body(job->loop, chunk_env, start, end);
 
+    for (int i = 0; i < job->reduce_count; i++) {
+        job->partials[chunk * job->reduce_count + i] = environment_get(chunk_env, job->names[i]);
+    }
+}
+
+void eval_parallel_for(LoopBody body, void* loop, Environment* env, int64_t start, int64_t end,
+                       char** operators, char** names, int reduce_count) {
+    int64_t chunk_count = scheduler_range_chunks(end - start);
+    if (chunk_count <= 0) return;
+
+    ParallelFor job;
+    job.body = body;
+    job.loop = loop;
+    job.env = env;
+    job.names = names;
+    job.reduce_count = reduce_count;
+    job.identities = malloc(sizeof(Object*) * (reduce_count > 0 ? reduce_count : 1));
+    job.partials = malloc(sizeof(Object*) * (reduce_count > 0 ? chunk_count * reduce_count : 1));
+
+    for (int i = 0; i < reduce_count; i++) {
+        job.identities[i] = eval_reduce_identity(operators[i], environment_get(env, names[i]));
+    }
+
+    scheduler_parallel_range(start, end, chunk_count, eval_parallel_chunk, &job);
+
+    // Folding in chunk order, not completion order, makes the result
+    // independent of which worker ran which chunk.
+    for (int i = 0; i < reduce_count; i++) {
+        Object* value = environment_get(env, names[i]);
+        for (int64_t chunk = 0; chunk < chunk_count; chunk++) {
+            value = eval_reduce_combine(operators[i], value, job.partials[chunk * reduce_count + i]);
+        }
+        environment_assign(env, names[i], value);
+    }
+
+    free(job.identities);
+    free(job.partials);
+}
+
+static Object* eval_loop_body(Statement* body, Environment* env) {
+    for (int j = 0; j < body->data.block_stmt.statement_count; j++) {
+        Object* result = eval_statement(body->data.block_stmt.statements[j], env);
         if (result != NULL && result->type == OBJ_RETURN_VALUE) {
-            environment_free(enclosed_env);
             return result;
         }
     }
-    
-    environment_free(enclosed_env);
+    return NULL;
+}
+
+static Object* eval_while_statement(Statement* stmt, Environment* env) {
+    HeapScratch scratch;
+    heap_scratch_begin(vm_heap(), &scratch);
+    Object* result = NULL;
+    while (is_truthy(eval_expression(stmt->data.while_stmt.condition, env))) {
+        result = eval_statement(stmt->data.while_stmt.body, env);
+        if (result != NULL && result->type == OBJ_RETURN_VALUE) {
+            scratch.escaped = 1;
+            break;
+        }
+        result = NULL;
+        heap_scratch_reset(&scratch);
+    }
+    heap_scratch_end(&scratch);
+    return result;
+}
+
+// The body's statements run directly in the loop environment, which is
+// reused across iterations: only the loop variable is rebound, instead of
+// allocating a block environment per iteration. Each iteration runs in a
+// scratch region, as in eval_sequence_loop.
+static Object* eval_range(void* loop, Environment* env, int64_t start, int64_t end) {
+    Statement* stmt = loop;
+    const char* variable = stmt->data.for_stmt.variable;
+
+    HeapScratch scratch;
+    heap_scratch_begin(vm_heap(), &scratch);
+    Object* result = NULL;
+    for (int64_t i = start; i < end; i++) {
+        environment_set(env, variable, object_new_integer(i));
+        result = eval_loop_body(stmt->data.for_stmt.body, env);
+        if (result) {
+            scratch.escaped = 1;
+            break;
+        }
+        heap_scratch_reset(&scratch);
+    }
+    heap_scratch_end(&scratch);
+    return result;
+}
+
+// Each item is pulled and its pass run in a scratch region (heap.h) that
+// the next pass reuses, so a loop over a long sequence only keeps what its
+// passes store somewhere older. Each pass binds the item in a fresh
+// environment inside the region. A return keeps the region it leaves.
+// Range and while loops run their passes the same way.
+static Object* eval_sequence_loop(Statement* stmt, Environment* env, Sequence* source) {
+    HeapScratch scratch;
+    heap_scratch_begin(vm_heap(), &scratch);
+
+    Object* result = NULL;
+    Object* item;
+    while ((item = sequence_next(source)) != NULL) {
+        Environment* item_env = environment_new_on_heap(vm_heap(), env);
+        environment_set(item_env, stmt->data.for_stmt.variable, item);
+        result = eval_loop_body(stmt->data.for_stmt.body, item_env);
+        if (result) {
+            scratch.escaped = 1;
+            break;
+        }
+        heap_scratch_reset(&scratch);
+    }
+    heap_scratch_end(&scratch);
     return result;
-}
\ No newline at end of file
+}
+
+static Object* eval_for_statement(Statement* stmt, Environment* env) {
+    Object* start = eval_expression(stmt->data.for_stmt.start, env);
+    if (stmt->data.for_stmt.end == NULL) {
+        if (start == NULL || start->type != OBJ_SEQUENCE) return NULL;
+
+        return eval_sequence_loop(stmt, env, start->value.sequence);
+    }
+
+    Object* end = eval_expression(stmt->data.for_stmt.end, env);
+    if (start == NULL || end == NULL || start->type != OBJ_INTEGER || end->type != OBJ_INTEGER) {
+        return NULL;
+    }
+
+    if (stmt->data.for_stmt.is_parallel) {
+        eval_parallel_for(eval_range, stmt, env, start->value.integer, end->value.integer,
+                          stmt->data.for_stmt.reduce_operators, stmt->data.for_stmt.reduce_names,
+                          stmt->data.for_stmt.reduce_count);
+        return NULL;
+    }
+
+    return eval_range(stmt, environment_new_on_heap(vm_heap(), env), start->value.integer, end->value.integer);
+}
+
+// --- generators ---
+
+// A generator call returns at once with a sequence; its body runs a piece
+// at a time, each time a consumer pulls. Instead of a native stack the body
+// keeps an explicit stack of resume points, one per block or loop it is
+// inside, so suspending at a yield is just returning from generator_next
+// and resuming is picking up the innermost point where it stopped.
+// Statements that cannot contain a yield run through eval_statement.
+
+typedef enum {
+    RESUME_BLOCK,      // next statement of a statement list
+    RESUME_RANGE,      // next iteration of `for i in a..b`
+    RESUME_SEQUENCE,   // next iteration of `for x in s`
+    RESUME_WHILE       // next test of a while condition
+} ResumeKind;
+
+typedef struct ResumePoint {
+    ResumeKind kind;
+    Statement* loop;
+    Statement** statements;
+    int count;
+    int index;
+    Environment* env;
+    int64_t next;
+    int64_t end;
+    Sequence* source;
+    int own_env;       // env was made for this point and goes when it does
+} ResumePoint;
+
+typedef struct Generator {
+    Sequence base;
+    ResumePoint* points;
+    int depth;
+    int capacity;
+    Environment* spare_envs;   // popped environments no closure kept, linked by outer
+} Generator;
+
+// The generator's points and environments live as long as it does, so a
+// generator pulled from inside a scratch region (heap.h) gets reclaimed
+// with it, and one that outlives the region does not lose its state.
+static ResumePoint* generator_push(Generator* gen, ResumeKind kind, Environment* env) {
+    if (gen->depth >= gen->capacity) {
+        int capacity = gen->capacity * 2;
+        ResumePoint* points = heap_alloc_beside(vm_heap(), gen, sizeof(ResumePoint) * capacity);
+        memcpy(points, gen->points, sizeof(ResumePoint) * gen->depth);
+        gen->points = points;
+        gen->capacity = capacity;
+    }
+
+    ResumePoint* point = &gen->points[gen->depth++];
+    memset(point, 0, sizeof(*point));
+    point->kind = kind;
+    point->env = env;
+    return point;
+}
+
+static void generator_push_block(Generator* gen, Statement** statements, int count, Environment* env) {
+    ResumePoint* point = generator_push(gen, RESUME_BLOCK, env);
+    point->statements = statements;
+    point->count = count;
+}
+
+// Pushes a point with a block environment of its own inside outer,
+// reusing one an earlier point gave back.
+static ResumePoint* generator_push_scope(Generator* gen, ResumeKind kind, Environment* outer) {
+    Environment* env = gen->spare_envs;
+    if (env) {
+        gen->spare_envs = env->outer;
+        env->outer = outer;
+    } else {
+        env = environment_new_beside(vm_heap(), gen, outer);
+    }
+    ResumePoint* point = generator_push(gen, kind, env);
+    point->own_env = 1;
+    return point;
+}
+
+static void generator_push_block_scope(Generator* gen, Statement** statements, int count, Environment* outer) {
+    ResumePoint* point = generator_push_scope(gen, RESUME_BLOCK, outer);
+    point->statements = statements;
+    point->count = count;
+}
+
+static void generator_pop(Generator* gen) {
+    ResumePoint* point = &gen->points[--gen->depth];
+    if (point->own_env && !point->env->captured) {
+        environment_clear(point->env);
+        point->env->outer = gen->spare_envs;
+        gen->spare_envs = point->env;
+    }
+}
+
+// Starts stmt. Returns 1 with *value set if it is a yield; otherwise it
+// either ran to completion or pushed the points that will run it.
+static int generator_start(Generator* gen, Statement* stmt, Environment* env, Object** value) {
+    switch (stmt->node_type) {
+        case STMT_YIELD:
+            *value = eval_expression(stmt->data.yield_stmt.value, env);
+            if (*value == NULL) *value = object_new_null();
+            return 1;
+        case STMT_BLOCK:
+            generator_push_block_scope(gen, stmt->data.block_stmt.statements, stmt->data.block_stmt.statement_count,
+                                       env);
+            return 0;
+        case STMT_WHILE:
+            generator_push(gen, RESUME_WHILE, env)->loop = stmt;
+            return 0;
+        case STMT_FOR:
+            {
+                // A par for body cannot yield.
+                if (stmt->data.for_stmt.is_parallel) break;
+
+                Object* start = eval_expression(stmt->data.for_stmt.start, env);
+                if (stmt->data.for_stmt.end == NULL) {
+                    if (start == NULL || start->type != OBJ_SEQUENCE) return 0;
+                    ResumePoint* point = generator_push_scope(gen, RESUME_SEQUENCE, env);
+                    point->loop = stmt;
+                    point->source = start->value.sequence;
+                    heap_note_store(gen, point->source);
+                    return 0;
+                }
+
+                Object* end = eval_expression(stmt->data.for_stmt.end, env);
+                if (start == NULL || end == NULL || start->type != OBJ_INTEGER || end->type != OBJ_INTEGER) return 0;
+                ResumePoint* point = generator_push_scope(gen, RESUME_RANGE, env);
+                point->loop = stmt;
+                point->next = start->value.integer;
+                point->end = end->value.integer;
+                return 0;
+            }
+        case STMT_EXPRESSION:
+            {
+                Expression* expr = stmt->data.expression_stmt.expression;
+                if (expr->node_type != EXPR_IF) break;
+
+                if (is_truthy(eval_expression(expr->data.if_expr.condition, env))) {
+                    generator_push_block_scope(gen, expr->data.if_expr.then_branch, expr->data.if_expr.then_count,
+                                               env);
+                } else if (expr->data.if_expr.else_branch) {
+                    generator_push_block_scope(gen, expr->data.if_expr.else_branch, expr->data.if_expr.else_count,
+                                               env);
+                }
+                return 0;
+            }
+        default:
+            break;
+    }
+
+    eval_statement(stmt, env);
+    return 0;
+}
+
+static Object* generator_next(Sequence* sequence) {
+    Generator* gen = (Generator*)sequence;
+    Object* value = NULL;
+
+    while (gen->depth > 0) {
+        // Pushing may move the stack, so the point is looked up each time.
+        ResumePoint* point = &gen->points[gen->depth - 1];
+
+        switch (point->kind) {
+            case RESUME_BLOCK:
+                if (point->index >= point->count) {
+                    generator_pop(gen);
+                } else {
+                    Statement* stmt = point->statements[point->index++];
+                    if (generator_start(gen, stmt, point->env, &value)) return value;
+                }
+                break;
+            case RESUME_RANGE:
+                if (point->next >= point->end) {
+                    generator_pop(gen);
+                } else {
+                    environment_set(point->env, point->loop->data.for_stmt.variable, object_new_integer(point->next++));
+                    Statement* body = point->loop->data.for_stmt.body;
+                    generator_push_block(gen, body->data.block_stmt.statements, body->data.block_stmt.statement_count,
+                                         point->env);
+                }
+                break;
+            case RESUME_SEQUENCE:
+                {
+                    Object* item = sequence_next(point->source);
+                    if (item == NULL) {
+                        generator_pop(gen);
+                    } else {
+                        environment_set(point->env, point->loop->data.for_stmt.variable, item);
+                        Statement* body = point->loop->data.for_stmt.body;
+                        generator_push_block(gen, body->data.block_stmt.statements,
+                                             body->data.block_stmt.statement_count, point->env);
+                    }
+                    break;
+                }
+            case RESUME_WHILE:
+                if (!is_truthy(eval_expression(point->loop->data.while_stmt.condition, point->env))) {
+                    generator_pop(gen);
+                } else if (generator_start(gen, point->loop->data.while_stmt.body, point->env, &value)) {
+                    return value;
+                }
+                break;
+        }
+    }
+    return NULL;
+}
+
+static Sequence* generator_new(Statement** body, int count, Environment* env) {
+    Generator* gen = heap_alloc(vm_heap(), sizeof(Generator));
+    gen->base.next = generator_next;
+    gen->base.done = 0;
+    gen->capacity = 8;
+    gen->depth = 0;
+    gen->spare_envs = NULL;
+    gen->points = heap_alloc_beside(vm_heap(), gen, sizeof(ResumePoint) * gen->capacity);
+
+    // Like eval_block_statement, the body gets a block environment inside
+    // the one holding the parameters.
+    generator_push_block_scope(gen, body, count, env);
+    return &gen->base;
+}
@@ -0,0 +1,783 @@
+#include "evaluator.h"
+#include "memo.h"
+#include "scheduler.h"
+#include "builtins.h"
+#include "sequence.h"
+#include "array.h"
+#include "map.h"
+#include "match.h"
+#include "record.h"
+#include "vm.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Evaluator over a FlatAst. Semantics match evaluator.c; the difference is
+// that nodes are read from the parallel arrays and operators are already
+// decoded, so no strcmp happens on the hot path.
+
+static Object* flat_eval_node(const FlatAst* ast, FlatRef ref, Environment* env);
+static Sequence* flat_generator_new(const FlatAst* ast, FlatRef body, Environment* env);
+
+static int is_truthy(Object* obj) {
+    if (obj == NULL) return 0;
+    switch (obj->type) {
+        case OBJ_NULL:
+            return 0;
+        case OBJ_BOOLEAN:
+            return obj->value.boolean;
+        default:
+            return 1;
+    }
+}
+
+static double number_value(Object* obj) {
+    return obj->type == OBJ_INTEGER ? (double)obj->value.integer : obj->value.float_val;
+}
+
+static Object* flat_eval_statements(const FlatAst* ast, FlatRef block, Environment* env) {
+    Object* result = NULL;
+    uint32_t start = ast->a[block];
+    uint32_t count = ast->b[block];
+
+    for (uint32_t i = 0; i < count; i++) {
+        result = flat_eval_node(ast, flat_child(ast, start, i), env);
+
+        if (result != NULL && result->type == OBJ_RETURN_VALUE) {
+            break;
+        }
+    }
+    return result;
+}
+
+static Object* flat_eval_block(const FlatAst* ast, FlatRef block, Environment* env) {
+    return flat_eval_statements(ast, block, environment_new_on_heap(vm_heap(), env));
+}
+
+Object* flat_apply_function(Object* fn, Object** args, int arg_count) {
+    if (fn != NULL && fn->type == OBJ_BUILTIN) {
+        return fn->value.builtin->function(args, arg_count);
+    }
+    if (fn != NULL && fn->type == OBJ_STRUCT_TYPE) {
+        return record_construct(fn->value.layout, args, arg_count);
+    }
+    if (fn == NULL || fn->type != OBJ_FUNCTION || fn->value.function.flat == NULL) {
+        return object_new_null();
+    }
+
+    const FlatAst* ast = fn->value.function.flat;
+    const FlatFunction* function = &ast->functions[fn->value.function.flat_function];
+    if ((int)function->param_count != arg_count) {
+        return object_new_null();
+    }
+
+    MemoTable* memo = fn->value.function.is_memo ? memo_table_of(fn) : NULL;
+    if (memo) {
+        Object* cached = memo_lookup(memo, args, arg_count);
+        if (cached) return cached;
+    }
+
+    Environment* extended_env = environment_new_on_heap(vm_heap(), fn->value.function.env);
+    for (int i = 0; i < arg_count; i++) {
+        environment_set(extended_env, ast->strings[flat_child(ast, function->params_start, i)], args[i]);
+    }
+
+    if (function->is_generator) {
+        return object_new_sequence(flat_generator_new(ast, function->body, extended_env));
+    }
+    // The body runs in the call's own environment, which closures it makes
+    // may keep.
+    Object* evaluated = flat_eval_statements(ast, function->body, extended_env);
+
+    if (evaluated && evaluated->type == OBJ_RETURN_VALUE) {
+        evaluated = evaluated->value.return_value;
+    }
+
+    if (memo) {
+        memo_store(memo, args, arg_count, evaluated);
+    }
+
+    return evaluated;
+}
+
+static Object* flat_eval_integer_infix(FlatOperator op, int64_t left_val, int64_t right_val) {
+    switch (op) {
+        case FLAT_OP_ADD: return object_new_integer(left_val + right_val);
+        case FLAT_OP_SUB: return object_new_integer(left_val - right_val);
+        case FLAT_OP_MUL: return object_new_integer(left_val * right_val);
+        // Dividing by -1 negates, wrapping instead of trapping at INT64_MIN.
+        case FLAT_OP_DIV:
+            if (right_val == 0) return object_new_null();
+            return object_new_integer(right_val == -1 ? (int64_t)(0 - (uint64_t)left_val) : left_val / right_val);
+        case FLAT_OP_MOD:
+            if (right_val == 0) return object_new_null();
+            return object_new_integer(right_val == -1 ? 0 : left_val % right_val);
+        case FLAT_OP_LT: return object_new_boolean(left_val < right_val);
+        case FLAT_OP_GT: return object_new_boolean(left_val > right_val);
+        case FLAT_OP_LE: return object_new_boolean(left_val <= right_val);
+        case FLAT_OP_GE: return object_new_boolean(left_val >= right_val);
+        case FLAT_OP_EQ: return object_new_boolean(left_val == right_val);
+        case FLAT_OP_NE: return object_new_boolean(left_val != right_val);
+        default: return object_new_null();
+    }
+}
+
+static Object* flat_eval_float_infix(FlatOperator op, double left_val, double right_val) {
+    switch (op) {
+        case FLAT_OP_ADD: return object_new_float(left_val + right_val);
+        case FLAT_OP_SUB: return object_new_float(left_val - right_val);
+        case FLAT_OP_MUL: return object_new_float(left_val * right_val);
+        case FLAT_OP_DIV: return object_new_float(left_val / right_val);
+        case FLAT_OP_MOD: return object_new_float(fmod(left_val, right_val));
+        case FLAT_OP_LT: return object_new_boolean(left_val < right_val);
+        case FLAT_OP_GT: return object_new_boolean(left_val > right_val);
+        case FLAT_OP_LE: return object_new_boolean(left_val <= right_val);
+        case FLAT_OP_GE: return object_new_boolean(left_val >= right_val);
+        case FLAT_OP_EQ: return object_new_boolean(left_val == right_val);
+        case FLAT_OP_NE: return object_new_boolean(left_val != right_val);
+        default: return object_new_null();
+    }
+}
+
+static Object* flat_eval_boolean_infix(FlatOperator op, int left_val, int right_val) {
+    switch (op) {
+        case FLAT_OP_AND: return object_new_boolean(left_val && right_val);
+        case FLAT_OP_OR: return object_new_boolean(left_val || right_val);
+        case FLAT_OP_EQ: return object_new_boolean(left_val == right_val);
+        case FLAT_OP_NE: return object_new_boolean(left_val != right_val);
+        default: return object_new_null();
+    }
+}
+
+static Object* flat_eval_string_infix(FlatOperator op, const String* left_val, const String* right_val) {
+    if (op == FLAT_OP_ADD) return object_new_string_concat(left_val, right_val);
+
+    int cmp = string_compare(left_val, right_val);
+
+    switch (op) {
+        case FLAT_OP_EQ: return object_new_boolean(cmp == 0);
+        case FLAT_OP_NE: return object_new_boolean(cmp != 0);
+        case FLAT_OP_LT: return object_new_boolean(cmp < 0);
+        case FLAT_OP_GT: return object_new_boolean(cmp > 0);
+        case FLAT_OP_LE: return object_new_boolean(cmp <= 0);
+        case FLAT_OP_GE: return object_new_boolean(cmp >= 0);
+        default: return object_new_null();
+    }
+}
+
+static int flat_is_container_literal(const FlatAst* ast, FlatRef ref) {
+    return ref != FLAT_NONE && (ast->kinds[ref] == EXPR_ARRAY_LITERAL || ast->kinds[ref] == EXPR_MAP_LITERAL);
+}
+
+static Object* flat_eval_array_literal(const FlatAst* ast, FlatRef ref, Environment* env) {
+    uint32_t count = ast->b[ref];
+    Array* array = array_new(ARRAY_UNTYPED, count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        array_push(array, flat_eval_node(ast, flat_child(ast, ast->a[ref], i), env));
+    }
+    return object_new_array(array);
+}
+
+static Object* flat_eval_map_literal(const FlatAst* ast, FlatRef ref, Environment* env) {
+    uint32_t count = ast->b[ref];
+    Map* map = map_new(count / 2);
+
+    for (uint32_t i = 0; i < count; i += 2) {
+        FlatRef value = flat_child(ast, ast->a[ref], i + 1);
+        Object* key = flat_eval_node(ast, flat_child(ast, ast->a[ref], i), env);
+        map_set(map, key, object_bind_value(flat_eval_node(ast, value, env), flat_is_container_literal(ast, value)));
+    }
+    return object_new_map(map);
+}
+
+static Object* flat_eval_index(const FlatAst* ast, FlatRef ref, Environment* env) {
+    Object* array = flat_eval_node(ast, ast->a[ref], env);
+    Object* index = flat_eval_node(ast, ast->b[ref], env);
+    if (!array || !index || array->type != OBJ_ARRAY || index->type != OBJ_INTEGER) {
+        return object_new_null();
+    }
+    if (ast->c[ref]) return array_load(array->value.array, index->value.integer);
+    return array_get(array->value.array, index->value.integer);
+}
+
+static Object* flat_eval_element_assignment(const FlatAst* ast, FlatRef ref, Environment* env) {
+    FlatRef target = ast->a[ref];
+    Object* array = flat_eval_node(ast, ast->a[target], env);
+    Object* index = flat_eval_node(ast, ast->b[target], env);
+    Object* value = flat_eval_node(ast, ast->c[ref], env);
+
+    if (array && index && value && array->type == OBJ_ARRAY && index->type == OBJ_INTEGER) {
+        if (ast->c[target]) {
+            array_store(array->value.array, index->value.integer, value);
+        } else {
+            array_set(array->value.array, index->value.integer, value);
+        }
+    }
+    return NULL;
+}
+
+static Object* flat_eval_field_assignment(const FlatAst* ast, FlatRef ref, Environment* env) {
+    FlatRef target = ast->a[ref];
+    Object* object = flat_eval_node(ast, ast->a[target], env);
+    Object* value = object_bind_value(flat_eval_node(ast, ast->c[ref], env), flat_is_container_literal(ast, ast->c[ref]));
+
+    if (object && value && object->type == OBJ_STRUCT && ast->c[target] != FLAT_NONE) {
+        record_store(object->value.record, (int)ast->c[target], value);
+    }
+    return NULL;
+}
+
+static Object* flat_eval_field(const FlatAst* ast, FlatRef ref, Environment* env) {
+    Object* object = flat_eval_node(ast, ast->a[ref], env);
+    if (!object || object->type != OBJ_STRUCT || ast->c[ref] == FLAT_NONE) {
+        return object_new_null();
+    }
+    return record_load(object->value.record, (int)ast->c[ref]);
+}
+
+// Same as eval_type_declaration, from the (name, kind) pairs in the pool.
+static Object* flat_eval_type_declaration(const FlatAst* ast, FlatRef ref, Environment* env) {
+    uint32_t count = ast->c[ref];
+    const char** names = malloc(sizeof(char*) * (count > 0 ? count : 1));
+    FieldKind* kinds = malloc(sizeof(FieldKind) * (count > 0 ? count : 1));
+
+    for (uint32_t i = 0; i < count; i++) {
+        names[i] = ast->strings[flat_child(ast, ast->b[ref], i * 2)];
+        kinds[i] = (FieldKind)flat_child(ast, ast->b[ref], i * 2 + 1);
+    }
+    StructLayout* layout = struct_layout_new(ast->strings[ast->a[ref]], names, kinds, (int)count);
+    free(names);
+    free(kinds);
+    environment_set(env, ast->strings[ast->a[ref]], object_new_struct_type(layout));
+    return NULL;
+}
+
+static Object* flat_eval_infix(const FlatAst* ast, FlatRef ref, Environment* env) {
+    FlatOperator op = (FlatOperator)ast->b[ref];
+    if (op == FLAT_OP_ASSIGN) {
+        if (ast->kinds[ast->a[ref]] == EXPR_INDEX) {
+            return flat_eval_element_assignment(ast, ref, env);
+        }
+        if (ast->kinds[ast->a[ref]] == EXPR_FIELD) {
+            return flat_eval_field_assignment(ast, ref, env);
+        }
+        Object* value = object_bind_value(flat_eval_node(ast, ast->c[ref], env), flat_is_container_literal(ast, ast->c[ref]));
+        if (value) {
+            environment_assign(env, ast->strings[ast->a[ast->a[ref]]], value);
+        }
+        return NULL;
+    }
+
+    Object* left = flat_eval_node(ast, ast->a[ref], env);
+
+    if (left && left->type == OBJ_BOOLEAN) {
+        if (op == FLAT_OP_AND && !left->value.boolean) return object_new_boolean(0);
+        if (op == FLAT_OP_OR && left->value.boolean) return object_new_boolean(1);
+    }
+    Object* right = flat_eval_node(ast, ast->c[ref], env);
+
+    if (left == NULL || right == NULL) {
+        return object_new_null();
+    }
+    if (left->type == OBJ_INTEGER && right->type == OBJ_INTEGER) {
+        return flat_eval_integer_infix(op, left->value.integer, right->value.integer);
+    }
+    if ((left->type == OBJ_INTEGER || left->type == OBJ_FLOAT) &&
+        (right->type == OBJ_INTEGER || right->type == OBJ_FLOAT)) {
+        return flat_eval_float_infix(op, number_value(left), number_value(right));
+    }
+    if (left->type == OBJ_BOOLEAN && right->type == OBJ_BOOLEAN) {
+        return flat_eval_boolean_infix(op, left->value.boolean, right->value.boolean);
+    }
+    if (left->type == OBJ_STRING && right->type == OBJ_STRING) {
+        return flat_eval_string_infix(op, &left->value.string, &right->value.string);
+    }
+
+    return object_new_null();
+}
+
+static Object* flat_eval_prefix(FlatOperator op, Object* right) {
+    if (right == NULL) return object_new_null();
+
+    switch (op) {
+        case FLAT_OP_NOT:
+            if (right->type == OBJ_BOOLEAN) return object_new_boolean(!right->value.boolean);
+            return object_new_boolean(right->type == OBJ_NULL);
+        case FLAT_OP_AWAIT:
+            if (right->type != OBJ_FUTURE) return object_new_null();
+            return scheduler_await(right->value.task);
+        case FLAT_OP_NEG:
+            if (right->type == OBJ_INTEGER) return object_new_integer(-right->value.integer);
+            if (right->type == OBJ_FLOAT) return object_new_float(-right->value.float_val);
+            return object_new_null();
+        default:
+            return object_new_null();
+    }
+}
+
+static Object* flat_eval_spawn(const FlatAst* ast, FlatRef call, Environment* env) {
+    Object* function_obj = flat_eval_node(ast, ast->a[call], env);
+    uint32_t count = ast->c[call];
+
+    Object** args = malloc(sizeof(Object*) * (count > 0 ? count : 1));
+    for (uint32_t i = 0; i < count; i++) {
+        args[i] = flat_eval_node(ast, flat_child(ast, ast->b[call], i), env);
+    }
+
+    return object_new_future(scheduler_spawn(function_obj, args, (int)count));
+}
+
+typedef struct FlatLoop {
+    const FlatAst* ast;
+    FlatRef ref;
+} FlatLoop;
+
+static Object* flat_eval_loop_body(const FlatAst* ast, FlatRef body, Environment* env) {
+    uint32_t body_start = ast->a[body];
+    uint32_t count = ast->b[body];
+
+    for (uint32_t j = 0; j < count; j++) {
+        Object* result = flat_eval_node(ast, flat_child(ast, body_start, j), env);
+        if (result != NULL && result->type == OBJ_RETURN_VALUE) {
+            return result;
+        }
+    }
+    return NULL;
+}
+
+// Same fast path as eval_range: body statements run in the loop
+// environment, with only the loop variable rebound per iteration.
+static Object* flat_eval_range(void* context, Environment* env, int64_t start, int64_t end) {
+    FlatLoop* loop = context;
+    const FlatAst* ast = loop->ast;
+    const char* variable = ast->strings[ast->a[loop->ref]];
+    FlatRef body = flat_child(ast, ast->b[loop->ref], 2);
+
+    // Each iteration runs in a scratch region, as in eval_range.
+    HeapScratch scratch;
+    heap_scratch_begin(vm_heap(), &scratch);
+    Object* result = NULL;
+    for (int64_t i = start; i < end; i++) {
+        environment_set(env, variable, object_new_integer(i));
+        result = flat_eval_loop_body(ast, body, env);
+        if (result) {
+            scratch.escaped = 1;
+            break;
+        }
+        heap_scratch_reset(&scratch);
+    }
+    heap_scratch_end(&scratch);
+    return result;
+}
+
+static Object* flat_eval_while(const FlatAst* ast, FlatRef ref, Environment* env) {
+    HeapScratch scratch;
+    heap_scratch_begin(vm_heap(), &scratch);
+    Object* result = NULL;
+    while (is_truthy(flat_eval_node(ast, ast->a[ref], env))) {
+        result = flat_eval_node(ast, ast->b[ref], env);
+        if (result != NULL && result->type == OBJ_RETURN_VALUE) {
+            scratch.escaped = 1;
+            break;
+        }
+        result = NULL;
+        heap_scratch_reset(&scratch);
+    }
+    heap_scratch_end(&scratch);
+    return result;
+}
+
+static Object* flat_eval_sequence_loop(const FlatAst* ast, FlatRef ref, Environment* env, Sequence* source) {
+    const char* variable = ast->strings[ast->a[ref]];
+    FlatRef body = flat_child(ast, ast->b[ref], 2);
+    HeapScratch scratch;
+    heap_scratch_begin(vm_heap(), &scratch);
+
+    // As in eval_sequence_loop, each pass runs in a scratch region.
+    Object* result = NULL;
+    Object* item;
+    while ((item = sequence_next(source)) != NULL) {
+        Environment* item_env = environment_new_on_heap(vm_heap(), env);
+        environment_set(item_env, variable, item);
+        result = flat_eval_loop_body(ast, body, item_env);
+        if (result) {
+            scratch.escaped = 1;
+            break;
+        }
+        heap_scratch_reset(&scratch);
+    }
+    heap_scratch_end(&scratch);
+    return result;
+}
+
+static Object* flat_eval_for(const FlatAst* ast, FlatRef ref, Environment* env) {
+    uint32_t operands = ast->b[ref];
+    Object* start = flat_eval_node(ast, flat_child(ast, operands, 0), env);
+    if (flat_child(ast, operands, 1) == FLAT_NONE) {
+        if (start == NULL || start->type != OBJ_SEQUENCE) return NULL;
+
+        return flat_eval_sequence_loop(ast, ref, env, start->value.sequence);
+    }
+
+    Object* end = flat_eval_node(ast, flat_child(ast, operands, 1), env);
+    if (start == NULL || end == NULL || start->type != OBJ_INTEGER || end->type != OBJ_INTEGER) {
+        return NULL;
+    }
+
+    FlatLoop loop = { ast, ref };
+
+    if (ast->c[ref] & 1) {
+        int reduce_count = (int)(ast->c[ref] >> 1);
+        char** operators = malloc(sizeof(char*) * (reduce_count > 0 ? reduce_count : 1));
+        char** names = malloc(sizeof(char*) * (reduce_count > 0 ? reduce_count : 1));
+        for (int i = 0; i < reduce_count; i++) {
+            operators[i] = ast->strings[flat_child(ast, operands, 3 + i * 2)];
+            names[i] = ast->strings[flat_child(ast, operands, 4 + i * 2)];
+        }
+        eval_parallel_for(flat_eval_range, &loop, env, start->value.integer, end->value.integer,
+                          operators, names, reduce_count);
+        free(operators);
+        free(names);
+        return NULL;
+    }
+
+    return flat_eval_range(&loop, environment_new_on_heap(vm_heap(), env), start->value.integer, end->value.integer);
+}
+
+// Same as eval_pipe_expression: a builtin stage gets the piped value as
+// its first argument, anything else is called with it.
+static Object* flat_eval_pipe(const FlatAst* ast, FlatRef ref, Environment* env) {
+    Object* left = flat_eval_node(ast, ast->a[ref], env);
+    FlatRef right = ast->b[ref];
+    Object* stage;
+
+    if (ast->kinds[right] == EXPR_CALL) {
+        Object* function_obj = flat_eval_node(ast, ast->a[right], env);
+        int is_builtin = function_obj && function_obj->type == OBJ_BUILTIN;
+        uint32_t offset = is_builtin ? 1 : 0;
+        uint32_t count = ast->c[right] + offset;
+
+        Object** args = malloc(sizeof(Object*) * (count > 0 ? count : 1));
+        args[0] = left;
+        for (uint32_t i = 0; i < ast->c[right]; i++) {
+            args[i + offset] = flat_eval_node(ast, flat_child(ast, ast->b[right], i), env);
+        }
+        stage = flat_apply_function(function_obj, args, (int)count);
+        free(args);
+        if (is_builtin) return stage;
+    } else {
+        stage = flat_eval_node(ast, right, env);
+    }
+
+    return flat_apply_function(stage, &left, 1);
+}
+
+static Object* flat_eval_node(const FlatAst* ast, FlatRef ref, Environment* env) {
+    if (ref == FLAT_NONE) return NULL;
+
+    switch (ast->kinds[ref]) {
+        case EXPR_INTEGER_LITERAL:
+            return object_new_integer(ast->integers[ast->a[ref]]);
+        case EXPR_FLOAT_LITERAL:
+            return object_new_float(ast->floats[ast->a[ref]]);
+        case EXPR_STRING_LITERAL:
+            return object_new_string_literal(&ast->literals[ast->a[ref]]);
+        case EXPR_BOOLEAN_LITERAL:
+            return object_new_boolean((int)ast->a[ref]);
+        case EXPR_IDENTIFIER:
+            {
+                Object* value = environment_get(env, ast->strings[ast->a[ref]]);
+                return value ? value : builtin_lookup(ast->strings[ast->a[ref]]);
+            }
+        case EXPR_PREFIX:
+            if ((FlatOperator)ast->a[ref] == FLAT_OP_SPAWN) {
+                return flat_eval_spawn(ast, ast->b[ref], env);
+            }
+            return flat_eval_prefix((FlatOperator)ast->a[ref], flat_eval_node(ast, ast->b[ref], env));
+        case EXPR_INFIX:
+            return flat_eval_infix(ast, ref, env);
+        case EXPR_IF:
+            {
+                Object* condition = flat_eval_node(ast, ast->a[ref], env);
+
+                if (is_truthy(condition)) {
+                    return flat_eval_block(ast, ast->b[ref], env);
+                } else if (ast->c[ref] != FLAT_NONE) {
+                    return flat_eval_block(ast, ast->c[ref], env);
+                } else {
+                    return object_new_null();
+                }
+            }
+        case EXPR_MATCH:
+            {
+                int arm = match_table_find(ast->matches[ast->c[ref]], flat_eval_node(ast, ast->a[ref], env));
+                if (arm < 0) return object_new_null();
+                return flat_eval_node(ast, flat_child(ast, ast->b[ref], (uint32_t)arm * 2 + 1), env);
+            }
+        case EXPR_FUNCTION_LITERAL:
+            {
+                const FlatFunction* function = &ast->functions[ast->a[ref]];
+                Object* object = object_new_function(NULL, (int)function->param_count, NULL, 0, env);
+                object->value.function.flat = ast;
+                object->value.function.flat_function = ast->a[ref];
+                if (function->is_memo && function->is_pure) {
+                    object->value.function.is_memo = 1;
+                    object->value.function.memo_name = function->name;
+                }
+                return object;
+            }
+        case EXPR_CALL:
+            {
+                Object* function_obj = flat_eval_node(ast, ast->a[ref], env);
+                uint32_t count = ast->c[ref];
+
+                Object** args = malloc(sizeof(Object*) * (count > 0 ? count : 1));
+                for (uint32_t i = 0; i < count; i++) {
+                    args[i] = flat_eval_node(ast, flat_child(ast, ast->b[ref], i), env);
+                }
+
+                Object* result = flat_apply_function(function_obj, args, (int)count);
+                free(args);
+                return result;
+            }
+        case EXPR_PIPE:
+            return flat_eval_pipe(ast, ref, env);
+        case EXPR_ARRAY_LITERAL:
+            return flat_eval_array_literal(ast, ref, env);
+        case EXPR_MAP_LITERAL:
+            return flat_eval_map_literal(ast, ref, env);
+        case EXPR_INDEX:
+            return flat_eval_index(ast, ref, env);
+        case EXPR_FIELD:
+            return flat_eval_field(ast, ref, env);
+        case STMT_EXPRESSION:
+            return flat_eval_node(ast, ast->a[ref], env);
+        case STMT_LET:
+            {
+                Object* val = object_bind_value(flat_eval_node(ast, ast->b[ref], env), flat_is_container_literal(ast, ast->b[ref]));
+                if (val) {
+                    environment_set(env, ast->strings[ast->a[ref]], val);
+                }
+                return NULL;
+            }
+        case STMT_RETURN:
+            return object_new_return_value(flat_eval_node(ast, ast->a[ref], env));
+        case STMT_BLOCK:
+            return flat_eval_block(ast, ref, env);
+        case STMT_WHILE:
+            return flat_eval_while(ast, ref, env);
+        case STMT_FOR:
+            return flat_eval_for(ast, ref, env);
+        case STMT_TYPE:
+            return flat_eval_type_declaration(ast, ref, env);
+        default:
+            return NULL;
+    }
+}
+
+Object* flat_eval_program(const FlatAst* ast, Environment* env) {
+    Object* result = NULL;
+    uint32_t start = ast->a[ast->root];
+    uint32_t count = ast->b[ast->root];
+
+    // Top-level statements run directly in env, like eval_program.
+    for (uint32_t i = 0; i < count; i++) {
+        result = flat_eval_node(ast, flat_child(ast, start, i), env);
+        if (result && result->type == OBJ_RETURN_VALUE) {
+            return result->value.return_value;
+        }
+    }
+    return result;
+}
+
+// --- generators ---
+
+// Same resumable state machine as the generators in evaluator.c, over flat
+// nodes: a stack of resume points, one per block or loop the suspended body
+// is inside.
+
+typedef enum {
+    FLAT_RESUME_BLOCK,
+    FLAT_RESUME_RANGE,
+    FLAT_RESUME_SEQUENCE,
+    FLAT_RESUME_WHILE
+} FlatResumeKind;
+
+typedef struct FlatResumePoint {
+    FlatResumeKind kind;
+    FlatRef node;         // the block, or the loop statement
+    uint32_t index;
+    Environment* env;
+    int64_t next;
+    int64_t end;
+    Sequence* source;
+    int own_env;          // env was made for this point and goes when it does
+} FlatResumePoint;
+
+typedef struct FlatGenerator {
+    Sequence base;
+    const FlatAst* ast;
+    FlatResumePoint* points;
+    int depth;
+    int capacity;
+    Environment* spare_envs;   // popped environments no closure kept, linked by outer
+} FlatGenerator;
+
+// Points and environments live as long as the generator; see generator_push
+// in evaluator.c.
+static FlatResumePoint* flat_generator_push(FlatGenerator* gen, FlatResumeKind kind, FlatRef node,
+                                            Environment* env) {
+    if (gen->depth >= gen->capacity) {
+        int capacity = gen->capacity * 2;
+        FlatResumePoint* points = heap_alloc_beside(vm_heap(), gen, sizeof(FlatResumePoint) * capacity);
+        memcpy(points, gen->points, sizeof(FlatResumePoint) * gen->depth);
+        gen->points = points;
+        gen->capacity = capacity;
+    }
+
+    FlatResumePoint* point = &gen->points[gen->depth++];
+    memset(point, 0, sizeof(*point));
+    point->kind = kind;
+    point->node = node;
+    point->env = env;
+    return point;
+}
+
+static FlatResumePoint* flat_generator_push_scope(FlatGenerator* gen, FlatResumeKind kind, FlatRef node,
+                                                  Environment* outer) {
+    Environment* env = gen->spare_envs;
+    if (env) {
+        gen->spare_envs = env->outer;
+        env->outer = outer;
+    } else {
+        env = environment_new_beside(vm_heap(), gen, outer);
+    }
+    FlatResumePoint* point = flat_generator_push(gen, kind, node, env);
+    point->own_env = 1;
+    return point;
+}
+
+static void flat_generator_pop(FlatGenerator* gen) {
+    FlatResumePoint* point = &gen->points[--gen->depth];
+    if (point->own_env && !point->env->captured) {
+        environment_clear(point->env);
+        point->env->outer = gen->spare_envs;
+        gen->spare_envs = point->env;
+    }
+}
+
+static int flat_generator_start(FlatGenerator* gen, FlatRef ref, Environment* env, Object** value) {
+    const FlatAst* ast = gen->ast;
+
+    switch (ast->kinds[ref]) {
+        case STMT_YIELD:
+            *value = flat_eval_node(ast, ast->a[ref], env);
+            if (*value == NULL) *value = object_new_null();
+            return 1;
+        case STMT_BLOCK:
+            flat_generator_push_scope(gen, FLAT_RESUME_BLOCK, ref, env);
+            return 0;
+        case STMT_WHILE:
+            flat_generator_push(gen, FLAT_RESUME_WHILE, ref, env);
+            return 0;
+        case STMT_FOR:
+            {
+                if (ast->c[ref] & 1) break;
+
+                uint32_t operands = ast->b[ref];
+                Object* start = flat_eval_node(ast, flat_child(ast, operands, 0), env);
+                if (flat_child(ast, operands, 1) == FLAT_NONE) {
+                    if (start == NULL || start->type != OBJ_SEQUENCE) return 0;
+                    flat_generator_push_scope(gen, FLAT_RESUME_SEQUENCE, ref, env)->source = start->value.sequence;
+                    heap_note_store(gen, start->value.sequence);
+                    return 0;
+                }
+
+                Object* end = flat_eval_node(ast, flat_child(ast, operands, 1), env);
+                if (start == NULL || end == NULL || start->type != OBJ_INTEGER || end->type != OBJ_INTEGER) return 0;
+                FlatResumePoint* point = flat_generator_push_scope(gen, FLAT_RESUME_RANGE, ref, env);
+                point->next = start->value.integer;
+                point->end = end->value.integer;
+                return 0;
+            }
+        case STMT_EXPRESSION:
+            {
+                FlatRef expr = ast->a[ref];
+                if (ast->kinds[expr] != EXPR_IF) break;
+
+                if (is_truthy(flat_eval_node(ast, ast->a[expr], env))) {
+                    flat_generator_push_scope(gen, FLAT_RESUME_BLOCK, ast->b[expr], env);
+                } else if (ast->c[expr] != FLAT_NONE) {
+                    flat_generator_push_scope(gen, FLAT_RESUME_BLOCK, ast->c[expr], env);
+                }
+                return 0;
+            }
+        default:
+            break;
+    }
+
+    flat_eval_node(ast, ref, env);
+    return 0;
+}
+
+static Object* flat_generator_next(Sequence* sequence) {
+    FlatGenerator* gen = (FlatGenerator*)sequence;
+    const FlatAst* ast = gen->ast;
+    Object* value = NULL;
+
+    while (gen->depth > 0) {
+        FlatResumePoint* point = &gen->points[gen->depth - 1];
+        FlatRef node = point->node;
+
+        switch (point->kind) {
+            case FLAT_RESUME_BLOCK:
+                if (point->index >= ast->b[node]) {
+                    flat_generator_pop(gen);
+                } else {
+                    FlatRef stmt = flat_child(ast, ast->a[node], point->index++);
+                    if (flat_generator_start(gen, stmt, point->env, &value)) return value;
+                }
+                break;
+            case FLAT_RESUME_RANGE:
+            case FLAT_RESUME_SEQUENCE:
+                {
+                    Object* item;
+                    if (point->kind == FLAT_RESUME_RANGE) {
+                        item = point->next < point->end ? object_new_integer(point->next++) : NULL;
+                    } else {
+                        item = sequence_next(point->source);
+                    }
+                    if (item == NULL) {
+                        flat_generator_pop(gen);
+                    } else {
+                        environment_set(point->env, ast->strings[ast->a[node]], item);
+                        flat_generator_push(gen, FLAT_RESUME_BLOCK, flat_child(ast, ast->b[node], 2), point->env);
+                    }
+                    break;
+                }
+            case FLAT_RESUME_WHILE:
+                if (!is_truthy(flat_eval_node(ast, ast->a[node], point->env))) {
+                    flat_generator_pop(gen);
+                } else if (flat_generator_start(gen, ast->b[node], point->env, &value)) {
+                    return value;
+                }
+                break;
+        }
+    }
+    return NULL;
+}
+
+static Sequence* flat_generator_new(const FlatAst* ast, FlatRef body, Environment* env) {
+    FlatGenerator* gen = heap_alloc(vm_heap(), sizeof(FlatGenerator));
+    gen->base.next = flat_generator_next;
+    gen->base.done = 0;
+    gen->ast = ast;
+    gen->capacity = 8;
+    gen->depth = 0;
+    gen->spare_envs = NULL;
+    gen->points = heap_alloc_beside(vm_heap(), gen, sizeof(FlatResumePoint) * gen->capacity);
+
+    flat_generator_push_scope(gen, FLAT_RESUME_BLOCK, body, env);
+    return &gen->base;
+}
@@ -0,0 +1,826 @@
+#include "hkc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define HKC_NULL_NODE 0xFF
+#define HKC_CONSTANT_BUCKETS 256
+
+typedef struct Buffer {
+    unsigned char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+typedef struct Constant {
+    const char* value;
+    uint32_t index;
+    struct Constant* next;
+} Constant;
+
+typedef struct HkcWriter {
+    Buffer constants;
+    Buffer code;
+    Buffer lines;
+    uint32_t constant_count;
+    uint32_t line_count;
+    Constant* buckets[HKC_CONSTANT_BUCKETS];
+} HkcWriter;
+
+typedef struct HkcReader {
+    const unsigned char* code;
+    size_t code_size;
+    size_t position;
+    const int32_t* lines;
+    uint32_t line_count;
+    uint32_t next_line;
+    const char** constants;
+    uint32_t constant_count;
+    int failed;
+} HkcReader;
+
+static void write_statement(HkcWriter* w, Statement* stmt);
+static void write_expression(HkcWriter* w, Expression* expr);
+static void write_type(HkcWriter* w, Type* type);
+static Statement* read_statement(HkcReader* r);
+static Expression* read_expression(HkcReader* r);
+static Type* read_type(HkcReader* r);
+
+static char* string_duplicate(const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str);
+    char* dup = malloc(len + 1);
+    if (!dup) return NULL;
+    strcpy(dup, str);
+    return dup;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t hkc_hash_source(const char* source, size_t length, uint32_t options) {
+    uint64_t hash = 14695981039346656037ULL;
+    uint32_t version = HKC_VERSION;
+    hash = fnv1a(hash, &version, sizeof(version));
+    hash = fnv1a(hash, &options, sizeof(options));
+    return fnv1a(hash, source, length);
+}
+
+char* hkc_path_for(const char* source_path) {
+    size_t len = strlen(source_path);
+    char* path = malloc(len + 5);
+    if (!path) return NULL;
+
+    strcpy(path, source_path);
+    if (len >= 3 && strcmp(source_path + len - 3, ".hk") == 0) {
+        strcat(path, "c");
+    } else {
+        strcat(path, ".hkc");
+    }
+    return path;
+}
+
+// --- Writer ---
+
+static void buffer_append(Buffer* buffer, const void* data, size_t length) {
+    if (buffer->size + length > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 256;
+        while (buffer->size + length > capacity) capacity *= 2;
+        buffer->data = realloc(buffer->data, capacity);
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, data, length);
+    buffer->size += length;
+}
+
+static void emit_byte(HkcWriter* w, unsigned char byte) {
+    buffer_append(&w->code, &byte, 1);
+}
+
+static void emit_varint(HkcWriter* w, uint64_t value) {
+    while (value >= 0x80) {
+        emit_byte(w, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    emit_byte(w, (unsigned char)value);
+}
+
+static void emit_signed(HkcWriter* w, int64_t value) {
+    emit_varint(w, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static void emit_line(HkcWriter* w, int line, int column) {
+    int32_t entry[2] = { line, column };
+    buffer_append(&w->lines, entry, sizeof(entry));
+    w->line_count++;
+}
+
+// Strings are interned into the constant pool; the code refers to them by index.
+static void emit_constant(HkcWriter* w, const char* value) {
+    if (!value) value = "";
+
+    uint64_t hash = fnv1a(14695981039346656037ULL, value, strlen(value));
+    Constant** bucket = &w->buckets[hash % HKC_CONSTANT_BUCKETS];
+    for (Constant* c = *bucket; c; c = c->next) {
+        if (strcmp(c->value, value) == 0) {
+            emit_varint(w, c->index);
+            return;
+        }
+    }
+
+    Constant* constant = malloc(sizeof(Constant));
+    constant->value = value;
+    constant->index = w->constant_count++;
+    constant->next = *bucket;
+    *bucket = constant;
+
+    uint32_t length = (uint32_t)strlen(value);
+    buffer_append(&w->constants, &length, sizeof(length));
+    buffer_append(&w->constants, value, length + 1);
+    emit_varint(w, constant->index);
+}
+
+static void write_statements(HkcWriter* w, Statement** statements, int count) {
+    emit_varint(w, (uint64_t)count);
+    for (int i = 0; i < count; i++) {
+        write_statement(w, statements[i]);
+    }
+}
+
+static void write_type(HkcWriter* w, Type* type) {
+    if (!type) {
+        emit_byte(w, HKC_NULL_NODE);
+        return;
+    }
+
+    emit_byte(w, (unsigned char)type->node_type);
+    switch (type->node_type) {
+        case TYPE_IDENTIFIER:
+            emit_constant(w, type->data.identifier.name);
+            break;
+        case TYPE_FUNCTION:
+            emit_varint(w, (uint64_t)type->data.function.param_count);
+            for (int i = 0; i < type->data.function.param_count; i++) {
+                write_type(w, type->data.function.params[i]);
+            }
+            write_type(w, type->data.function.return_type);
+            break;
+        case TYPE_STRUCT:
+            emit_varint(w, (uint64_t)type->data.struct_type.field_count);
+            for (int i = 0; i < type->data.struct_type.field_count; i++) {
+                emit_constant(w, type->data.struct_type.field_names[i]);
+                write_type(w, type->data.struct_type.field_types[i]);
+            }
+            break;
+        case TYPE_GENERIC:
+            emit_constant(w, type->data.generic.name);
+            emit_varint(w, (uint64_t)type->data.generic.argument_count);
+            for (int i = 0; i < type->data.generic.argument_count; i++) {
+                write_type(w, type->data.generic.arguments[i]);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void write_statement(HkcWriter* w, Statement* stmt) {
+    if (!stmt) {
+        emit_byte(w, HKC_NULL_NODE);
+        return;
+    }
+
+    emit_byte(w, (unsigned char)stmt->node_type);
+    emit_line(w, stmt->line, stmt->column);
+
+    switch (stmt->node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            emit_constant(w, stmt->data.let_stmt.name);
+            write_type(w, stmt->data.let_stmt.type);
+            write_expression(w, stmt->data.let_stmt.value);
+            emit_byte(w, (unsigned char)stmt->data.let_stmt.is_const);
+            break;
+        case STMT_RETURN:
+            write_expression(w, stmt->data.return_stmt.return_value);
+            break;
+        case STMT_EXPRESSION:
+            write_expression(w, stmt->data.expression_stmt.expression);
+            break;
+        case STMT_YIELD:
+            write_expression(w, stmt->data.yield_stmt.value);
+            break;
+        case STMT_BLOCK:
+            write_statements(w, stmt->data.block_stmt.statements, stmt->data.block_stmt.statement_count);
+            break;
+        case STMT_WHILE:
+            write_expression(w, stmt->data.while_stmt.condition);
+            write_statement(w, stmt->data.while_stmt.body);
+            break;
+        case STMT_FOR:
+            emit_constant(w, stmt->data.for_stmt.variable);
+            write_expression(w, stmt->data.for_stmt.start);
+            write_expression(w, stmt->data.for_stmt.end);
+            write_statement(w, stmt->data.for_stmt.body);
+            emit_byte(w, (unsigned char)stmt->data.for_stmt.is_parallel);
+            emit_varint(w, (uint64_t)stmt->data.for_stmt.reduce_count);
+            for (int i = 0; i < stmt->data.for_stmt.reduce_count; i++) {
+                emit_constant(w, stmt->data.for_stmt.reduce_operators[i]);
+                emit_constant(w, stmt->data.for_stmt.reduce_names[i]);
+            }
+            break;
+        case STMT_TYPE:
+            emit_constant(w, stmt->data.type_decl.name);
+            write_type(w, stmt->data.type_decl.type);
+            break;
+        default:
+            break;
+    }
+}
+
+static void write_expression(HkcWriter* w, Expression* expr) {
+    if (!expr) {
+        emit_byte(w, HKC_NULL_NODE);
+        return;
+    }
+
+    emit_byte(w, (unsigned char)expr->node_type);
+    emit_line(w, expr->line, expr->column);
+
+    switch (expr->node_type) {
+        case EXPR_IDENTIFIER:
+            emit_constant(w, expr->data.identifier.value);
+            break;
+        case EXPR_INTEGER_LITERAL:
+            emit_signed(w, expr->data.integer_literal.value);
+            break;
+        case EXPR_FLOAT_LITERAL:
+            buffer_append(&w->code, &expr->data.float_literal.value, sizeof(double));
+            break;
+        case EXPR_STRING_LITERAL:
+            emit_constant(w, expr->data.string_literal.value);
+            break;
+        case EXPR_BOOLEAN_LITERAL:
+            emit_byte(w, (unsigned char)expr->data.boolean_literal.value);
+            break;
+        case EXPR_FUNCTION_LITERAL:
+            emit_varint(w, (uint64_t)expr->data.function_literal.parameter_count);
+            for (int i = 0; i < expr->data.function_literal.parameter_count; i++) {
+                emit_constant(w, expr->data.function_literal.parameters[i]->name);
+                write_type(w, expr->data.function_literal.parameters[i]->type);
+            }
+            write_type(w, expr->data.function_literal.return_type);
+            write_statements(w, expr->data.function_literal.body, expr->data.function_literal.body_count);
+            emit_byte(w, expr->data.function_literal.name != NULL);
+            if (expr->data.function_literal.name) {
+                emit_constant(w, expr->data.function_literal.name);
+            }
+            emit_byte(w, (unsigned char)expr->data.function_literal.is_pure);
+            emit_byte(w, (unsigned char)expr->data.function_literal.is_memo);
+            emit_byte(w, (unsigned char)expr->data.function_literal.is_generator);
+            break;
+        case EXPR_CALL:
+            write_expression(w, expr->data.call.function);
+            emit_varint(w, (uint64_t)expr->data.call.argument_count);
+            for (int i = 0; i < expr->data.call.argument_count; i++) {
+                write_expression(w, expr->data.call.arguments[i]);
+            }
+            break;
+        case EXPR_INFIX:
+            write_expression(w, expr->data.infix.left);
+            emit_constant(w, expr->data.infix.operator);
+            write_expression(w, expr->data.infix.right);
+            break;
+        case EXPR_PREFIX:
+            emit_constant(w, expr->data.prefix.operator);
+            write_expression(w, expr->data.prefix.right);
+            break;
+        case EXPR_IF:
+            write_expression(w, expr->data.if_expr.condition);
+            write_statements(w, expr->data.if_expr.then_branch, expr->data.if_expr.then_count);
+            emit_byte(w, expr->data.if_expr.else_branch != NULL);
+            if (expr->data.if_expr.else_branch) {
+                write_statements(w, expr->data.if_expr.else_branch, expr->data.if_expr.else_count);
+            }
+            break;
+        case EXPR_MATCH:
+            write_expression(w, expr->data.match.expression);
+            emit_varint(w, (uint64_t)expr->data.match.case_count);
+            for (int i = 0; i < expr->data.match.case_count; i++) {
+                write_expression(w, expr->data.match.cases[i]->pattern);
+                write_expression(w, expr->data.match.cases[i]->result);
+            }
+            break;
+        case EXPR_PIPE:
+            write_expression(w, expr->data.pipe.left);
+            write_expression(w, expr->data.pipe.right);
+            break;
+        case EXPR_ARRAY_LITERAL:
+            emit_varint(w, (uint64_t)expr->data.array_literal.element_count);
+            for (int i = 0; i < expr->data.array_literal.element_count; i++) {
+                write_expression(w, expr->data.array_literal.elements[i]);
+            }
+            break;
+        case EXPR_INDEX:
+            write_expression(w, expr->data.index.array);
+            write_expression(w, expr->data.index.index);
+            emit_byte(w, (unsigned char)expr->data.index.unchecked);
+            break;
+        case EXPR_MAP_LITERAL:
+            emit_varint(w, (uint64_t)expr->data.map_literal.entry_count);
+            for (int i = 0; i < expr->data.map_literal.entry_count; i++) {
+                write_expression(w, expr->data.map_literal.entries[i]);
+            }
+            break;
+        case EXPR_FIELD:
+            write_expression(w, expr->data.field.object);
+            emit_constant(w, expr->data.field.name);
+            // Biased by one: the offset is -1 until the analyzer resolves it.
+            emit_varint(w, (uint64_t)(expr->data.field.offset + 1));
+            break;
+        default:
+            break;
+    }
+}
+
+static void writer_free(HkcWriter* w) {
+    for (int i = 0; i < HKC_CONSTANT_BUCKETS; i++) {
+        Constant* c = w->buckets[i];
+        while (c) {
+            Constant* next = c->next;
+            free(c);
+            c = next;
+        }
+    }
+    free(w->constants.data);
+    free(w->code.data);
+    free(w->lines.data);
+}
+
+int hkc_write(const char* path, Program* program, uint64_t source_hash) {
+    HkcWriter writer;
+    memset(&writer, 0, sizeof(writer));
+
+    write_statements(&writer, program->statements, program->statement_count);
+
+    HkcHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, HKC_MAGIC, sizeof(HKC_MAGIC));
+    header.version = HKC_VERSION;
+    header.source_hash = source_hash;
+    header.constant_count = writer.constant_count;
+    header.constants_size = (uint32_t)writer.constants.size;
+    header.code_size = (uint32_t)writer.code.size;
+    header.line_count = writer.line_count;
+
+    // Keep the line table 4-byte aligned so it can be read in place.
+    static const unsigned char padding[4] = { 0 };
+    size_t unaligned = sizeof(header) + writer.constants.size + writer.code.size;
+    size_t pad = (4 - unaligned % 4) % 4;
+
+    uint64_t payload_hash = 14695981039346656037ULL;
+    payload_hash = fnv1a(payload_hash, writer.constants.data, writer.constants.size);
+    payload_hash = fnv1a(payload_hash, writer.code.data, writer.code.size);
+    payload_hash = fnv1a(payload_hash, padding, pad);
+    header.payload_hash = fnv1a(payload_hash, writer.lines.data, writer.lines.size);
+
+    // Write to a temporary file and rename so a concurrent reader never
+    // maps a half-written cache.
+    char* temp_path = malloc(strlen(path) + 16);
+    sprintf(temp_path, "%s.%ld.tmp", path, (long)getpid());
+
+    FILE* file = fopen(temp_path, "wb");
+    int ok = file != NULL;
+    if (ok) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(writer.constants.data, 1, writer.constants.size, file) == writer.constants.size &&
+             fwrite(writer.code.data, 1, writer.code.size, file) == writer.code.size &&
+             fwrite(padding, 1, pad, file) == pad &&
+             fwrite(writer.lines.data, 1, writer.lines.size, file) == writer.lines.size;
+        ok = (fclose(file) == 0) && ok;
+    }
+    ok = ok && rename(temp_path, path) == 0;
+    if (!ok) remove(temp_path);
+
+    free(temp_path);
+    writer_free(&writer);
+    return ok;
+}
+
+// --- Reader ---
+
+static int read_byte(HkcReader* r) {
+    if (r->position >= r->code_size) {
+        r->failed = 1;
+        return HKC_NULL_NODE;
+    }
+    return r->code[r->position++];
+}
+
+static uint64_t read_varint(HkcReader* r) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = read_byte(r);
+        if (r->failed) return 0;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    r->failed = 1;
+    return 0;
+}
+
+static int read_count(HkcReader* r) {
+    uint64_t count = read_varint(r);
+    // Every counted element occupies at least one byte of code.
+    if (count > r->code_size - r->position) {
+        r->failed = 1;
+        return 0;
+    }
+    return (int)count;
+}
+
+static char* read_constant(HkcReader* r) {
+    uint64_t index = read_varint(r);
+    if (r->failed || index >= r->constant_count) {
+        r->failed = 1;
+        return string_duplicate("");
+    }
+    return string_duplicate(r->constants[index]);
+}
+
+static void read_line(HkcReader* r, int* line, int* column) {
+    if (r->next_line >= r->line_count) {
+        r->failed = 1;
+        *line = 0;
+        *column = 0;
+        return;
+    }
+    *line = r->lines[r->next_line * 2];
+    *column = r->lines[r->next_line * 2 + 1];
+    r->next_line++;
+}
+
+static Statement** read_statements(HkcReader* r, int* count) {
+    *count = read_count(r);
+    Statement** statements = malloc(sizeof(Statement*) * (*count > 0 ? *count : 1));
+    for (int i = 0; i < *count; i++) {
+        statements[i] = read_statement(r);
+    }
+    return statements;
+}
+
+static Type* read_type(HkcReader* r) {
+    int node_type = read_byte(r);
+    if (node_type == HKC_NULL_NODE) return NULL;
+
+    switch (node_type) {
+        case TYPE_IDENTIFIER:
+            return type_new_identifier(read_constant(r));
+        case TYPE_FUNCTION:
+            {
+                int param_count = read_count(r);
+                Type** params = malloc(sizeof(Type*) * (param_count > 0 ? param_count : 1));
+                for (int i = 0; i < param_count; i++) {
+                    params[i] = read_type(r);
+                }
+                return type_new_function(params, param_count, read_type(r));
+            }
+        case TYPE_STRUCT:
+            {
+                Type* type = malloc(sizeof(Type));
+                type->node_type = TYPE_STRUCT;
+                int field_count = read_count(r);
+                type->data.struct_type.field_count = field_count;
+                type->data.struct_type.field_names = malloc(sizeof(char*) * (field_count > 0 ? field_count : 1));
+                type->data.struct_type.field_types = malloc(sizeof(Type*) * (field_count > 0 ? field_count : 1));
+                for (int i = 0; i < field_count; i++) {
+                    type->data.struct_type.field_names[i] = read_constant(r);
+                    type->data.struct_type.field_types[i] = read_type(r);
+                }
+                return type;
+            }
+        case TYPE_GENERIC:
+            {
+                char* name = read_constant(r);
+                int argument_count = read_count(r);
+                Type** arguments = malloc(sizeof(Type*) * (argument_count > 0 ? argument_count : 1));
+                for (int i = 0; i < argument_count; i++) {
+                    arguments[i] = read_type(r);
+                }
+                return type_new_generic(name, arguments, argument_count);
+            }
+        default:
+            r->failed = 1;
+            return NULL;
+    }
+}
+
+static Statement* read_statement(HkcReader* r) {
+    int node_type = read_byte(r);
+    if (node_type == HKC_NULL_NODE) return NULL;
+
+    int line, column;
+    read_line(r, &line, &column);
+
+    switch (node_type) {
+        case STMT_LET:
+        case STMT_CONST:
+            {
+                char* name = read_constant(r);
+                Type* type = read_type(r);
+                Expression* value = read_expression(r);
+                int is_const = read_byte(r);
+                Statement* stmt = statement_new_let(name, type, value, is_const, line, column);
+                stmt->node_type = node_type;
+                return stmt;
+            }
+        case STMT_RETURN:
+            return statement_new_return(read_expression(r), line, column);
+        case STMT_EXPRESSION:
+            return statement_new_expression(read_expression(r), line, column);
+        case STMT_YIELD:
+            return statement_new_yield(read_expression(r), line, column);
+        case STMT_BLOCK:
+            {
+                int count;
+                Statement** statements = read_statements(r, &count);
+                return statement_new_block(statements, count, line, column);
+            }
+        case STMT_WHILE:
+            {
+                Expression* condition = read_expression(r);
+                return statement_new_while(condition, read_statement(r), line, column);
+            }
+        case STMT_FOR:
+            {
+                char* variable = read_constant(r);
+                Expression* start = read_expression(r);
+                Expression* end = read_expression(r);
+                Statement* body = read_statement(r);
+                Statement* stmt = statement_new_for(variable, start, end, body, line, column);
+                stmt->data.for_stmt.is_parallel = read_byte(r) != 0;
+                int reduce_count = read_count(r);
+                if (reduce_count > 0) {
+                    stmt->data.for_stmt.reduce_operators = malloc(sizeof(char*) * reduce_count);
+                    stmt->data.for_stmt.reduce_names = malloc(sizeof(char*) * reduce_count);
+                    for (int i = 0; i < reduce_count; i++) {
+                        stmt->data.for_stmt.reduce_operators[i] = read_constant(r);
+                        stmt->data.for_stmt.reduce_names[i] = read_constant(r);
+                    }
+                    stmt->data.for_stmt.reduce_count = reduce_count;
+                }
+                return stmt;
+            }
+        case STMT_TYPE:
+            {
+                char* name = read_constant(r);
+                Type* type = read_type(r);
+                if (!type || type->node_type != TYPE_STRUCT) {
+                    r->failed = 1;
+                    return NULL;
+                }
+                return statement_new_type(name, type, line, column);
+            }
+        default:
+            r->failed = 1;
+            return NULL;
+    }
+}
+
+static Expression* read_expression(HkcReader* r) {
+    int node_type = read_byte(r);
+    if (node_type == HKC_NULL_NODE) return NULL;
+
+    int line, column;
+    read_line(r, &line, &column);
+
+    switch (node_type) {
+        case EXPR_IDENTIFIER:
+            return expression_new_identifier(read_constant(r), line, column);
+        case EXPR_INTEGER_LITERAL:
+            {
+                uint64_t encoded = read_varint(r);
+                int64_t value = (int64_t)(encoded >> 1) ^ -(int64_t)(encoded & 1);
+                return expression_new_integer_literal((int)value, line, column);
+            }
+        case EXPR_FLOAT_LITERAL:
+            {
+                double value = 0;
+                if (r->position + sizeof(double) > r->code_size) {
+                    r->failed = 1;
+                } else {
+                    memcpy(&value, r->code + r->position, sizeof(double));
+                    r->position += sizeof(double);
+                }
+                return expression_new_float_literal(value, line, column);
+            }
+        case EXPR_STRING_LITERAL:
+            return expression_new_string_literal(read_constant(r), line, column);
+        case EXPR_BOOLEAN_LITERAL:
+            return expression_new_boolean_literal(read_byte(r), line, column);
+        case EXPR_FUNCTION_LITERAL:
+            {
+                int param_count = read_count(r);
+                Parameter** params = malloc(sizeof(Parameter*) * (param_count > 0 ? param_count : 1));
+                for (int i = 0; i < param_count; i++) {
+                    char* name = read_constant(r);
+                    params[i] = parameter_new(read_type(r), name);
+                }
+                Type* return_type = read_type(r);
+                int body_count;
+                Statement** body = read_statements(r, &body_count);
+                Expression* expr = expression_new_function_literal(params, param_count, return_type, body, body_count, line, column);
+                if (read_byte(r)) {
+                    expr->data.function_literal.name = read_constant(r);
+                }
+                expr->data.function_literal.is_pure = read_byte(r);
+                expr->data.function_literal.is_memo = read_byte(r);
+                expr->data.function_literal.is_generator = read_byte(r);
+                return expr;
+            }
+        case EXPR_CALL:
+            {
+                Expression* function = read_expression(r);
+                int argument_count = read_count(r);
+                Expression** arguments = malloc(sizeof(Expression*) * (argument_count > 0 ? argument_count : 1));
+                for (int i = 0; i < argument_count; i++) {
+                    arguments[i] = read_expression(r);
+                }
+                return expression_new_call(function, arguments, argument_count, line, column);
+            }
+        case EXPR_INFIX:
+            {
+                Expression* left = read_expression(r);
+                char* operator = read_constant(r);
+                return expression_new_infix(left, operator, read_expression(r), line, column);
+            }
+        case EXPR_PREFIX:
+            {
+                char* operator = read_constant(r);
+                return expression_new_prefix(operator, read_expression(r), line, column);
+            }
+        case EXPR_IF:
+            {
+                Expression* condition = read_expression(r);
+                int then_count, else_count = 0;
+                Statement** then_branch = read_statements(r, &then_count);
+                Statement** else_branch = NULL;
+                if (read_byte(r)) {
+                    else_branch = read_statements(r, &else_count);
+                }
+                return expression_new_if(condition, then_branch, then_count, else_branch, else_count, line, column);
+            }
+        case EXPR_MATCH:
+            {
+                Expression* subject = read_expression(r);
+                int case_count = read_count(r);
+                MatchCase** cases = malloc(sizeof(MatchCase*) * (case_count > 0 ? case_count : 1));
+                for (int i = 0; i < case_count; i++) {
+                    Expression* pattern = read_expression(r);
+                    cases[i] = match_case_new(pattern, read_expression(r));
+                }
+                return expression_new_match(subject, cases, case_count, line, column);
+            }
+        case EXPR_PIPE:
+            {
+                Expression* left = read_expression(r);
+                return expression_new_pipe(left, read_expression(r), line, column);
+            }
+        case EXPR_ARRAY_LITERAL:
+            {
+                int element_count = read_count(r);
+                Expression** elements = malloc(sizeof(Expression*) * (element_count > 0 ? element_count : 1));
+                for (int i = 0; i < element_count; i++) {
+                    elements[i] = read_expression(r);
+                }
+                return expression_new_array_literal(elements, element_count, line, column);
+            }
+        case EXPR_INDEX:
+            {
+                Expression* array = read_expression(r);
+                Expression* expr = expression_new_index(array, read_expression(r), line, column);
+                expr->data.index.unchecked = read_byte(r);
+                return expr;
+            }
+        case EXPR_MAP_LITERAL:
+            {
+                int entry_count = read_count(r);
+                if (entry_count % 2 != 0) {
+                    r->failed = 1;
+                    return NULL;
+                }
+                Expression** entries = malloc(sizeof(Expression*) * (entry_count > 0 ? entry_count : 1));
+                for (int i = 0; i < entry_count; i++) {
+                    entries[i] = read_expression(r);
+                }
+                return expression_new_map_literal(entries, entry_count, line, column);
+            }
+        case EXPR_FIELD:
+            {
+                Expression* object = read_expression(r);
+                Expression* expr = expression_new_field(object, read_constant(r), line, column);
+                expr->data.field.offset = (int)read_varint(r) - 1;
+                return expr;
+            }
+        default:
+            r->failed = 1;
+            return NULL;
+    }
+}
+
+static Program* decode(const unsigned char* data, size_t size, uint64_t source_hash) {
+    if (size < sizeof(HkcHeader)) return NULL;
+
+    HkcHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, HKC_MAGIC, sizeof(HKC_MAGIC)) != 0 ||
+        header.version != HKC_VERSION ||
+        header.source_hash != source_hash) {
+        return NULL;
+    }
+
+    size_t code_offset = sizeof(header) + header.constants_size;
+    size_t lines_offset = code_offset + header.code_size;
+    lines_offset += (4 - lines_offset % 4) % 4;
+    if (code_offset > size || lines_offset > size ||
+        (size - lines_offset) / (2 * sizeof(int32_t)) < header.line_count) {
+        return NULL;
+    }
+    size_t payload_size = lines_offset - sizeof(header) + (size_t)header.line_count * 2 * sizeof(int32_t);
+    if (fnv1a(14695981039346656037ULL, data + sizeof(header), payload_size) != header.payload_hash) {
+        return NULL;
+    }
+
+    // Index the constant pool in place; strings are only copied as nodes claim them.
+    HkcReader reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.constants = malloc(sizeof(char*) * (header.constant_count > 0 ? header.constant_count : 1));
+    reader.constant_count = header.constant_count;
+
+    const unsigned char* cursor = data + sizeof(header);
+    const unsigned char* constants_end = data + code_offset;
+    for (uint32_t i = 0; i < header.constant_count; i++) {
+        uint32_t length;
+        if (cursor + sizeof(length) > constants_end) {
+            free(reader.constants);
+            return NULL;
+        }
+        memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        if ((size_t)(constants_end - cursor) < (size_t)length + 1 || cursor[length] != '\0') {
+            free(reader.constants);
+            return NULL;
+        }
+        reader.constants[i] = (const char*)cursor;
+        cursor += length + 1;
+    }
+
+    reader.code = data + code_offset;
+    reader.code_size = header.code_size;
+    reader.lines = (const int32_t*)(data + lines_offset);
+    reader.line_count = header.line_count;
+
+    Program* program = program_new();
+    int count;
+    Statement** statements = read_statements(&reader, &count);
+    for (int i = 0; i < count; i++) {
+        program_add_statement(program, statements[i]);
+    }
+    free(statements);
+    free(reader.constants);
+
+    if (reader.failed || reader.position != reader.code_size) {
+        program_free(program);
+        return NULL;
+    }
+    return program;
+}
+
+Program* hkc_load(const char* path, uint64_t source_hash) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return NULL;
+
+    Program* program = decode(data, (size_t)st.st_size, source_hash);
+    munmap(data, (size_t)st.st_size);
+    return program;
+}
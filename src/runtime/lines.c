@@ -0,0 +1,182 @@
+#include "lines.h"
+#include "vm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LINES_BUFFER_SIZE (1024 * 1024)
+// How far a mapped reader gets past the pages it has not released yet
+// before it releases them.
+#define LINES_RELEASE_SIZE (16 * 1024 * 1024)
+
+typedef struct LineReader {
+    Sequence base;
+    const char* next;  // where the next line starts
+    const char* end;   // the end of the bytes read so far
+    int fd;            // read from until the end of the input, or -1
+    int at_end;
+    char* buffer;      // malloc'd, reused by every refill
+    size_t capacity;
+    const char* kept;  // first mapped page not released yet
+} LineReader;
+
+static LineReader* reader_init(LineReader* reader, Object* (*next)(Sequence*), int fd) {
+    reader->base.next = next;
+    reader->base.done = 0;
+    reader->next = reader->end = NULL;
+    reader->fd = fd;
+    reader->at_end = 0;
+    reader->buffer = NULL;
+    reader->capacity = 0;
+    reader->kept = NULL;
+    return reader;
+}
+
+static void reader_close(LineReader* reader) {
+    if (reader->fd >= 0 && reader->fd != STDIN_FILENO) close(reader->fd);
+    reader->fd = -1;
+    free(reader->buffer);
+    reader->buffer = NULL;
+    reader->next = reader->end = NULL;
+    reader->capacity = 0;
+}
+
+static void reader_finalize(void* data) {
+    reader_close(data);
+    free(data);
+}
+
+// A mapped line views the mapping; a buffered one is copied out, since the
+// next refill writes over the buffer.
+static Object* line_object(LineReader* reader, const char* start, const char* end) {
+    if (end > start && end[-1] == '\r') end--;
+    if (reader->buffer) return object_new_string_length(start, end - start);
+    return object_new_string_view(start, end - start);
+}
+
+// Lines that view released pages still read right: the mapping is of
+// the file and never written, so the kernel reads them back in.
+static void release_behind(LineReader* reader) {
+    if (reader->next - reader->kept < LINES_RELEASE_SIZE) return;
+    long page = sysconf(_SC_PAGESIZE);
+    const char* until = reader->kept + (reader->next - reader->kept) / page * page;
+    madvise((void*)reader->kept, until - reader->kept, MADV_DONTNEED);
+    reader->kept = until;
+}
+
+static Object* mapped_next(Sequence* sequence) {
+    LineReader* reader = (LineReader*)sequence;
+    if (reader->next == reader->end) return NULL;
+    release_behind(reader);
+
+    const char* start = reader->next;
+    const char* newline = memchr(start, '\n', reader->end - start);
+    if (!newline) {
+        reader->next = reader->end;
+        return line_object(reader, start, reader->end);
+    }
+    reader->next = newline + 1;
+    return line_object(reader, start, newline);
+}
+
+// Reads more input after the unfinished line, which moves to the front of
+// the buffer first; the buffer only grows when that line fills all of it.
+// Returns 0 at the end of the input.
+static int refill(LineReader* reader) {
+    if (reader->at_end) return 0;
+
+    size_t pending = reader->end - reader->next;
+    if (pending > 0 && reader->next != reader->buffer) memmove(reader->buffer, reader->next, pending);
+    if (pending == reader->capacity) {
+        reader->capacity = reader->capacity ? reader->capacity * 2 : LINES_BUFFER_SIZE;
+        reader->buffer = realloc(reader->buffer, reader->capacity);
+    }
+    reader->next = reader->buffer;
+    reader->end = reader->buffer + pending;
+
+    ssize_t count;
+    do {
+        count = read(reader->fd, (char*)reader->end, reader->buffer + reader->capacity - reader->end);
+    } while (count < 0 && errno == EINTR);
+
+    if (count <= 0) {
+        reader->at_end = 1;
+        if (reader->fd != STDIN_FILENO) close(reader->fd);
+        reader->fd = -1;
+        return 0;
+    }
+    reader->end += count;
+    return 1;
+}
+
+static Object* buffered_next(Sequence* sequence) {
+    LineReader* reader = (LineReader*)sequence;
+    size_t scanned = 0;  // bytes after next known to hold no newline
+
+    for (;;) {
+        size_t unscanned = reader->end - reader->next - scanned;
+        const char* newline = unscanned > 0 ? memchr(reader->next + scanned, '\n', unscanned) : NULL;
+        if (newline) {
+            const char* start = reader->next;
+            reader->next = newline + 1;
+            return line_object(reader, start, newline);
+        }
+        scanned = reader->end - reader->next;
+
+        if (!refill(reader)) {
+            Object* last = reader->next == reader->end ? NULL : line_object(reader, reader->next, reader->end);
+            reader_close(reader);
+            return last;
+        }
+    }
+}
+
+static LineReader* mapped_reader_new(void) {
+    return reader_init(heap_alloc(vm_heap(), sizeof(LineReader)), mapped_next, -1);
+}
+
+// A reader of fd holds its buffer and fd until the end of the input. One
+// left before then gives them back when the VM's heap goes, so it is
+// malloc'd: a scratch region (heap.h) may drop its sequence before that.
+static LineReader* buffered_reader_new(int fd) {
+    LineReader* reader = reader_init(malloc(sizeof(LineReader)), buffered_next, fd);
+    heap_add_finalizer(vm_heap(), reader_finalize, reader);
+    return reader;
+}
+
+// Pipes, devices and the like cannot be mapped and are read instead, as
+// is a file the mapping of fails.
+Sequence* lines_open(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Could not open file \"%s\".\n", path);
+        exit(74);
+    }
+    if (!S_ISREG(st.st_mode)) return &buffered_reader_new(fd)->base;
+
+    char* mapping = NULL;
+    if (st.st_size > 0) {
+        mapping = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) return &buffered_reader_new(fd)->base;
+        madvise(mapping, st.st_size, MADV_SEQUENTIAL);
+        heap_retain_mapping(vm_heap(), mapping, st.st_size);
+    }
+    close(fd);
+
+    LineReader* reader = mapped_reader_new();
+    if (mapping) {
+        reader->next = reader->kept = mapping;
+        reader->end = mapping + st.st_size;
+    }
+    return &reader->base;
+}
+
+Sequence* lines_stdin(void) {
+    return &buffered_reader_new(STDIN_FILENO)->base;
+}
@@ -1,9 +1,26 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "lexer.h"
 #include "parser.h"
 #include "evaluator.h"
+#include "semantic.h"
+#include "cgen.h"
+#include "memo.h"
+#include "hkc.h"
+#include "astbin.h"
+#include "parallel.h"
+#include "incremental.h"
+#include "repl.h"
+#include "scheduler.h"
+#include "aio.h"
+#include "output.h"
+
+#define WATCH_POLL_MS 100
 
 char* read_file(const char* path) {
     FILE* file = fopen(path, "rb");
@@ -23,37 +40,294 @@ char* read_file(const char* path) {
 
 Object* eval_program(Program* program, Environment* env);
 
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        printf("Usage: interpreter <file_path>\n");
-        return 1;
+static void print_usage(void) {
+    printf("Usage: interpreter [--memo] [--stats] [--no-cache] [--emit-c [-o <output.c>]] [--emit-ast -o <output.hka>] [--dump-ast] [--flat] [--jobs <n>] [--no-uring] [--watch] <file_path>\n       interpreter --repl [--memo] [--stats] [--flat]\n");
+}
+
+static int has_extension(const char* path, const char* extension) {
+    size_t len = strlen(path);
+    size_t ext_len = strlen(extension);
+    return len >= ext_len && strcmp(path + len - ext_len, extension) == 0;
+}
+
+// A .hka file is used straight from its mapping when only printing;
+// running it rebuilds a Program and analyzes it like a parsed source.
+static int run_ast_file(const char* path, int dump_ast, int memoize_pure_functions) {
+    AstBinView* view = astbin_open(path);
+    if (!view) {
+        fprintf(stderr, "Could not load binary AST \"%s\".\n", path);
+        return 74;
     }
 
-    char* source = read_file(argv[1]);
+    if (dump_ast) {
+        astbin_print_program(view, 0);
+        astbin_close(view);
+        return 0;
+    }
 
-    Lexer* lexer = lexer_new(source);
-    Parser* parser = parser_new(lexer);
-    Program* program = parser_parse_program(parser);
+    Program* program = astbin_to_program(view);
+    astbin_close(view);
 
-    if (parser->error_count > 0) {
-        parser_print_errors(parser);
+    SemanticAnalyzer* analyzer = semantic_analyzer_new();
+    analyzer->memoize_pure_functions = memoize_pure_functions;
+    if (!semantic_analyze_program(analyzer, program)) {
+        semantic_print_errors(analyzer);
         return 1;
     }
 
     Environment* env = environment_new();
-    
     Object* evaluated = eval_program(program, env);
+    scheduler_shutdown();
+    if (evaluated != NULL) {
+        output_write("=> ", 3);
+        object_print(evaluated);
+        output_write("\n", 1);
+    }
+    output_flush();
+
+    semantic_analyzer_free(analyzer);
+    program_free(program);
+    environment_free(env);
+    return 0;
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Re-checks path whenever its modification time or size changes. Only
+// the declarations touched by the edit (and what depends on them) are
+// parsed and analyzed again.
+static int watch_file(const char* path) {
+    IncrementalSession* session = incremental_session_new();
+    struct timespec poll = { 0, WATCH_POLL_MS * 1000000L };
+    struct stat last;
+    memset(&last, 0, sizeof(last));
+
+    for (;;) {
+        struct stat current;
+        if (stat(path, &current) == 0 &&
+            (current.st_mtim.tv_sec != last.st_mtim.tv_sec || current.st_mtim.tv_nsec != last.st_mtim.tv_nsec ||
+             current.st_size != last.st_size)) {
+            last = current;
+            char* source = read_file(path);
+
+            double start = now_ms();
+            int ok = incremental_update(session, source, (int)strlen(source));
+            double elapsed = now_ms() - start;
+
+            if (!ok) incremental_print_errors(session);
+            printf("[watch] %s: %s in %.2f ms (%d/%d declarations parsed, %d analyzed%s)\n",
+                   path, ok ? "ok" : "errors", elapsed, session->reparsed_count, session->unit_count,
+                   session->reanalyzed_count, session->full_check ? ", full check" : "");
+            fflush(stdout);
+            free(source);
+        }
+        nanosleep(&poll, NULL);
+    }
+
+    incremental_session_free(session);
+    return 0;
+}
+
+// The C goes to a temporary file beside output_path that replaces it only
+// once the whole program was translated, so a failed run leaves no partial
+// file behind (nor clobbers an earlier good one). The file is named after
+// the process, as the cache's is, so two runs writing the same output do
+// not write into each other's.
+static int emit_c(Program* program, const char* output_path) {
+    if (!output_path) {
+        return cgen_emit_program(program, stdout) ? 0 : 1;
+    }
+
+    size_t length = strlen(output_path) + 32;
+    char* temp_path = malloc(length);
+    snprintf(temp_path, length, "%s.%ld.tmp", output_path, (long)getpid());
+
+    FILE* out = fopen(temp_path, "w");
+    if (!out) {
+        fprintf(stderr, "Could not open file \"%s\".\n", temp_path);
+        free(temp_path);
+        return 74;
+    }
+
+    int ok = cgen_emit_program(program, out);
+    if (fclose(out) != 0) ok = 0;
+    if (ok && rename(temp_path, output_path) != 0) {
+        fprintf(stderr, "Could not write file \"%s\".\n", output_path);
+        ok = 0;
+    }
+    if (!ok) unlink(temp_path);
+    free(temp_path);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    const char* path = NULL;
+    const char* output_path = NULL;
+    int emit_c_mode = 0;
+    int emit_ast_mode = 0;
+    int dump_ast = 0;
+    int use_flat_ast = 0;
+    int watch = 0;
+    int repl = 0;
+    int jobs = 1;
+    int memoize_pure_functions = 0;
+    int print_stats = 0;
+    int use_cache = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emit-c") == 0) {
+            emit_c_mode = 1;
+        } else if (strcmp(argv[i], "--emit-ast") == 0) {
+            emit_ast_mode = 1;
+        } else if (strcmp(argv[i], "--dump-ast") == 0) {
+            dump_ast = 1;
+        } else if (strcmp(argv[i], "--flat") == 0) {
+            use_flat_ast = 1;
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watch = 1;
+        } else if (strcmp(argv[i], "--repl") == 0) {
+            repl = 1;
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs <= 0) jobs = parallel_cpu_count();
+            scheduler_set_thread_count(jobs);
+        } else if (strcmp(argv[i], "--no-uring") == 0) {
+            aio_set_uring(0);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--memo") == 0) {
+            memoize_pure_functions = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            print_stats = 1;
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            use_cache = 0;
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (repl && path == NULL) {
+        ReplSession* session = repl_session_new(memoize_pure_functions, use_flat_ast);
+        int status = repl_run(session, stdin);
+        scheduler_shutdown();
+        if (print_stats) {
+            memo_print_stats(stderr);
+        }
+        repl_session_free(session);
+        return status;
+    }
+
+    if (path == NULL) {
+        print_usage();
+        return 1;
+    }
+
+    if (emit_ast_mode && output_path == NULL) {
+        print_usage();
+        return 1;
+    }
+
+    if (watch) {
+        return watch_file(path);
+    }
+
+    if (has_extension(path, ".hka")) {
+        return run_ast_file(path, dump_ast, memoize_pure_functions);
+    }
+
+    char* source = read_file(path);
+
+    // --emit-c needs the resolved types, which the cache does not keep, and
+    // the AST modes always work from a fresh parse.
+    use_cache = use_cache && !emit_c_mode && !emit_ast_mode && !dump_ast;
+    uint64_t source_hash = hkc_hash_source(source, strlen(source), (uint32_t)memoize_pure_functions);
+    char* cache_path = hkc_path_for(path);
+
+    Program* program = use_cache ? hkc_load(cache_path, source_hash) : NULL;
+    SemanticAnalyzer* analyzer = NULL;
+
+    if (!program) {
+        Lexer* lexer = lexer_new(source);
+        Parser* parser = parser_new(lexer);
+        program = jobs > 1 ? parser_parse_program_parallel(parser, jobs) : parser_parse_program(parser);
+
+        if (parser->error_count > 0) {
+            parser_print_errors(parser);
+            return 1;
+        }
+
+        analyzer = semantic_analyzer_new();
+        analyzer->memoize_pure_functions = memoize_pure_functions;
+        int analyzed = jobs > 1 ? semantic_analyze_program_parallel(analyzer, program, jobs)
+                                : semantic_analyze_program(analyzer, program);
+        if (!analyzed) {
+            semantic_print_errors(analyzer);
+            return 1;
+        }
+
+        if (use_cache) {
+            hkc_write(cache_path, program, source_hash);
+        }
+    }
+    free(cache_path);
+
+    if (dump_ast) {
+        ast_print_program(program, 0);
+    } else if (emit_ast_mode && !astbin_write(output_path, program)) {
+        fprintf(stderr, "Could not write binary AST \"%s\".\n", output_path);
+        return 74;
+    }
+
+    if (dump_ast || emit_ast_mode) {
+        semantic_analyzer_free(analyzer);
+        program_free(program);
+        free(source);
+        return 0;
+    }
+
+    if (emit_c_mode) {
+        int status = emit_c(program, output_path);
+        semantic_analyzer_free(analyzer);
+        program_free(program);
+        free(source);
+        return status;
+    }
+
+    Environment* env = environment_new();
+    FlatAst* flat = NULL;
+    Object* evaluated;
+
+    if (use_flat_ast) {
+        flat = flat_ast_from_program(program);
+        evaluated = flat_eval_program(flat, env);
+    } else {
+        evaluated = eval_program(program, env);
+    }
+    scheduler_shutdown();
 
     if (evaluated != NULL) {
-        printf("=> ");
+        output_write("=> ", 3);
         object_print(evaluated);
-        printf("\n");
-        object_free(evaluated);
+        output_write("\n", 1);
+    }
+    output_flush();
+
+    if (print_stats) {
+        memo_print_stats(stderr);
     }
 
+    semantic_analyzer_free(analyzer);
     program_free(program);
     environment_free(env);
+    flat_ast_free(flat);
     free(source);
 
     return 0;
-}
\ No newline at end of file
+}
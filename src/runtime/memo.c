@@ -0,0 +1,243 @@
+#include "memo.h"
+#include "vm.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char* string_duplicate(const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str);
+    char* dup = malloc(len + 1);
+    if (!dup) return NULL;
+    strcpy(dup, str);
+    return dup;
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t length) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int is_key_object(Object* obj) {
+    return obj && (obj->type == OBJ_INTEGER || obj->type == OBJ_FLOAT ||
+                   obj->type == OBJ_BOOLEAN || obj->type == OBJ_STRING);
+}
+
+static uint64_t hash_arguments(Object** args, int arg_count) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i = 0; i < arg_count; i++) {
+        Object* arg = args[i];
+        hash = hash_bytes(hash, &arg->type, sizeof(arg->type));
+        switch (arg->type) {
+            case OBJ_INTEGER: hash = hash_bytes(hash, &arg->value.integer, sizeof(int64_t)); break;
+            case OBJ_FLOAT: hash = hash_bytes(hash, &arg->value.float_val, sizeof(double)); break;
+            case OBJ_BOOLEAN: hash = hash_bytes(hash, &arg->value.boolean, sizeof(int)); break;
+            case OBJ_STRING: {
+                uint64_t string_hash_value = string_hash(&arg->value.string);
+                hash = hash_bytes(hash, &string_hash_value, sizeof(uint64_t));
+                break;
+            }
+            default: break;
+        }
+    }
+    return hash;
+}
+
+static int key_matches(MemoKey* key, Object* arg) {
+    if (key->type != arg->type) return 0;
+    switch (arg->type) {
+        case OBJ_INTEGER: return key->value.integer == arg->value.integer;
+        case OBJ_FLOAT: return key->value.float_val == arg->value.float_val;
+        case OBJ_BOOLEAN: return key->value.boolean == arg->value.boolean;
+        case OBJ_STRING: return strcmp(key->value.string, string_chars(&arg->value.string)) == 0;
+        default: return 0;
+    }
+}
+
+static void entry_clear(MemoEntry* entry, int arg_count) {
+    for (int i = 0; i < arg_count; i++) {
+        if (entry->keys[i].type == OBJ_STRING) {
+            free(entry->keys[i].value.string);
+        }
+    }
+    entry->used = 0;
+}
+
+static MemoTable* memo_table_new(const char* name, int arg_count) {
+    MemoTable* table = malloc(sizeof(MemoTable));
+    if (!table) return NULL;
+
+    table->name = string_duplicate(name ? name : "<anonymous>");
+    table->entries = calloc(MEMO_TABLE_INITIAL_CAPACITY, sizeof(MemoEntry));
+    if (!table->name || !table->entries) {
+        free(table->name);
+        free(table->entries);
+        free(table);
+        return NULL;
+    }
+    table->arg_count = arg_count;
+    table->capacity = MEMO_TABLE_INITIAL_CAPACITY;
+    table->size = 0;
+    table->hits = 0;
+    table->misses = 0;
+    table->evictions = 0;
+    table->next = NULL;
+    pthread_mutex_init(&table->lock, NULL);
+    return table;
+}
+
+MemoTable* memo_table_of(Object* function) {
+    MemoTable* table = atomic_load_explicit(&function->value.function.memo, memory_order_acquire);
+    if (table) return table;
+
+    // Tasks calling it for the first time at once must agree on one table.
+    HunickVM* vm = vm_current();
+    pthread_mutex_lock(&vm->memo_lock);
+    table = atomic_load_explicit(&function->value.function.memo, memory_order_relaxed);
+    if (!table) {
+        // NULL when out of memory: the call then goes unmemoized.
+        table = memo_table_new(function->value.function.memo_name, function->value.function.parameter_count);
+        if (table) {
+            table->next = vm->memo_tables;
+            vm->memo_tables = table;
+            atomic_store_explicit(&function->value.function.memo, table, memory_order_release);
+        }
+    }
+    pthread_mutex_unlock(&vm->memo_lock);
+    return table;
+}
+
+// Doubles the table while it is over half full, so that distinct arguments
+// rarely evict each other before the cap. Entries that land on the same
+// slot of the larger table keep the later one. Stays as it is when out of
+// memory.
+static void memo_grow(MemoTable* table) {
+    if (table->capacity >= MEMO_TABLE_CAPACITY || table->size * 2 <= table->capacity) return;
+
+    int capacity = table->capacity * 2;
+    MemoEntry* entries = calloc((size_t)capacity, sizeof(MemoEntry));
+    if (!entries) return;
+
+    int size = 0;
+    for (int i = 0; i < table->capacity; i++) {
+        MemoEntry* old = &table->entries[i];
+        if (!old->used) continue;
+        MemoEntry* entry = &entries[old->hash & (uint64_t)(capacity - 1)];
+        if (entry->used) {
+            entry_clear(entry, table->arg_count);
+            table->evictions++;
+        } else {
+            size++;
+        }
+        *entry = *old;
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    table->size = size;
+}
+
+Object* memo_lookup(MemoTable* table, Object** args, int arg_count) {
+    if (!table || arg_count != table->arg_count) return NULL;
+
+    for (int i = 0; i < arg_count; i++) {
+        if (!is_key_object(args[i])) return NULL;
+    }
+
+    uint64_t hash = hash_arguments(args, arg_count);
+    Object* result = NULL;
+
+    pthread_mutex_lock(&table->lock);
+    MemoEntry* entry = &table->entries[hash & (uint64_t)(table->capacity - 1)];
+    if (entry->used && entry->hash == hash) {
+        int match = 1;
+        for (int i = 0; i < arg_count && match; i++) {
+            match = key_matches(&entry->keys[i], args[i]);
+        }
+        if (match) result = entry->result;
+    }
+
+    if (result) {
+        table->hits++;
+    } else {
+        table->misses++;
+    }
+    pthread_mutex_unlock(&table->lock);
+    return result;
+}
+
+void memo_store(MemoTable* table, Object** args, int arg_count, Object* result) {
+    if (!table || !result || arg_count != table->arg_count) return;
+
+    for (int i = 0; i < arg_count; i++) {
+        if (!is_key_object(args[i])) return;
+    }
+
+    uint64_t hash = hash_arguments(args, arg_count);
+
+    pthread_mutex_lock(&table->lock);
+    memo_grow(table);
+    MemoEntry* entry = &table->entries[hash & (uint64_t)(table->capacity - 1)];
+    if (entry->used) {
+        entry_clear(entry, arg_count);
+        table->evictions++;
+    } else {
+        table->size++;
+    }
+
+    entry->hash = hash;
+    entry->used = 1;
+    entry->result = result;
+    heap_note_store(table, result);
+    for (int i = 0; i < arg_count; i++) {
+        entry->keys[i].type = args[i]->type;
+        switch (args[i]->type) {
+            case OBJ_INTEGER: entry->keys[i].value.integer = args[i]->value.integer; break;
+            case OBJ_FLOAT: entry->keys[i].value.float_val = args[i]->value.float_val; break;
+            case OBJ_BOOLEAN: entry->keys[i].value.boolean = args[i]->value.boolean; break;
+            case OBJ_STRING: entry->keys[i].value.string = string_duplicate(string_chars(&args[i]->value.string)); break;
+            default: break;
+        }
+    }
+    for (int i = 0; i < arg_count; i++) {
+        if (entry->keys[i].type == OBJ_STRING && !entry->keys[i].value.string) {
+            entry_clear(entry, arg_count);
+            table->size--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&table->lock);
+}
+
+void memo_tables_free(MemoTable* tables) {
+    while (tables) {
+        MemoTable* next = tables->next;
+        for (int i = 0; i < tables->capacity; i++) {
+            if (tables->entries[i].used) entry_clear(&tables->entries[i], tables->arg_count);
+        }
+        pthread_mutex_destroy(&tables->lock);
+        free(tables->entries);
+        free(tables->name);
+        free(tables);
+        tables = next;
+    }
+}
+
+void memo_print_stats(FILE* out) {
+    MemoTable* tables = vm_current()->memo_tables;
+    if (!tables) return;
+
+    fprintf(out, "Memoization:\n");
+    for (MemoTable* table = tables; table; table = table->next) {
+        fprintf(out, "  %s: %llu hits, %llu misses, %d/%d entries, %llu evictions\n",
+                table->name,
+                (unsigned long long)table->hits,
+                (unsigned long long)table->misses,
+                table->size, table->capacity,
+                (unsigned long long)table->evictions);
+    }
+}
@@ -0,0 +1,190 @@
+#include "output.h"
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// The owner holds lock while it appends and output_flush_all while it
+// drains, so flush() can empty a buffer another thread is filling.
+typedef struct OutputBuffer {
+    pthread_mutex_t lock;
+    size_t used;
+    struct OutputBuffer* next;  // every live thread's buffer, for output_flush_all
+    struct OutputBuffer** link;
+    char bytes[OUTPUT_BUFFER_SIZE];
+} OutputBuffer;
+
+static pthread_once_t output_once = PTHREAD_ONCE_INIT;
+static pthread_key_t output_key;
+static pthread_mutex_t output_lock = PTHREAD_MUTEX_INITIALIZER;
+static OutputBuffer* output_buffers;
+
+static _Thread_local OutputBuffer* thread_buffer;
+
+static void write_all(const char* bytes, size_t length) {
+    fflush(stdout);
+    while (length > 0) {
+        ssize_t written = write(STDOUT_FILENO, bytes, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        bytes += written;
+        length -= (size_t)written;
+    }
+}
+
+static void buffer_flush(OutputBuffer* buffer) {
+    if (buffer->used == 0) return;
+    write_all(buffer->bytes, buffer->used);
+    buffer->used = 0;
+}
+
+// Runs as a thread exits. Once unlinked no other thread can reach the
+// buffer.
+static void buffer_release(void* value) {
+    OutputBuffer* buffer = value;
+    pthread_mutex_lock(&output_lock);
+    *buffer->link = buffer->next;
+    if (buffer->next) buffer->next->link = buffer->link;
+    pthread_mutex_unlock(&output_lock);
+
+    buffer_flush(buffer);
+    pthread_mutex_destroy(&buffer->lock);
+    free(buffer);
+}
+
+// The main thread never runs key destructors, so its buffer is written
+// at exit.
+static void output_init(void) {
+    pthread_key_create(&output_key, buffer_release);
+    atexit(output_flush_all);
+}
+
+static OutputBuffer* current_buffer(void) {
+    if (thread_buffer) return thread_buffer;
+
+    pthread_once(&output_once, output_init);
+    OutputBuffer* buffer = malloc(sizeof(OutputBuffer));
+    pthread_mutex_init(&buffer->lock, NULL);
+    buffer->used = 0;
+
+    pthread_mutex_lock(&output_lock);
+    buffer->next = output_buffers;
+    buffer->link = &output_buffers;
+    if (output_buffers) output_buffers->link = &buffer->next;
+    output_buffers = buffer;
+    pthread_mutex_unlock(&output_lock);
+
+    pthread_setspecific(output_key, buffer);
+    thread_buffer = buffer;
+    return buffer;
+}
+
+void output_write(const char* bytes, size_t length) {
+    OutputBuffer* buffer = current_buffer();
+    pthread_mutex_lock(&buffer->lock);
+    if (length > OUTPUT_BUFFER_SIZE - buffer->used) {
+        buffer_flush(buffer);
+        if (length > OUTPUT_BUFFER_SIZE) {
+            write_all(bytes, length);
+            pthread_mutex_unlock(&buffer->lock);
+            return;
+        }
+    }
+    memcpy(buffer->bytes + buffer->used, bytes, length);
+    buffer->used += length;
+    pthread_mutex_unlock(&buffer->lock);
+}
+
+void output_string(const char* string) {
+    output_write(string, strlen(string));
+}
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Writes value's digits so that they end at end, two at a time, and
+// returns where they start.
+static char* format_digits(char* end, uint64_t value) {
+    while (value >= 100) {
+        end -= 2;
+        memcpy(end, digit_pairs + value % 100 * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        end -= 2;
+        memcpy(end, digit_pairs + value * 2, 2);
+    } else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+void output_int(int64_t value) {
+    char text[24];
+    char* end = text + sizeof(text);
+    char* start = format_digits(end, value < 0 ? 0 - (uint64_t)value : (uint64_t)value);
+    if (value < 0) *--start = '-';
+    output_write(start, (size_t)(end - start));
+}
+
+// Below 1e9 the value times 1e6 is under 2^50, so the product is off from
+// the exact one by at most 1/16. Unless its fraction is that close to a
+// half, rounding it gives the digits printf would, which round the exact
+// value. Everything else goes to snprintf.
+void output_float(double value) {
+    double magnitude = fabs(value);
+    if (magnitude < 1e9) {
+        double scaled = magnitude * 1e6;
+        double whole = floor(scaled);
+        double fraction = scaled - whole;
+        if (fabs(fraction - 0.5) > 0.0625) {
+            uint64_t units = (uint64_t)whole + (fraction > 0.5);
+            char text[32];
+            char* end = text + sizeof(text);
+            char* start = format_digits(end, units % 1000000);
+            while (end - start < 6) *--start = '0';
+            *--start = '.';
+            start = format_digits(start, units / 1000000);
+            if (signbit(value)) *--start = '-';
+            output_write(start, (size_t)(end - start));
+            return;
+        }
+    }
+
+    char text[512];
+    int length = snprintf(text, sizeof(text), "%f", value);
+    output_write(text, (size_t)length);
+}
+
+void output_flush(void) {
+    OutputBuffer* buffer = thread_buffer;
+    if (!buffer) return;
+    pthread_mutex_lock(&buffer->lock);
+    buffer_flush(buffer);
+    pthread_mutex_unlock(&buffer->lock);
+}
+
+// Buffers go out in turn, so each thread's bytes stay in order.
+void output_flush_all(void) {
+    pthread_mutex_lock(&output_lock);
+    for (OutputBuffer* buffer = output_buffers; buffer; buffer = buffer->next) {
+        pthread_mutex_lock(&buffer->lock);
+        buffer_flush(buffer);
+        pthread_mutex_unlock(&buffer->lock);
+    }
+    pthread_mutex_unlock(&output_lock);
+}
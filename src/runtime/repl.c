@@ -0,0 +1,170 @@
+#include "repl.h"
+#include "lexer.h"
+#include "parser.h"
+#include "evaluator.h"
+#include "memo.h"
+#include "output.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#define REPL_PROMPT ">> "
+#define REPL_CONTINUE_PROMPT ".. "
+
+ReplSession* repl_session_new(int memoize_pure_functions, int use_flat_ast) {
+    ReplSession* session = calloc(1, sizeof(ReplSession));
+    session->analyzer = semantic_analyzer_new();
+    session->analyzer->memoize_pure_functions = memoize_pure_functions;
+    session->env = environment_new();
+    session->use_flat_ast = use_flat_ast;
+    return session;
+}
+
+void repl_session_free(ReplSession* session) {
+    if (!session) return;
+
+    environment_free(session->env);
+    for (int i = 0; i < session->input_count; i++) {
+        flat_ast_free(session->flats[i]);
+        program_free(session->programs[i]);
+    }
+    free(session->programs);
+    free(session->flats);
+    semantic_analyzer_free(session->analyzer);
+    free(session);
+}
+
+static void keep_input(ReplSession* session, Program* program, FlatAst* flat) {
+    if (session->input_count >= session->input_capacity) {
+        session->input_capacity = session->input_capacity ? session->input_capacity * 2 : 16;
+        session->programs = realloc(session->programs, sizeof(Program*) * session->input_capacity);
+        session->flats = realloc(session->flats, sizeof(FlatAst*) * session->input_capacity);
+    }
+    session->programs[session->input_count] = program;
+    session->flats[session->input_count] = flat;
+    session->input_count++;
+}
+
+int repl_eval(ReplSession* session, const char* input) {
+    int length = (int)strlen(input);
+    int first_line = session->line + 1;
+    for (int i = 0; i < length; i++) {
+        if (input[i] == '\n') session->line++;
+    }
+    if (length > 0 && input[length - 1] != '\n') session->line++;
+
+    Lexer* lexer = lexer_new_range(input, 0, length, first_line, 0);
+    Parser* parser = parser_new(lexer);
+    Program* program = parser_parse_program(parser);
+
+    if (parser->error_count > 0) {
+        parser_print_errors(parser);
+        lexer_free(lexer);
+        parser_free(parser);
+        program_free(program);
+        return 0;
+    }
+    lexer_free(lexer);
+    parser_free(parser);
+
+    SemanticAnalyzer* analyzer = session->analyzer;
+    int first_index = analyzer->global_scope->symbol_count;
+    int analyzed = semantic_analyze_program(analyzer, program);
+
+    // A statement that fails part-way can leave its inner scopes open.
+    while (analyzer->current_scope != analyzer->global_scope) {
+        semantic_pop_scope(analyzer);
+    }
+
+    if (!analyzed) {
+        semantic_print_errors(analyzer);
+        semantic_clear_errors(analyzer);
+        semantic_drop_globals_from(analyzer, first_index);
+        program_free(program);
+        return 0;
+    }
+
+    FlatAst* flat = NULL;
+    Object* evaluated;
+    if (session->use_flat_ast) {
+        flat = flat_ast_from_program(program);
+        evaluated = flat_eval_program(flat, session->env);
+    } else {
+        evaluated = eval_program(program, session->env);
+    }
+    keep_input(session, program, flat);
+
+    if (evaluated != NULL) {
+        output_write("=> ", 3);
+        object_print(evaluated);
+        output_write("\n", 1);
+    }
+    output_flush();
+    return 1;
+}
+
+static int run_command(ReplSession* session, const char* command) {
+    if (strcmp(command, ":quit") == 0 || strcmp(command, ":q") == 0) {
+        return 0;
+    }
+    if (strcmp(command, ":stats") == 0) {
+        memo_print_stats(stdout);
+    } else {
+        printf("Unknown command \"%s\" (try :stats or :quit)\n", command);
+    }
+    return 1;
+}
+
+int repl_run(ReplSession* session, FILE* in) {
+    int interactive = isatty(fileno(in));
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t line_length;
+
+    size_t input_capacity = 256;
+    size_t input_length = 0;
+    char* input = malloc(input_capacity);
+
+    for (;;) {
+        if (interactive) {
+            fputs(input_length > 0 ? REPL_CONTINUE_PROMPT : REPL_PROMPT, stdout);
+        }
+        fflush(stdout);
+
+        line_length = getline(&line, &line_capacity, in);
+        if (line_length < 0) break;
+
+        if (input_length == 0 && line[0] == ':') {
+            session->line++;
+            while (line_length > 0 && isspace((unsigned char)line[line_length - 1])) {
+                line[--line_length] = '\0';
+            }
+            if (!run_command(session, line)) break;
+            continue;
+        }
+
+        if (input_length + line_length + 1 > input_capacity) {
+            while (input_length + line_length + 1 > input_capacity) input_capacity *= 2;
+            input = realloc(input, input_capacity);
+        }
+        memcpy(input + input_length, line, line_length);
+        input_length += line_length;
+        input[input_length] = '\0';
+
+        if (!parser_input_complete(input, (int)input_length)) continue;
+
+        repl_eval(session, input);
+        input_length = 0;
+    }
+
+    // Let an unfinished input at end of file report its own parse error.
+    if (input_length > 0) {
+        repl_eval(session, input);
+    }
+    if (interactive) printf("\n");
+
+    free(line);
+    free(input);
+    return 0;
+}
@@ -0,0 +1,501 @@
+#include "scheduler.h"
+#include "aio.h"
+#include "evaluator.h"
+#include "output.h"
+#include "parallel.h"
+#include "vm.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEQUE_INITIAL_CAPACITY 64
+#define IDLE_SPINS 64
+#define RANGE_CHUNKS 64
+#define BLOCK_SPINS 256
+#define MAX_SPARE_WORKERS 64
+#define AWAIT_POLL_MS 1
+
+#define TASK_PENDING 0
+#define TASK_DONE 1
+
+// The iterations of one scheduler_parallel_range call. Helper tasks and
+// the caller all claim chunks from `next` until none are left.
+typedef struct RangeJob {
+    RangeTask task;
+    void* context;
+    int64_t start;
+    int64_t chunk_count;
+    int64_t chunk_size;   // iterations per chunk, one more for the first `remainder`
+    int64_t remainder;
+    atomic_int_fast64_t next;
+} RangeJob;
+
+struct Task {
+    Object* fn;
+    Object** args;
+    int arg_count;
+    RangeJob* range;      // set instead of fn for a scheduler_parallel_range helper
+    int external;         // finished by scheduler_complete, never queued
+    Object* result;
+    atomic_int state;
+};
+
+// Circular buffer of a deque. A thief may still be reading an outgrown
+// buffer, so the old ones stay chained to the new one until shutdown.
+typedef struct DequeBuffer {
+    int64_t capacity;  // power of two
+    struct DequeBuffer* retired;
+    _Atomic(Task*) items[];
+} DequeBuffer;
+
+// Chase-Lev work-stealing deque, with the C11 orderings from Le et al.,
+// "Correct and Efficient Work-Stealing for Weak Memory Models" (2013).
+// Only the owning worker pushes and pops at the bottom; any worker may
+// steal from the top.
+typedef struct Deque {
+    _Alignas(64) atomic_int_fast64_t top;
+    _Alignas(64) atomic_int_fast64_t bottom;
+    _Atomic(DequeBuffer*) buffer;
+} Deque;
+
+typedef struct Worker {
+    Deque deque;
+    uint32_t seed;
+    pthread_t thread;
+} Worker;
+
+struct Scheduler {
+    HunickVM* vm;          // bound in every worker thread
+    int requested_thread_count;
+    Worker* workers;       // room for MAX_SPARE_WORKERS more than requested
+    atomic_int worker_count;
+    int capacity;          // workers allocated
+    atomic_int started;
+    atomic_int stopping;
+    atomic_int pending;    // tasks sitting in some deque
+    atomic_int sleeping;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+};
+
+typedef struct WorkerStart {
+    Scheduler* scheduler;
+    int index;
+} WorkerStart;
+
+// A thread works for one scheduler at a time: its own worker threads, or
+// worker 0 for the thread running the VM.
+static _Thread_local int current_worker = 0;
+
+static Scheduler* current_scheduler(void) {
+    return vm_current()->scheduler;
+}
+
+static DequeBuffer* deque_buffer_new(int64_t capacity, DequeBuffer* retired) {
+    DequeBuffer* buffer = malloc(sizeof(DequeBuffer) + sizeof(_Atomic(Task*)) * capacity);
+    buffer->capacity = capacity;
+    buffer->retired = retired;
+    return buffer;
+}
+
+static void deque_init(Deque* deque) {
+    atomic_init(&deque->top, 0);
+    atomic_init(&deque->bottom, 0);
+    atomic_init(&deque->buffer, deque_buffer_new(DEQUE_INITIAL_CAPACITY, NULL));
+}
+
+static void deque_free(Deque* deque) {
+    DequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    while (buffer) {
+        DequeBuffer* retired = buffer->retired;
+        free(buffer);
+        buffer = retired;
+    }
+}
+
+static void deque_push(Deque* deque, Task* task) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    DequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+
+    if (bottom - top > buffer->capacity - 1) {
+        DequeBuffer* grown = deque_buffer_new(buffer->capacity * 2, buffer);
+        for (int64_t i = top; i < bottom; i++) {
+            Task* item = atomic_load_explicit(&buffer->items[i & (buffer->capacity - 1)], memory_order_relaxed);
+            atomic_store_explicit(&grown->items[i & (grown->capacity - 1)], item, memory_order_relaxed);
+        }
+        atomic_store_explicit(&deque->buffer, grown, memory_order_release);
+        buffer = grown;
+    }
+
+    atomic_store_explicit(&buffer->items[bottom & (buffer->capacity - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+}
+
+static Task* deque_pop(Deque* deque) {
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    DequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_relaxed);
+
+    if (top > bottom) {
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    Task* task = atomic_load_explicit(&buffer->items[bottom & (buffer->capacity - 1)], memory_order_relaxed);
+    if (top == bottom) {
+        // Last item: race any thief for it.
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed)) {
+            task = NULL;
+        }
+        atomic_store_explicit(&deque->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static Task* deque_steal(Deque* deque) {
+    int64_t top = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+
+    DequeBuffer* buffer = atomic_load_explicit(&deque->buffer, memory_order_acquire);
+    Task* task = atomic_load_explicit(&buffer->items[top & (buffer->capacity - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &top, top + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+static uint32_t next_random(Worker* worker) {
+    uint32_t x = worker->seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    worker->seed = x;
+    return x;
+}
+
+// Own deque first (most recently spawned, still warm in cache), then one
+// pass over the others starting from a random victim.
+static Task* find_task(Scheduler* scheduler, int index) {
+    Worker* self = &scheduler->workers[index];
+    Task* task = deque_pop(&self->deque);
+    int worker_count = atomic_load(&scheduler->worker_count);
+
+    if (!task && worker_count > 1) {
+        int start = (int)(next_random(self) % (uint32_t)worker_count);
+        for (int i = 0; i < worker_count && !task; i++) {
+            int victim = (start + i) % worker_count;
+            if (victim != index) {
+                task = deque_steal(&scheduler->workers[victim].deque);
+            }
+        }
+    }
+
+    if (task) atomic_fetch_sub(&scheduler->pending, 1);
+    return task;
+}
+
+static void run_range(RangeJob* job) {
+    int64_t chunk;
+    while ((chunk = atomic_fetch_add(&job->next, 1)) < job->chunk_count) {
+        int64_t extra = chunk < job->remainder ? chunk : job->remainder;
+        int64_t start = job->start + chunk * job->chunk_size + extra;
+        int64_t end = start + job->chunk_size + (chunk < job->remainder ? 1 : 0);
+        job->task(job->context, chunk, start, end);
+    }
+}
+
+static void run_task(Task* task) {
+    if (task->range) {
+        run_range(task->range);
+    } else {
+        task->result = eval_apply_function(task->fn, task->args, task->arg_count);
+        free(task->args);
+        task->args = NULL;
+    }
+    output_flush();
+    atomic_store_explicit(&task->state, TASK_DONE, memory_order_release);
+}
+
+static void* worker_main(void* arg) {
+    WorkerStart* start = arg;
+    Scheduler* scheduler = start->scheduler;
+    int index = start->index;
+    free(start);
+
+    vm_bind(scheduler->vm);
+    current_worker = index;
+    int spins = 0;
+
+    for (;;) {
+        Task* task = find_task(scheduler, index);
+        if (task) {
+            run_task(task);
+            spins = 0;
+            continue;
+        }
+
+        if (atomic_load(&scheduler->stopping) && atomic_load(&scheduler->pending) == 0) break;
+
+        if (++spins < IDLE_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        // Announce the sleep before re-checking pending, so a concurrent
+        // spawn either sees the sleeper or is seen by it.
+        pthread_mutex_lock(&scheduler->lock);
+        atomic_fetch_add(&scheduler->sleeping, 1);
+        while (atomic_load(&scheduler->pending) == 0 && !atomic_load(&scheduler->stopping)) {
+            pthread_cond_wait(&scheduler->wake, &scheduler->lock);
+        }
+        atomic_fetch_sub(&scheduler->sleeping, 1);
+        pthread_mutex_unlock(&scheduler->lock);
+        spins = 0;
+    }
+    return NULL;
+}
+
+Scheduler* scheduler_new(HunickVM* vm, int thread_count) {
+    Scheduler* scheduler = calloc(1, sizeof(Scheduler));
+    scheduler->vm = vm;
+    scheduler->requested_thread_count = thread_count;
+    pthread_mutex_init(&scheduler->lock, NULL);
+    pthread_cond_init(&scheduler->wake, NULL);
+    return scheduler;
+}
+
+void scheduler_free(Scheduler* scheduler) {
+    if (!scheduler) return;
+    HunickVM* previous = vm_bind(scheduler->vm);
+    scheduler_shutdown();
+    vm_bind(previous);
+
+    pthread_mutex_destroy(&scheduler->lock);
+    pthread_cond_destroy(&scheduler->wake);
+    free(scheduler);
+}
+
+static void worker_init(Scheduler* scheduler, int index) {
+    deque_init(&scheduler->workers[index].deque);
+    scheduler->workers[index].seed = 2463534242u + (uint32_t)index * 2654435761u;
+}
+
+static void worker_create(Scheduler* scheduler, int index) {
+    WorkerStart* start = malloc(sizeof(WorkerStart));
+    start->scheduler = scheduler;
+    start->index = index;
+    pthread_create(&scheduler->workers[index].thread, NULL, worker_main, start);
+}
+
+static void scheduler_start(Scheduler* scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+    if (!atomic_load(&scheduler->started)) {
+        int count = scheduler->requested_thread_count > 0 ? scheduler->requested_thread_count : parallel_cpu_count();
+        // Deque keeps its ends on cache lines of their own, which calloc
+        // does not align for.
+        scheduler->workers = aligned_alloc(_Alignof(Worker), sizeof(Worker) * (count + MAX_SPARE_WORKERS));
+        memset(scheduler->workers, 0, sizeof(Worker) * (count + MAX_SPARE_WORKERS));
+        scheduler->capacity = count + MAX_SPARE_WORKERS;
+        atomic_store(&scheduler->worker_count, count);
+        atomic_store(&scheduler->stopping, 0);
+        for (int i = 0; i < count; i++) {
+            worker_init(scheduler, i);
+        }
+        current_worker = 0;
+        for (int i = 1; i < count; i++) {
+            worker_create(scheduler, i);
+        }
+        atomic_store(&scheduler->started, 1);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+// Thieves only look at workers below worker_count, so the new deque is
+// ready before the count covers it.
+static void add_spare_worker(Scheduler* scheduler) {
+    pthread_mutex_lock(&scheduler->lock);
+    int index = atomic_load(&scheduler->worker_count);
+    if (index < scheduler->capacity && !atomic_load(&scheduler->stopping)) {
+        worker_init(scheduler, index);
+        atomic_store(&scheduler->worker_count, index + 1);
+        worker_create(scheduler, index);
+    }
+    pthread_mutex_unlock(&scheduler->lock);
+}
+
+static Scheduler* started_scheduler(void) {
+    Scheduler* scheduler = current_scheduler();
+    if (!atomic_load(&scheduler->started)) scheduler_start(scheduler);
+    return scheduler;
+}
+
+void scheduler_set_thread_count(int thread_count) {
+    current_scheduler()->requested_thread_count = thread_count;
+}
+
+// A future can be awaited any time while its VM lives, so spawned and
+// external tasks come from the VM's heap; a range helper, which nothing
+// outlives, is malloc'd (heap NULL) and freed by its caller. A task may
+// still run after the scratch region it was made in is reset, so it
+// escapes every region open on this thread.
+static Task* task_new(Heap* heap, Object* fn, Object** args, int arg_count, RangeJob* range) {
+    Task* task;
+    if (heap) {
+        heap_scratch_escape();
+        task = heap_alloc(heap, sizeof(Task));
+    } else {
+        task = malloc(sizeof(Task));
+    }
+    task->fn = fn;
+    task->args = args;
+    task->arg_count = arg_count;
+    task->range = range;
+    task->external = 0;
+    task->result = NULL;
+    atomic_init(&task->state, TASK_PENDING);
+    return task;
+}
+
+static void submit(Scheduler* scheduler, Task* task) {
+    deque_push(&scheduler->workers[current_worker].deque, task);
+    atomic_fetch_add(&scheduler->pending, 1);
+
+    if (atomic_load(&scheduler->sleeping) > 0) {
+        pthread_mutex_lock(&scheduler->lock);
+        pthread_cond_signal(&scheduler->wake);
+        pthread_mutex_unlock(&scheduler->lock);
+    }
+}
+
+Task* scheduler_spawn(Object* fn, Object** args, int arg_count) {
+    Scheduler* scheduler = started_scheduler();
+    Task* task = task_new(vm_heap(), fn, args, arg_count, NULL);
+    output_flush();
+    submit(scheduler, task);
+    return task;
+}
+
+Task* scheduler_task_new(void) {
+    Task* task = task_new(vm_heap(), NULL, NULL, 0, NULL);
+    task->external = 1;
+    return task;
+}
+
+void scheduler_complete(Task* task, Object* result) {
+    task->result = result;
+    atomic_store_explicit(&task->state, TASK_DONE, memory_order_release);
+}
+
+// With nothing queued, the waiter reaps I/O completions; it only sleeps
+// in the kernel when the task it waits for is itself an I/O operation.
+// What those tasks and completions make outlives the waiter's scratch
+// region, so it is set aside meanwhile.
+Object* scheduler_await(Task* task) {
+    Scheduler* scheduler = current_scheduler();
+    output_flush();
+    HeapScratch* scratch = heap_scratch_suspend();
+    while (atomic_load_explicit(&task->state, memory_order_acquire) != TASK_DONE) {
+        Task* other = atomic_load(&scheduler->started) ? find_task(scheduler, current_worker) : NULL;
+        if (other) {
+            run_task(other);
+        } else if (!aio_poll(task->external ? AWAIT_POLL_MS : 0)) {
+            sched_yield();
+        }
+    }
+    heap_scratch_resume(scratch);
+    return task->result;
+}
+
+void scheduler_block(int* spins) {
+    Scheduler* scheduler = current_scheduler();
+    sched_yield();
+    if (++*spins < BLOCK_SPINS) return;
+
+    *spins = 0;
+    if (atomic_load(&scheduler->started) && atomic_load(&scheduler->pending) > 0 &&
+        atomic_load(&scheduler->sleeping) == 0) {
+        add_spare_worker(scheduler);
+    }
+}
+
+int64_t scheduler_range_chunks(int64_t iterations) {
+    if (iterations <= 0) return 0;
+    return iterations < RANGE_CHUNKS ? iterations : RANGE_CHUNKS;
+}
+
+void scheduler_parallel_range(int64_t start, int64_t end, int64_t chunk_count, RangeTask task, void* context) {
+    if (end <= start || chunk_count <= 0) return;
+    Scheduler* scheduler = started_scheduler();
+
+    RangeJob job;
+    job.task = task;
+    job.context = context;
+    job.start = start;
+    job.chunk_count = chunk_count;
+    job.chunk_size = (end - start) / chunk_count;
+    job.remainder = (end - start) % chunk_count;
+    atomic_init(&job.next, 0);
+
+    // One helper per other worker at most; the caller takes chunks too, so
+    // helpers that start late simply find nothing left.
+    int helper_count = atomic_load(&scheduler->worker_count) - 1;
+    if (helper_count > chunk_count - 1) helper_count = (int)(chunk_count - 1);
+
+    Task** helpers = malloc(sizeof(Task*) * (helper_count > 0 ? helper_count : 1));
+    if (helper_count > 0) output_flush();
+    for (int i = 0; i < helper_count; i++) {
+        helpers[i] = task_new(NULL, NULL, NULL, 0, &job);
+        submit(scheduler, helpers[i]);
+    }
+
+    run_range(&job);
+
+    for (int i = 0; i < helper_count; i++) {
+        scheduler_await(helpers[i]);
+        free(helpers[i]);
+    }
+    free(helpers);
+}
+
+void scheduler_shutdown(void) {
+    Scheduler* scheduler = current_scheduler();
+    aio_drain();
+    if (!atomic_load(&scheduler->started)) return;
+
+    while (atomic_load(&scheduler->pending) > 0) {
+        Task* task = find_task(scheduler, current_worker);
+        if (task) {
+            run_task(task);
+        } else {
+            sched_yield();
+        }
+    }
+
+    pthread_mutex_lock(&scheduler->lock);
+    atomic_store(&scheduler->stopping, 1);
+    pthread_cond_broadcast(&scheduler->wake);
+    pthread_mutex_unlock(&scheduler->lock);
+
+    int worker_count = atomic_load(&scheduler->worker_count);
+    for (int i = 1; i < worker_count; i++) {
+        pthread_join(scheduler->workers[i].thread, NULL);
+    }
+    for (int i = 0; i < worker_count; i++) {
+        deque_free(&scheduler->workers[i].deque);
+    }
+    free(scheduler->workers);
+    scheduler->workers = NULL;
+    atomic_store(&scheduler->worker_count, 0);
+    atomic_store(&scheduler->started, 0);
+}
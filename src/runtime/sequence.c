@@ -0,0 +1,118 @@
+#include "sequence.h"
+#include "evaluator.h"
+#include "vm.h"
+#include <string.h>
+
+typedef struct Stage {
+    Sequence base;
+    Sequence* source;
+    Object* function;
+    int64_t remaining;   // take only
+} Stage;
+
+Object* sequence_next(Sequence* sequence) {
+    if (sequence->done) return NULL;
+
+    Object* item = sequence->next(sequence);
+    if (item == NULL) sequence->done = 1;
+    return item;
+}
+
+static Stage* stage_new(Object* (*next)(Sequence*), Sequence* source, Object* function) {
+    Stage* stage = heap_alloc(vm_heap(), sizeof(Stage));
+    stage->base.next = next;
+    stage->base.done = 0;
+    stage->source = source;
+    stage->function = function;
+    stage->remaining = 0;
+    return stage;
+}
+
+static Object* filter_next(Sequence* sequence) {
+    Stage* stage = (Stage*)sequence;
+    Object* item;
+
+    while ((item = sequence_next(stage->source)) != NULL) {
+        Object* keep = eval_apply_function(stage->function, &item, 1);
+        if (keep && keep->type == OBJ_BOOLEAN && keep->value.boolean) return item;
+    }
+    return NULL;
+}
+
+static Object* map_next(Sequence* sequence) {
+    Stage* stage = (Stage*)sequence;
+    Object* item = sequence_next(stage->source);
+    if (item == NULL) return NULL;
+
+    Object* mapped = eval_apply_function(stage->function, &item, 1);
+    return mapped ? mapped : object_new_null();
+}
+
+// Stops pulling as soon as the count is reached, so take() ends an
+// infinite generator.
+static Object* take_next(Sequence* sequence) {
+    Stage* stage = (Stage*)sequence;
+    if (stage->remaining <= 0) return NULL;
+
+    stage->remaining--;
+    return sequence_next(stage->source);
+}
+
+Sequence* sequence_filter(Sequence* source, Object* predicate) {
+    return &stage_new(filter_next, source, predicate)->base;
+}
+
+Sequence* sequence_map(Sequence* source, Object* function) {
+    return &stage_new(map_next, source, function)->base;
+}
+
+Sequence* sequence_take(Sequence* source, int64_t count) {
+    Stage* stage = stage_new(take_next, source, NULL);
+    stage->remaining = count;
+    return &stage->base;
+}
+
+typedef struct Split {
+    Sequence base;
+    const char* next;
+    const char* end;
+    const char* separator;
+    int64_t separator_length;
+    int finished;
+} Split;
+
+static const char* find_separator(const Split* split) {
+    const char* last = split->end - split->separator_length;
+    for (const char* p = split->next; p <= last; p++) {
+        p = memchr(p, split->separator[0], last - p + 1);
+        if (!p) return NULL;
+        if (memcmp(p, split->separator, split->separator_length) == 0) return p;
+    }
+    return NULL;
+}
+
+static Object* split_next(Sequence* sequence) {
+    Split* split = (Split*)sequence;
+    if (split->finished) return NULL;
+
+    const char* start = split->next;
+    const char* found = split->separator_length > 0 ? find_separator(split) : NULL;
+    if (!found) {
+        split->finished = 1;
+        return object_new_string_view(start, split->end - start);
+    }
+    split->next = found + split->separator_length;
+    return object_new_string_view(start, found - start);
+}
+
+Sequence* sequence_split(Object* string, Object* separator) {
+    Split* split = heap_alloc(vm_heap(), sizeof(Split));
+    split->base.next = split_next;
+    split->base.done = 0;
+    split->next = string_bytes(&string->value.string);
+    split->end = split->next + string->value.string.length;
+    split->separator = string_bytes(&separator->value.string);
+    split->separator_length = separator->value.string.length;
+    split->finished = 0;
+    return &split->base;
+}
@@ -0,0 +1,221 @@
+#include "vm.h"
+#include "lexer.h"
+#include "parser.h"
+#include "evaluator.h"
+#include "memo.h"
+#include "scheduler.h"
+#include "aio.h"
+#include "output.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static _Thread_local HunickVM* current_vm = NULL;
+
+static pthread_once_t default_vm_once = PTHREAD_ONCE_INIT;
+static HunickVM* default_vm = NULL;
+
+static HunickVM* vm_create(int thread_count) {
+    HunickVM* vm = calloc(1, sizeof(HunickVM));
+    heap_init(&vm->heap);
+    vm->scheduler = scheduler_new(vm, thread_count);
+    vm->aio = aio_new();
+    pthread_mutex_init(&vm->memo_lock, NULL);
+    // The analyzer's types come from the heap of the VM that is current.
+    HunickVM* previous = vm_bind(vm);
+    vm->analyzer = semantic_analyzer_new();
+    vm_bind(previous);
+    vm->globals = environment_new();
+    return vm;
+}
+
+// The command line tools keep their historical default of one worker per
+// processor; embedded VMs start with one.
+static void default_vm_create(void) {
+    default_vm = vm_create(0);
+}
+
+HunickVM* vm_current(void) {
+    if (!current_vm) {
+        pthread_once(&default_vm_once, default_vm_create);
+        current_vm = default_vm;
+    }
+    return current_vm;
+}
+
+HunickVM* vm_bind(HunickVM* vm) {
+    HunickVM* previous = current_vm;
+    current_vm = vm;
+    return previous;
+}
+
+HunickVM* hunick_vm_new(void) {
+    return vm_create(1);
+}
+
+void hunick_vm_free(HunickVM* vm) {
+    if (!vm) return;
+
+    // Workers may still be running spawned tasks that allocate.
+    scheduler_free(vm->scheduler);
+    aio_free(vm->aio);
+
+    environment_free(vm->globals);
+    for (int i = 0; i < vm->run_count; i++) {
+        flat_ast_free(vm->flats[i]);
+        program_free(vm->programs[i]);
+    }
+    free(vm->programs);
+    free(vm->flats);
+    semantic_analyzer_free(vm->analyzer);
+    memo_tables_free(vm->memo_tables);
+    pthread_mutex_destroy(&vm->memo_lock);
+    heap_destroy(&vm->heap);
+    free(vm->error);
+
+    if (current_vm == vm) current_vm = NULL;
+    free(vm);
+}
+
+void hunick_vm_set_thread_count(HunickVM* vm, int thread_count) {
+    HunickVM* previous = vm_bind(vm);
+    scheduler_set_thread_count(thread_count > 0 ? thread_count : 1);
+    vm_bind(previous);
+}
+
+void hunick_vm_set_memoize(HunickVM* vm, int enabled) {
+    vm->analyzer->memoize_pure_functions = enabled;
+}
+
+void hunick_vm_set_flat(HunickVM* vm, int enabled) {
+    vm->use_flat_ast = enabled;
+}
+
+static void error_append(HunickVM* vm, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (vm->error_length + length + 1 > vm->error_capacity) {
+        vm->error_capacity = (vm->error_length + length + 1) * 2;
+        vm->error = realloc(vm->error, vm->error_capacity);
+    }
+
+    va_start(args, format);
+    vsnprintf(vm->error + vm->error_length, length + 1, format, args);
+    va_end(args);
+    vm->error_length += length;
+}
+
+static void keep_run(HunickVM* vm, Program* program, FlatAst* flat) {
+    if (vm->run_count >= vm->run_capacity) {
+        vm->run_capacity = vm->run_capacity ? vm->run_capacity * 2 : 8;
+        vm->programs = realloc(vm->programs, sizeof(Program*) * vm->run_capacity);
+        vm->flats = realloc(vm->flats, sizeof(FlatAst*) * vm->run_capacity);
+    }
+    vm->programs[vm->run_count] = program;
+    vm->flats[vm->run_count] = flat;
+    vm->run_count++;
+}
+
+static HunickStatus vm_run(HunickVM* vm, const char* source, size_t length) {
+    vm->error_length = 0;
+    if (vm->error) vm->error[0] = '\0';
+
+    Lexer* lexer = lexer_new_range(source, 0, (int)length, 1, 0);
+    Parser* parser = parser_new(lexer);
+    Program* program = parser_parse_program(parser);
+
+    if (parser->error_count > 0) {
+        for (int i = 0; i < parser->error_count; i++) {
+            error_append(vm, "%s\n", parser->errors[i]);
+        }
+        lexer_free(lexer);
+        parser_free(parser);
+        program_free(program);
+        return HUNICK_PARSE_ERROR;
+    }
+    lexer_free(lexer);
+    parser_free(parser);
+
+    SemanticAnalyzer* analyzer = vm->analyzer;
+    int first_index = analyzer->global_scope->symbol_count;
+    int analyzed = semantic_analyze_program(analyzer, program);
+
+    while (analyzer->current_scope != analyzer->global_scope) {
+        semantic_pop_scope(analyzer);
+    }
+
+    if (!analyzed) {
+        for (SemanticError* error = analyzer->errors; error; error = error->next) {
+            error_append(vm, "Line %d:%d - %s\n", error->line, error->column, error->message);
+        }
+        semantic_clear_errors(analyzer);
+        semantic_drop_globals_from(analyzer, first_index);
+        program_free(program);
+        return HUNICK_SEMANTIC_ERROR;
+    }
+
+    FlatAst* flat = NULL;
+    if (vm->use_flat_ast) {
+        flat = flat_ast_from_program(program);
+        vm->result = flat_eval_program(flat, vm->globals);
+    } else {
+        vm->result = eval_program(program, vm->globals);
+    }
+    output_flush();
+    keep_run(vm, program, flat);
+    return HUNICK_OK;
+}
+
+HunickStatus hunick_vm_run(HunickVM* vm, const char* source, size_t length) {
+    HunickVM* previous = vm_bind(vm);
+    HunickStatus status = vm_run(vm, source, length);
+    vm_bind(previous);
+    return status;
+}
+
+static HunickValue to_value(Object* obj) {
+    HunickValue value;
+    memset(&value, 0, sizeof(value));
+    if (!obj) return value;
+
+    switch (obj->type) {
+        case OBJ_INTEGER:
+            value.type = HUNICK_INT;
+            value.integer = obj->value.integer;
+            break;
+        case OBJ_FLOAT:
+            value.type = HUNICK_FLOAT;
+            value.number = obj->value.float_val;
+            break;
+        case OBJ_BOOLEAN:
+            value.type = HUNICK_BOOL;
+            value.boolean = obj->value.boolean;
+            break;
+        case OBJ_STRING:
+            value.type = HUNICK_STRING;
+            value.string = string_chars(&obj->value.string);
+            break;
+        case OBJ_NULL:
+            break;
+        default:
+            value.type = HUNICK_OTHER;
+            break;
+    }
+    return value;
+}
+
+HunickValue hunick_vm_result(HunickVM* vm) {
+    return to_value(vm->result);
+}
+
+HunickValue hunick_vm_get(HunickVM* vm, const char* name) {
+    return to_value(environment_get(vm->globals, name));
+}
+
+const char* hunick_vm_error(HunickVM* vm) {
+    return vm->error ? vm->error : "";
+}
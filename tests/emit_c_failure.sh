@@ -0,0 +1,35 @@
+#!/bin/sh
+# --emit-c -o leaves nothing behind, and keeps an earlier file, when the
+# program cannot be translated.
+HUNICK=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+printf 'let a = [1, 2]\nlen(a)\n' > "$WORK/arrays.hk"
+
+if "$HUNICK" --emit-c -o "$WORK/new.c" "$WORK/arrays.hk" 2>/dev/null; then
+    echo "arrays were translated"
+    exit 1
+fi
+if [ -n "$(ls "$WORK" | grep '\.c')" ]; then
+    echo "a failed translation left $(ls "$WORK" | grep '\.c')"
+    exit 1
+fi
+
+echo "earlier" > "$WORK/old.c"
+"$HUNICK" --emit-c -o "$WORK/old.c" "$WORK/arrays.hk" 2>/dev/null
+if [ "$(cat "$WORK/old.c")" != "earlier" ] || [ "$(ls "$WORK" | grep -c '\.tmp$')" -ne 0 ]; then
+    echo "a failed translation replaced the earlier file"
+    exit 1
+fi
+
+# Runs writing the same file each use a temporary of their own.
+printf 'print(1 + 2)\n' > "$WORK/sum.hk"
+for i in 1 2 3 4; do
+    "$HUNICK" --emit-c -o "$WORK/sum.c" "$WORK/sum.hk" &
+done
+wait
+if ! grep -q 'int main' "$WORK/sum.c" || [ "$(ls "$WORK" | grep -c '\.tmp$')" -ne 0 ]; then
+    echo "concurrent translations left $(ls "$WORK")"
+    exit 1
+fi
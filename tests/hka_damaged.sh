@@ -0,0 +1,70 @@
+#!/bin/sh
+# The .hka that --emit-ast writes loads and prints what the source does.
+# Loading one whose words have been overwritten, one at a time, with
+# ASTBIN_NONE or with 0 never crashes: the file is rejected, or it passes
+# the checks and runs like any other program.
+HUNICK=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cat > "$WORK/program.hk" <<'HK'
+type Point { x: int, y: int }
+func pick(v: int) -> string {
+    match (v) {
+        1 -> "one"
+        2 -> "two"
+        _ -> "many"
+    }
+}
+func total(values: [int]) -> int {
+    let mut sum = 0
+    for i in 0..len(values) {
+        sum = sum + values[i]
+    }
+    sum
+}
+let mut p = Point(3, -4)
+p.y = p.y * 2
+let names = {1: "a", 2: "b"}
+func countdown(n: int) -> seq<int> {
+    let mut i = n
+    while (i > 0) {
+        yield i
+        i = i - 1
+    }
+}
+let mut n = 0
+while (n < 3) { n = n + 1 }
+for c in countdown(4) { n = n + c }
+let word = if (p.x > 0) { n |> pick } else { get(names, 1) }
+print(word)
+print(n)
+total([1, 2, 3]) + p.y
+HK
+
+"$HUNICK" --emit-ast -o "$WORK/good.hka" "$WORK/program.hk" || exit 1
+printf 'many\n13\n=> -2\n' > "$WORK/expected"
+"$HUNICK" "$WORK/good.hka" > "$WORK/output" 2>&1
+if ! cmp -s "$WORK/expected" "$WORK/output"; then
+    echo "the undamaged .hka does not run like its source:"
+    diff "$WORK/expected" "$WORK/output" | head -10
+    exit 1
+fi
+
+# The 32-byte header is checked field by field; damage what follows it.
+size=$(wc -c < "$WORK/good.hka")
+offset=32
+while [ "$offset" -lt "$size" ]; do
+    for word in '\377\377\377\377' '\0\0\0\0'; do
+        cp "$WORK/good.hka" "$WORK/program.hka"
+        printf "$word" | dd of="$WORK/program.hka" bs=1 seek="$offset" conv=notrunc 2>/dev/null
+        # A changed loop bound may run for a very long time.
+        timeout 1 "$HUNICK" "$WORK/program.hka" > /dev/null 2>&1
+        status=$?
+        if [ "$status" -ge 128 ] && [ "$status" -ne 124 ]; then
+            echo "word $offset set to $word: exit status $status"
+            exit 1
+        fi
+    done
+    offset=$((offset + 4))
+done
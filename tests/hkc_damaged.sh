@@ -0,0 +1,37 @@
+#!/bin/sh
+# A cache with any byte after its header changed is rejected and the
+# source parsed again, so the program still prints what it should.
+HUNICK=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cat > "$WORK/program.hk" <<'HK'
+func scale(x: int, by: int) -> int { x * by }
+let mut total = 0
+for i in 0..10 {
+    if (i % 2 == 0) { total = total + scale(i, 3) } else { total = total - 1 }
+}
+let name = "total"
+total
+HK
+
+expected=$("$HUNICK" "$WORK/program.hk" 2>&1)
+if [ ! -s "$WORK/program.hkc" ]; then
+    echo "no cache was written"
+    exit 1
+fi
+cp "$WORK/program.hkc" "$WORK/good.hkc"
+
+# The header is 40 bytes; damage each payload byte in turn.
+size=$(wc -c < "$WORK/good.hkc")
+offset=40
+while [ "$offset" -lt "$size" ]; do
+    cp "$WORK/good.hkc" "$WORK/program.hkc"
+    printf '\252' | dd of="$WORK/program.hkc" bs=1 seek="$offset" conv=notrunc 2>/dev/null
+    actual=$("$HUNICK" "$WORK/program.hk" 2>&1)
+    if [ "$actual" != "$expected" ]; then
+        echo "damaging byte $offset of the cache printed: $actual"
+        exit 1
+    fi
+    offset=$((offset + 1))
+done
@@ -0,0 +1,30 @@
+#!/bin/sh
+# A par for cuts its range the same way whatever --jobs is, so a float sum,
+# whose rounding depends on how the partials are grouped, prints the same
+# digits under one worker as under four.
+HUNICK=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cat > "$WORK/program.hk" <<'HK'
+let mut sum = 0.0
+let mut product = 1.0
+par for i in 0..100000 reduce(+: sum, *: product) {
+    sum = sum + 1.0 / (i + 1.0) + 0.1
+    product = product * (1.0 + 0.000001 * (i % 7))
+}
+print((sum - 10012.0) * 1000000000.0)
+print((product - 1.0) * 1000000000.0)
+HK
+
+for evaluator in "" --flat; do
+    one=$("$HUNICK" --no-cache $evaluator --jobs 1 "$WORK/program.hk" 2>&1)
+    four=$("$HUNICK" --no-cache $evaluator --jobs 4 "$WORK/program.hk" 2>&1)
+    if [ "$one" != "$four" ]; then
+        echo "--jobs 1 and --jobs 4 disagree${evaluator:+ under $evaluator}:"
+        echo "$one"
+        echo "$four"
+        exit 1
+    fi
+done
+echo "$one"
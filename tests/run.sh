@@ -0,0 +1,86 @@
+#!/bin/sh
+# The test suite, run by `make test` from the top of the tree.
+#
+#   tests/programs/*.hk  run under both evaluators; what each prints must
+#                        equal the .out file beside it
+#   tests/emit_c/*.hk    the same, and the C that --emit-c makes of them,
+#                        compiled and run, must print it too
+#   examples/*.hk        the C made of each must print what the
+#                        interpreter does
+#   tests/*.sh           standalone checks, given the interpreter's path
+#
+# Prints one line per failure and a count at the end; exits 1 if anything
+# failed.
+
+HUNICK=${HUNICK:-bin/hunick}
+CC=${CC:-cc}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+passed=0
+failed=0
+
+pass() {
+    passed=$((passed + 1))
+}
+
+fail() {
+    failed=$((failed + 1))
+    echo "FAIL $1"
+}
+
+# check NAME EXPECTED-FILE ACTUAL-FILE
+check() {
+    if cmp -s "$2" "$3"; then
+        pass
+    else
+        fail "$1"
+        diff "$2" "$3" | head -10
+    fi
+}
+
+for test in tests/programs/*.hk tests/emit_c/*.hk; do
+    [ -e "$test" ] || continue
+    expected=${test%.hk}.out
+    "$HUNICK" --no-cache "$test" > "$WORK/tree" 2>&1
+    check "$test (tree)" "$expected" "$WORK/tree"
+    "$HUNICK" --no-cache --flat "$test" > "$WORK/flat" 2>&1
+    check "$test (flat)" "$expected" "$WORK/flat"
+done
+
+for test in tests/emit_c/*.hk; do
+    [ -e "$test" ] || continue
+    if "$HUNICK" --emit-c -o "$WORK/program.c" "$test" &&
+       $CC -Wall -O2 -o "$WORK/program" "$WORK/program.c" -lm; then
+        "$WORK/program" > "$WORK/c" 2>&1
+        check "$test (emit-c)" "${test%.hk}.out" "$WORK/c"
+    else
+        fail "$test (emit-c build)"
+    fi
+done
+
+for example in examples/*.hk; do
+    [ -e "$example" ] || continue
+    "$HUNICK" --no-cache "$example" > "$WORK/expected" 2>&1
+    if "$HUNICK" --emit-c -o "$WORK/program.c" "$example" &&
+       $CC -Wall -O2 -o "$WORK/program" "$WORK/program.c" -lm; then
+        "$WORK/program" > "$WORK/c" 2>&1
+        check "$example (emit-c)" "$WORK/expected" "$WORK/c"
+    else
+        fail "$example (emit-c build)"
+    fi
+done
+
+for test in tests/*.sh; do
+    [ "$test" = tests/run.sh ] && continue
+    [ -e "$test" ] || continue
+    if sh "$test" "$HUNICK" > "$WORK/script" 2>&1; then
+        pass
+    else
+        fail "$test"
+        head -10 "$WORK/script"
+    fi
+done
+
+echo "$passed passed, $failed failed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,108 @@
+#!/bin/sh
+# Every vector kernel gives what the scalar one does at each level the
+# processor supports, for every length up to a few vectors (so each way of
+# splitting a tail off is taken), from unaligned starts, and writing over
+# an input. The elements are small whole numbers, so float sums are exact
+# whatever order the partial sums are added in.
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+CC=${CC:-cc}
+
+cat > "$WORK/levels.c" <<'C'
+#include <stdio.h>
+#include <string.h>
+#include "simd.h"
+
+#define MAX_LENGTH 70
+#define OFFSETS 3
+
+static double fa[MAX_LENGTH + OFFSETS], fb[MAX_LENGTH + OFFSETS];
+static int64_t ia[MAX_LENGTH + OFFSETS], ib[MAX_LENGTH + OFFSETS];
+static int failures;
+
+static void expect(int same, const char* kernel, SimdLevel level, int64_t n, int offset) {
+    if (same) return;
+    if (failures++ < 10) {
+        printf("%s differs at %s, n = %lld, offset %d\n", kernel, simd_level_name(level), (long long)n, offset);
+    }
+}
+
+// All the kernels at `level` against the scalar ones over n elements.
+static void check(SimdLevel level, int64_t n, int offset) {
+    const double* a = fa + offset;
+    const double* b = fb + offset;
+    const int64_t* x = ia + offset;
+    const int64_t* y = ib + offset;
+    double fout[MAX_LENGTH], fwant[MAX_LENGTH];
+    int64_t iout[MAX_LENGTH], iwant[MAX_LENGTH];
+
+    simd_set_level(SIMD_SCALAR);
+    double sum_f = simd_sum_f64(a, n), dot_f = simd_dot_f64(a, b, n);
+    int64_t sum_i = simd_sum_i64(x, n), dot_i = simd_dot_i64(x, y, n);
+    simd_add_f64(fwant, a, b, n);
+    simd_add_i64(iwant, x, y, n);
+    simd_set_level(level);
+    expect(simd_sum_f64(a, n) == sum_f, "sum_f64", level, n, offset);
+    expect(simd_dot_f64(a, b, n) == dot_f, "dot_f64", level, n, offset);
+    expect(simd_sum_i64(x, n) == sum_i, "sum_i64", level, n, offset);
+    expect(simd_dot_i64(x, y, n) == dot_i, "dot_i64", level, n, offset);
+    simd_add_f64(fout, a, b, n);
+    expect(memcmp(fout, fwant, n * sizeof(double)) == 0, "add_f64", level, n, offset);
+    simd_add_i64(iout, x, y, n);
+    expect(memcmp(iout, iwant, n * sizeof(int64_t)) == 0, "add_i64", level, n, offset);
+
+    simd_set_level(SIMD_SCALAR);
+    simd_scale_f64(fwant, a, -3.0, n);
+    simd_scale_i64(iwant, x, -3, n);
+    simd_set_level(level);
+    memcpy(fout, a, n * sizeof(double));
+    simd_scale_f64(fout, fout, -3.0, n);
+    expect(memcmp(fout, fwant, n * sizeof(double)) == 0, "scale_f64 in place", level, n, offset);
+    memcpy(iout, x, n * sizeof(int64_t));
+    simd_scale_i64(iout, iout, -3, n);
+    expect(memcmp(iout, iwant, n * sizeof(int64_t)) == 0, "scale_i64 in place", level, n, offset);
+
+    if (n == 0) return;
+    simd_set_level(SIMD_SCALAR);
+    double min_f = simd_min_f64(a, n), max_f = simd_max_f64(a, n);
+    int64_t min_i = simd_min_i64(x, n), max_i = simd_max_i64(x, n);
+    int64_t argmax_f = simd_argmax_f64(a, n), argmax_i = simd_argmax_i64(x, n);
+    simd_set_level(level);
+    expect(simd_min_f64(a, n) == min_f, "min_f64", level, n, offset);
+    expect(simd_max_f64(a, n) == max_f, "max_f64", level, n, offset);
+    expect(simd_min_i64(x, n) == min_i, "min_i64", level, n, offset);
+    expect(simd_max_i64(x, n) == max_i, "max_i64", level, n, offset);
+    expect(simd_argmax_f64(a, n) == argmax_f, "argmax_f64", level, n, offset);
+    expect(simd_argmax_i64(x, n) == argmax_i, "argmax_i64", level, n, offset);
+}
+
+int main(void) {
+    // Few distinct values, so the largest one repeats and argmax has to
+    // pick the first of them.
+    unsigned seed = 12345;
+    for (int i = 0; i < MAX_LENGTH + OFFSETS; i++) {
+        seed = seed * 1103515245 + 12345;
+        ia[i] = (int64_t)(seed >> 16) % 41 - 20;
+        seed = seed * 1103515245 + 12345;
+        ib[i] = (int64_t)(seed >> 16) % 41 - 20;
+        fa[i] = ia[i] * 0.5;
+        fb[i] = ib[i] * 0.25;
+    }
+
+    SimdLevel levels[] = { SIMD_SSE2, SIMD_AVX2, SIMD_AVX512 };
+    SimdLevel last = SIMD_SCALAR;
+    for (int l = 0; l < 3; l++) {
+        SimdLevel level = simd_set_level(levels[l]);
+        if (level == last) continue;
+        last = level;
+        for (int64_t n = 0; n <= MAX_LENGTH; n++) {
+            for (int offset = 0; offset < OFFSETS; offset++) check(level, n, offset);
+        }
+        printf("%s\n", simd_level_name(level));
+    }
+    return failures > 0;
+}
+C
+
+$CC -O2 -Wall -Isrc/include -o "$WORK/levels" "$WORK/levels.c" src/core/simd.c || exit 1
+"$WORK/levels"
@@ -0,0 +1,70 @@
+#!/bin/sh
+# What a task prints comes out after what was printed before its spawn and
+# before what is printed after its await, even with the task on another
+# worker; flush() also writes out what other workers have buffered.
+HUNICK=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cat > "$WORK/program.hk" <<'HK'
+func busy(n: int) -> int {
+    let mut total = 0
+    for i in 0..n { total = total + i % 7 }
+    total
+}
+func report(n: int) -> int {
+    print(n * 10 + 1)
+    busy(n * 1000)
+}
+for round in 0..20 {
+    print(round * 10)
+    let task = spawn report(round)
+    busy(2000)
+    await task
+    print(round * 10 + 2)
+}
+HK
+
+round=0
+while [ "$round" -lt 20 ]; do
+    echo $((round * 10))
+    echo $((round * 10 + 1))
+    echo $((round * 10 + 2))
+    round=$((round + 1))
+done > "$WORK/expected"
+for test in 1 2 3 4 5; do
+    "$HUNICK" --no-cache --jobs 4 "$WORK/program.hk" > "$WORK/output" 2>&1
+    if ! cmp -s "$WORK/expected" "$WORK/output"; then
+        echo "task output out of order:"
+        diff "$WORK/expected" "$WORK/output" | head -10
+        exit 1
+    fi
+done
+
+# The task is still running, blocked in recv, when flush() is called.
+cat > "$WORK/flush.hk" <<'HK'
+func speak(ready: chan<int>, done: chan<int>) -> int {
+    print(1)
+    send(ready, 1)
+    recv(done)
+}
+let ready: chan<int> = channel(1)
+let done: chan<int> = channel(1)
+let task = spawn speak(ready, done)
+recv(ready)
+flush()
+print(2)
+flush()
+send(done, 3)
+await task
+HK
+
+printf '1\n2\n=> 3\n' > "$WORK/expected"
+for test in 1 2 3 4 5; do
+    "$HUNICK" --no-cache --jobs 4 "$WORK/flush.hk" > "$WORK/output" 2>&1
+    if ! cmp -s "$WORK/expected" "$WORK/output"; then
+        echo "flush() left another worker's output behind:"
+        diff "$WORK/expected" "$WORK/output" | head -10
+        exit 1
+    fi
+done
@@ -0,0 +1,59 @@
+#!/bin/sh
+# stdin_lines() reuses one buffer, so lines that cross a refill, and one
+# longer than the buffer, must still come out whole and unchanged. lines()
+# of a path that does not exist is an error, not an empty sequence.
+HUNICK=$1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cat > "$WORK/program.hk" <<'HK'
+let mut count = 0
+let mut total = 0
+let mut first = ""
+for line in stdin_lines() {
+    if (count == 0) { first = line }
+    count = count + 1
+    total = total + len(line)
+}
+print(first)
+print(count)
+print(total)
+HK
+
+{
+    printf 'first line\r\n'
+    seq 1 300000
+    head -c 3000000 /dev/zero | tr '\0' x
+    printf '\nlast'
+} > "$WORK/input"
+expected="first line
+300003
+4688909"
+for evaluator in "" --flat; do
+    actual=$("$HUNICK" --no-cache $evaluator "$WORK/program.hk" < "$WORK/input" 2>&1)
+    if [ "$actual" != "$expected" ]; then
+        echo "wrong lines${evaluator:+ under $evaluator}:"
+        echo "$actual"
+        exit 1
+    fi
+    actual=$(cat "$WORK/input" | "$HUNICK" --no-cache $evaluator "$WORK/program.hk" 2>&1)
+    if [ "$actual" != "$expected" ]; then
+        echo "wrong lines from a pipe${evaluator:+ under $evaluator}:"
+        echo "$actual"
+        exit 1
+    fi
+done
+
+cat > "$WORK/missing.hk" <<'HK'
+for line in lines("does/not/exist") { print(line) }
+print("after")
+HK
+for evaluator in "" --flat; do
+    actual=$("$HUNICK" --no-cache $evaluator "$WORK/missing.hk" 2>&1)
+    status=$?
+    if [ "$status" -ne 74 ] || [ "$actual" != 'Could not open file "does/not/exist".' ]; then
+        echo "lines() of a missing path${evaluator:+ under $evaluator} exited $status:"
+        echo "$actual"
+        exit 1
+    fi
+done